@@ -0,0 +1,545 @@
+//
+// Benchmark Program for the pdf2cairo renderer.
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pdfops-private.h"
+#include "cairo-private.h"
+
+int g_verbose = 0;
+
+//
+// 'bench_now()' - Get a monotonic time in seconds
+//
+
+static double				  // O - Time in seconds
+bench_now(void)
+{
+  struct timespec ts;			// Current time
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+//
+// 'bench_report()' - Print a benchmark result
+//
+
+static void
+bench_report(const char *title,		// I - Benchmark name
+	     double     elapsed,	// I - Elapsed time in seconds
+	     size_t     count,		// I - Number of operations
+	     const char *unit)		// I - Name of an operation
+{
+  printf("%-40s %10.1f ns/%s  %12.0f %s/s\n", title,
+         elapsed * 1e9 / count, unit, count / elapsed, unit);
+}
+
+//
+// 'bench_glyph_names()' - Time glyph name lookups for /Differences arrays
+//
+
+static void
+bench_glyph_names(void)
+{
+  static const char * const names[] =	// Typical /Differences names
+  {
+    "A", "Aacute", "B", "C", "Ccedilla", "Delta", "E", "Eacute", "Euro",
+    "O", "Omega", "Scaron", "T", "Zcaron", "a", "aacute", "b", "bullet",
+    "c", "comma", "d", "e", "eacute", "emdash", "endash", "f", "fi", "fl",
+    "g", "h", "hyphen", "i", "j", "k", "l", "m", "n", "o", "p", "period",
+    "q", "quotedblleft", "quotedblright", "quoteright", "r", "s", "space",
+    "t", "u", "v", "w", "x", "y", "z", "zero", "one", "two", "uni2044",
+    "nosuchglyph"
+  };
+  const size_t	num_names = sizeof(names) / sizeof(names[0]);
+  const size_t	iterations = 200000;	// Number of passes over names
+  volatile int	sink = 0;		// Keep lookups from being optimized out
+  double	start;			// Start time
+
+  start = bench_now();
+  for (size_t i = 0; i < iterations; i ++)
+    for (size_t j = 0; j < num_names; j ++)
+      sink += glyph_name_to_unicode(names[j]);
+
+  bench_report("glyph_name_to_unicode", bench_now() - start, iterations * num_names, "lookup");
+  (void)sink;
+}
+
+//
+// 'bench_text_extraction()' - Time text extraction against rendering
+//
+
+static void
+bench_text_extraction(const char *filename)// I - PDF file
+{
+  pdfrip_doc_t	*doc;			// PDF document
+  const int	iterations = 20;	// Passes over the document
+  FILE		*null_fp;		// Text output
+  double	start;			// Start time
+
+  if ((doc = openPDFfile((char *)filename)) == NULL)
+  {
+    printf("%-40s skipped, unable to open %s\n", "text extraction", filename);
+    return;
+  }
+
+  if ((null_fp = fopen("/dev/null", "w")) == NULL)
+  {
+    freePDFdoc(doc);
+    return;
+  }
+
+  for (int text_mode = 0; text_mode < 2; text_mode ++)
+  {
+    start = bench_now();
+
+    for (int i = 0; i < iterations; i ++)
+    {
+      for (size_t cur_page = 0; cur_page < doc->num_pages; cur_page ++)
+      {
+        pdfrip_page_t *page = getPageData(doc, cur_page);
+        p2c_device_t *dev = text_mode ? device_create_text(page, 150) : device_create(page, 150);
+
+        if (dev)
+        {
+          dev->font_dict = pdfioDictGetDict(page->resources_dict, "Font");
+          if (getPageFonts(dev))
+            process_content_stream(dev, page);
+
+          if (text_mode)
+            device_write_text(dev, null_fp, P2C_TEXT_JSON, cur_page + 1);
+          else
+            device_save_to_png(dev, "/dev/null");
+
+          device_destroy(dev);
+        }
+
+        freePageData(page);
+      }
+    }
+
+    bench_report(text_mode ? "extract text (150 DPI boxes)" : "render PNG (150 DPI)", bench_now() - start, iterations * doc->num_pages, "page");
+  }
+
+  fclose(null_fp);
+  freePDFdoc(doc);
+}
+
+//
+// 'bench_glyph_cache()' - Time page rendering with and without the glyph mask cache
+//
+
+static void
+bench_glyph_cache(const char *filename)	// I - PDF file
+{
+  pdfrip_doc_t	*doc;			// PDF document
+  const int	iterations = 20;	// Passes over the document
+  double	start;			// Start time
+  size_t	count, bytes, hits, misses;
+
+  if ((doc = openPDFfile((char *)filename)) == NULL)
+  {
+    printf("%-40s skipped, unable to open %s\n", "glyph cache", filename);
+    return;
+  }
+
+  for (int cached = 0; cached < 2; cached ++)
+  {
+    p2c_glyph_cache_clear();
+    p2c_glyph_cache_set_budget(cached ? P2C_GLYPH_CACHE_BUDGET : 0);
+
+    start = bench_now();
+
+    for (int i = 0; i < iterations; i ++)
+    {
+      for (size_t cur_page = 0; cur_page < doc->num_pages; cur_page ++)
+      {
+        pdfrip_page_t *page = getPageData(doc, cur_page);
+        p2c_device_t *dev = device_create(page, 150);
+
+        if (dev)
+        {
+          dev->font_dict = pdfioDictGetDict(page->resources_dict, "Font");
+          if (getPageFonts(dev))
+            process_content_stream(dev, page);
+
+          device_destroy(dev);
+        }
+
+        freePageData(page);
+      }
+    }
+
+    bench_report(cached ? "render page, glyph cache (150 DPI)" : "render page, no glyph cache (150 DPI)", bench_now() - start, iterations * doc->num_pages, "page");
+  }
+
+  p2c_glyph_cache_stats(&count, &bytes, &hits, &misses);
+  printf("%-40s %10zu glyphs %10zu bytes  %zu hits, %zu misses\n", "glyph cache", count, bytes, hits, misses);
+
+  p2c_glyph_cache_clear();
+  freePDFdoc(doc);
+}
+
+//
+// 'bench_image_convert()' - Time the image row conversion kernels
+//
+
+static void
+bench_image_convert(void)
+{
+  static const char * const kernels[PDFRIP_CONVERT_MAX] =
+  {					// Kernel names
+    "gray1", "gray8", "rgb8", "cmyk8", "rgb16"
+  };
+  static const char * const simds[] =	// Instruction set names
+  {
+    "scalar", "sse2", "avx2"
+  };
+  const size_t	width = 4096;		// Pixels per row
+  const int	iterations = 4000;	// Rows converted
+  uint8_t	*src,			// Samples
+		gray[2] = { 0, 255 };	// 1-bit gray levels
+  uint32_t	*dst;			// Pixels
+  char		title[64];		// Benchmark name
+  double	start;			// Start time
+
+  src = malloc(6 * width);
+  dst = malloc(width * sizeof(uint32_t));
+
+  if (!src || !dst)
+  {
+    free(src);
+    free(dst);
+    return;
+  }
+
+  for (size_t i = 0; i < 6 * width; i ++)
+    src[i] = (uint8_t)(i * 31 + (i >> 7));
+
+  for (int kernel = 0; kernel < PDFRIP_CONVERT_MAX; kernel ++)
+  {
+    for (int simd = PDFRIP_SIMD_NONE; simd <= PDFRIP_SIMD_AVX2; simd ++)
+    {
+      pdfrip_convert_cb_t convert = image_convert_func((pdfrip_convert_t)kernel, (pdfrip_simd_t)simd);
+					// Kernel
+
+      if (!convert)
+        continue;
+
+      start = bench_now();
+      for (int i = 0; i < iterations; i ++)
+        (convert)(src, dst, width, gray);
+
+      snprintf(title, sizeof(title), "convert %s (%s)", kernels[kernel], simds[simd]);
+      bench_report(title, bench_now() - start, iterations * width, "pixel");
+    }
+  }
+
+  // 1-bit stencil and bilevel rows to A8 coverage, written over the pixels
+  for (int simd = PDFRIP_SIMD_NONE; simd <= PDFRIP_SIMD_AVX2; simd ++)
+  {
+    pdfrip_expand_cb_t expand = image_expand_func((pdfrip_simd_t)simd);
+					// Kernel
+
+    if (!expand)
+      continue;
+
+    start = bench_now();
+    for (int i = 0; i < iterations; i ++)
+      (expand)(src, (uint8_t *)dst, width, gray);
+
+    snprintf(title, sizeof(title), "expand mask1 (%s)", simds[simd]);
+    bench_report(title, bench_now() - start, iterations * width, "pixel");
+  }
+
+  free(src);
+  free(dst);
+}
+
+//
+// 'bench_image_shrink()' - Time the box filter for oversampled images
+//
+
+static void
+bench_image_shrink(void)
+{
+  static const char * const simds[] =	// Instruction set names
+  {
+    "scalar", "sse2", "avx2"
+  };
+  const int	width = 2400,		// Image size, a letter page at 300 DPI
+		height = 3000,
+		iterations = 10;	// Reductions per factor
+  cairo_surface_t *image;		// Image to reduce
+  uint8_t	*data;			// Image pixels
+  char		title[64];		// Benchmark name
+  double	start;			// Start time
+
+  image = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+  if (cairo_surface_status(image) != CAIRO_STATUS_SUCCESS)
+    return;
+
+  data = cairo_image_surface_get_data(image);
+  for (size_t i = 0; i < (size_t)cairo_image_surface_get_stride(image) * height; i ++)
+    data[i] = (uint8_t)(i * 31 + (i >> 7));
+  cairo_surface_mark_dirty(image);
+
+  for (int factor = 2; factor <= 8; factor *= 2)
+  {
+    for (int simd = PDFRIP_SIMD_NONE; simd <= PDFRIP_SIMD_AVX2 && simd <= image_simd_level(); simd ++)
+    {
+      start = bench_now();
+      for (int i = 0; i < iterations; i ++)
+        cairo_surface_destroy(image_shrink(image, factor, factor, (pdfrip_simd_t)simd));
+
+      snprintf(title, sizeof(title), "shrink %dx%d (%s)", factor, factor, simds[simd]);
+      bench_report(title, bench_now() - start, (size_t)iterations * width * height, "pixel");
+    }
+  }
+
+  cairo_surface_destroy(image);
+}
+
+//
+// CCITT fax data held in memory
+//
+
+#define BENCH_FAX_IMAGES	8	// Most fax images read from the corpus
+#define BENCH_FAX_PAGE_ROWS	2200	// Rows in a fine mode letter page
+
+typedef struct bench_fax_s
+{
+  pdfrip_ccitt_params_t	params;		// Decoding parameters
+  uint8_t		*data;		// Encoded data
+  size_t		length,		// Length of data
+			pos;		// Read position
+} bench_fax_t;
+
+//
+// 'bench_fax_read()' - Read fax data from memory
+//
+
+static ssize_t				  // O - Bytes read
+bench_fax_read(void    *data,		// I - Fax data
+	       uint8_t *buffer,		// I - Buffer
+	       size_t  bytes)		// I - Size of buffer
+{
+  bench_fax_t	*fax = (bench_fax_t *)data;
+					// Fax data
+
+  if (bytes > fax->length - fax->pos)
+    bytes = fax->length - fax->pos;
+
+  memcpy(buffer, fax->data + fax->pos, bytes);
+  fax->pos += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+//
+// 'bench_ccitt()' - Time CCITT fax decoding of the synthetic fax corpus
+//
+// The /Fax images of CCITTFax.pdf are read into memory first, so only the
+// decoder is timed.  Pages are counted as 2200 rows of any width.
+//
+
+static void
+bench_ccitt(const char *filename)	// I - PDF file
+{
+  pdfrip_doc_t	*doc;			// PDF document
+  bench_fax_t	faxes[BENCH_FAX_IMAGES];// Fax images
+  size_t	num_faxes = 0,		// Number of fax images
+		total_rows = 0;		// Rows in all images
+  const int	iterations = 50;	// Passes over the corpus
+  uint8_t	row[4096];		// Decoded row
+  char		title[64];		// Benchmark name
+  double	start,			// Start time
+		elapsed,		// Time for one image
+		total = 0.0;		// Time for all images
+
+  if ((doc = openPDFfile((char *)filename)) == NULL)
+  {
+    printf("%-40s skipped, unable to open %s\n", "ccitt decode", filename);
+    return;
+  }
+
+  for (size_t i = 0; i < doc->num_pages && num_faxes < BENCH_FAX_IMAGES; i ++)
+  {
+    pdfrip_page_t	*page = getPageData(doc, i);
+    pdfio_obj_t		*obj = page ? pdfioDictGetObj(pdfioDictGetDict(page->resources_dict, "XObject"), "Fax") : NULL;
+    pdfio_stream_t	*st = obj ? pdfioObjOpenStream(obj, false) : NULL;
+    bench_fax_t		*fax = faxes + num_faxes;
+    size_t		alloc = 0;	// Allocated size of data
+    ssize_t		bytes;		// Bytes read
+
+    if (st)
+    {
+      memset(fax, 0, sizeof(bench_fax_t));
+      ccitt_get_params(pdfioObjGetDict(obj), &fax->params);
+
+      for (;;)
+      {
+        if (fax->length == alloc)
+        {
+          uint8_t *temp = realloc(fax->data, alloc + 65536);
+
+          if (!temp)
+            break;
+
+          fax->data = temp;
+          alloc     += 65536;
+        }
+
+        if ((bytes = pdfioStreamRead(st, fax->data + fax->length, alloc - fax->length)) <= 0)
+          break;
+
+        fax->length += (size_t)bytes;
+      }
+
+      pdfioStreamClose(st);
+
+      if (fax->length > 0 && fax->params.columns <= 8 * (int)sizeof(row))
+        num_faxes ++;
+      else
+        free(fax->data);
+    }
+
+    freePageData(page);
+  }
+
+  freePDFdoc(doc);
+
+  for (size_t i = 0; i < num_faxes; i ++)
+  {
+    bench_fax_t	*fax = faxes + i;	// Fax image
+    size_t	rows = 0;		// Rows decoded
+
+    start = bench_now();
+
+    for (int j = 0; j < iterations; j ++)
+    {
+      pdfrip_ccitt_t *ccitt;		// Decoder
+
+      fax->pos = 0;
+      if ((ccitt = ccitt_open(&fax->params, bench_fax_read, fax)) == NULL)
+        break;
+
+      while (ccitt_read_row(ccitt, row))
+        rows ++;
+
+      ccitt_close(ccitt);
+    }
+
+    elapsed    = bench_now() - start;
+    total      += elapsed;
+    total_rows += rows;
+
+    snprintf(title, sizeof(title), "ccitt decode K=%d %dx%d", fax->params.k, fax->params.columns, fax->params.rows);
+    bench_report(title, elapsed, rows ? rows : 1, "row");
+
+    free(fax->data);
+  }
+
+  if (total_rows >= BENCH_FAX_PAGE_ROWS)
+    bench_report("ccitt decode, fax corpus", total, total_rows / BENCH_FAX_PAGE_ROWS, "page");
+}
+
+//
+// 'bench_jpx()' - Time JPEG 2000 decoding at full and reduced resolution
+//
+// Im0 of JPXImages.pdf is decoded whole at each scale and over a quarter
+// of its area, as a page drawing it in strips would.
+//
+
+static void
+bench_jpx(const char *filename)		// I - PDF file
+{
+#ifdef HAVE_OPENJPEG
+  pdfrip_doc_t	*doc;			// PDF document
+  pdfrip_page_t	*page;			// First page
+  pdfio_obj_t	*obj;			// Image object
+  static const pdfio_rect_t area = { 0.25, 0.25, 0.75, 0.75 };
+					// Middle of the image
+  static const int scales[] = { 1, 2, 4, 8, 0 };
+					// Reductions, 0 for the area
+  const int	iterations = 20;	// Decodes per scale
+  static uint8_t row[PDFRIP_IMAGE_MAX_WIDTH * 4];
+					// Decoded row
+  char		title[64];		// Benchmark name
+  double	start;			// Start time
+
+  if ((doc = openPDFfile((char *)filename)) == NULL)
+  {
+    printf("%-40s skipped, unable to open %s\n", "jpx decode", filename);
+    return;
+  }
+
+  page = getPageData(doc, 0);
+  obj  = page ? pdfioDictGetObj(pdfioDictGetDict(page->resources_dict, "XObject"), "Im0") : NULL;
+
+  for (size_t i = 0; obj && i < sizeof(scales) / sizeof(scales[0]); i ++)
+  {
+    pdfrip_jpx_t	*jpx;		// Decoder
+    pdfrip_jpx_info_t	info;		// Decoded size
+
+    start = bench_now();
+
+    for (int j = 0; j < iterations; j ++)
+    {
+      if ((jpx = jpx_open(obj, 3, scales[i] ? scales[i] : 1, scales[i] ? NULL : &area, &info)) == NULL)
+        break;
+
+      for (int y = 0; y < info.height && jpx_read_row(jpx, row); y ++);
+
+      jpx_close(jpx);
+    }
+
+    if (scales[i])
+      snprintf(title, sizeof(title), "jpx decode 640x400 at 1/%d", scales[i]);
+    else
+      snprintf(title, sizeof(title), "jpx decode 640x400 middle quarter");
+
+    bench_report(title, bench_now() - start, iterations, "image");
+  }
+
+  freePageData(page);
+  freePDFdoc(doc);
+#else
+  printf("%-40s skipped, no OpenJPEG\n", "jpx decode");
+  (void)filename;
+#endif // HAVE_OPENJPEG
+}
+
+//
+// 'main()' - Run all benchmarks
+//
+// Usage: benchpdf2cairo [file.pdf]
+//
+
+int					  // O - Exit status
+main(int  argc,				// I - Number of command-line args
+     char *argv[])			// I - Command-line arguments
+{
+  const char *filename = argc > 1 ? argv[1] : "testfiles/input/full_pdf/test_file_1pg.pdf";
+
+  puts(" --- Running PDF2Cairo Benchmarks --- ");
+
+  bench_glyph_names();
+  bench_image_convert();
+  bench_image_shrink();
+  bench_ccitt("testfiles/input/xobject/CCITTFax.pdf");
+  bench_jpx("testfiles/input/xobject/JPXImages.pdf");
+  bench_text_extraction(filename);
+  bench_glyph_cache(filename);
+
+  return (0);
+}
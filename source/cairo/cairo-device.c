@@ -7,50 +7,32 @@
 //
 
 #include "cairo-private.h"
+#include "../pdf/pdfops-private.h"
 
 // --- Device LifeCycle Functions ---
 
 //
-// 'device_create()' - Initializes the Cairo rendering environment. 
-// 		       Sets up the pixel surface, coordinate system, and 
-// 		       initial graphics state
+// 'device_init()' - Set up the initial graphics state of a page.
+//
+// The base CTM maps PDF user space (y-up, 72 units per inch) onto a
+// y-down device space at the requested resolution.
 //
 
-p2c_device_t*				  
-device_create(pdfrip_page_t *page, 	
-	      int dpi)			
+void
+device_init(p2c_device_t *dev,		// I - Device
+	    pdfrip_page_t *page,	// I - Page
+	    int dpi)			// I - Resolution
 {
-  p2c_device_t *dev = calloc(1, sizeof(p2c_device_t));
-  if (!dev)
-  {
-    fprintf(stderr, "ERROR: Could not allocate memory for Cairo device.\n");
-    return (NULL);
-  }
-
-  // Calculate scale factor based on target DPI (PDF base is 72 DPI)
   double scale = dpi / 72.0;
-  double width = (page->mediaBox.x2 - page->mediaBox.x1) * scale;
-  double height = (page->mediaBox.y2 - page->mediaBox.y1) * scale;
 
-  if (g_verbose)
-    printf("DEBUG: Creating Cairo surface: %.2fx%.2f pixels (scale: %.2f)\n", width, height, scale);
+  dev->width = (page->mediaBox.x2 - page->mediaBox.x1) * scale;
+  dev->height = (page->mediaBox.y2 - page->mediaBox.y1) * scale;
 
   dev->num_fonts = 0;
   
+  dev->doc = page->parent_doc;
   dev->page_obj = page->object; 
 
-  dev->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, (int)width, (int)height);
-  if (cairo_surface_status(dev->surface) != CAIRO_STATUS_SUCCESS)
-  {
-    free(dev);
-    return NULL;
-  }
-
-  dev->cr = cairo_create(dev->surface);
-  cairo_scale(dev->cr, scale, scale);
-  cairo_translate(dev->cr, 0, page->mediaBox.y2 - page->mediaBox.y1); 
-  cairo_scale(dev->cr, 1.0, -1.0); 
-
   dev->gstack[0] = (graphics_state_t)
   {
     .fill_rgb = {0.0, 0.0, 0.0},
@@ -61,16 +43,48 @@ device_create(pdfrip_page_t *page,
     .text_leading = 0.0,
     .font_size = 1.0,
     .text_rendering_mode = 0,
+    .horiz_scale = 1.0,
     .fill_colorspace = CS_DEVICE_GRAY,
     .stroke_colorspace = CS_DEVICE_GRAY
   };
 
+  cairo_matrix_init(&dev->gstack[0].ctm, scale, 0.0, 0.0, -scale, 0.0, dev->height);
   cairo_matrix_init_identity(&dev->gstack[0].text_matrix);
   cairo_matrix_init_identity(&dev->gstack[0].text_line_matrix);
   dev->gstack_ptr = 0;
+}
 
-  for (int i=0; i<256; i++) 
-    dev->gstack[0].encoding[i] = i;
+//
+// 'device_create()' - Initializes the Cairo rendering environment. 
+// 		       Sets up the pixel surface, coordinate system, and 
+// 		       initial graphics state
+//
+
+p2c_device_t*				  
+device_create(pdfrip_page_t *page, 	
+	      int dpi)			
+{
+  p2c_device_t *dev = calloc(1, sizeof(p2c_device_t));
+  if (!dev)
+  {
+    fprintf(stderr, "ERROR: Could not allocate memory for Cairo device.\n");
+    return (NULL);
+  }
+
+  device_init(dev, page, dpi);
+
+  if (g_verbose)
+    printf("DEBUG: Creating Cairo surface: %.2fx%.2f pixels (scale: %.2f)\n", dev->width, dev->height, dpi / 72.0);
+
+  dev->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, (int)dev->width, (int)dev->height);
+  if (cairo_surface_status(dev->surface) != CAIRO_STATUS_SUCCESS)
+  {
+    free(dev);
+    return NULL;
+  }
+
+  dev->cr = cairo_create(dev->surface);
+  cairo_set_matrix(dev->cr, &dev->gstack[0].ctm);
 
   cairo_set_source_rgb(dev->cr, 1.0, 1.0, 1.0);
   cairo_paint(dev->cr);
@@ -88,6 +102,9 @@ p2c_font_destroy(p2c_font_t *font)
   if (!font)
     return;
 
+  p2c_outline_cache_clear(&font->outlines);
+  p2c_type3_clear(font);
+
   if (font->cairo_face)
   {
     cairo_font_face_destroy(font->cairo_face);
@@ -96,17 +113,22 @@ p2c_font_destroy(p2c_font_t *font)
   }
   else if (font->ft_face)
   {
-    FT_Done_Face(font->ft_face);
+    p2c_font_done_face(font->ft_face);
     font->ft_face = NULL;
   }
 
-  free(font->data);
   free(font->widths);
+  free(font->cid_to_gid);
+  free(font->cid_widths);
+  free(font->gid_to_unicode);
   free(font);
 }
 
 //
-// 'device_clear_fonts()' - free the font structures
+// 'device_clear_fonts()' - forget the fonts of the page resources
+//
+// The fonts themselves belong to the document and are freed by
+// freeDocFonts().
 //
 
 void
@@ -115,19 +137,103 @@ device_clear_fonts(p2c_device_t *dev)
   if (!dev || !dev->fonts)
     return;
 
-  /*
-   * cairo_face owns ft_face through Cairo user data.
-   * Destroy it before freeing font->data because an
-   * FT_Memory_Face depends on that data.
-   */
-
-  for (size_t i = 0; i < dev->num_fonts; i++)
-    p2c_font_destroy(dev->fonts[i]);
-
   free(dev->fonts);
+  free(dev->font_hash);
 
   dev->fonts = NULL;
   dev->num_fonts = 0;
+  dev->font_hash = NULL;
+  dev->font_hash_size = 0;
+}
+
+//
+// 'font_name_hash()' - Compute the FNV-1a hash of a font resource name
+//
+
+static size_t				  // O - Hash value
+font_name_hash(const char *name)	// I - Resource name, e.g. "F1"
+{
+  size_t hash = 2166136261u;
+
+  while (*name)
+  {
+    hash ^= (unsigned char)*name++;
+    hash *= 16777619u;
+  }
+
+  return (hash);
+}
+
+//
+// 'device_index_fonts()' - Build the resource name index for the loaded fonts
+//
+
+bool					  // O - true on success, false on error
+device_index_fonts(p2c_device_t *dev)	// I - Active Rendering Context
+{
+  size_t size = 8;			// Number of slots
+
+  free(dev->font_hash);
+  dev->font_hash = NULL;
+  dev->font_hash_size = 0;
+
+  // Keep the load factor at or below 50% so probe chains stay short
+  while (size < dev->num_fonts * 2)
+    size *= 2;
+
+  if ((dev->font_hash = calloc(size, sizeof(p2c_font_ref_t *))) == NULL)
+    return (false);
+
+  dev->font_hash_size = size;
+
+  for (size_t i = 0; i < dev->num_fonts; i++)
+  {
+    p2c_font_ref_t *ref = dev->fonts + i;
+
+    if (!ref->font || !ref->name)
+      continue;
+
+    size_t slot = font_name_hash(ref->name) & (size - 1);
+
+    while (dev->font_hash[slot])
+    {
+      // Keep the first font registered under a duplicate name
+      if (!strcmp(dev->font_hash[slot]->name, ref->name))
+        break;
+
+      slot = (slot + 1) & (size - 1);
+    }
+
+    if (!dev->font_hash[slot])
+      dev->font_hash[slot] = ref;
+  }
+
+  return (true);
+}
+
+//
+// 'device_find_font()' - Find a loaded font by its resource name
+//
+
+p2c_font_t *				  // O - Font or NULL if not loaded
+device_find_font(p2c_device_t *dev,	// I - Active Rendering Context
+		 const char *name)	// I - Resource name, e.g. "F1"
+{
+  if (!dev->font_hash || !name)
+    return (NULL);
+
+  size_t mask = dev->font_hash_size - 1;
+  size_t slot = font_name_hash(name) & mask;
+
+  while (dev->font_hash[slot])
+  {
+    if (!strcmp(dev->font_hash[slot]->name, name))
+      return (dev->font_hash[slot]->font);
+
+    slot = (slot + 1) & mask;
+  }
+
+  return (NULL);
 }
 
 //
@@ -151,6 +257,18 @@ device_destroy(p2c_device_t *dev)
   }
   
   device_clear_fonts(dev);
+  free(dev->glyphs);
+
+  if (dev->extract)
+  {
+    free(dev->extract->text);
+    free(dev->extract->words);
+    free(dev->extract);
+  }
+
+  for (size_t i = 0; i < dev->num_text_clip; i++)
+    cairo_path_destroy(dev->text_clip[i]);
+  free(dev->text_clip);
   
   if (dev->surface)
   {
@@ -169,9 +287,14 @@ void 						  // O - Void
 device_save_to_png(p2c_device_t *dev, 		// I - Active Rendering context
 		   const char *filename)	// I - File path where PNG will be saved
 {
+  if (!dev->surface)
+    return;
+
   if (g_verbose)
     printf("DEBUG: Writing surface to PNG: %s\n", filename);
 
+  device_flush_text(dev);
+
   // Use Cairo's built-in utility to write the image surface to the filesystem
   if (cairo_surface_write_to_png(dev->surface, filename) != CAIRO_STATUS_SUCCESS)
   {
@@ -0,0 +1,257 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#include "cairo-private.h"
+#include <math.h>
+
+// --- Text Extraction ---
+//
+// A text extraction device runs the same content stream processing as a
+// rendering device, but has no surface or Cairo context.  Path operators
+// do nothing, and shown text is decoded to Unicode and grouped into words
+// with device space bounding boxes instead of being drawn.
+//
+
+//
+// 'device_create_text()' - Create a text extraction device for a page.
+//
+
+p2c_device_t *				  // O - Device or NULL on error
+device_create_text(pdfrip_page_t *page,	// I - Page
+		   int dpi)		// I - Resolution of the bounding boxes
+{
+  p2c_device_t *dev = calloc(1, sizeof(p2c_device_t));
+
+  if (!dev)
+  {
+    fprintf(stderr, "ERROR: Could not allocate memory for text device.\n");
+    return (NULL);
+  }
+
+  if ((dev->extract = calloc(1, sizeof(p2c_text_page_t))) == NULL)
+  {
+    free(dev);
+    return (NULL);
+  }
+
+  device_init(dev, page, dpi);
+
+  return (dev);
+}
+
+//
+// 'end_word()' - Close the word being collected.
+//
+
+static void
+end_word(p2c_text_page_t *page)		// I - Page text
+{
+  // Words that only had unmappable glyphs carry no text
+  if (page->in_word && page->num_words > 0 && page->words[page->num_words - 1].length == 0)
+    page->num_words --;
+
+  page->in_word = false;
+}
+
+//
+// 'device_add_text_char()' - Add a shown character to the page text.
+//
+// Whitespace, and gaps between glyphs of more than a quarter of the font
+// height, end the current word.
+//
+
+void
+device_add_text_char(
+    p2c_device_t   *dev,		// I - Text extraction device
+    const uint32_t *text,		// I - Code points of the character
+    size_t         num_text,		// I - Number of code points
+    const double   bbox[4],		// I - Glyph bounds in device space
+    const double   origin[2],		// I - Glyph origin in device space
+    const double   end[2],		// I - Origin of the next glyph
+    double         size)		// I - Font height in device space
+{
+  p2c_text_page_t	*page = dev->extract;
+  p2c_text_word_t	*word;
+
+  if (num_text == 1 && (text[0] == ' ' || text[0] == '\t' || text[0] == 0xa0))
+  {
+    end_word(page);
+    return;
+  }
+
+  if (page->in_word && hypot(origin[0] - page->next_x, origin[1] - page->next_y) > 0.25 * size)
+    end_word(page);
+
+  if (!page->in_word)
+  {
+    if (page->num_words == page->alloc_words)
+    {
+      size_t alloc = page->alloc_words ? page->alloc_words * 2 : 256;
+      p2c_text_word_t *temp = realloc(page->words, alloc * sizeof(p2c_text_word_t));
+
+      if (!temp)
+        return;
+
+      page->words = temp;
+      page->alloc_words = alloc;
+    }
+
+    word = page->words + page->num_words++;
+    word->start  = page->num_text;
+    word->length = 0;
+    word->x1     = bbox[0];
+    word->y1     = bbox[1];
+    word->x2     = bbox[2];
+    word->y2     = bbox[3];
+    word->base_x = origin[0];
+    word->base_y = origin[1];
+    word->size   = size;
+
+    page->in_word = true;
+  }
+  else
+  {
+    word = page->words + page->num_words - 1;
+
+    if (bbox[0] < word->x1)
+      word->x1 = bbox[0];
+    if (bbox[1] < word->y1)
+      word->y1 = bbox[1];
+    if (bbox[2] > word->x2)
+      word->x2 = bbox[2];
+    if (bbox[3] > word->y2)
+      word->y2 = bbox[3];
+  }
+
+  page->next_x = end[0];
+  page->next_y = end[1];
+
+  if (page->num_text + num_text > page->alloc_text)
+  {
+    size_t alloc = page->alloc_text ? page->alloc_text * 2 : 4096;
+    uint32_t *temp;
+
+    while (alloc < page->num_text + num_text)
+      alloc *= 2;
+
+    if ((temp = realloc(page->text, alloc * sizeof(uint32_t))) == NULL)
+      return;
+
+    page->text = temp;
+    page->alloc_text = alloc;
+  }
+
+  memcpy(page->text + page->num_text, text, num_text * sizeof(uint32_t));
+  page->num_text += num_text;
+  word->length += num_text;
+}
+
+//
+// 'write_utf8()' - Write code points as UTF-8, optionally escaped for JSON.
+//
+
+static void
+write_utf8(FILE *fp,			// I - Output file
+	   const uint32_t *text,	// I - Code points
+	   size_t num_text,		// I - Number of code points
+	   bool json)			// I - Escape for a JSON string?
+{
+  for (size_t i = 0; i < num_text; i ++)
+  {
+    uint32_t ch = text[i];
+
+    if (json && (ch == '\"' || ch == '\\'))
+    {
+      putc('\\', fp);
+      putc((int)ch, fp);
+    }
+    else if (ch < 0x20)
+    {
+      if (json)
+        fprintf(fp, "\\u%04x", (unsigned)ch);
+    }
+    else if (ch < 0x80)
+    {
+      putc((int)ch, fp);
+    }
+    else if (ch < 0x800)
+    {
+      putc((int)(0xc0 | (ch >> 6)), fp);
+      putc((int)(0x80 | (ch & 0x3f)), fp);
+    }
+    else if (ch < 0x10000)
+    {
+      // Lone surrogates cannot be encoded
+      if (ch >= 0xd800 && ch < 0xe000)
+        continue;
+
+      putc((int)(0xe0 | (ch >> 12)), fp);
+      putc((int)(0x80 | ((ch >> 6) & 0x3f)), fp);
+      putc((int)(0x80 | (ch & 0x3f)), fp);
+    }
+    else if (ch < 0x110000)
+    {
+      putc((int)(0xf0 | (ch >> 18)), fp);
+      putc((int)(0x80 | ((ch >> 12) & 0x3f)), fp);
+      putc((int)(0x80 | ((ch >> 6) & 0x3f)), fp);
+      putc((int)(0x80 | (ch & 0x3f)), fp);
+    }
+  }
+}
+
+//
+// 'device_write_text()' - Write the text collected from a page.
+//
+// Plain text separates words with spaces and starts a new line when the
+// baseline moves by more than half the font height.  JSON output is one
+// page object with the UTF-8 text and bounding box of each word.
+//
+
+void
+device_write_text(p2c_device_t *dev,	// I - Text extraction device
+		  FILE *fp,		// I - Output file
+		  p2c_text_format_t format,// I - Output format
+		  size_t pagenum)	// I - Page number (1-based)
+{
+  p2c_text_page_t *page = dev->extract;
+
+  if (!page)
+    return;
+
+  end_word(page);
+
+  if (format == P2C_TEXT_JSON)
+  {
+    fprintf(fp, "{\"page\":%zu,\"width\":%.2f,\"height\":%.2f,\"words\":[", pagenum, dev->width, dev->height);
+
+    for (size_t i = 0; i < page->num_words; i ++)
+    {
+      p2c_text_word_t *word = page->words + i;
+
+      fputs(i ? ",\n{\"text\":\"" : "\n{\"text\":\"", fp);
+      write_utf8(fp, page->text + word->start, word->length, true);
+      fprintf(fp, "\",\"bbox\":[%.2f,%.2f,%.2f,%.2f]}", word->x1, word->y1, word->x2, word->y2);
+    }
+
+    fputs("]}", fp);
+  }
+  else
+  {
+    for (size_t i = 0; i < page->num_words; i ++)
+    {
+      p2c_text_word_t *word = page->words + i;
+
+      if (i > 0)
+        putc(fabs(word->base_y - word[-1].base_y) > 0.5 * word->size ? '\n' : ' ', fp);
+
+      write_utf8(fp, page->text + word->start, word->length, false);
+    }
+
+    if (page->num_words > 0)
+      putc('\n', fp);
+  }
+}
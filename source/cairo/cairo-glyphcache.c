@@ -0,0 +1,463 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#include "cairo-private.h"
+#include <math.h>
+#include <pthread.h>
+
+// --- Glyph Mask Cache ---
+//
+// Filled text is composited from A8 glyph masks kept for the life of the
+// process, so body text is rasterized once rather than on every page.
+// Masks are keyed by the font program's identity (not the per-document
+// font record), glyph index, glyph to device matrix quantized to 1/64
+// pixel and the sub-pixel position of the glyph origin.  The least
+// recently used masks are dropped when the cache goes over its budget,
+// which is P2C_GLYPH_CACHE_BUDGET or $PDFRIP_GLYPH_CACHE kilobytes.
+//
+
+// Cache key of a glyph mask
+typedef struct p2c_glyph_key_s
+{
+  uint64_t		font_id;	// Font program identity
+  uint32_t		glyph;		// Glyph index
+  int32_t		matrix[4];	// Glyph to device matrix in 1/64 pixels
+  uint8_t		sub_x,		// Sub-pixel position of the origin
+			sub_y;
+} p2c_glyph_key_t;
+
+// A cached glyph mask
+typedef struct p2c_glyph_s
+{
+  p2c_glyph_key_t	key;		// Cache key
+  cairo_surface_t	*mask;		// A8 coverage, NULL for a blank glyph
+  int			x, y;		// Mask offset from the origin's pixel
+  size_t		bytes;		// Memory charged to the cache
+  struct p2c_glyph_s	*hash_next,	// Next glyph in bucket
+			*lru_prev,	// More recently used glyph
+			*lru_next;	// Less recently used glyph
+} p2c_glyph_t;
+
+static pthread_mutex_t	glyph_mutex = PTHREAD_MUTEX_INITIALIZER;
+					// Lock for the cache
+static pthread_once_t	glyph_once = PTHREAD_ONCE_INIT;
+					// Reads the budget from the environment
+static p2c_glyph_t	**glyph_buckets = NULL;	// Hash buckets
+static size_t		glyph_num_buckets = 0,	// Number of buckets (power of 2)
+			glyph_count = 0,	// Number of cached glyphs
+			glyph_bytes = 0,	// Memory used by cached glyphs
+			glyph_budget = P2C_GLYPH_CACHE_BUDGET,
+					// Memory budget
+			glyph_hits = 0,		// Number of cache hits
+			glyph_misses = 0;	// Number of cache misses
+static p2c_glyph_t	*glyph_lru_head = NULL,	// Most recently used glyph
+			*glyph_lru_tail = NULL;	// Least recently used glyph
+
+
+//
+// 'glyph_init()' - Read the cache budget from the environment.
+//
+
+static void
+glyph_init(void)
+{
+  const char *budget = getenv("PDFRIP_GLYPH_CACHE");
+
+  if (budget && *budget)
+    glyph_budget = (size_t)strtoul(budget, NULL, 10) * 1024;
+}
+
+//
+// 'glyph_hash()' - Hash a glyph key.
+//
+
+static size_t				  // O - Hash value
+glyph_hash(const p2c_glyph_key_t *key)	// I - Key
+{
+  uint64_t h = key->font_id ^ ((uint64_t)key->glyph * 0x9e3779b97f4a7c15ULL);
+
+  for (int i = 0; i < 4; i ++)
+    h = (h ^ (uint32_t)key->matrix[i]) * 0x100000001b3ULL;
+
+  h = (h ^ ((uint64_t)key->sub_x << 8 | key->sub_y)) * 0x100000001b3ULL;
+
+  return ((size_t)(h ^ (h >> 32)));
+}
+
+//
+// 'glyph_unlink()' - Remove a glyph from the LRU list.
+//
+
+static void
+glyph_unlink(p2c_glyph_t *g)		// I - Glyph
+{
+  if (g->lru_prev)
+    g->lru_prev->lru_next = g->lru_next;
+  else
+    glyph_lru_head = g->lru_next;
+
+  if (g->lru_next)
+    g->lru_next->lru_prev = g->lru_prev;
+  else
+    glyph_lru_tail = g->lru_prev;
+
+  g->lru_prev = g->lru_next = NULL;
+}
+
+//
+// 'glyph_touch()' - Make a glyph the most recently used.
+//
+// Glyphs not yet in the list have no neighbors and are just added.
+//
+
+static void
+glyph_touch(p2c_glyph_t *g)		// I - Glyph
+{
+  if (glyph_lru_head == g)
+    return;
+
+  if (g->lru_prev)
+    glyph_unlink(g);
+
+  g->lru_next = glyph_lru_head;
+  if (glyph_lru_head)
+    glyph_lru_head->lru_prev = g;
+  glyph_lru_head = g;
+
+  if (!glyph_lru_tail)
+    glyph_lru_tail = g;
+}
+
+//
+// 'glyph_remove()' - Remove and free a glyph.
+//
+// Surfaces still being composited by another thread hold their own
+// reference, so dropping the cache's reference is safe.
+//
+
+static void
+glyph_remove(p2c_glyph_t *g)		// I - Glyph
+{
+  p2c_glyph_t **bucket = glyph_buckets + (glyph_hash(&g->key) & (glyph_num_buckets - 1));
+
+  while (*bucket != g)
+    bucket = &(*bucket)->hash_next;
+  *bucket = g->hash_next;
+
+  glyph_unlink(g);
+
+  glyph_bytes -= g->bytes;
+  glyph_count --;
+
+  if (g->mask)
+    cairo_surface_destroy(g->mask);
+
+  free(g);
+}
+
+//
+// 'glyph_find()' - Find a cached glyph.
+//
+
+static p2c_glyph_t *			  // O - Glyph or NULL
+glyph_find(const p2c_glyph_key_t *key)	// I - Key
+{
+  p2c_glyph_t *g;
+
+  if (!glyph_num_buckets)
+    return (NULL);
+
+  for (g = glyph_buckets[glyph_hash(key) & (glyph_num_buckets - 1)]; g; g = g->hash_next)
+  {
+    if (!memcmp(&g->key, key, sizeof(p2c_glyph_key_t)))
+      return (g);
+  }
+
+  return (NULL);
+}
+
+//
+// 'glyph_insert()' - Add a glyph, growing the table and evicting as needed.
+//
+
+static void
+glyph_insert(p2c_glyph_t *g)		// I - Glyph
+{
+  size_t bucket;
+
+  if (glyph_count >= glyph_num_buckets)
+  {
+    size_t	num_buckets = glyph_num_buckets ? glyph_num_buckets * 2 : 1024;
+    p2c_glyph_t	**buckets = calloc(num_buckets, sizeof(p2c_glyph_t *));
+
+    if (buckets)
+    {
+      for (size_t i = 0; i < glyph_num_buckets; i ++)
+      {
+        p2c_glyph_t *next;
+
+        for (p2c_glyph_t *old = glyph_buckets[i]; old; old = next)
+        {
+          next   = old->hash_next;
+          bucket = glyph_hash(&old->key) & (num_buckets - 1);
+
+          old->hash_next   = buckets[bucket];
+          buckets[bucket] = old;
+        }
+      }
+
+      free(glyph_buckets);
+      glyph_buckets     = buckets;
+      glyph_num_buckets = num_buckets;
+    }
+  }
+
+  bucket = glyph_hash(&g->key) & (glyph_num_buckets - 1);
+  g->hash_next = glyph_buckets[bucket];
+  glyph_buckets[bucket] = g;
+
+  glyph_touch(g);
+
+  glyph_bytes += g->bytes;
+  glyph_count ++;
+
+  while (glyph_bytes > glyph_budget && glyph_lru_tail && glyph_lru_tail != g)
+    glyph_remove(glyph_lru_tail);
+}
+
+//
+// 'glyph_render()' - Rasterize a glyph into a new cache entry.
+//
+
+static p2c_glyph_t *			  // O - Glyph or NULL if not cacheable
+glyph_render(
+    const p2c_glyph_key_t *key,		// I - Key
+    cairo_font_face_t     *face)	// I - Font face
+{
+  cairo_matrix_t	matrix,		// Quantized font matrix
+			identity;	// Identity CTM
+  cairo_font_options_t	*options;	// Default font options
+  cairo_scaled_font_t	*scaled_font;	// Face at matrix
+  cairo_text_extents_t	extents;	// Ink extents of the glyph
+  cairo_glyph_t		glyph;		// Glyph at its sub-pixel position
+  p2c_glyph_t		*g;
+  double		x1, y1;		// Upper-left corner of the mask
+  int			width, height;	// Size of mask
+  cairo_t		*cr;
+
+  cairo_matrix_init(&matrix, key->matrix[0] / 64.0, key->matrix[1] / 64.0, key->matrix[2] / 64.0, key->matrix[3] / 64.0, 0.0, 0.0);
+  cairo_matrix_init_identity(&identity);
+
+  if (matrix.xx * matrix.yy - matrix.xy * matrix.yx == 0.0)
+    return (NULL);
+
+  options     = cairo_font_options_create();
+  scaled_font = cairo_scaled_font_create(face, &matrix, &identity, options);
+  cairo_font_options_destroy(options);
+
+  if (cairo_scaled_font_status(scaled_font) != CAIRO_STATUS_SUCCESS)
+  {
+    cairo_scaled_font_destroy(scaled_font);
+    return (NULL);
+  }
+
+  glyph.index = key->glyph;
+  glyph.x     = (double)key->sub_x / P2C_GLYPH_SUBPIXEL;
+  glyph.y     = (double)key->sub_y / P2C_GLYPH_SUBPIXEL;
+
+  cairo_scaled_font_glyph_extents(scaled_font, &glyph, 1, &extents);
+
+  if ((g = calloc(1, sizeof(p2c_glyph_t))) == NULL)
+  {
+    cairo_scaled_font_destroy(scaled_font);
+    return (NULL);
+  }
+
+  g->key   = *key;
+  g->bytes = sizeof(p2c_glyph_t);
+
+  if (extents.width > 0.0 && extents.height > 0.0)
+  {
+    // Leave a pixel for antialiasing on each side
+    x1     = floor(glyph.x + extents.x_bearing) - 1.0;
+    y1     = floor(glyph.y + extents.y_bearing) - 1.0;
+    width  = (int)(ceil(glyph.x + extents.x_bearing + extents.width) + 1.0 - x1);
+    height = (int)(ceil(glyph.y + extents.y_bearing + extents.height) + 1.0 - y1);
+
+    if (width > P2C_GLYPH_CACHE_MAX_SIZE || height > P2C_GLYPH_CACHE_MAX_SIZE)
+    {
+      free(g);
+      cairo_scaled_font_destroy(scaled_font);
+      return (NULL);
+    }
+
+    g->mask = cairo_image_surface_create(CAIRO_FORMAT_A8, width, height);
+    g->x    = (int)x1;
+    g->y    = (int)y1;
+
+    cr = cairo_create(g->mask);
+    cairo_set_scaled_font(cr, scaled_font);
+    glyph.x -= x1;
+    glyph.y -= y1;
+    cairo_show_glyphs(cr, &glyph, 1);
+    cairo_destroy(cr);
+
+    cairo_surface_flush(g->mask);
+
+    g->bytes += (size_t)cairo_image_surface_get_stride(g->mask) * (size_t)height;
+  }
+
+  cairo_scaled_font_destroy(scaled_font);
+
+  return (g);
+}
+
+//
+// 'p2c_glyph_cache_get()' - Get the mask of a glyph at a device position.
+//
+// On success the mask is returned with a reference the caller must drop
+// with cairo_surface_destroy(), and is NULL for glyphs without ink.  Glyphs
+// that are too large to cache return false and should be drawn directly.
+//
+
+bool					  // O - true if cached, false otherwise
+p2c_glyph_cache_get(
+    const p2c_font_t     *font,		// I - Font
+    FT_UInt              glyph,		// I - Glyph index
+    const cairo_matrix_t *font_matrix,	// I - Glyph to device matrix, without translation
+    double               x,		// I - Device X of the glyph origin
+    double               y,		// I - Device Y of the glyph origin
+    cairo_surface_t      **mask,	// O - Mask or NULL
+    int                  *mask_x,	// O - Device X of the mask
+    int                  *mask_y)	// O - Device Y of the mask
+{
+  p2c_glyph_key_t	key;		// Cache key
+  p2c_glyph_t		*g, *existing;
+  double		ix = floor(x),	// Pixel of the glyph origin
+			iy = floor(y);
+
+  pthread_once(&glyph_once, glyph_init);
+
+  if (!font->font_id || !font->cairo_face || glyph_budget == 0)
+    return (false);
+
+  memset(&key, 0, sizeof(key));
+  key.font_id   = font->font_id;
+  key.glyph     = glyph;
+  key.matrix[0] = (int32_t)lround(font_matrix->xx * 64.0);
+  key.matrix[1] = (int32_t)lround(font_matrix->yx * 64.0);
+  key.matrix[2] = (int32_t)lround(font_matrix->xy * 64.0);
+  key.matrix[3] = (int32_t)lround(font_matrix->yy * 64.0);
+  key.sub_x     = (uint8_t)((x - ix) * P2C_GLYPH_SUBPIXEL);
+  key.sub_y     = (uint8_t)((y - iy) * P2C_GLYPH_SUBPIXEL);
+
+  pthread_mutex_lock(&glyph_mutex);
+
+  if ((g = glyph_find(&key)) != NULL)
+  {
+    glyph_hits ++;
+    glyph_touch(g);
+  }
+  else
+  {
+    glyph_misses ++;
+
+    // Rasterize without holding the lock
+    pthread_mutex_unlock(&glyph_mutex);
+    g = glyph_render(&key, font->cairo_face);
+    pthread_mutex_lock(&glyph_mutex);
+
+    if (!g)
+    {
+      pthread_mutex_unlock(&glyph_mutex);
+      return (false);
+    }
+
+    if ((existing = glyph_find(&key)) != NULL)
+    {
+      // Another thread got there first
+      if (g->mask)
+        cairo_surface_destroy(g->mask);
+      free(g);
+
+      g = existing;
+      glyph_touch(g);
+    }
+    else
+      glyph_insert(g);
+  }
+
+  *mask   = g->mask ? cairo_surface_reference(g->mask) : NULL;
+  *mask_x = (int)ix + g->x;
+  *mask_y = (int)iy + g->y;
+
+  pthread_mutex_unlock(&glyph_mutex);
+
+  return (true);
+}
+
+//
+// 'p2c_glyph_cache_set_budget()' - Set the memory budget of the glyph cache.
+//
+// A budget of 0 disables the cache.
+//
+
+void
+p2c_glyph_cache_set_budget(size_t bytes)// I - Budget in bytes
+{
+  pthread_once(&glyph_once, glyph_init);
+
+  pthread_mutex_lock(&glyph_mutex);
+
+  glyph_budget = bytes;
+
+  while (glyph_bytes > glyph_budget && glyph_lru_tail)
+    glyph_remove(glyph_lru_tail);
+
+  pthread_mutex_unlock(&glyph_mutex);
+}
+
+//
+// 'p2c_glyph_cache_stats()' - Get glyph cache statistics.
+//
+
+void
+p2c_glyph_cache_stats(size_t *count,	// O - Number of cached glyphs
+		      size_t *bytes,	// O - Memory used
+		      size_t *hits,	// O - Number of hits
+		      size_t *misses)	// O - Number of misses
+{
+  pthread_mutex_lock(&glyph_mutex);
+
+  *count  = glyph_count;
+  *bytes  = glyph_bytes;
+  *hits   = glyph_hits;
+  *misses = glyph_misses;
+
+  pthread_mutex_unlock(&glyph_mutex);
+}
+
+//
+// 'p2c_glyph_cache_clear()' - Empty the glyph cache and reset its statistics.
+//
+
+void
+p2c_glyph_cache_clear(void)
+{
+  pthread_mutex_lock(&glyph_mutex);
+
+  while (glyph_lru_tail)
+    glyph_remove(glyph_lru_tail);
+
+  free(glyph_buckets);
+  glyph_buckets     = NULL;
+  glyph_num_buckets = 0;
+  glyph_hits        = 0;
+  glyph_misses      = 0;
+
+  pthread_mutex_unlock(&glyph_mutex);
+}
@@ -0,0 +1,307 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#include "cairo-private.h"
+#include "../pdf/pdfops-private.h"
+#include <math.h>
+
+// --- Image XObjects ---
+//
+// An image fills the unit square of user space, with its first row at the
+// top.  The pixels come from the document's decoded image cache and are
+// painted through a pattern, with the fill alpha of the graphics state.
+// Images shown at half their size or less are painted from a copy the
+// cache reduced with a box filter, which is faster and smoother than
+// Cairo's own downscaling.
+//
+// Stencil masks (/ImageMask) and black and white 1-bit images are cached
+// as A1 or A8 coverage and painted with cairo_mask(): stencils in the fill
+// color, bilevel images as black over a white rectangle.
+//
+// Images too large to cache are painted a strip of rows at a time, so
+// only one strip of pixels exists at once.  Rows below the clip are never
+// decoded, and rows above it are read but not converted.  JPEG 2000
+// images are only decoded over the visible area.  Each strip
+// overlaps the next by a row, so the anti-aliased strip edges are always
+// covered by opaque pixels of the same image.  Translucent images are
+// built in a group with the SOURCE operator for the same reason.
+//
+
+//
+// 'image_pattern_filter()' - Choose the pattern filter for an image.
+//
+
+static cairo_filter_t			  // O - Pattern filter
+image_pattern_filter(
+    graphics_state_t *gs,		// I - Graphics state
+    int              width,		// I - Image width
+    int              height,		// I - Image height
+    bool             interpolate)	// I - Smooth when enlarged?
+{
+  // Keep the pixels of enlarged images sharp unless /Interpolate asks otherwise
+  if (!interpolate && hypot(gs->ctm.xx, gs->ctm.yx) > width && hypot(gs->ctm.xy, gs->ctm.yy) > height)
+    return (CAIRO_FILTER_NEAREST);
+  else
+    return (CAIRO_FILTER_GOOD);
+}
+
+//
+// 'draw_image_strips()' - Paint a large image a strip at a time.
+//
+
+static void
+draw_image_strips(p2c_device_t *dev,	// I - Active Rendering Context
+		  pdfio_obj_t  *obj,	// I - Image object
+		  pdfio_dict_t *resources,// I - Resources for named color spaces
+		  double       target_width,// I - Device width in pixels
+		  double       target_height)// I - Device height in pixels
+{
+  graphics_state_t	*gs = &dev->gstack[dev->gstack_ptr];
+  p2c_image_strips_t	*strips;	// Image strips
+  cairo_surface_t	*surface;	// Strip pixels
+  cairo_pattern_t	*pattern;	// Strip pattern
+  cairo_matrix_t	matrix;		// Image space to user space
+  pdfio_rect_t		area;		// Visible part of the unit square
+  double		y1, y2;		// Clip extents in image rows
+  int			first,		// First visible row
+			last,		// Last visible row + 1
+			strip_rows;	// Rows per strip
+  bool			group;		// Composite in a group?
+
+  cairo_save(dev->cr);
+
+  // The unit square, top row first, clipped to find the visible area
+  cairo_matrix_init(&matrix, 1.0, 0.0, 0.0, -1.0, 0.0, 1.0);
+  cairo_transform(dev->cr, &matrix);
+
+  cairo_rectangle(dev->cr, 0.0, 0.0, 1.0, 1.0);
+  cairo_clip(dev->cr);
+  cairo_clip_extents(dev->cr, &area.x1, &area.y1, &area.x2, &area.y2);
+
+  if ((strips = openImageStrips(obj, resources, target_width, target_height, &area)) == NULL)
+  {
+    cairo_restore(dev->cr);
+    return;
+  }
+
+  cairo_scale(dev->cr, 1.0 / strips->width, 1.0 / strips->height);
+
+  y1 = area.y1 * strips->height;
+  y2 = area.y2 * strips->height;
+
+  // One row of margin for the pattern filter
+  first      = y1 > 1.0 ? (int)floor(y1) - 1 : 0;
+  last       = y2 < strips->height - 1 ? (int)ceil(y2) + 1 : strips->height;
+  strip_rows = PDFRIP_IMAGE_STRIP_BYTES / (strips->width * 4);
+
+  if (strip_rows < 1)
+    strip_rows = 1;
+
+  group = strips->has_alpha || gs->fill_alpha < 1.0;
+
+  if (group)
+  {
+    cairo_push_group(dev->cr);
+    cairo_set_operator(dev->cr, CAIRO_OPERATOR_SOURCE);
+  }
+
+  for (int y = first; y < last; y += strip_rows)
+  {
+    int rows = last - y < strip_rows ? last - y : strip_rows;
+					// Rows in this strip
+
+    // Overlap the next strip by a row
+    if (y + rows < strips->height)
+      rows ++;
+
+    if ((surface = readImageStrip(strips, y, rows)) == NULL)
+      break;
+
+    pattern = cairo_pattern_create_for_surface(surface);
+    cairo_matrix_init_translate(&matrix, 0.0, -y);
+    cairo_pattern_set_matrix(pattern, &matrix);
+    cairo_pattern_set_extend(pattern, CAIRO_EXTEND_PAD);
+    cairo_pattern_set_filter(pattern, image_pattern_filter(gs, strips->width, strips->height, strips->interpolate));
+
+    cairo_set_source(dev->cr, pattern);
+    cairo_rectangle(dev->cr, 0.0, y, strips->width, rows);
+    cairo_fill(dev->cr);
+
+    cairo_pattern_destroy(pattern);
+    cairo_surface_destroy(surface);
+  }
+
+  if (group)
+  {
+    cairo_pop_group_to_source(dev->cr);
+    cairo_set_operator(dev->cr, CAIRO_OPERATOR_OVER);
+    cairo_paint_with_alpha(dev->cr, gs->fill_alpha);
+  }
+
+  cairo_restore(dev->cr);
+  closeImageStrips(strips);
+}
+
+//
+// 'draw_image_mask()' - Paint a stencil mask or bilevel image.
+//
+
+static void
+draw_image_mask(p2c_device_t *dev,	// I - Active Rendering Context
+		p2c_image_t  *image)	// I - Stencil or bilevel image
+{
+  graphics_state_t	*gs = &dev->gstack[dev->gstack_ptr];
+  cairo_pattern_t	*pattern;	// Coverage pattern
+  cairo_matrix_t	matrix;		// Image space to user space
+  bool			group = image->bilevel && gs->fill_alpha < 1.0;
+					// Composite white and black together?
+
+  cairo_matrix_init(&matrix, 1.0 / image->width, 0.0, 0.0, -1.0 / image->height, 0.0, 1.0);
+  cairo_transform(dev->cr, &matrix);
+
+  pattern = cairo_pattern_create_for_surface(image->surface);
+  cairo_pattern_set_extend(pattern, CAIRO_EXTEND_PAD);
+  cairo_pattern_set_filter(pattern, image_pattern_filter(gs, image->width, image->height, image->interpolate));
+
+  cairo_rectangle(dev->cr, 0.0, 0.0, image->width, image->height);
+  cairo_clip(dev->cr);
+
+  if (group)
+    cairo_push_group(dev->cr);
+
+  if (image->stencil)
+  {
+    cairo_set_source_rgba(dev->cr, gs->fill_rgb[0], gs->fill_rgb[1], gs->fill_rgb[2], gs->fill_alpha);
+  }
+  else
+  {
+    // The group applies the fill alpha of a translucent bilevel image
+    cairo_set_source_rgb(dev->cr, 1.0, 1.0, 1.0);
+    cairo_paint(dev->cr);
+    cairo_set_source_rgb(dev->cr, 0.0, 0.0, 0.0);
+  }
+
+  cairo_mask(dev->cr, pattern);
+
+  if (group)
+  {
+    cairo_pop_group_to_source(dev->cr);
+    cairo_paint_with_alpha(dev->cr, gs->fill_alpha);
+  }
+
+  cairo_pattern_destroy(pattern);
+}
+
+//
+// 'device_draw_image()' - Paint an image XObject in the unit square.
+//
+
+void
+device_draw_image(p2c_device_t *dev,	// I - Active Rendering Context
+		  pdfio_obj_t  *obj,	// I - Image object
+		  pdfio_dict_t *resources)// I - Resources for named color spaces
+{
+  graphics_state_t	*gs = &dev->gstack[dev->gstack_ptr];
+  p2c_image_t		*image;		// Decoded image
+  cairo_surface_t	*surface;	// Pixels to paint
+  cairo_pattern_t	*pattern;	// Image pattern
+  cairo_matrix_t	matrix;		// Image space to user space
+  int			width,		// Size of surface in pixels
+			height;
+  double		det = gs->ctm.xx * gs->ctm.yy - gs->ctm.xy * gs->ctm.yx,
+			target_width = hypot(gs->ctm.xx, gs->ctm.yx),
+			target_height = hypot(gs->ctm.xy, gs->ctm.yy);
+					// Device pixels covered by the image
+
+  // Nothing to paint when extracting text or when the image is flattened
+  if (!dev->cr || !dev->doc || fabs(det) < 1e-9)
+    return;
+
+  device_flush_text(dev);
+
+  // The device size bounds the resolution JPEG images need to be decoded at
+  if ((image = getDocImage(dev->doc, obj, resources, target_width, target_height)) == NULL)
+    return;
+
+  if (image->strips)
+  {
+    draw_image_strips(dev, obj, resources, target_width, target_height);
+    return;
+  }
+
+  if (!image->surface)
+    return;
+
+  cairo_save(dev->cr);
+
+  if (image->stencil || image->bilevel)
+  {
+    draw_image_mask(dev, image);
+    cairo_restore(dev->cr);
+    return;
+  }
+
+  // Oversampled images are painted from a reduced copy
+  if ((surface = getDocImageScaled(dev->doc, image, target_width, target_height)) == NULL)
+    surface = image->surface;
+
+  width  = cairo_image_surface_get_width(surface);
+  height = cairo_image_surface_get_height(surface);
+
+  cairo_matrix_init(&matrix, 1.0 / width, 0.0, 0.0, -1.0 / height, 0.0, 1.0);
+  cairo_transform(dev->cr, &matrix);
+
+  pattern = cairo_pattern_create_for_surface(surface);
+  cairo_pattern_set_extend(pattern, CAIRO_EXTEND_PAD);
+
+  cairo_pattern_set_filter(pattern, image_pattern_filter(gs, width, height, image->interpolate));
+
+  cairo_set_source(dev->cr, pattern);
+  cairo_rectangle(dev->cr, 0.0, 0.0, width, height);
+  cairo_clip(dev->cr);
+  cairo_paint_with_alpha(dev->cr, gs->fill_alpha);
+
+  cairo_pattern_destroy(pattern);
+  cairo_restore(dev->cr);
+}
+
+//
+// 'device_draw_xobject()' - Paint a named XObject (corresponding to the 'Do' operator).
+//
+// Only image XObjects are drawn.
+//
+
+void
+device_draw_xobject(p2c_device_t *dev,	// I - Active Rendering Context
+		    pdfio_dict_t *resources,// I - Resources of the content stream
+		    const char   *name)	// I - XObject name
+{
+  pdfio_dict_t	*xobjects;		// XObject resources
+  pdfio_obj_t	*obj;			// XObject
+  const char	*subtype;		// XObject subtype
+
+  if (resources && pdfioDictGetType(resources, "XObject") == PDFIO_VALTYPE_INDIRECT)
+    xobjects = pdfioObjGetDict(pdfioDictGetObj(resources, "XObject"));
+  else if (resources)
+    xobjects = pdfioDictGetDict(resources, "XObject");
+  else
+    xobjects = dev->xobject_dict;
+
+  if (!xobjects || (obj = pdfioDictGetObj(xobjects, name)) == NULL)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: XObject /%s not found.\n", name);
+    return;
+  }
+
+  subtype = pdfioDictGetName(pdfioObjGetDict(obj), "Subtype");
+
+  if (subtype && !strcmp(subtype, "Image"))
+    device_draw_image(dev, obj, resources);
+  else if (g_verbose)
+    fprintf(stderr, "DEBUG: Skipping /%s XObject /%s.\n", subtype ? subtype : "(unknown)", name);
+}
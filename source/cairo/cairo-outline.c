@@ -0,0 +1,337 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#include "cairo-private.h"
+#include FT_OUTLINE_H
+
+// --- Glyph Outline Cache ---
+//
+// Stroked and clipping text modes need glyph outlines as paths.  Outlines
+// are loaded from FreeType once per glyph, kept in font units and only
+// transformed into device space when they are emitted.  Each font bounds
+// its cache by P2C_OUTLINE_CACHE_BUDGET bytes and evicts the least
+// recently used outlines first.
+//
+
+// Outline being built by FT_Outline_Decompose()
+typedef struct outline_builder_s
+{
+  cairo_path_data_t	*data;		// Path elements
+  size_t		num_data,	// Number of elements used
+			alloc_data;	// Number of elements allocated
+  bool			open;		// Is there an unclosed contour?
+  FT_Vector		last;		// Current point
+} outline_builder_t;
+
+//
+// 'builder_add()' - Append a path element and its points.
+//
+
+static int				  // O - 0 on success, -1 on error
+builder_add(outline_builder_t *b,	// I - Outline builder
+	    cairo_path_data_type_t type,// I - Element type
+	    const FT_Vector *points,	// I - Points
+	    int num_points)		// I - Number of points
+{
+  size_t needed = b->num_data + 1 + num_points;
+
+  if (needed > b->alloc_data)
+  {
+    size_t alloc = b->alloc_data ? b->alloc_data * 2 : 64;
+    cairo_path_data_t *data;
+
+    while (alloc < needed)
+      alloc *= 2;
+
+    if ((data = realloc(b->data, alloc * sizeof(cairo_path_data_t))) == NULL)
+      return (-1);
+
+    b->data = data;
+    b->alloc_data = alloc;
+  }
+
+  b->data[b->num_data].header.type = type;
+  b->data[b->num_data].header.length = 1 + num_points;
+  b->num_data ++;
+
+  for (int i = 0; i < num_points; i ++, b->num_data ++)
+  {
+    b->data[b->num_data].point.x = points[i].x;
+    b->data[b->num_data].point.y = points[i].y;
+  }
+
+  return (0);
+}
+
+static int
+builder_move_to(const FT_Vector *to, void *user)
+{
+  outline_builder_t *b = user;
+
+  // FreeType contours are implicitly closed
+  if (b->open && builder_add(b, CAIRO_PATH_CLOSE_PATH, NULL, 0))
+    return (-1);
+
+  b->open = true;
+  b->last = *to;
+  return (builder_add(b, CAIRO_PATH_MOVE_TO, to, 1));
+}
+
+static int
+builder_line_to(const FT_Vector *to, void *user)
+{
+  outline_builder_t *b = user;
+
+  b->last = *to;
+  return (builder_add(b, CAIRO_PATH_LINE_TO, to, 1));
+}
+
+static int
+builder_conic_to(const FT_Vector *control, const FT_Vector *to, void *user)
+{
+  outline_builder_t *b = user;
+  FT_Vector points[3];
+
+  // Raise the quadratic segment to a cubic one
+  points[0].x = b->last.x + 2 * (control->x - b->last.x) / 3;
+  points[0].y = b->last.y + 2 * (control->y - b->last.y) / 3;
+  points[1].x = to->x + 2 * (control->x - to->x) / 3;
+  points[1].y = to->y + 2 * (control->y - to->y) / 3;
+  points[2] = *to;
+
+  b->last = *to;
+  return (builder_add(b, CAIRO_PATH_CURVE_TO, points, 3));
+}
+
+static int
+builder_cubic_to(const FT_Vector *control1, const FT_Vector *control2,
+		 const FT_Vector *to, void *user)
+{
+  outline_builder_t *b = user;
+  FT_Vector points[3] = { *control1, *control2, *to };
+
+  b->last = *to;
+  return (builder_add(b, CAIRO_PATH_CURVE_TO, points, 3));
+}
+
+//
+// 'outline_unlink()' - Remove an outline from the LRU list.
+//
+
+static void
+outline_unlink(p2c_outline_cache_t *cache,// I - Outline cache
+	       p2c_outline_t *outline)	// I - Outline
+{
+  if (outline->lru_prev)
+    outline->lru_prev->lru_next = outline->lru_next;
+  else
+    cache->lru_head = outline->lru_next;
+
+  if (outline->lru_next)
+    outline->lru_next->lru_prev = outline->lru_prev;
+  else
+    cache->lru_tail = outline->lru_prev;
+
+  outline->lru_prev = outline->lru_next = NULL;
+}
+
+//
+// 'outline_push_front()' - Make an outline the most recently used one.
+//
+
+static void
+outline_push_front(p2c_outline_cache_t *cache,// I - Outline cache
+		   p2c_outline_t *outline)// I - Outline
+{
+  outline->lru_prev = NULL;
+  outline->lru_next = cache->lru_head;
+
+  if (cache->lru_head)
+    cache->lru_head->lru_prev = outline;
+  else
+    cache->lru_tail = outline;
+
+  cache->lru_head = outline;
+}
+
+//
+// 'outline_evict()' - Drop the least recently used outline.
+//
+
+static void
+outline_evict(p2c_outline_cache_t *cache)// I - Outline cache
+{
+  p2c_outline_t *outline = cache->lru_tail;
+  p2c_outline_t **link;
+
+  if (!outline)
+    return;
+
+  outline_unlink(cache, outline);
+
+  for (link = &cache->buckets[outline->glyph & (P2C_OUTLINE_BUCKETS - 1)]; *link; link = &(*link)->hash_next)
+  {
+    if (*link == outline)
+    {
+      *link = outline->hash_next;
+      break;
+    }
+  }
+
+  cache->bytes -= outline->bytes;
+  free(outline->data);
+  free(outline);
+}
+
+//
+// 'p2c_outline_cache_clear()' - Free all outlines of a font.
+//
+
+void
+p2c_outline_cache_clear(p2c_outline_cache_t *cache)// I - Outline cache
+{
+  while (cache->lru_tail)
+    outline_evict(cache);
+}
+
+//
+// 'p2c_font_get_outline()' - Get the outline of a glyph in font units.
+//
+
+const p2c_outline_t *			  // O - Outline or NULL on error
+p2c_font_get_outline(p2c_font_t *font,	// I - Font
+		     FT_UInt glyph)	// I - Glyph index
+{
+  p2c_outline_cache_t	*cache = &font->outlines;
+  p2c_outline_t		*outline;
+  outline_builder_t	builder = { 0 };
+  static const FT_Outline_Funcs funcs =
+  {
+    builder_move_to,
+    builder_line_to,
+    builder_conic_to,
+    builder_cubic_to,
+    0,
+    0
+  };
+
+  for (outline = cache->buckets[glyph & (P2C_OUTLINE_BUCKETS - 1)]; outline; outline = outline->hash_next)
+  {
+    if (outline->glyph == glyph)
+    {
+      if (cache->lru_head != outline)
+      {
+        outline_unlink(cache, outline);
+        outline_push_front(cache, outline);
+      }
+
+      return (outline);
+    }
+  }
+
+  if (!font->ft_face)
+    return (NULL);
+
+  // Load the unscaled, unhinted outline.  Cairo may have left a transform
+  // on the shared face, so ignore it.
+  if (FT_Load_Glyph(font->ft_face, glyph, FT_LOAD_NO_SCALE | FT_LOAD_NO_HINTING |
+                                          FT_LOAD_NO_BITMAP | FT_LOAD_IGNORE_TRANSFORM))
+    return (NULL);
+
+  if (font->ft_face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+    return (NULL);
+
+  if (FT_Outline_Decompose(&font->ft_face->glyph->outline, &funcs, &builder) ||
+      (builder.open && builder_add(&builder, CAIRO_PATH_CLOSE_PATH, NULL, 0)))
+  {
+    free(builder.data);
+    return (NULL);
+  }
+
+  if ((outline = calloc(1, sizeof(p2c_outline_t))) == NULL)
+  {
+    free(builder.data);
+    return (NULL);
+  }
+
+  outline->glyph    = glyph;
+  outline->data     = builder.data;
+  outline->num_data = builder.num_data;
+  outline->bytes    = sizeof(p2c_outline_t) + builder.alloc_data * sizeof(cairo_path_data_t);
+
+  outline->hash_next = cache->buckets[glyph & (P2C_OUTLINE_BUCKETS - 1)];
+  cache->buckets[glyph & (P2C_OUTLINE_BUCKETS - 1)] = outline;
+  outline_push_front(cache, outline);
+  cache->bytes += outline->bytes;
+
+  // Stay within the budget, but never evict the outline just loaded
+  while (cache->bytes > P2C_OUTLINE_CACHE_BUDGET && cache->lru_tail != outline)
+    outline_evict(cache);
+
+  return (outline);
+}
+
+//
+// 'device_glyph_path()' - Append glyph outlines to the current path.
+//
+// The font matrix maps Cairo glyph space (y-down, 1 unit = 1 em) to the
+// current user space, and each glyph is placed at its x/y position.
+//
+
+void
+device_glyph_path(p2c_device_t *dev,	// I - Active Rendering Context
+		  p2c_font_t *font,	// I - Font
+		  const cairo_matrix_t *font_matrix,// I - Glyph space to user space
+		  const cairo_glyph_t *glyphs,// I - Glyphs
+		  size_t num_glyphs)	// I - Number of glyphs
+{
+  cairo_matrix_t units_to_user;		// Font units to user space
+  double upem = font->ft_face && font->ft_face->units_per_EM ? font->ft_face->units_per_EM : 1000.0;
+
+  // Font units are y-up, glyph space is y-down
+  cairo_matrix_init_scale(&units_to_user, 1.0 / upem, -1.0 / upem);
+  cairo_matrix_multiply(&units_to_user, &units_to_user, font_matrix);
+
+  for (size_t i = 0; i < num_glyphs; i ++)
+  {
+    const p2c_outline_t *outline = p2c_font_get_outline(font, (FT_UInt)glyphs[i].index);
+
+    if (!outline)
+      continue;
+
+    for (size_t j = 0; j < outline->num_data; j += outline->data[j].header.length)
+    {
+      const cairo_path_data_t *element = outline->data + j;
+      double pts[6];
+
+      for (int k = 1; k < element->header.length; k ++)
+      {
+        pts[2 * k - 2] = element[k].point.x;
+        pts[2 * k - 1] = element[k].point.y;
+        cairo_matrix_transform_distance(&units_to_user, pts + 2 * k - 2, pts + 2 * k - 1);
+        pts[2 * k - 2] += glyphs[i].x;
+        pts[2 * k - 1] += glyphs[i].y;
+      }
+
+      switch (element->header.type)
+      {
+        case CAIRO_PATH_MOVE_TO :
+            cairo_move_to(dev->cr, pts[0], pts[1]);
+            break;
+        case CAIRO_PATH_LINE_TO :
+            cairo_line_to(dev->cr, pts[0], pts[1]);
+            break;
+        case CAIRO_PATH_CURVE_TO :
+            cairo_curve_to(dev->cr, pts[0], pts[1], pts[2], pts[3], pts[4], pts[5]);
+            break;
+        case CAIRO_PATH_CLOSE_PATH :
+            cairo_close_path(dev->cr);
+            break;
+      }
+    }
+  }
+}
@@ -23,6 +23,9 @@ _apply_fill_color(p2c_device_t *dev)		// I - Active Rendering Context
   // Target the graphics state at the top of the stack.
   graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
 
+  // Queued text must be drawn before anything painted after it.
+  device_flush_text(dev);
+
   // Apply RGB and alpha transparency to the Cairo context.
   cairo_set_source_rgba(dev->cr, gs->fill_rgb[0], gs->fill_rgb[1], gs->fill_rgb[2], gs->fill_alpha);
 }
@@ -39,11 +42,18 @@ _apply_stroke_color(p2c_device_t *dev)		// I - Active Rendering Context
   // Target the graphics state at the top of the stack.
   graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
 
+  // Queued text must be drawn before anything painted after it.
+  device_flush_text(dev);
+
   // Sets Cairo source to the current stroke color settings.
   cairo_set_source_rgba(dev->cr, gs->stroke_rgb[0], gs->stroke_rgb[1], gs->stroke_rgb[2], gs->stroke_alpha);
 }
 
 // --- Path Construction ---
+//
+// Text extraction devices have no Cairo context, so path construction
+// and painting do nothing on them.
+//
 
 //
 // 'device_move_to()' - Starts a new sub-path at the specified (x, y) coordinates.
@@ -53,6 +63,9 @@ void 						  // O - Void
 device_move_to(p2c_device_t *dev,		// I - Active Rendering Context
 	       double x, double y)		// I - X and Y coordinates
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Path Move To (%f, %f)\n", x, y);
 
@@ -68,6 +81,9 @@ void 						  // O - Void
 device_line_to(p2c_device_t *dev, 		// I - Active Rendering Context
 	       double x, double y)		// I - X and Y coordinates
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Path Line To (%f, %f)\n", x, y);
 
@@ -85,6 +101,9 @@ device_curve_to(p2c_device_t *dev, 		// I - Active Rendering Context
 		double x2, double y2, 		// I - Control point 2 coordinates
 		double x3, double y3)		// I - End Point coordinates
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Path Curve To (%f,%f %f,%f %f,%f)\n", x1, y1, x2, y2, x3, y3);
 
@@ -101,6 +120,9 @@ device_rectangle(p2c_device_t *dev, 		// I - Active Rendering Context
 		 double x, double y, 		// I - Coordinate of lower left coordinates
 		 double w, double h)		// I - Width and Height of Rectangle
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Path Rectangle (%f,%f size %f x %f)\n", x, y, w, h);
 
@@ -115,6 +137,9 @@ device_rectangle(p2c_device_t *dev, 		// I - Active Rendering Context
 void 						  // O - Void
 device_close_path(p2c_device_t *dev)		// I - Active Rendering Context
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Path Close\n");
 
@@ -132,6 +157,9 @@ device_close_path(p2c_device_t *dev)		// I - Active Rendering Context
 void 						  // O - Void
 device_stroke(p2c_device_t *dev)		// I - Active Rendering Context
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Paint Stroke\n");
 
@@ -149,6 +177,9 @@ device_stroke(p2c_device_t *dev)		// I - Active Rendering Context
 void 						  // O - Void
 device_fill(p2c_device_t *dev)			// I - Active Rendering Context	
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Paint Fill\n");
 
@@ -168,6 +199,9 @@ device_fill(p2c_device_t *dev)			// I - Active Rendering Context
 void 						  // O - Void
 device_fill_preserve(p2c_device_t *dev)		// I - Active Rendering Context
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Paint Fill Preserve\n");
 
@@ -185,6 +219,9 @@ device_fill_preserve(p2c_device_t *dev)		// I - Active Rendering Context
 void 						  // O - Void
 device_fill_even_odd(p2c_device_t *dev)		// I - Active Rendering Context
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Paint Fill (Even/Odd Rule)\n");
 
@@ -208,6 +245,9 @@ device_fill_even_odd(p2c_device_t *dev)		// I - Active Rendering Context
 void 							  // O - Void		
 device_fill_preserve_even_odd(p2c_device_t *dev)	// I - Active Rendering Context
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Paint Fill Preserve (Even/Odd Rule)\n");
 
@@ -234,9 +274,15 @@ device_fill_preserve_even_odd(p2c_device_t *dev)	// I - Active Rendering Context
 void 						  // O - Void
 device_clip(p2c_device_t *dev)			// I - Active Rendering Context
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Set Clip Path\n");
 
+  // Queued text was shown under the old clip.
+  device_flush_text(dev);
+
   // Ensure the Non-Zero rule is used for the clip.
   cairo_set_fill_rule(dev->cr, CAIRO_FILL_RULE_WINDING);
 
@@ -255,9 +301,15 @@ device_clip(p2c_device_t *dev)			// I - Active Rendering Context
 void 						  // O - Void
 device_clip_even_odd(p2c_device_t *dev)		// I - Active Rendering Context
 {
+  if (!dev->cr)
+    return;
+
   if (g_verbose) 
     printf("DEBUG: Set Clip Path (Even/Odd Rule)\n");
 
+  // Queued text was shown under the old clip.
+  device_flush_text(dev);
+
   // Set the Even-Odd rule for the clip.
   cairo_set_fill_rule(dev->cr, CAIRO_FILL_RULE_EVEN_ODD);
 
@@ -277,7 +329,7 @@ void                              			  // O - Void
 device_get_current_point(p2c_device_t *dev, 		// I - Active Rendering Context
                          double *x, double *y) 		// O - Current X and Y
 {
-  if (cairo_has_current_point(dev->cr))
+  if (dev->cr && cairo_has_current_point(dev->cr))
   {
     cairo_get_current_point(dev->cr, x, y);
   }
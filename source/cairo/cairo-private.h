@@ -30,8 +30,19 @@ typedef enum
   CS_DEVICE_GRAY,
   CS_DEVICE_RGB,
   CS_DEVICE_CMYK,
+  CS_SEPARATION,			// Tint shown as gray, 1 is full colorant
+  CS_INDEXED,				// Index into a palette
 } p2c_colorspace_t;
 
+// An Indexed color space with its colors converted to pixels once, cached
+// by the document
+typedef struct p2c_palette_s
+{
+  const void		*key;		// Indexed color space array
+  int			hival;		// Highest index
+  uint32_t		pixels[256];	// Opaque ARGB32 pixel of each index
+} p2c_palette_t;
+
 // Our internal graphics state structure
 typedef struct graphics_state_s
 {
@@ -40,6 +51,7 @@ typedef struct graphics_state_s
   double 	line_width;
   double 	fill_alpha;
   double 	stroke_alpha;
+  cairo_matrix_t ctm;			// User space to device space
   cairo_matrix_t text_matrix;
   cairo_matrix_t text_line_matrix;
   double 	text_leading;
@@ -47,20 +59,89 @@ typedef struct graphics_state_s
   // Text State
   double 	font_size;
   char 		font_name[128];
-  int 		encoding[256];
   int 		text_rendering_mode;
+  double	char_spacing;		// Tc, in unscaled text space units
+  double	word_spacing;		// Tw, in unscaled text space units
+  double	horiz_scale;		// Tz / 100
+  double	text_rise;		// Ts, in unscaled text space units
+  struct p2c_font_s *font;		// Font selected by the last Tf, if loaded
 
   p2c_colorspace_t fill_colorspace;
   p2c_colorspace_t stroke_colorspace;
+  const p2c_palette_t *fill_palette;	// Palette of an Indexed fill color space
+  const p2c_palette_t *stroke_palette;	// Palette of an Indexed stroke color space
 } graphics_state_t;
 
+#define P2C_OUTLINE_BUCKETS	256		// Hash buckets per outline cache (power of 2)
+#define P2C_OUTLINE_CACHE_BUDGET (1024 * 1024)	// Outline bytes cached per font
+
+// A glyph outline in font units
+typedef struct p2c_outline_s
+{
+  FT_UInt		glyph;		// Glyph index
+  cairo_path_data_t	*data;		// Path elements, y-up font units
+  size_t		num_data;	// Number of path elements
+  size_t		bytes;		// Memory charged to the cache
+  struct p2c_outline_s	*hash_next,	// Next outline in bucket
+			*lru_prev,	// More recently used outline
+			*lru_next;	// Less recently used outline
+} p2c_outline_t;
+
+// Per-font outline cache with LRU eviction
+typedef struct p2c_outline_cache_s
+{
+  p2c_outline_t		*buckets[P2C_OUTLINE_BUCKETS];
+  p2c_outline_t		*lru_head,	// Most recently used outline
+			*lru_tail;	// Least recently used outline
+  size_t		bytes;		// Memory used by all outlines
+} p2c_outline_cache_t;
+
+// Width of a range of CIDs, from a /W array
+typedef struct p2c_cid_width_s
+{
+  uint32_t	first,			// First CID
+		last;			// Last CID
+  double	width;			// Width in 1/1000 text space
+} p2c_cid_width_t;
+
+#define P2C_TYPE3_MASKS		4	// Cached mask scales per Type 3 glyph
+#define P2C_TYPE3_MAX_DEPTH	4	// Maximum nesting of Type 3 glyphs
+#define P2C_TYPE3_MAX_MASK	1024	// Largest Type 3 mask in pixels per side
+
+#define P2C_GLYPH_CACHE_BUDGET	(16 * 1024 * 1024)
+					// Default memory budget of the glyph mask cache
+#define P2C_GLYPH_CACHE_MAX_SIZE 256	// Largest cached glyph mask in pixels per side
+#define P2C_GLYPH_SUBPIXEL	4	// Sub-pixel positions of cached glyphs per pixel
+
+#define P2C_IMAGE_SCALED	4	// Cached box filtered sizes per image
+
+// A d1 Type 3 glyph rasterized at one device scale
+typedef struct p2c_type3_mask_s
+{
+  int32_t		scale[4];	// Text space to device space, 1/16 pixel units
+  cairo_surface_t	*mask;		// A8 coverage
+  int			x, y;		// Offset of mask from glyph origin in pixels
+} p2c_type3_mask_t;
+
+// A compiled Type 3 glyph
+typedef struct p2c_type3_glyph_s
+{
+  bool			loaded;		// Has the CharProc been compiled?
+  parser_program_t	*program;	// Compiled CharProc or NULL
+  p2c_type3_mask_t	masks[P2C_TYPE3_MASKS];
+  size_t		num_masks,	// Number of cached masks
+			next_mask;	// Mask to replace when full
+} p2c_type3_glyph_t;
+
 typedef struct p2c_font_s
 {
-  const char	*ref_font_name;		// PDF font reference Name e.g. "F1"
+  size_t	obj_number;		// Font object number, 0 for direct fonts
+  pdfio_dict_t	*direct_dict;		// Font dictionary of a direct font, owned by the PDF file
   const char   	*font_name;    		// Original Font Name e.g. "BCDEEE+Calibri"
   const char	*encoding;		// Encoding type.
-  uint8_t   	*data;         		// Font Binary data
+  uint8_t   	*data;         		// Embedded font program, owned by ft_face
   size_t    	data_size;     		// size of data
+  uint64_t	font_id;		// Identity of the font program for the glyph cache, 0 for none
 					
   int           first_char;       	// starting CID/GID
   int           last_char;        	// ending CID/GID
@@ -68,33 +149,194 @@ typedef struct p2c_font_s
   size_t 	num_widths;		// Number of Extracted /Widths Array
 
   int           encoding_table[256];
+  FT_UInt	glyph_ids[256];		// Character code to glyph index in ft_face
+  double	advances[256];		// Character code to advance in 1/1000 text space
+  const pdfrip_cmap_t *to_unicode;	// ToUnicode CMap or NULL
+  uint32_t	unicode[256];		// Character code to Unicode value for simple fonts
+
+  // Composite (Type0) fonts
+  bool		cid;			// Is this a Type0 font?
+  bool		embedded;		// Was the font program embedded?
+  const pdfrip_cmap_t *cmap;		// Character code to CID map
+  uint16_t	*cid_to_gid;		// CIDToGIDMap, NULL for Identity
+  size_t	num_cid_to_gid;		// Number of entries in cid_to_gid
+  p2c_cid_width_t *cid_widths;		// Sorted /W intervals
+  size_t	num_cid_widths;		// Number of intervals
+  double	default_width;		// /DW
+  uint32_t	*gid_to_unicode;	// Glyph index to Unicode, when there is no ToUnicode
+  size_t	num_gid_to_unicode;	// Number of entries in gid_to_unicode
+
+  // Type 3 fonts
+  bool		type3;			// Is this a Type 3 font?
+  cairo_matrix_t type3_matrix;		// FontMatrix, glyph space to text space
+  pdfio_dict_t	*type3_resources;	// Resources of the CharProcs or NULL
+  pdfio_obj_t	*char_procs[256];	// Character code to CharProc
+  p2c_type3_glyph_t *type3_glyphs;	// Compiled glyphs, allocated on first use
 
   FT_Face       ft_face;            	// Active FreeType face object initialized from 'data'
   cairo_font_face_t *cairo_face; 	// The face created for Cairo
+  p2c_outline_cache_t outlines;		// Glyph outlines for stroke and clip modes
 } p2c_font_t;
 
+// An image reduced with a box filter for placements much smaller than it
+typedef struct p2c_image_scaled_s
+{
+  int			x_factor,	// Image pixels per reduced pixel
+			y_factor;
+  cairo_surface_t	*surface;	// Reduced pixels
+} p2c_image_scaled_t;
+
+// A decoded image XObject, cached by the document
+typedef struct p2c_image_s
+{
+  size_t		obj_number;	// Image object number
+  cairo_surface_t	*surface;	// Pixels, NULL if the image could not be decoded
+  int			width,		// Size in pixels
+			height;
+  bool			interpolate;	// Smooth when enlarged?
+  int			scale;		// JPEG IDCT scale denominator, 1 for full size
+  bool			strips;		// Too large to cache, drawn in strips
+  bool			stencil,	// ImageMask, A1/A8 coverage in the fill color
+			bilevel;	// Black and white, A1/A8 coverage of black
+  p2c_image_scaled_t	scaled[P2C_IMAGE_SCALED];
+  size_t		num_scaled,	// Number of reduced copies
+			next_scaled;	// Copy to replace when full
+  size_t		bytes,		// Memory charged to the cache, reduced copies included
+			saved;		// Bytes saved by scaled decoding
+  uint64_t		last_used;	// Document image clock at last use
+} p2c_image_t;
+
+// A large image XObject, decoded a strip of rows at a time
+typedef struct p2c_image_strips_s
+{
+  int			width,		// Decoded size in pixels
+			height;
+  bool			interpolate,	// Smooth when enlarged?
+			has_alpha;	// Is there a mask?
+  uint32_t		*last_row;	// Last row of the previous strip
+  struct image_decoder_s *decoder;	// Row decoder
+} p2c_image_strips_t;
+
+// A font as named by the resources of the current page
+typedef struct p2c_font_ref_s
+{
+  const char	*name;			// Resource name, e.g. "F1"
+  p2c_font_t	*font;			// Font, owned by the document
+} p2c_font_ref_t;
+
+// Glyphs shown in a text object, batched until something forces a flush
+typedef struct p2c_text_run_s
+{
+  p2c_font_t		*font;		// Font of every glyph in the run
+  cairo_font_face_t	*face;		// Cairo face of font
+  cairo_matrix_t	font_matrix;	// Glyph to device space, without translation
+  int			mode;		// Text rendering mode (Tr)
+  double		color[4];	// Fill color and alpha
+  double		stroke_color[4];// Stroke color and alpha
+  double		line_width;	// Stroke width in device space
+  size_t		num_glyphs;	// Number of glyphs queued in dev->glyphs
+} p2c_text_run_t;
+
+// A word collected by a text extraction device
+typedef struct p2c_text_word_s
+{
+  size_t		start,		// First code point in the page text
+			length;		// Number of code points
+  double		x1, y1,		// Upper-left corner in device space
+			x2, y2;		// Lower-right corner in device space
+  double		base_x,		// Origin of the first glyph
+			base_y;
+  double		size;		// Font height in device space
+} p2c_text_word_t;
+
+// Text collected from a page by a text extraction device
+typedef struct p2c_text_page_s
+{
+  uint32_t		*text;		// Code points of all words
+  size_t		num_text,	// Number of code points
+			alloc_text;	// Allocated size of text
+  p2c_text_word_t	*words;		// Words in content stream order
+  size_t		num_words,	// Number of words
+			alloc_words;	// Allocated size of words
+  bool			in_word;	// Can the last word still grow?
+  double		next_x,		// Where the last word would continue
+			next_y;
+} p2c_text_page_t;
+
+#define P2C_MAX_CHAR_TEXT 8	// Maximum code points extracted per character code
+
+// Output formats of text extraction
+typedef enum p2c_text_format_e
+{
+  P2C_TEXT_PLAIN,			// UTF-8 text, one line per text line
+  P2C_TEXT_JSON				// Words with bounding boxes as JSON
+} p2c_text_format_t;
+
+FT_Library p2c_font_library(void);
+FT_Error p2c_font_new_face(const unsigned char *data, size_t size, int index, FT_Face *face);
+void p2c_font_done_face(void *face);
 void p2c_font_destroy(p2c_font_t *font);
+void p2c_type3_clear(p2c_font_t *font);
+void device_show_type3_text(p2c_device_t *dev, const unsigned char *codes, size_t len);
+bool p2c_glyph_cache_get(const p2c_font_t *font, FT_UInt glyph, const cairo_matrix_t *font_matrix,
+			 double x, double y, cairo_surface_t **mask, int *mask_x, int *mask_y);
+void p2c_glyph_cache_set_budget(size_t bytes);
+void p2c_glyph_cache_stats(size_t *count, size_t *bytes, size_t *hits, size_t *misses);
+void p2c_glyph_cache_clear(void);
+double p2c_font_cid_width(const p2c_font_t *font, uint32_t cid);
+size_t p2c_font_get_unicode(const p2c_font_t *font, const unsigned char *str, size_t len,
+			    uint32_t *text, size_t textsize);
+const p2c_outline_t *p2c_font_get_outline(p2c_font_t *font, FT_UInt glyph);
+void p2c_outline_cache_clear(p2c_outline_cache_t *cache);
+void device_glyph_path(p2c_device_t *dev, p2c_font_t *font, const cairo_matrix_t *font_matrix,
+		       const cairo_glyph_t *glyphs, size_t num_glyphs);
 void device_clear_fonts(p2c_device_t *dev);
+void device_draw_image(p2c_device_t *dev, pdfio_obj_t *obj, pdfio_dict_t *resources);
+bool getDocColorSpace(pdfrip_doc_t *doc, pdfio_dict_t *resources, const char *name,
+		      p2c_colorspace_t *family, const p2c_palette_t **palette);
+void device_init(p2c_device_t *dev, pdfrip_page_t *page, int dpi);
+p2c_device_t *device_create_text(pdfrip_page_t *page, int dpi);
+void device_add_text_char(p2c_device_t *dev, const uint32_t *text, size_t num_text,
+			  const double bbox[4], const double origin[2], const double end[2], double size);
+void device_write_text(p2c_device_t *dev, FILE *fp, p2c_text_format_t format, size_t pagenum);
+bool device_index_fonts(p2c_device_t *dev);
+p2c_font_t *device_find_font(p2c_device_t *dev, const char *name);
 
 
 // The complete device structure definition
 struct cairo_device_s
 {
-  cairo_surface_t 	*surface;
-  cairo_t 	  	*cr;
+  cairo_surface_t 	*surface;	// Page surface, NULL for text extraction
+  cairo_t 	  	*cr;		// Cairo context, NULL for text extraction
+  double		width,		// Page size in device space
+			height;
+  p2c_text_page_t	*extract;	// Collected text, for text extraction
   graphics_state_t 	gstack[MAX_GSTATE];
   int 			gstack_ptr;
 
   // font context
   pdfio_dict_t 		*font_dict;
-  p2c_font_t        	**fonts;    // Array of extracted font structures
+  pdfrip_doc_t		*doc;		// Document, owner of the font cache
+  p2c_font_ref_t	*fonts;		// Fonts of the page resources
   size_t            	num_fonts;
+  cairo_glyph_t		*glyphs;	// Device space glyphs of text_run
+  size_t		glyph_capacity;	// Allocated size of glyphs
+  p2c_text_run_t	text_run;	// Pending text run
+  int			type3_depth;	// Nesting of Type 3 glyphs being drawn
+  double		greek_threshold;// Draw text smaller than this many pixels as bars
+  cairo_path_t		**text_clip;	// Glyph outlines of clipping text modes
+  size_t		num_text_clip,	// Number of outlines in text_clip
+			alloc_text_clip;// Allocated size of text_clip
+  p2c_font_ref_t	**font_hash;	// Open-addressing index keyed by resource name
+  size_t		font_hash_size;	// Number of slots in font_hash (power of 2)
 
-  // TODO: For XOBJECTS
-  pdfio_dict_t 		*xobject_dict;
+  // XObjects
+  pdfio_dict_t 		*xobject_dict;	// XObjects of the page, for Do without resources
   pdfio_obj_t 		*page_obj;
 };
 
+void	      device_flush_text(p2c_device_t *dev);
+
 p2c_device_t* device_create(pdfrip_page_t *page, int dpi);
 void 	      device_destroy(p2c_device_t *dev);
 void 	      device_save_to_png(p2c_device_t *dev, const char *filename);
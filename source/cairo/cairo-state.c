@@ -42,8 +42,14 @@ device_transform(p2c_device_t *dev,    // I - Active Rendering Context
   // Initialize a cairo matrix with the PDF operands
   cairo_matrix_init(&matrix, a, b, c, d, e, f);
 
+  // The CTM is tracked in the graphics state for devices without a Cairo
+  // context and so text never has to ask Cairo for it
+  graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
+  cairo_matrix_multiply(&gs->ctm, &matrix, &gs->ctm);
+
   // Apply the transformation to the current context
-  cairo_transform(dev->cr, &matrix);
+  if (dev->cr)
+    cairo_transform(dev->cr, &matrix);
 }
 
 // --- Graphics State Management ---
@@ -59,7 +65,8 @@ device_save_state(p2c_device_t *dev)		// I - Active Rendering Context
   if (dev->gstack_ptr < (MAX_GSTATE - 1))
   {
     // Save the internal Cairo context state
-    cairo_save(dev->cr);
+    if (dev->cr)
+      cairo_save(dev->cr);
     // Copy the current custom state structure to the next slot
     memcpy(&dev->gstack[dev->gstack_ptr + 1], &dev->gstack[dev->gstack_ptr], sizeof(graphics_state_t));
     // Move the pointer up
@@ -82,11 +89,15 @@ device_save_state(p2c_device_t *dev)		// I - Active Rendering Context
 void 						  // O - Void
 device_restore_state(p2c_device_t *dev)		// I - Active Rendering Context
 {
+  // Queued text was shown under the clip being restored
+  device_flush_text(dev);
+
   // Ensure there is a state to return to
   if (dev->gstack_ptr > 0)
   {
     // Revert the Cairo context to its previous settings
-    cairo_restore(dev->cr);
+    if (dev->cr)
+      cairo_restore(dev->cr);
     //Move the pointer down
     dev->gstack_ptr--;
     if (g_verbose)
@@ -114,7 +125,8 @@ device_set_line_width(p2c_device_t *dev, 	// I - Active Rendering Context
   dev->gstack[dev->gstack_ptr].line_width = width;
 
   // Apply the line width directly to the Cairo context so it takes effect immediately.
-  cairo_set_line_width(dev->cr, width);
+  if (dev->cr)
+    cairo_set_line_width(dev->cr, width);
 }
 
 //
@@ -139,6 +151,7 @@ device_set_fill_rgb(p2c_device_t *dev,			// I - Active Rendering Context
   
   // Mark the colorspace as RGB.
   gs->fill_colorspace = CS_DEVICE_RGB;
+  gs->fill_palette = NULL;
 }
 
 //
@@ -163,6 +176,7 @@ device_set_stroke_rgb(p2c_device_t *dev, 		// I - Active Rendering Context
 
   // Mark the colorspace as RGB.
   gs->stroke_colorspace = CS_DEVICE_RGB;
+  gs->stroke_palette = NULL;
 }
 
 //
@@ -187,6 +201,7 @@ device_set_fill_gray(p2c_device_t *dev, 	// I - Active Rendering Context
 
   // Update colorspace flag
   gs->fill_colorspace = CS_DEVICE_GRAY;
+  gs->fill_palette = NULL;
 }
 
 //
@@ -211,6 +226,7 @@ device_set_stroke_gray(p2c_device_t *dev, 	// I - Active rendering Context
 
   // Update colorspace flag
   gs->stroke_colorspace = CS_DEVICE_GRAY;
+  gs->stroke_palette = NULL;
 }
 
 //
@@ -234,6 +250,7 @@ device_set_fill_cmyk(p2c_device_t *dev, 	// I - Active Rendering Context
 
   // Mark colorspace as CMYK.
   gs->fill_colorspace = CS_DEVICE_CMYK;
+  gs->fill_palette = NULL;
 }
 
 //
@@ -257,6 +274,174 @@ device_set_stroke_cmyk(p2c_device_t *dev, 	// I - Active Rendering Context
 
   // Mark colorspace as CMYK.
   gs->stroke_colorspace = CS_DEVICE_CMYK;
+  gs->stroke_palette = NULL;
+}
+
+//
+// 'set_colorspace()' - Select a color space and its initial color.
+//
+
+static void
+set_colorspace(p2c_device_t        *dev,	// I - Active Rendering Context
+	       pdfio_dict_t        *resources,	// I - Resources of the content stream
+	       const char          *name,	// I - Color space name
+	       p2c_colorspace_t    *family,	// O - Color space family
+	       const p2c_palette_t **palette,	// O - Palette of an Indexed space
+	       double              *rgb)	// O - Initial color
+{
+  p2c_colorspace_t	new_family;	// Color space family
+  const p2c_palette_t	*new_palette;	// Indexed palette
+
+  if (!dev->doc || !getDocColorSpace(dev->doc, resources, name, &new_family, &new_palette))
+  {
+    if (g_verbose)
+      printf("DEBUG: Unsupported color space /%s, keeping the current color\n", name);
+    return;
+  }
+
+  *family  = new_family;
+  *palette = new_palette;
+
+  // The initial color is black, the first palette entry, or full colorant
+  if (new_palette)
+  {
+    uint32_t pixel = new_palette->pixels[0];
+
+    rgb[0] = ((pixel >> 16) & 255) / 255.0;
+    rgb[1] = ((pixel >> 8) & 255) / 255.0;
+    rgb[2] = (pixel & 255) / 255.0;
+  }
+  else
+  {
+    rgb[0] = rgb[1] = rgb[2] = 0.0;
+  }
+}
+
+//
+// 'device_set_fill_colorspace()' - Sets the color space used for fill
+// 				    operations (corresponding to the 'cs' operator).
+//
+
+void 							  // O - Void
+device_set_fill_colorspace(p2c_device_t *dev,		// I - Active Rendering Context
+			   pdfio_dict_t *resources,	// I - Resources of the content stream
+			   const char   *name)		// I - Color space name
+{
+  graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
+
+  if (g_verbose)
+    printf("DEBUG: Setting fill color space to /%s\n", name);
+
+  set_colorspace(dev, resources, name, &gs->fill_colorspace, &gs->fill_palette, gs->fill_rgb);
+}
+
+//
+// 'device_set_stroke_colorspace()' - Sets the color space used for stroke
+// 				      operations (corresponding to the 'CS' operator).
+//
+
+void 							  // O - Void
+device_set_stroke_colorspace(p2c_device_t *dev,		// I - Active Rendering Context
+			     pdfio_dict_t *resources,	// I - Resources of the content stream
+			     const char   *name)	// I - Color space name
+{
+  graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
+
+  if (g_verbose)
+    printf("DEBUG: Setting stroke color space to /%s\n", name);
+
+  set_colorspace(dev, resources, name, &gs->stroke_colorspace, &gs->stroke_palette, gs->stroke_rgb);
+}
+
+//
+// 'set_color()' - Convert the components of a color in the current color space.
+//
+// Colors with the wrong number of components for the space are ignored.
+//
+
+static void
+set_color(p2c_colorspace_t    family,	// I - Color space family
+	  const p2c_palette_t *palette,	// I - Palette of an Indexed space
+	  const double        *values,	// I - Color components
+	  int                 num_values,// I - Number of components
+	  double              *rgb)	// O - RGB color
+{
+  switch (family)
+  {
+    case CS_DEVICE_GRAY :
+        if (num_values == 1)
+          rgb[0] = rgb[1] = rgb[2] = values[0];
+        break;
+
+    case CS_DEVICE_RGB :
+        if (num_values == 3)
+          memcpy(rgb, values, 3 * sizeof(double));
+        break;
+
+    case CS_DEVICE_CMYK :
+        if (num_values == 4)
+          cmyk_to_rgb(values[0], values[1], values[2], values[3], rgb + 0, rgb + 1, rgb + 2);
+        break;
+
+    case CS_SEPARATION :
+        if (num_values == 1)
+          rgb[0] = rgb[1] = rgb[2] = 1.0 - values[0];
+        break;
+
+    case CS_INDEXED :
+        if (num_values == 1 && palette)
+        {
+          int		index = (int)values[0];	// Palette index
+          uint32_t	pixel;			// Palette pixel
+
+          if (index < 0)
+            index = 0;
+          else if (index > palette->hival)
+            index = palette->hival;
+
+          pixel  = palette->pixels[index];
+          rgb[0] = ((pixel >> 16) & 255) / 255.0;
+          rgb[1] = ((pixel >> 8) & 255) / 255.0;
+          rgb[2] = (pixel & 255) / 255.0;
+        }
+        break;
+  }
+}
+
+//
+// 'device_set_fill_color()' - Sets the fill color in the current fill color
+// 			       space (corresponding to the 'sc' and 'scn' operators).
+//
+
+void 							  // O - Void
+device_set_fill_color(p2c_device_t *dev,		// I - Active Rendering Context
+		      const double *values,		// I - Color components
+		      int          num_values)		// I - Number of components
+{
+  graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
+
+  if (g_verbose)
+    printf("DEBUG: Setting fill color with %d components\n", num_values);
+
+  set_color(gs->fill_colorspace, gs->fill_palette, values, num_values, gs->fill_rgb);
+}
+
+//
+// 'device_set_stroke_color()' - Sets the stroke color in the current stroke color
+// 				 space (corresponding to the 'SC' and 'SCN' operators).
+//
+
+void 							  // O - Void
+device_set_stroke_color(p2c_device_t *dev,		// I - Active Rendering Context
+			const double *values,		// I - Color components
+			int          num_values)	// I - Number of components
+{
+  graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
+
+  if (g_verbose)
+    printf("DEBUG: Setting stroke color with %d components\n", num_values);
+
+  set_color(gs->stroke_colorspace, gs->stroke_palette, values, num_values, gs->stroke_rgb);
 }
 
 //
@@ -8,6 +8,7 @@
 
 #include "cairo-private.h"
 #include "../pdf/pdfops-private.h"
+#include <math.h>
 
 void 
 device_begin_text(p2c_device_t *dev) 
@@ -21,7 +22,31 @@ device_begin_text(p2c_device_t *dev)
 
 void 
 device_end_text(p2c_device_t *dev) 
-{}
+{
+  device_flush_text(dev);
+
+  if (dev->num_text_clip == 0)
+    return;
+
+  // Intersect the clip with the outlines of all glyphs shown in a clipping
+  // mode.  The outlines are in device space and the clip must outlive ET,
+  // so swap the CTM rather than saving the Cairo state.
+  cairo_matrix_t ctm;
+  cairo_get_matrix(dev->cr, &ctm);
+  cairo_identity_matrix(dev->cr);
+  cairo_new_path(dev->cr);
+
+  for (size_t i = 0; i < dev->num_text_clip; i++)
+  {
+    cairo_append_path(dev->cr, dev->text_clip[i]);
+    cairo_path_destroy(dev->text_clip[i]);
+  }
+  dev->num_text_clip = 0;
+
+  cairo_set_fill_rule(dev->cr, CAIRO_FILL_RULE_WINDING);
+  cairo_clip(dev->cr);
+  cairo_set_matrix(dev->cr, &ctm);
+}
 
 void 
 device_set_text_leading(p2c_device_t *dev, 
@@ -66,115 +91,616 @@ device_set_font(p2c_device_t *dev,
 {
   graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
 
+  // Repeating a Tf for the font and size already selected is a no-op; the
+  // selection lives in the graphics state, which q/Q save and restore.
+  if (gs->font && gs->font_size == font_size && !strcmp(gs->font_name, font_name))
+    return;
+
   gs->font_size = font_size;
   // Safely copy the font name to the graphics state
   strncpy(gs->font_name, font_name, sizeof(gs->font_name) - 1);
   gs->font_name[sizeof(gs->font_name) - 1] = '\0';
 
-  // Find the loaded font in our extracted device fonts array
-  p2c_font_t *active_font = NULL;
-  for (size_t i = 0; i < dev->num_fonts; i++) 
+  // Find the loaded font by its PDF resource name (e.g., "F1")
+  p2c_font_t *active_font = device_find_font(dev, font_name);
+
+  // device_show_text() applies the face and size when it draws
+  if (g_verbose)
+  {
+    if (active_font && active_font->cairo_face)
+      fprintf(stderr, "DEBUG: Selecting font face: %s\n", font_name);
+    else
+      fprintf(stderr, "DEBUG: Font %s has no usable face, text will only advance.\n", font_name);
+  }
+
+  // Glyph and Unicode maps were built when the font was loaded
+  gs->font = active_font;
+}
+
+void 
+device_set_char_spacing(p2c_device_t *dev, 
+			double spacing) 
+{
+  dev->gstack[dev->gstack_ptr].char_spacing = spacing;
+}
+
+void 
+device_set_word_spacing(p2c_device_t *dev, 
+			double spacing) 
+{
+  dev->gstack[dev->gstack_ptr].word_spacing = spacing;
+}
+
+void 
+device_set_horizontal_scaling(p2c_device_t *dev, 
+			      double scale) 
+{
+  dev->gstack[dev->gstack_ptr].horiz_scale = scale / 100.0;
+}
+
+void 
+device_set_text_rise(p2c_device_t *dev, 
+		     double rise) 
+{
+  dev->gstack[dev->gstack_ptr].text_rise = rise;
+}
+
+//
+// 'reserve_glyphs()' - Make room for a number of glyphs in the glyph buffer
+//
+
+static bool				  // O - true on success, false on error
+reserve_glyphs(p2c_device_t *dev,	// I - Active Rendering Context
+	       size_t count)		// I - Number of glyphs needed
+{
+  cairo_glyph_t *glyphs;		// New glyph buffer
+  size_t capacity;			// New capacity
+
+  if (count <= dev->glyph_capacity)
+    return (true);
+
+  capacity = dev->glyph_capacity ? dev->glyph_capacity : 256;
+  while (capacity < count)
+    capacity *= 2;
+
+  if ((glyphs = realloc(dev->glyphs, capacity * sizeof(cairo_glyph_t))) == NULL)
+    return (false);
+
+  dev->glyphs = glyphs;
+  dev->glyph_capacity = capacity;
+
+  return (true);
+}
+
+//
+// 'add_text_clip()' - Keep the current path for the text clip applied at ET.
+//
+
+static void
+add_text_clip(p2c_device_t *dev)	// I - Active Rendering Context
+{
+  if (dev->num_text_clip == dev->alloc_text_clip)
   {
-    // Match the requested PDF resource name (e.g., "F1") with the parsed font
-    if (dev->fonts[i] && dev->fonts[i]->ref_font_name && 
-        strcmp(dev->fonts[i]->ref_font_name, font_name) == 0) 
+    size_t alloc = dev->alloc_text_clip ? dev->alloc_text_clip * 2 : 16;
+    cairo_path_t **text_clip = realloc(dev->text_clip, alloc * sizeof(cairo_path_t *));
+
+    if (!text_clip)
+      return;
+
+    dev->text_clip = text_clip;
+    dev->alloc_text_clip = alloc;
+  }
+
+  dev->text_clip[dev->num_text_clip++] = cairo_copy_path(dev->cr);
+}
+
+//
+// 'p2c_font_cid_width()' - Get the width of a CID from the font's /W intervals.
+//
+
+double					  // O - Width in 1/1000 text space
+p2c_font_cid_width(const p2c_font_t *font,// I - Type0 font
+		   uint32_t cid)	// I - CID
+{
+  size_t lo = 0, hi = font->num_cid_widths;
+
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+
+    if (font->cid_widths[mid].last < cid)
+      lo = mid + 1;
+    else if (font->cid_widths[mid].first > cid)
+      hi = mid;
+    else
+      return (font->cid_widths[mid].width);
+  }
+
+  return (font->default_width);
+}
+
+//
+// 'cid_glyph()' - Get the glyph index of a CID.
+//
+
+static inline FT_UInt			  // O - Glyph index, 0 if none
+cid_glyph(const p2c_font_t *font,	// I - Type0 font
+	  uint32_t cid)			// I - CID
+{
+  // Without the embedded program the CIDs mean nothing to our face
+  if (!font->embedded)
+    return (0);
+  else if (font->cid_to_gid)
+    return (cid < font->num_cid_to_gid ? font->cid_to_gid[cid] : 0);
+  else
+    return ((FT_UInt)cid);
+}
+
+//
+// 'p2c_font_get_unicode()' - Get the Unicode text of a character code.
+//
+// The string holds exactly one character code, as found by decoding it
+// with the font.  Simple fonts use the table built at load time; Type0
+// fonts use their ToUnicode CMap, or the reverse of the embedded font's
+// Unicode cmap.
+//
+
+size_t					  // O - Number of code points
+p2c_font_get_unicode(const p2c_font_t *font,// I - Font or NULL
+		     const unsigned char *str,// I - Character code bytes
+		     size_t len,		// I - Length of code
+		     uint32_t *text,		// O - Code points
+		     size_t textsize)		// I - Size of text array
+{
+  uint32_t code = 0, value;
+
+  if (len == 0 || textsize == 0)
+    return (0);
+
+  if (!font)
+  {
+    text[0] = *str;
+    return (1);
+  }
+  else if (!font->cid)
+  {
+    return (cmap_unicode(font->to_unicode, font->unicode[*str], text, textsize));
+  }
+
+  for (size_t i = 0; i < len && i < 4; i ++)
+    code = (code << 8) | str[i];
+
+  if (font->to_unicode && cmap_lookup(font->to_unicode, code, len, &value))
+    return (cmap_unicode(font->to_unicode, value, text, textsize));
+
+  // Otherwise go back from the glyph through the font's own cmap
+  if (font->gid_to_unicode && cmap_lookup(font->cmap, code, len, &value))
+  {
+    FT_UInt glyph = cid_glyph(font, value);
+
+    if (glyph < font->num_gid_to_unicode && font->gid_to_unicode[glyph])
     {
-      active_font = dev->fonts[i];
-      break;
+      text[0] = font->gid_to_unicode[glyph];
+      return (1);
     }
   }
 
-  // Apply the true embedded FreeType font face to the Cairo context
-  if (active_font && active_font->cairo_face) 
+  return (0);
+}
+
+//
+// 'text_next_char()' - Decode the next character of a string.
+//
+// Simple fonts use one byte per code and the glyph map built at load time.
+// Type0 fonts decode multi-byte codes through their CMap and look up the
+// glyph and width of the resulting CID.
+//
+
+static inline size_t			  // O - Number of bytes used
+text_next_char(graphics_state_t *gs,	// I - Graphics state
+	       p2c_font_t *font,	// I - Current font or NULL
+	       const unsigned char *str,// I - String
+	       size_t len,		// I - Bytes left in string
+	       FT_UInt *glyph,		// O - Glyph index, 0 if none
+	       double *advance)		// O - Displacement in text space
+{
+  size_t	n = 1;			// Bytes used
+  double	width;			// Width in 1/1000 text space
+
+  if (!font)
   {
-    if (g_verbose)
-      fprintf(stderr, "DEBUG: Applying embedded font face: %s\n", font_name);
-      
-    cairo_set_font_face(dev->cr, active_font->cairo_face);
-  } 
-  else 
+    *glyph = 0;
+    width  = 500.0;
+  }
+  else if (!font->cid)
   {
-    if (g_verbose)
-      fprintf(stderr, "DEBUG: Font %s not found, falling back to basic Sans.\n", font_name);
-      
-    cairo_select_font_face(dev->cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    *glyph = font->glyph_ids[*str];
+    width  = font->advances[*str];
   }
+  else
+  {
+    uint32_t cid;			// CID of code
+
+    n = cmap_decode(font->cmap, str, len, &cid);
+    *glyph = cid_glyph(font, cid);
+    width = p2c_font_cid_width(font, cid);
+  }
+
+  // tx = (w0 * Tfs / 1000 + Tc + Tw) * Th, with Tw only for single-byte code 32
+  *advance = width * gs->font_size / 1000.0 + gs->char_spacing;
+
+  if (n == 1 && *str == ' ')
+    *advance += gs->word_spacing;
 
-  cairo_set_font_size(dev->cr, font_size);
+  *advance *= gs->horiz_scale;
 
-  // Load the encoding table for this specific font
-  // (NOTE: Using dev->page_obj instead of dev->page based on our previous header fixes!)
-  if (dev->page_obj) {
-      load_encoding(dev->page_obj, font_name, gs->encoding);
+  return (n);
+}
+
+//
+// 'text_width()' - Compute the horizontal displacement of a string.
+//
+
+static double				  // O - Displacement in text space
+text_width(graphics_state_t *gs,	// I - Graphics state
+	   p2c_font_t *font,		// I - Current font or NULL
+	   const unsigned char *str,	// I - String
+	   size_t len)			// I - Length of string
+{
+  double	x = 0.0, advance;
+  FT_UInt	glyph;
+
+  for (size_t i = 0; i < len; i += text_next_char(gs, font, str + i, len - i, &glyph, &advance))
+    x += advance;
+
+  return (x);
+}
+
+//
+// 'device_flush_text()' - Draw the pending text run with one Cairo call.
+//
+
+void
+device_flush_text(p2c_device_t *dev)	// I - Active Rendering Context
+{
+  p2c_text_run_t *run = &dev->text_run;
+  cairo_path_t *user_path = NULL;	// Path under construction, if any
+
+  if (run->num_glyphs == 0)
+    return;
+
+  // Modes 0, 2, 4 and 6 fill; 1, 2, 5 and 6 stroke; 4 to 7 add to the clip
+  bool fill   = run->mode == 0 || run->mode == 2 || run->mode == 4 || run->mode == 6;
+  bool stroke = run->mode == 1 || run->mode == 2 || run->mode == 5 || run->mode == 6;
+  bool clip   = run->mode >= 4;
+
+  // Outlines go through the current path, which a paint operator flushing
+  // us may still need
+  if ((stroke || clip) && cairo_has_current_point(dev->cr))
+    user_path = cairo_copy_path(dev->cr);
+
+  // Glyph positions and the font matrix are already in device space
+  cairo_save(dev->cr);
+  cairo_identity_matrix(dev->cr);
+  cairo_set_font_face(dev->cr, run->face);
+  cairo_set_font_matrix(dev->cr, &run->font_matrix);
+
+  if (fill)
+  {
+    cairo_set_source_rgba(dev->cr, run->color[0], run->color[1], run->color[2], run->color[3]);
+
+    if (run->font->font_id)
+    {
+      // Composite cached masks, drawing glyphs too large to cache directly
+      for (size_t i = 0; i < run->num_glyphs; i++)
+      {
+        cairo_glyph_t	*glyph = dev->glyphs + i;
+        cairo_surface_t	*mask;		// Cached glyph mask
+        int		mask_x, mask_y;	// Position of mask
+
+        if (p2c_glyph_cache_get(run->font, (FT_UInt)glyph->index, &run->font_matrix, glyph->x, glyph->y, &mask, &mask_x, &mask_y))
+        {
+          if (mask)
+          {
+            cairo_mask_surface(dev->cr, mask, mask_x, mask_y);
+            cairo_surface_destroy(mask);
+          }
+        }
+        else
+          cairo_show_glyphs(dev->cr, glyph, 1);
+      }
+    }
+    else
+      cairo_show_glyphs(dev->cr, dev->glyphs, (int)run->num_glyphs);
   }
+
+  if (stroke || clip)
+  {
+    cairo_new_path(dev->cr);
+    device_glyph_path(dev, run->font, &run->font_matrix, dev->glyphs, run->num_glyphs);
+
+    if (clip)
+      add_text_clip(dev);
+
+    if (stroke)
+    {
+      cairo_set_source_rgba(dev->cr, run->stroke_color[0], run->stroke_color[1],
+                            run->stroke_color[2], run->stroke_color[3]);
+      cairo_set_line_width(dev->cr, run->line_width);
+      cairo_stroke(dev->cr);
+    }
+    else
+      cairo_new_path(dev->cr);
+  }
+
+  cairo_restore(dev->cr);
+
+  if (user_path)
+  {
+    cairo_new_path(dev->cr);
+    cairo_append_path(dev->cr, user_path);
+    cairo_path_destroy(user_path);
+  }
+
+  run->num_glyphs = 0;
 }
 
-static void 
-utf8_encode(int unicode, 
-	    char *out, 
-	    int *len) 
+//
+// 'greek_text()' - Draw a string as gray bars instead of glyphs.
+//
+// Each word becomes a bar spanning its advance widths from the baseline
+// to roughly the x-height, drawn at half the opacity of the text color.
+//
+
+static void
+greek_text(p2c_device_t *dev,		// I - Active Rendering Context
+	   const cairo_matrix_t *text_to_device,// I - Text space to device space
+	   const unsigned char *codes,	// I - Character codes
+	   size_t len)			// I - Number of codes
 {
-  if (unicode < 0x80) 
-  { 
-    *len=1; 
-    out[0]=unicode; 
+  graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
+  const double *color = gs->text_rendering_mode == 1 ? gs->stroke_rgb : gs->fill_rgb;
+  double alpha = gs->text_rendering_mode == 1 ? gs->stroke_alpha : gs->fill_alpha;
+  double bottom = gs->text_rise;
+  double top = gs->text_rise + 0.5 * gs->font_size;
+  double x = 0.0, start = 0.0;
+  bool in_word = false;
+
+  // Queued glyphs were shown first
+  device_flush_text(dev);
+
+  cairo_save(dev->cr);
+  cairo_identity_matrix(dev->cr);
+  cairo_new_path(dev->cr);
+
+  for (size_t i = 0; i <= len;)
+  {
+    FT_UInt glyph;
+    double advance = 0.0;
+    size_t n = i < len ? text_next_char(gs, gs->font, codes + i, len - i, &glyph, &advance) : 1;
+    bool blank = i == len || (n == 1 && codes[i] == ' ');
+
+    if (blank && in_word)
+    {
+      double corners[4][2] = { { start, bottom }, { x, bottom }, { x, top }, { start, top } };
+
+      for (int j = 0; j < 4; j++)
+      {
+        cairo_matrix_transform_point(text_to_device, &corners[j][0], &corners[j][1]);
+        if (j == 0)
+          cairo_move_to(dev->cr, corners[j][0], corners[j][1]);
+        else
+          cairo_line_to(dev->cr, corners[j][0], corners[j][1]);
+      }
+      cairo_close_path(dev->cr);
+      in_word = false;
+    }
+    else if (!blank && !in_word)
+    {
+      start = x;
+      in_word = true;
+    }
+
+    x += advance;
+    i += n;
   }
-  else if (unicode < 0x800) 
-  { 
-    *len=2;
-    out[0]=0xC0|(unicode>>6); 
-    out[1]=0x80|(unicode&0x3F); 
+
+  cairo_set_source_rgba(dev->cr, color[0], color[1], color[2], alpha * 0.5);
+  cairo_fill(dev->cr);
+  cairo_restore(dev->cr);
+}
+
+//
+// 'extract_text()' - Collect the Unicode text and glyph boxes of a string.
+//
+
+static void
+extract_text(p2c_device_t *dev,		// I - Text extraction device
+	     const unsigned char *codes,// I - Character codes
+	     size_t len)		// I - Length of string
+{
+  graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
+  p2c_font_t	*font = gs->font;
+  cairo_matrix_t text_to_device;	// Text space to device space
+  double	x = 0.0,		// Pen position in text space
+		ascent = 0.8,		// Ascent in em
+		descent = -0.2,		// Descent in em
+		size;			// Font height in device space
+  uint32_t	text[P2C_MAX_CHAR_TEXT];// Unicode text of a character
+
+  if (font && font->ft_face && font->ft_face->units_per_EM && font->ft_face->ascender > 0)
+  {
+    ascent  = (double)font->ft_face->ascender / font->ft_face->units_per_EM;
+    descent = (double)font->ft_face->descender / font->ft_face->units_per_EM;
   }
-  else 
-  { 
-    *len=3; 
-    out[0]=0xE0|(unicode>>12); 
-    out[1]=0x80|((unicode>>6)&0x3F); 
-    out[2]=0x80|(unicode&0x3F); 
+
+  cairo_matrix_multiply(&text_to_device, &gs->text_matrix, &gs->ctm);
+
+  double dx = 0.0, dy = gs->font_size;
+  cairo_matrix_transform_distance(&text_to_device, &dx, &dy);
+  size = hypot(dx, dy);
+
+  for (size_t i = 0; i < len;)
+  {
+    FT_UInt	glyph;
+    double	advance;
+    size_t	n = text_next_char(gs, font, codes + i, len - i, &glyph, &advance);
+    size_t	num_text = p2c_font_get_unicode(font, codes + i, n, text, P2C_MAX_CHAR_TEXT);
+    double	corners[4][2] =
+    {
+      { x, gs->text_rise + descent * gs->font_size },
+      { x + advance, gs->text_rise + descent * gs->font_size },
+      { x + advance, gs->text_rise + ascent * gs->font_size },
+      { x, gs->text_rise + ascent * gs->font_size }
+    };
+    double	bbox[4] = { HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL },
+		origin[2] = { x, gs->text_rise },
+		end[2] = { x + advance, gs->text_rise };
+
+    for (int j = 0; j < 4; j ++)
+    {
+      cairo_matrix_transform_point(&text_to_device, &corners[j][0], &corners[j][1]);
+      bbox[0] = fmin(bbox[0], corners[j][0]);
+      bbox[1] = fmin(bbox[1], corners[j][1]);
+      bbox[2] = fmax(bbox[2], corners[j][0]);
+      bbox[3] = fmax(bbox[3], corners[j][1]);
+    }
+
+    cairo_matrix_transform_point(&text_to_device, origin, origin + 1);
+    cairo_matrix_transform_point(&text_to_device, end, end + 1);
+
+    device_add_text_char(dev, text, num_text, bbox, origin, end, size);
+
+    x += advance;
+    i += n;
   }
-  out[*len] = 0;
+
+  cairo_matrix_translate(&gs->text_matrix, x, 0);
 }
 
+//
+// 'device_show_text()' - Show a string (Tj operator).
+//
+// Character codes are mapped straight to glyph indices through the font's
+// glyph map (or CMap, for Type0 fonts) and positioned from its widths.
+// The glyphs are queued in device space so that all strings of a text
+// object sharing font, size and color are drawn with a single
+// cairo_show_glyphs() call.
+//
+
 void 
 device_show_text(p2c_device_t *dev, 
-		 const char *str) 
+		 const char *str,
+		 size_t len) 
 {
   graphics_state_t *gs = &dev->gstack[dev->gstack_ptr];
+  p2c_text_run_t *run = &dev->text_run;
+  p2c_font_t *font = gs->font;
+  const unsigned char *codes = (const unsigned char *)str;
+  cairo_matrix_t ctm, text_to_device, font_matrix;
+  double x = 0.0;			// Pen position in text space
 
-  cairo_save(dev->cr);
+  if (len == 0)
+    return;
 
-  // Get Text Matrix and Flip Y for upright text
-  cairo_matrix_t tm = gs->text_matrix;
-  cairo_matrix_scale(&tm, 1.0, -1.0); // Flip Y because Cairo is Top-Down but we set CTM to Bottom-Up
-  cairo_transform(dev->cr, &tm);
+  // Text extraction devices collect the text of every rendering mode,
+  // including invisible OCR layers
+  if (dev->extract)
+  {
+    extract_text(dev, codes, len);
+    return;
+  }
 
-  // Decode String to UTF-8 using the encoding table
-  char *utf8_str = malloc(strlen(str) * 4 + 1);
-  char *p = utf8_str;
-  for (int i = 0; str[i]; i++) 
+  // Invisible text (e.g. an OCR layer) only moves the text position
+  if (gs->text_rendering_mode == 3)
   {
-    int code = (unsigned char)str[i];
-    int unicode = gs->encoding[code];
-    int len;
-    utf8_encode(unicode, p, &len);
-    p += len;
+    cairo_matrix_translate(&gs->text_matrix, text_width(gs, font, codes, len), 0);
+    return;
   }
-  *p = 0;
 
-  // Draw
-  cairo_set_source_rgb(dev->cr, gs->fill_rgb[0], gs->fill_rgb[1], gs->fill_rgb[2]);
-  cairo_show_text(dev->cr, utf8_str);
+  // Type 3 glyphs are content streams rather than outlines
+  if (font && font->type3)
+  {
+    device_show_type3_text(dev, codes, len);
+    return;
+  }
 
-  // Advance
-  cairo_text_extents_t extents;
-  cairo_text_extents(dev->cr, utf8_str, &extents);
+  // Text space to device space, and glyph space to device space.  Glyph
+  // space is y-down in Cairo, so it is flipped into the y-up text space.
+  ctm = gs->ctm;
+  cairo_matrix_multiply(&text_to_device, &gs->text_matrix, &ctm);
+  cairo_matrix_init_scale(&font_matrix, gs->font_size * gs->horiz_scale, -gs->font_size);
+  cairo_matrix_multiply(&font_matrix, &font_matrix, &text_to_device);
+  font_matrix.x0 = font_matrix.y0 = 0.0;
 
-  cairo_restore(dev->cr);
+  // A singular font matrix would put the Cairo context into an error state
+  bool draw = font && font->cairo_face &&
+              font_matrix.xx * font_matrix.yy - font_matrix.xy * font_matrix.yx != 0.0;
+
+  // Text too small to read is cheaper and no less legible as bars.  The
+  // clipping modes still need the real outlines.
+  if (draw && dev->greek_threshold > 0.0 && gs->text_rendering_mode < 3 &&
+      hypot(font_matrix.xy, font_matrix.yy) < dev->greek_threshold)
+  {
+    greek_text(dev, &text_to_device, codes, len);
+    cairo_matrix_translate(&gs->text_matrix, text_width(gs, font, codes, len), 0);
+    return;
+  }
+
+  if (draw)
+  {
+    double color[4] = { gs->fill_rgb[0], gs->fill_rgb[1], gs->fill_rgb[2], gs->fill_alpha };
+    double stroke_color[4] = { gs->stroke_rgb[0], gs->stroke_rgb[1], gs->stroke_rgb[2], gs->stroke_alpha };
+    double line_width = gs->line_width * sqrt(fabs(ctm.xx * ctm.yy - ctm.xy * ctm.yx));
+
+    if (run->num_glyphs > 0 &&
+        (run->font != font ||
+         run->mode != gs->text_rendering_mode ||
+         memcmp(&run->font_matrix, &font_matrix, sizeof(font_matrix)) ||
+         memcmp(run->color, color, sizeof(color)) ||
+         memcmp(run->stroke_color, stroke_color, sizeof(stroke_color)) ||
+         run->line_width != line_width))
+      device_flush_text(dev);
+
+    if (run->num_glyphs == 0)
+    {
+      run->font = font;
+      run->face = font->cairo_face;
+      run->font_matrix = font_matrix;
+      run->mode = gs->text_rendering_mode;
+      memcpy(run->color, color, sizeof(color));
+      memcpy(run->stroke_color, stroke_color, sizeof(stroke_color));
+      run->line_width = line_width;
+    }
+
+    draw = reserve_glyphs(dev, run->num_glyphs + len);
+  }
 
-  // Advance internal matrix (unflipped)
-  cairo_matrix_translate(&dev->gstack[dev->gstack_ptr].text_matrix, extents.x_advance, 0);
+  for (size_t i = 0; i < len;) 
+  {
+    FT_UInt index;
+    double advance;
+
+    i += text_next_char(gs, font, codes + i, len - i, &index, &advance);
+
+    if (draw && index)
+    {
+      cairo_glyph_t *glyph = dev->glyphs + run->num_glyphs++;
 
-  free(utf8_str);
+      glyph->index = index;
+      glyph->x = x;
+      glyph->y = gs->text_rise;
+      cairo_matrix_transform_point(&text_to_device, &glyph->x, &glyph->y);
+    }
+
+    x += advance;
+  }
+
+  if (!font && g_verbose)
+    fprintf(stderr, "DEBUG: No font selected for text, only advancing.\n");
+
+  // Advance internal matrix
+  cairo_matrix_translate(&gs->text_matrix, x, 0);
 }
 
 void 
@@ -187,11 +713,11 @@ device_show_text_kerning(p2c_device_t *dev,
   {
     if (operands[i].type == OP_TYPE_STRING) 
     {
-      device_show_text(dev, operands[i].value.string);
+      device_show_text(dev, operands[i].value.string, operands[i].length);
     } 
     else if (operands[i].type == OP_TYPE_NUMBER) 
     {
-      double adj = -operands[i].value.number / 1000.0 * gs->font_size;
+      double adj = -operands[i].value.number / 1000.0 * gs->font_size * gs->horiz_scale;
       cairo_matrix_translate(&dev->gstack[dev->gstack_ptr].text_matrix, adj, 0);
     }
   }
@@ -201,5 +727,12 @@ void
 device_set_text_rendering_mode(p2c_device_t *dev, 
 			       int mode) 
 {
+  if (mode < 0 || mode > 7)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Ignoring invalid text rendering mode %d\n", mode);
+    return;
+  }
+
   dev->gstack[dev->gstack_ptr].text_rendering_mode = mode;
 }
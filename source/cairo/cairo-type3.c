@@ -0,0 +1,282 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#include "cairo-private.h"
+#include <math.h>
+
+// --- Type 3 Fonts ---
+//
+// The glyphs of a Type 3 font are content streams.  Each CharProc is
+// compiled once per font into a parser program.  Uncolored (d1) glyphs are
+// then rasterized into A8 masks, cached per glyph by the quantized text
+// space to device space scale, and painted in the fill color.  Colored
+// (d0) glyphs, and d1 glyphs that cannot be masked, run their program
+// with the glyph matrix as CTM.
+//
+
+//
+// 'type3_get_glyph()' - Get a compiled glyph, compiling it on first use.
+//
+
+static p2c_type3_glyph_t *		  // O - Glyph or NULL if none
+type3_get_glyph(p2c_font_t *font,	// I - Type 3 font
+		unsigned char code)	// I - Character code
+{
+  p2c_type3_glyph_t *glyph;
+
+  if (!font->char_procs[code])
+    return (NULL);
+
+  if (!font->type3_glyphs && (font->type3_glyphs = calloc(256, sizeof(p2c_type3_glyph_t))) == NULL)
+    return (NULL);
+
+  glyph = font->type3_glyphs + code;
+
+  if (!glyph->loaded)
+  {
+    glyph->program = parser_compile_stream(font->char_procs[code]);
+    glyph->loaded  = true;
+  }
+
+  return (glyph->program ? glyph : NULL);
+}
+
+//
+// 'type3_run_glyph()' - Run a glyph program with a glyph space CTM.
+//
+
+static void
+type3_run_glyph(p2c_device_t *dev,	// I - Active Rendering Context
+		p2c_font_t *font,	// I - Type 3 font
+		const p2c_type3_glyph_t *glyph,// I - Glyph
+		const cairo_matrix_t *glyph_to_device)// I - Glyph space to device space
+{
+  graphics_state_t *gs;
+
+  device_save_state(dev);
+
+  gs = &dev->gstack[dev->gstack_ptr];
+  gs->ctm = *glyph_to_device;
+
+  if (dev->cr)
+    cairo_set_matrix(dev->cr, &gs->ctm);
+
+  dev->type3_depth ++;
+  parser_run_program(dev, glyph->program, font->type3_resources);
+  dev->type3_depth --;
+
+  device_restore_state(dev);
+}
+
+//
+// 'type3_get_mask()' - Get the mask of a d1 glyph at a device scale.
+//
+// The mask is rendered by running the glyph program on an A8 surface in
+// place of the page context.
+//
+
+static p2c_type3_mask_t *		  // O - Mask or NULL if not maskable
+type3_get_mask(p2c_device_t *dev,	// I - Active Rendering Context
+	       p2c_font_t *font,	// I - Type 3 font
+	       p2c_type3_glyph_t *glyph,// I - Glyph
+	       const cairo_matrix_t *text_scale)// I - Text space to device space, without translation
+{
+  int32_t		scale[4];	// Quantized scale
+  cairo_matrix_t	quantized,	// Scale the mask is rendered at
+			glyph_to_mask;	// Glyph space to mask pixels
+  p2c_type3_mask_t	*mask;
+  const double		*bbox = glyph->program->glyph_bbox;
+  double		x1 = HUGE_VAL, y1 = HUGE_VAL, x2 = -HUGE_VAL, y2 = -HUGE_VAL;
+  int			width, height;
+  cairo_t		*saved_cr;
+  graphics_state_t	*gs;
+
+  // Some producers write an empty d1 box, so the extent is unknown
+  if (bbox[2] <= bbox[0] || bbox[3] <= bbox[1])
+    return (NULL);
+
+  scale[0] = (int32_t)lround(text_scale->xx * 16.0);
+  scale[1] = (int32_t)lround(text_scale->yx * 16.0);
+  scale[2] = (int32_t)lround(text_scale->xy * 16.0);
+  scale[3] = (int32_t)lround(text_scale->yy * 16.0);
+
+  for (size_t i = 0; i < glyph->num_masks; i ++)
+  {
+    if (!memcmp(glyph->masks[i].scale, scale, sizeof(scale)))
+      return (glyph->masks + i);
+  }
+
+  cairo_matrix_init(&quantized, scale[0] / 16.0, scale[1] / 16.0, scale[2] / 16.0, scale[3] / 16.0, 0.0, 0.0);
+  cairo_matrix_multiply(&glyph_to_mask, &font->type3_matrix, &quantized);
+  glyph_to_mask.x0 = glyph_to_mask.y0 = 0.0;
+
+  for (int i = 0; i < 4; i ++)
+  {
+    double x = bbox[(i & 1) ? 2 : 0], y = bbox[(i & 2) ? 3 : 1];
+
+    cairo_matrix_transform_point(&glyph_to_mask, &x, &y);
+    x1 = fmin(x1, x);
+    y1 = fmin(y1, y);
+    x2 = fmax(x2, x);
+    y2 = fmax(y2, y);
+  }
+
+  // Leave a pixel for antialiasing on each side
+  x1 = floor(x1) - 1.0;
+  y1 = floor(y1) - 1.0;
+  width  = (int)(ceil(x2) + 1.0 - x1);
+  height = (int)(ceil(y2) + 1.0 - y1);
+
+  if (width > P2C_TYPE3_MAX_MASK || height > P2C_TYPE3_MAX_MASK)
+    return (NULL);
+
+  if (glyph->num_masks < P2C_TYPE3_MASKS)
+  {
+    mask = glyph->masks + glyph->num_masks++;
+  }
+  else
+  {
+    mask = glyph->masks + glyph->next_mask;
+    glyph->next_mask = (glyph->next_mask + 1) % P2C_TYPE3_MASKS;
+
+    if (mask->mask)
+      cairo_surface_destroy(mask->mask);
+  }
+
+  memcpy(mask->scale, scale, sizeof(scale));
+  mask->x    = (int)x1;
+  mask->y    = (int)y1;
+  mask->mask = cairo_image_surface_create(CAIRO_FORMAT_A8, width, height);
+
+  // Draw the glyph opaque, shifted into the mask
+  glyph_to_mask.x0 = -x1;
+  glyph_to_mask.y0 = -y1;
+
+  saved_cr = dev->cr;
+  dev->cr  = cairo_create(mask->mask);
+
+  device_save_state(dev);
+
+  gs = &dev->gstack[dev->gstack_ptr];
+  gs->fill_alpha = gs->stroke_alpha = 1.0;
+  cairo_set_line_width(dev->cr, gs->line_width);
+
+  type3_run_glyph(dev, font, glyph, &glyph_to_mask);
+
+  device_restore_state(dev);
+
+  cairo_destroy(dev->cr);
+  dev->cr = saved_cr;
+
+  cairo_surface_flush(mask->mask);
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: Cached %dx%d Type 3 glyph mask.\n", width, height);
+
+  return (mask);
+}
+
+//
+// 'device_show_type3_text()' - Show a string in a Type 3 font.
+//
+
+void
+device_show_type3_text(
+    p2c_device_t        *dev,		// I - Active Rendering Context
+    const unsigned char *codes,		// I - Character codes
+    size_t              len)		// I - Number of codes
+{
+  graphics_state_t	*gs = &dev->gstack[dev->gstack_ptr];
+  p2c_font_t		*font = gs->font;
+  cairo_matrix_t	text_to_device,	// Text space to device space
+			text_scale;	// Font size and Tz applied to text_to_device
+  double		x = 0.0;	// Pen position in text space
+  bool			draw;
+
+  // Glyphs are drawn straight away, after anything already queued
+  device_flush_text(dev);
+
+  // Mode 7 only adds to the clip, which Type 3 glyphs do not support
+  draw = dev->cr && gs->text_rendering_mode != 7 &&
+         dev->type3_depth < P2C_TYPE3_MAX_DEPTH && dev->gstack_ptr < MAX_GSTATE - 3;
+
+  cairo_matrix_multiply(&text_to_device, &gs->text_matrix, &gs->ctm);
+  cairo_matrix_init_scale(&text_scale, gs->font_size * gs->horiz_scale, gs->font_size);
+  cairo_matrix_multiply(&text_scale, &text_scale, &text_to_device);
+  text_scale.x0 = text_scale.y0 = 0.0;
+
+  for (size_t i = 0; i < len; i ++)
+  {
+    p2c_type3_glyph_t	*glyph;
+    p2c_type3_mask_t	*mask = NULL;
+    double		advance = font->advances[codes[i]] * gs->font_size / 1000.0 + gs->char_spacing;
+    double		ox = x, oy = gs->text_rise;
+
+    if (codes[i] == ' ')
+      advance += gs->word_spacing;
+
+    advance *= gs->horiz_scale;
+
+    if (draw && (glyph = type3_get_glyph(font, codes[i])) != NULL)
+    {
+      cairo_matrix_transform_point(&text_to_device, &ox, &oy);
+
+      if (glyph->program->glyph_type == PARSER_GLYPH_UNCOLORED)
+        mask = type3_get_mask(dev, font, glyph, &text_scale);
+
+      if (mask)
+      {
+        cairo_save(dev->cr);
+        cairo_identity_matrix(dev->cr);
+        cairo_set_source_rgba(dev->cr, gs->fill_rgb[0], gs->fill_rgb[1], gs->fill_rgb[2], gs->fill_alpha);
+        cairo_mask_surface(dev->cr, mask->mask, floor(ox + 0.5) + mask->x, floor(oy + 0.5) + mask->y);
+        cairo_restore(dev->cr);
+      }
+      else
+      {
+        cairo_matrix_t glyph_to_device;	// Glyph space to device space
+
+        cairo_matrix_multiply(&glyph_to_device, &font->type3_matrix, &text_scale);
+        glyph_to_device.x0 += ox;
+        glyph_to_device.y0 += oy;
+
+        type3_run_glyph(dev, font, glyph, &glyph_to_device);
+      }
+    }
+
+    x += advance;
+  }
+
+  cairo_matrix_translate(&gs->text_matrix, x, 0);
+}
+
+//
+// 'p2c_type3_clear()' - Free the compiled glyphs and masks of a font.
+//
+
+void
+p2c_type3_clear(p2c_font_t *font)	// I - Font
+{
+  if (!font->type3_glyphs)
+    return;
+
+  for (int code = 0; code < 256; code ++)
+  {
+    p2c_type3_glyph_t *glyph = font->type3_glyphs + code;
+
+    parser_program_free(glyph->program);
+
+    for (size_t i = 0; i < glyph->num_masks; i ++)
+    {
+      if (glyph->masks[i].mask)
+        cairo_surface_destroy(glyph->masks[i].mask);
+    }
+  }
+
+  free(font->type3_glyphs);
+  font->type3_glyphs = NULL;
+}
@@ -25,13 +25,14 @@ extern int g_verbose;
 static bool
 parser_context_init(parser_context_t *ctx,
                     p2c_device_t *dev,
-                    pdfrip_page_t *page_data)
+                    pdfrip_page_t *page_data,
+                    pdfio_dict_t *resources)
 {
   memset(ctx, 0, sizeof(*ctx));
 
   ctx->device = dev;
   ctx->page_data = page_data;
-  ctx->resources = page_data->resources_dict;
+  ctx->resources = resources;
   ctx->operand_capacity = INITIAL_OPERAND_CAPACITY;
   ctx->token_capacity = PDF_TOKEN_SIZE;
 
@@ -117,6 +118,44 @@ parser_parse_number(const char *token, double *number)
   return end != token && *end == '\0';
 }
 
+static size_t
+parser_decode_hex(const char *hex, char *string, size_t size)
+{
+  size_t length = 0;
+  int digits = 0;
+  int value = 0;
+
+  // Hex strings may contain whitespace and end with an odd digit, which
+  // is treated as if it were followed by a 0...
+  for (; *hex && *hex != '>' && length < size; hex ++)
+  {
+    int digit;
+
+    if (*hex >= '0' && *hex <= '9')
+      digit = *hex - '0';
+    else if (*hex >= 'a' && *hex <= 'f')
+      digit = *hex - 'a' + 10;
+    else if (*hex >= 'A' && *hex <= 'F')
+      digit = *hex - 'A' + 10;
+    else
+      continue;
+
+    value = (value << 4) | digit;
+
+    if (++ digits == 2)
+    {
+      string[length++] = (char)value;
+      digits = 0;
+      value = 0;
+    }
+  }
+
+  if (digits && length < size)
+    string[length++] = (char)(value << 4);
+
+  return length;
+}
+
 // --- Operator Handler Functions ---
 // Each function handles the logic for a single PDF operator.
 
@@ -231,7 +270,107 @@ handle_Tj(parser_context_t *ctx)
       fprintf(stderr, "DEBUG: Operator Tj (Show Text) with string \"%s\"\n", 
 	       ctx->operands[0].value.string);
 
-    device_show_text(ctx->device, ctx->operands[0].value.string);
+    device_show_text(ctx->device, ctx->operands[0].value.string,
+                     ctx->operands[0].length);
+  }
+}
+
+static void 
+handle_quote(parser_context_t *ctx) 
+{
+  if (ctx->num_operands == 1 && 
+       ctx->operands[0].type == OP_TYPE_STRING) 
+  {
+    if (g_verbose) 
+      fprintf(stderr, "DEBUG: Operator ' (Next Line and Show Text)\n");
+
+    device_next_line(ctx->device);
+    device_show_text(ctx->device, ctx->operands[0].value.string,
+                     ctx->operands[0].length);
+  }
+}
+
+static void 
+handle_dquote(parser_context_t *ctx) 
+{
+  if (ctx->num_operands == 3 && 
+       ctx->operands[0].type == OP_TYPE_NUMBER && 
+        ctx->operands[1].type == OP_TYPE_NUMBER && 
+         ctx->operands[2].type == OP_TYPE_STRING) 
+  {
+    if (g_verbose) 
+      fprintf(stderr, "DEBUG: Operator \" (Set Spacing, Next Line and Show Text)\n");
+
+    device_set_word_spacing(ctx->device, ctx->operands[0].value.number);
+    device_set_char_spacing(ctx->device, ctx->operands[1].value.number);
+    device_next_line(ctx->device);
+    device_show_text(ctx->device, ctx->operands[2].value.string,
+                     ctx->operands[2].length);
+  }
+}
+
+static void 
+handle_Tc(parser_context_t *ctx) 
+{
+  if (parser_has_number_operands(ctx, 1))
+  {
+    if (g_verbose) 
+      fprintf(stderr, "DEBUG: Operator Tc (Set Character Spacing) with arg %f\n", 
+		       ctx->operands[0].value.number);
+
+    device_set_char_spacing(ctx->device, ctx->operands[0].value.number);
+  }
+}
+
+static void 
+handle_Tw(parser_context_t *ctx) 
+{
+  if (parser_has_number_operands(ctx, 1))
+  {
+    if (g_verbose) 
+      fprintf(stderr, "DEBUG: Operator Tw (Set Word Spacing) with arg %f\n", 
+		       ctx->operands[0].value.number);
+
+    device_set_word_spacing(ctx->device, ctx->operands[0].value.number);
+  }
+}
+
+static void 
+handle_Tz(parser_context_t *ctx) 
+{
+  if (parser_has_number_operands(ctx, 1))
+  {
+    if (g_verbose) 
+      fprintf(stderr, "DEBUG: Operator Tz (Set Horizontal Scaling) with arg %f\n", 
+		       ctx->operands[0].value.number);
+
+    device_set_horizontal_scaling(ctx->device, ctx->operands[0].value.number);
+  }
+}
+
+static void 
+handle_TL(parser_context_t *ctx) 
+{
+  if (parser_has_number_operands(ctx, 1))
+  {
+    if (g_verbose) 
+      fprintf(stderr, "DEBUG: Operator TL (Set Text Leading) with arg %f\n", 
+		       ctx->operands[0].value.number);
+
+    device_set_text_leading(ctx->device, ctx->operands[0].value.number);
+  }
+}
+
+static void 
+handle_Ts(parser_context_t *ctx) 
+{
+  if (parser_has_number_operands(ctx, 1))
+  {
+    if (g_verbose) 
+      fprintf(stderr, "DEBUG: Operator Ts (Set Text Rise) with arg %f\n", 
+		       ctx->operands[0].value.number);
+
+    device_set_text_rise(ctx->device, ctx->operands[0].value.number);
   }
 }
 
@@ -540,6 +679,20 @@ handle_gs(parser_context_t *ctx)
   }
 }
 
+static void
+handle_Do(parser_context_t *ctx)
+{
+  if (ctx->num_operands == 1 &&
+       ctx->operands[0].type == OP_TYPE_NAME)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Operator Do (Paint XObject) with name %s\n",
+		       ctx->operands[0].value.name);
+
+    device_draw_xobject(ctx->device, ctx->resources, ctx->operands[0].value.name + 1); // +1 to skip leading '/'
+  }
+}
+
 static void
 handle_cm(parser_context_t *ctx)
 {
@@ -561,6 +714,8 @@ handle_cs(parser_context_t *ctx)
     if (g_verbose) 
       fprintf(stderr, "DEBUG: Operator cs (Set fill Color Space) with name %s\n", 
 		       ctx->operands[0].value.name);
+
+    device_set_fill_colorspace(ctx->device, ctx->resources, ctx->operands[0].value.name + 1); // +1 to skip leading '/'
   }
 }
 
@@ -573,7 +728,84 @@ handle_CS(parser_context_t *ctx)
     if (g_verbose) 
       fprintf(stderr, "DEBUG: Operator CS (Set Stroke Color Space) with name %s \n", 
 		       ctx->operands[0].value.name);
+
+    device_set_stroke_colorspace(ctx->device, ctx->resources, ctx->operands[0].value.name + 1); // +1 to skip leading '/'
+  }
+}
+
+//
+// 'parser_color_operands()' - Collect the numeric components of a color.
+//
+// A trailing pattern name (scn/SCN) is ignored since patterns are not
+// drawn.  Returns -1 when the operands are not a color.
+//
+
+static int				  // O - Number of components or -1
+parser_color_operands(
+    const parser_context_t *ctx,	// I - Parser context
+    bool                   allow_name,	// I - Allow a trailing pattern name?
+    double                 *values)	// O - Components, up to 8
+{
+  size_t num_values = ctx->num_operands;	// Number of components
+
+  if (allow_name && num_values > 0 && ctx->operands[num_values - 1].type == OP_TYPE_NAME)
+    num_values --;
+
+  if (num_values > 8)
+    return (-1);
+
+  for (size_t i = 0; i < num_values; i ++)
+  {
+    if (ctx->operands[i].type != OP_TYPE_NUMBER)
+      return (-1);
+
+    values[i] = ctx->operands[i].value.number;
   }
+
+  return ((int)num_values);
+}
+
+static void 
+handle_set_color(parser_context_t *ctx, const char *op, bool stroke, bool allow_name) 
+{
+  double values[8];			// Color components
+  int    num_values = parser_color_operands(ctx, allow_name, values);
+					// Number of components
+
+  if (num_values <= 0)
+    return;
+
+  if (g_verbose) 
+    fprintf(stderr, "DEBUG: Operator %s (Set %s Color) with %d args\n", op, stroke ? "Stroke" : "Fill", num_values);
+
+  if (stroke)
+    device_set_stroke_color(ctx->device, values, num_values);
+  else
+    device_set_fill_color(ctx->device, values, num_values);
+}
+
+static void 
+handle_sc(parser_context_t *ctx) 
+{
+  handle_set_color(ctx, "sc", false, false);
+}
+
+static void 
+handle_scn(parser_context_t *ctx) 
+{
+  handle_set_color(ctx, "scn", false, true);
+}
+
+static void 
+handle_SC(parser_context_t *ctx) 
+{
+  handle_set_color(ctx, "SC", true, false);
+}
+
+static void 
+handle_SCN(parser_context_t *ctx) 
+{
+  handle_set_color(ctx, "SCN", true, true);
 }
 
 static void 
@@ -619,13 +851,6 @@ handle_Tr(parser_context_t *ctx)
     int mode = (int)ctx->operands[0].value.number;
     if (g_verbose) 
       fprintf(stderr, "DEBUG: Operator Tr (Set Text Rendering Mode) with mode %d\n", mode);
-    // This is a placeholder for the actual device function you'll write
-    // For now, let's just imagine it exists
-    // device_set_text_rendering_mode(dev, mode);
-    // Since our state is in the internal header, we can set it directly
-    // from here for simplicity, but a dedicated function is cleaner.
-    // For now, let's assume we don't have that function yet. We'll add it to graphics_state_t.
-    // This is a simplified approach, a dedicated function in cairo_device.c would be better.
     device_set_text_rendering_mode(ctx->device, mode);
   }
 }
@@ -646,24 +871,34 @@ typedef struct
 // IMPORTANT: This table MUST be sorted alphabetically by operator name for bsearch to work.
 static const pdf_operator_t operator_table[] = 
 {
+  {"\"", 	handle_dquote},
+  {"'", 	handle_quote},
   {"B", 	handle_B},
   {"B*", 	handle_B_star},
   {"BT", 	handle_BT},
   {"CS", 	handle_CS},
+  {"Do", 	handle_Do},
   {"ET", 	handle_ET},
   {"G", 	handle_G},
   {"K", 	handle_K},
   {"Q", 	handle_Q},
   {"RG", 	handle_RG},
   {"S", 	handle_S},
+  {"SC", 	handle_SC},
+  {"SCN", 	handle_SCN},
   {"T*", 	handle_T_star},
   {"TD", 	handle_TD},
   {"TJ", 	handle_TJ},
+  {"TL", 	handle_TL},
+  {"Tc", 	handle_Tc},
   {"Td", 	handle_Td},
   {"Tf", 	handle_Tf},
   {"Tj", 	handle_Tj},
   {"Tm", 	handle_Tm},
   {"Tr", 	handle_Tr},
+  {"Ts", 	handle_Ts},
+  {"Tw", 	handle_Tw},
+  {"Tz", 	handle_Tz},
   {"W", 	handle_W},
   {"W*", 	handle_W_star},
   {"b", 	handle_b},
@@ -683,6 +918,8 @@ static const pdf_operator_t operator_table[] =
   {"q", 	handle_q},
   {"re", 	handle_re},
   {"rg", 	handle_rg},
+  {"sc", 	handle_sc},
+  {"scn", 	handle_scn},
   {"v", 	handle_v},
   {"w", 	handle_w},
   {"y", 	handle_y},
@@ -700,6 +937,106 @@ compare_operators(const void *a,
   return strcmp(token, op->name);
 }
 
+//
+// 'parser_read_operand()' - Push a token onto the operand stack if it is one.
+//
+
+static int				  // O - 1 if pushed, 0 if not an operand, -1 on error
+parser_read_operand(parser_context_t *ctx,// I - Parser context
+		    const char *token)	// I - Token
+{
+  operand_t *operand;
+  double number;
+
+  if (parser_parse_number(token, &number))
+  {
+    if ((operand = parser_push_operand(ctx)) == NULL)
+      return (-1);
+
+    operand->type = OP_TYPE_NUMBER;
+    operand->value.number = number;
+
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Pushed number: %f\n", number);
+  }
+  else if (token[0] == '/')
+  {
+    if ((operand = parser_push_operand(ctx)) == NULL)
+      return (-1);
+
+    operand->type = OP_TYPE_NAME;
+    snprintf(operand->value.name, sizeof(operand->value.name), "%s", token);
+
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Pushed name: %s\n", operand->value.name);
+  }
+  else if (token[0] == '(')
+  {
+    size_t token_length;
+    size_t string_length;
+
+    if ((operand = parser_push_operand(ctx)) == NULL)
+      return (-1);
+
+    operand->type = OP_TYPE_STRING;
+    token_length = strlen(token);
+    string_length = token_length > 0 ? token_length - 1 : 0;
+
+    if (string_length > 0 && token[token_length - 1] == ')')
+      string_length --;
+
+    if (string_length >= sizeof(operand->value.string))
+      string_length = sizeof(operand->value.string) - 1;
+
+    memcpy(operand->value.string, token + 1, string_length);
+    operand->value.string[string_length] = '\0';
+    operand->length = string_length;
+
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Pushed string: \"%s\"\n",
+              operand->value.string);
+  }
+  else if (token[0] == '<' && token[1] != '<')
+  {
+    if ((operand = parser_push_operand(ctx)) == NULL)
+      return (-1);
+
+    operand->type = OP_TYPE_STRING;
+    operand->length = parser_decode_hex(token + 1, operand->value.string,
+                                        sizeof(operand->value.string) - 1);
+    operand->value.string[operand->length] = '\0';
+
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Pushed hex string of %zu bytes\n",
+              operand->length);
+  }
+  // Array delimiters are currently ignored. Their strings and numbers are
+  // kept as consecutive operands for the existing TJ device interface.
+  else if (token[0] != '[' && token[0] != ']')
+  {
+    return (0);
+  }
+
+  return (1);
+}
+
+//
+// 'parser_find_operator()' - Find the handler of an operator.
+//
+
+static const pdf_operator_t *		  // O - Operator or NULL if unhandled
+parser_find_operator(const char *token)	// I - Operator token
+{
+  const pdf_operator_t *pdf_operator =
+      bsearch(token, operator_table, operator_table_size,
+              sizeof(pdf_operator_t), compare_operators);
+
+  if (!pdf_operator && g_verbose)
+    fprintf(stderr, "DEBUG: Unhandled operator: %s\n", token);
+
+  return (pdf_operator);
+}
+
 void 
 process_content_stream(p2c_device_t *dev, 
 		       pdfrip_page_t *page_data)
@@ -713,7 +1050,7 @@ process_content_stream(p2c_device_t *dev,
     return;
   }
 
-  if (!parser_context_init(&ctx, dev, page_data))
+  if (!parser_context_init(&ctx, dev, page_data, page_data->resources_dict))
   {
     fprintf(stderr, "ERROR: Unable to allocate the PDF parser context.\n");
     return;
@@ -724,94 +1061,299 @@ process_content_stream(p2c_device_t *dev,
     pdfio_stream_t *st = pdfioPageOpenStream(page_data->object, i, true);
     while (pdfioStreamGetToken(st, ctx.token, ctx.token_capacity))
     { 
-      const char *token = ctx.token;
-      double number;
-      if (parser_parse_number(token, &number))
-      {
-        operand_t *operand = parser_push_operand(&ctx);
+      int status = parser_read_operand(&ctx, ctx.token);
 
-        if (!operand)
-        {
-          allocation_failed = true;
-          break;
-        }
+      if (status < 0)
+      {
+        allocation_failed = true;
+        break;
+      }
+      else if (status == 0)
+      {
+        const pdf_operator_t *pdf_operator = parser_find_operator(ctx.token);
 
-        operand->type = OP_TYPE_NUMBER;
-        operand->value.number = number;
+        if (pdf_operator)
+          pdf_operator->handler(&ctx);
 
-        if (g_verbose)
-          fprintf(stderr, "DEBUG: Pushed number: %f\n", number);
+        ctx.num_operands = 0;
       }
-      else if (token[0] == '/')
-      {
-        operand_t *operand = parser_push_operand(&ctx);
+    }
 
-        if (!operand)
-        {
-          allocation_failed = true;
-          break;
-        }
+    pdfioStreamClose(st);
 
-        operand->type = OP_TYPE_NAME;
-        snprintf(operand->value.name, sizeof(operand->value.name), "%s", token);
+    if (allocation_failed)
+      break;
+  }
+
+  if (allocation_failed)
+    fprintf(stderr, "ERROR: Unable to grow the PDF operand stack.\n");
 
-        if (g_verbose)
-          fprintf(stderr, "DEBUG: Pushed name: %s\n", operand->value.name);
+  parser_context_destroy(&ctx);
+}
+
+// --- Compiled Content Streams ---
+//
+// Content streams that are run many times, such as the CharProcs of Type 3
+// glyphs, are tokenized once into a program: a list of operator table
+// indices with compact operands.  Running a program skips tokenizing,
+// number parsing and operator lookup.
+//
+
+// Operators whose color is ignored in uncolored (d1) Type 3 glyphs
+static const char * const parser_color_operators[] =
+{
+  "CS", "G", "K", "RG", "SC", "SCN", "cs", "g", "k", "rg", "sc", "scn"
+};
+
+
+//
+// 'parser_program_add()' - Append the operator and operands on the stack.
+//
+
+static bool				  // O - true on success
+parser_program_add(parser_program_t *prog,// I - Program
+		   const parser_context_t *ctx,// I - Context with operands
+		   size_t handler)	// I - Index in operator_table
+{
+  parser_op_t *op;
+
+  if (prog->num_ops == prog->alloc_ops)
+  {
+    size_t alloc = prog->alloc_ops ? prog->alloc_ops * 2 : 32;
+    parser_op_t *temp = realloc(prog->ops, alloc * sizeof(parser_op_t));
+
+    if (!temp)
+      return (false);
+
+    prog->ops = temp;
+    prog->alloc_ops = alloc;
+  }
+
+  if (prog->num_operands + ctx->num_operands > prog->alloc_operands)
+  {
+    size_t alloc = prog->alloc_operands ? prog->alloc_operands * 2 : 64;
+    parser_operand_t *temp;
+
+    while (alloc < prog->num_operands + ctx->num_operands)
+      alloc *= 2;
+
+    if ((temp = realloc(prog->operands, alloc * sizeof(parser_operand_t))) == NULL)
+      return (false);
+
+    prog->operands = temp;
+    prog->alloc_operands = alloc;
+  }
+
+  op = prog->ops + prog->num_ops++;
+  op->handler      = (uint16_t)handler;
+  op->first        = (uint32_t)prog->num_operands;
+  op->num_operands = (uint32_t)ctx->num_operands;
+
+  for (size_t i = 0; i < ctx->num_operands; i ++)
+  {
+    const operand_t	*src = ctx->operands + i;
+    parser_operand_t	*dst = prog->operands + prog->num_operands++;
+    size_t		length;
+
+    dst->type = src->type;
+
+    if (src->type == OP_TYPE_NUMBER)
+    {
+      dst->value.number = src->value.number;
+      continue;
+    }
+
+    // Names and strings go into the string pool with their terminator
+    length = src->type == OP_TYPE_NAME ? strlen(src->value.name) : src->length;
+
+    if (prog->num_strings + length + 1 > prog->alloc_strings)
+    {
+      size_t alloc = prog->alloc_strings ? prog->alloc_strings * 2 : 256;
+      char *temp;
+
+      while (alloc < prog->num_strings + length + 1)
+        alloc *= 2;
+
+      if ((temp = realloc(prog->strings, alloc)) == NULL)
+        return (false);
+
+      prog->strings = temp;
+      prog->alloc_strings = alloc;
+    }
+
+    dst->length       = (uint32_t)length;
+    dst->value.offset = prog->num_strings;
+
+    memcpy(prog->strings + prog->num_strings, src->value.string, length);
+    prog->strings[prog->num_strings + length] = '\0';
+    prog->num_strings += length + 1;
+  }
+
+  return (true);
+}
+
+//
+// 'parser_compile_stream()' - Compile a content stream into a program.
+//
+// A leading d0 or d1 operator is recorded in the program rather than
+// compiled.  Color operators of d1 glyphs are dropped, since their color
+// comes from the text being shown.
+//
+
+parser_program_t *			  // O - Program or NULL on error
+parser_compile_stream(pdfio_obj_t *obj)	// I - Content stream object
+{
+  parser_context_t	ctx;
+  parser_program_t	*prog;
+  pdfio_stream_t	*st;
+  bool			ok = true;
+
+  if (!obj || (st = pdfioObjOpenStream(obj, true)) == NULL)
+    return (NULL);
+
+  if ((prog = calloc(1, sizeof(parser_program_t))) == NULL)
+  {
+    pdfioStreamClose(st);
+    return (NULL);
+  }
+
+  if (!parser_context_init(&ctx, NULL, NULL, NULL))
+  {
+    free(prog);
+    pdfioStreamClose(st);
+    return (NULL);
+  }
+
+  while (ok && pdfioStreamGetToken(st, ctx.token, ctx.token_capacity))
+  {
+    int status = parser_read_operand(&ctx, ctx.token);
+
+    if (status < 0)
+    {
+      ok = false;
+    }
+    else if (status == 0)
+    {
+      const pdf_operator_t *pdf_operator;
+
+      if (!strcmp(ctx.token, "d0") && parser_has_number_operands(&ctx, 2))
+      {
+        prog->glyph_type  = PARSER_GLYPH_COLORED;
+        prog->glyph_width = ctx.operands[0].value.number;
+      }
+      else if (!strcmp(ctx.token, "d1") && parser_has_number_operands(&ctx, 6))
+      {
+        prog->glyph_type  = PARSER_GLYPH_UNCOLORED;
+        prog->glyph_width = ctx.operands[0].value.number;
+
+        for (int i = 0; i < 4; i ++)
+          prog->glyph_bbox[i] = ctx.operands[i + 2].value.number;
       }
-      else if (token[0] == '(')
+      else if ((pdf_operator = parser_find_operator(ctx.token)) != NULL)
       {
-        operand_t *operand = parser_push_operand(&ctx);
-        size_t token_length;
-        size_t string_length;
+        bool skip = false;
 
-        if (!operand)
+        if (prog->glyph_type == PARSER_GLYPH_UNCOLORED)
         {
-          allocation_failed = true;
-          break;
+          for (size_t i = 0; !skip && i < sizeof(parser_color_operators) / sizeof(parser_color_operators[0]); i ++)
+            skip = !strcmp(ctx.token, parser_color_operators[i]);
         }
 
-        operand->type = OP_TYPE_STRING;
-        token_length = strlen(token);
-        string_length = token_length > 0 ? token_length - 1 : 0;
+        if (!skip)
+          ok = parser_program_add(prog, &ctx, (size_t)(pdf_operator - operator_table));
+      }
 
-        if (string_length > 0 && token[token_length - 1] == ')')
-          string_length --;
+      ctx.num_operands = 0;
+    }
+  }
 
-        if (string_length >= sizeof(operand->value.string))
-          string_length = sizeof(operand->value.string) - 1;
+  pdfioStreamClose(st);
+  parser_context_destroy(&ctx);
 
-        memcpy(operand->value.string, token + 1, string_length);
-        operand->value.string[string_length] = '\0';
+  if (!ok)
+  {
+    fprintf(stderr, "ERROR: Unable to allocate memory for a compiled content stream.\n");
+    parser_program_free(prog);
+    return (NULL);
+  }
 
-        if (g_verbose)
-          fprintf(stderr, "DEBUG: Pushed string: \"%s\"\n",
-                  operand->value.string);
-      }
-      // Array delimiters are currently ignored. Their strings and numbers are
-      // kept as consecutive operands for the existing TJ device interface.
-      else if (token[0] != '[' && token[0] != ']')
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: Compiled content stream %u into %zu operators.\n", (unsigned)pdfioObjGetNumber(obj), prog->num_ops);
+
+  return (prog);
+}
+
+//
+// 'parser_run_program()' - Run a compiled content stream on a device.
+//
+
+void
+parser_run_program(p2c_device_t *dev,	// I - Device
+		   const parser_program_t *prog,// I - Program
+		   pdfio_dict_t *resources)// I - Resources of the stream
+{
+  parser_context_t ctx;
+
+  if (!dev || !prog)
+    return;
+
+  if (!parser_context_init(&ctx, dev, NULL, resources))
+  {
+    fprintf(stderr, "ERROR: Unable to allocate the PDF parser context.\n");
+    return;
+  }
+
+  for (size_t i = 0; i < prog->num_ops; i ++)
+  {
+    const parser_op_t *op = prog->ops + i;
+
+    // Only the fields the handlers read are filled in
+    ctx.num_operands = 0;
+
+    for (uint32_t j = 0; j < op->num_operands; j ++)
+    {
+      const parser_operand_t *src = prog->operands + op->first + j;
+      operand_t *dst;
+
+      if (ctx.num_operands == ctx.operand_capacity)
       {
-        const pdf_operator_t *pdf_operator =
-            bsearch(token, operator_table, operator_table_size,
-                    sizeof(pdf_operator_t), compare_operators);
+        if ((dst = parser_push_operand(&ctx)) == NULL)
+          break;
+      }
+      else
+        dst = ctx.operands + ctx.num_operands++;
 
-        if (pdf_operator)
-          pdf_operator->handler(&ctx);
-        else if (g_verbose)
-          fprintf(stderr, "DEBUG: Unhandled operator: %s\n", token);
+      dst->type = src->type;
 
-        ctx.num_operands = 0;
+      if (src->type == OP_TYPE_NUMBER)
+      {
+        dst->value.number = src->value.number;
+      }
+      else
+      {
+        memcpy(dst->value.string, prog->strings + src->value.offset, src->length + 1);
+        dst->length = src->length;
       }
     }
 
-    pdfioStreamClose(st);
-
-    if (allocation_failed)
-      break;
+    operator_table[op->handler].handler(&ctx);
   }
 
-  if (allocation_failed)
-    fprintf(stderr, "ERROR: Unable to grow the PDF operand stack.\n");
-
   parser_context_destroy(&ctx);
-}     
+}
+
+//
+// 'parser_program_free()' - Free a compiled content stream.
+//
+
+void
+parser_program_free(parser_program_t *prog)// I - Program
+{
+  if (!prog)
+    return;
+
+  free(prog->ops);
+  free(prog->operands);
+  free(prog->strings);
+  free(prog);
+}
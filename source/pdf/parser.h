@@ -10,6 +10,7 @@
 #define PARSER_H
 
 #include <pdfio.h>
+#include <stdint.h>
 #include "pdfops-private.h"
 
 typedef struct pdfrip_page_s pdfrip_page_t;
@@ -28,6 +29,7 @@ typedef enum operand_type_s
 typedef struct operand_s
 {
   operand_type_t type;
+  size_t length;			// Length of a string operand in bytes
   union 
   {
     double number;
@@ -52,6 +54,50 @@ typedef struct parser_context_s
 } parser_context_t;
 
 
+// Kind of Type 3 glyph description
+typedef enum parser_glyph_e
+{
+  PARSER_GLYPH_NONE,			// Not a glyph (no d0 or d1)
+  PARSER_GLYPH_COLORED,			// d0: the glyph sets its own colors
+  PARSER_GLYPH_UNCOLORED		// d1: a shape painted in the text color
+} parser_glyph_t;
+
+// An operand of a compiled content stream
+typedef struct parser_operand_s
+{
+  operand_type_t type;
+  uint32_t length;			// Length of a name or string
+  union
+  {
+    double number;
+    size_t offset;			// Offset of a name or string in the pool
+  } value;
+} parser_operand_t;
+
+// An operator of a compiled content stream
+typedef struct parser_op_s
+{
+  uint16_t handler;			// Index in the operator table
+  uint32_t first;			// First operand
+  uint32_t num_operands;		// Number of operands
+} parser_op_t;
+
+// A content stream compiled for repeated runs
+typedef struct parser_program_s
+{
+  parser_op_t *ops;
+  size_t num_ops, alloc_ops;
+  parser_operand_t *operands;
+  size_t num_operands, alloc_operands;
+  char *strings;			// Pool of names and strings
+  size_t num_strings, alloc_strings;
+
+  parser_glyph_t glyph_type;		// d0/d1 at the start of the stream
+  double glyph_width;			// Horizontal displacement from d0/d1
+  double glyph_bbox[4];			// Glyph bounding box from d1
+} parser_program_t;
+
+
 /**
  * @brief Processes a PDF content stream and uses a device to render it
  *
@@ -60,6 +106,10 @@ typedef struct parser_context_s
  * @param[in] resources The page's resource dictionary.
  */
 void process_content_stream(p2c_device_t *dev, pdfrip_page_t *page_data);
+
+parser_program_t *parser_compile_stream(pdfio_obj_t *obj);
+void parser_run_program(p2c_device_t *dev, const parser_program_t *prog, pdfio_dict_t *resources);
+void parser_program_free(parser_program_t *prog);
 		
 
 #endif // PARSER_H
@@ -0,0 +1,748 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+//
+// CCITTFaxDecode (Group 3 and Group 4 fax) image decoder.
+//
+// pdfio has no CCITT filter, so the raw image data is decoded here a row
+// at a time, straight to packed 1-bit rows in the image's own polarity.
+// Run lengths and 2-D modes are read with lookup tables indexed by the
+// next 13 (runs) or 7 (modes) bits, built once per process.  Each row is
+// kept as a list of changing elements, which is also the reference line
+// of the next row, and black runs are written into a white row with whole
+// byte stores.
+//
+// Damaged Group 3 data is resynchronized at the next EOL code; damaged
+// Group 4 data ends the image.  Rows past the end of the data are white.
+//
+
+#include "pdfops-private.h"
+#include <pthread.h>
+#include <string.h>
+
+extern int g_verbose;
+
+#define CCITT_RUN_BITS	13		// Longest run code
+#define CCITT_MODE_BITS	7		// Longest 2-D mode code
+#define CCITT_EOL	-2		// Run value of an EOL code
+#define CCITT_MAX_RUN	(1 << 20)	// Longest accepted run
+
+// 2-D coding modes
+typedef enum ccitt_mode_e
+{
+  CCITT_MODE_ERROR,			// Invalid code, EOL or extension
+  CCITT_MODE_PASS,			// Pass mode
+  CCITT_MODE_HORIZ,			// Horizontal mode, two runs follow
+  CCITT_MODE_V0,			// Vertical modes, a1 = b1 + delta
+  CCITT_MODE_VR1,
+  CCITT_MODE_VR2,
+  CCITT_MODE_VR3,
+  CCITT_MODE_VL1,
+  CCITT_MODE_VL2,
+  CCITT_MODE_VL3
+} ccitt_mode_t;
+
+// A run length code from ITU-T T.4
+typedef struct ccitt_code_s
+{
+  uint16_t	code;			// Code bits
+  uint8_t	length;			// Number of bits
+  int16_t	run;			// Run length
+} ccitt_code_t;
+
+// A lookup table entry
+typedef struct ccitt_entry_s
+{
+  int16_t	value;			// Run length or mode, 0 length if invalid
+  uint8_t	length;			// Bits used
+} ccitt_entry_t;
+
+// Decoder state
+struct pdfrip_ccitt_s
+{
+  pdfrip_ccitt_params_t	params;		// Decoding parameters
+  pdfrip_ccitt_cb_t	cb;		// Read callback
+  void			*cb_data;	// Callback data
+  uint8_t		buffer[4096];	// Input buffer
+  size_t		bufpos,		// Next byte in buffer
+			buflen;		// Bytes in buffer
+  uint64_t		bits;		// Bit buffer, next bit in the MSB
+  int			num_bits,	// Bits in bit buffer
+			pad_bits,	// Zero bits past the end of the data
+			row;		// Rows decoded
+  bool			eof,		// No more input?
+			done;		// End of data or fatal error?
+  int			*ref,		// Changing elements of the reference line
+			*cur,		// Changing elements of the coding line
+			num_ref,	// Number of reference changes
+			num_cur;	// Number of coding changes
+};
+
+//
+// Local globals...
+//
+
+static pthread_once_t	ccitt_once = PTHREAD_ONCE_INIT;
+					// One-time table setup
+static ccitt_entry_t	ccitt_runs[2][1 << CCITT_RUN_BITS],
+					// White and black run tables
+			ccitt_modes[1 << CCITT_MODE_BITS];
+					// 2-D mode table
+
+// Run codes from ITU-T T.4, tables 2 and 3: terminating codes, make-up
+// codes, then the extended make-up codes shared by both colors
+static const ccitt_code_t ccitt_white[] =
+{					// White run codes
+  { 0x035,  8,    0 }, { 0x007,  6,    1 }, { 0x007,  4,    2 }, { 0x008,  4,    3 },
+  { 0x00b,  4,    4 }, { 0x00c,  4,    5 }, { 0x00e,  4,    6 }, { 0x00f,  4,    7 },
+  { 0x013,  5,    8 }, { 0x014,  5,    9 }, { 0x007,  5,   10 }, { 0x008,  5,   11 },
+  { 0x008,  6,   12 }, { 0x003,  6,   13 }, { 0x034,  6,   14 }, { 0x035,  6,   15 },
+  { 0x02a,  6,   16 }, { 0x02b,  6,   17 }, { 0x027,  7,   18 }, { 0x00c,  7,   19 },
+  { 0x008,  7,   20 }, { 0x017,  7,   21 }, { 0x003,  7,   22 }, { 0x004,  7,   23 },
+  { 0x028,  7,   24 }, { 0x02b,  7,   25 }, { 0x013,  7,   26 }, { 0x024,  7,   27 },
+  { 0x018,  7,   28 }, { 0x002,  8,   29 }, { 0x003,  8,   30 }, { 0x01a,  8,   31 },
+  { 0x01b,  8,   32 }, { 0x012,  8,   33 }, { 0x013,  8,   34 }, { 0x014,  8,   35 },
+  { 0x015,  8,   36 }, { 0x016,  8,   37 }, { 0x017,  8,   38 }, { 0x028,  8,   39 },
+  { 0x029,  8,   40 }, { 0x02a,  8,   41 }, { 0x02b,  8,   42 }, { 0x02c,  8,   43 },
+  { 0x02d,  8,   44 }, { 0x004,  8,   45 }, { 0x005,  8,   46 }, { 0x00a,  8,   47 },
+  { 0x00b,  8,   48 }, { 0x052,  8,   49 }, { 0x053,  8,   50 }, { 0x054,  8,   51 },
+  { 0x055,  8,   52 }, { 0x024,  8,   53 }, { 0x025,  8,   54 }, { 0x058,  8,   55 },
+  { 0x059,  8,   56 }, { 0x05a,  8,   57 }, { 0x05b,  8,   58 }, { 0x04a,  8,   59 },
+  { 0x04b,  8,   60 }, { 0x032,  8,   61 }, { 0x033,  8,   62 }, { 0x034,  8,   63 },
+  { 0x01b,  5,   64 }, { 0x012,  5,  128 }, { 0x017,  6,  192 }, { 0x037,  7,  256 },
+  { 0x036,  8,  320 }, { 0x037,  8,  384 }, { 0x064,  8,  448 }, { 0x065,  8,  512 },
+  { 0x068,  8,  576 }, { 0x067,  8,  640 }, { 0x0cc,  9,  704 }, { 0x0cd,  9,  768 },
+  { 0x0d2,  9,  832 }, { 0x0d3,  9,  896 }, { 0x0d4,  9,  960 }, { 0x0d5,  9, 1024 },
+  { 0x0d6,  9, 1088 }, { 0x0d7,  9, 1152 }, { 0x0d8,  9, 1216 }, { 0x0d9,  9, 1280 },
+  { 0x0da,  9, 1344 }, { 0x0db,  9, 1408 }, { 0x098,  9, 1472 }, { 0x099,  9, 1536 },
+  { 0x09a,  9, 1600 }, { 0x018,  6, 1664 }, { 0x09b,  9, 1728 }, { 0x008, 11, 1792 },
+  { 0x00c, 11, 1856 }, { 0x00d, 11, 1920 }, { 0x012, 12, 1984 }, { 0x013, 12, 2048 },
+  { 0x014, 12, 2112 }, { 0x015, 12, 2176 }, { 0x016, 12, 2240 }, { 0x017, 12, 2304 },
+  { 0x01c, 12, 2368 }, { 0x01d, 12, 2432 }, { 0x01e, 12, 2496 }, { 0x01f, 12, 2560 }
+};
+
+static const ccitt_code_t ccitt_black[] =
+{					// Black run codes
+  { 0x037, 10,    0 }, { 0x002,  3,    1 }, { 0x003,  2,    2 }, { 0x002,  2,    3 },
+  { 0x003,  3,    4 }, { 0x003,  4,    5 }, { 0x002,  4,    6 }, { 0x003,  5,    7 },
+  { 0x005,  6,    8 }, { 0x004,  6,    9 }, { 0x004,  7,   10 }, { 0x005,  7,   11 },
+  { 0x007,  7,   12 }, { 0x004,  8,   13 }, { 0x007,  8,   14 }, { 0x018,  9,   15 },
+  { 0x017, 10,   16 }, { 0x018, 10,   17 }, { 0x008, 10,   18 }, { 0x067, 11,   19 },
+  { 0x068, 11,   20 }, { 0x06c, 11,   21 }, { 0x037, 11,   22 }, { 0x028, 11,   23 },
+  { 0x017, 11,   24 }, { 0x018, 11,   25 }, { 0x0ca, 12,   26 }, { 0x0cb, 12,   27 },
+  { 0x0cc, 12,   28 }, { 0x0cd, 12,   29 }, { 0x068, 12,   30 }, { 0x069, 12,   31 },
+  { 0x06a, 12,   32 }, { 0x06b, 12,   33 }, { 0x0d2, 12,   34 }, { 0x0d3, 12,   35 },
+  { 0x0d4, 12,   36 }, { 0x0d5, 12,   37 }, { 0x0d6, 12,   38 }, { 0x0d7, 12,   39 },
+  { 0x06c, 12,   40 }, { 0x06d, 12,   41 }, { 0x0da, 12,   42 }, { 0x0db, 12,   43 },
+  { 0x054, 12,   44 }, { 0x055, 12,   45 }, { 0x056, 12,   46 }, { 0x057, 12,   47 },
+  { 0x064, 12,   48 }, { 0x065, 12,   49 }, { 0x052, 12,   50 }, { 0x053, 12,   51 },
+  { 0x024, 12,   52 }, { 0x037, 12,   53 }, { 0x038, 12,   54 }, { 0x027, 12,   55 },
+  { 0x028, 12,   56 }, { 0x058, 12,   57 }, { 0x059, 12,   58 }, { 0x02b, 12,   59 },
+  { 0x02c, 12,   60 }, { 0x05a, 12,   61 }, { 0x066, 12,   62 }, { 0x067, 12,   63 },
+  { 0x00f, 10,   64 }, { 0x0c8, 12,  128 }, { 0x0c9, 12,  192 }, { 0x05b, 12,  256 },
+  { 0x033, 12,  320 }, { 0x034, 12,  384 }, { 0x035, 12,  448 }, { 0x06c, 13,  512 },
+  { 0x06d, 13,  576 }, { 0x04a, 13,  640 }, { 0x04b, 13,  704 }, { 0x04c, 13,  768 },
+  { 0x04d, 13,  832 }, { 0x072, 13,  896 }, { 0x073, 13,  960 }, { 0x074, 13, 1024 },
+  { 0x075, 13, 1088 }, { 0x076, 13, 1152 }, { 0x077, 13, 1216 }, { 0x052, 13, 1280 },
+  { 0x053, 13, 1344 }, { 0x054, 13, 1408 }, { 0x055, 13, 1472 }, { 0x05a, 13, 1536 },
+  { 0x05b, 13, 1600 }, { 0x064, 13, 1664 }, { 0x065, 13, 1728 }, { 0x008, 11, 1792 },
+  { 0x00c, 11, 1856 }, { 0x00d, 11, 1920 }, { 0x012, 12, 1984 }, { 0x013, 12, 2048 },
+  { 0x014, 12, 2112 }, { 0x015, 12, 2176 }, { 0x016, 12, 2240 }, { 0x017, 12, 2304 },
+  { 0x01c, 12, 2368 }, { 0x01d, 12, 2432 }, { 0x01e, 12, 2496 }, { 0x01f, 12, 2560 }
+};
+
+//
+// 'ccitt_add()' - Add a code to a lookup table.
+//
+
+static void
+ccitt_add(ccitt_entry_t *table,		// I - Table
+	  int           bits,		// I - Table index bits
+	  unsigned      code,		// I - Code bits
+	  int           length,		// I - Code length
+	  int           value)		// I - Run or mode
+{
+  unsigned	first = code << (bits - length),
+					// First index with this prefix
+		count = 1u << (bits - length);
+					// Number of indices
+
+  for (unsigned i = 0; i < count; i ++)
+  {
+    table[first + i].value  = (int16_t)value;
+    table[first + i].length = (uint8_t)length;
+  }
+}
+
+//
+// 'ccitt_init()' - Build the lookup tables.
+//
+
+static void
+ccitt_init(void)
+{
+  static const struct
+  {
+    unsigned		code;		// Code bits
+    int			length;		// Code length
+    ccitt_mode_t	mode;		// Mode
+  } modes[] =
+  {					// 2-D mode codes from ITU-T T.4 table 4
+    { 0x1, 4, CCITT_MODE_PASS },
+    { 0x1, 3, CCITT_MODE_HORIZ },
+    { 0x1, 1, CCITT_MODE_V0 },
+    { 0x3, 3, CCITT_MODE_VR1 },
+    { 0x3, 6, CCITT_MODE_VR2 },
+    { 0x3, 7, CCITT_MODE_VR3 },
+    { 0x2, 3, CCITT_MODE_VL1 },
+    { 0x2, 6, CCITT_MODE_VL2 },
+    { 0x2, 7, CCITT_MODE_VL3 }
+  };
+
+  for (size_t i = 0; i < sizeof(ccitt_white) / sizeof(ccitt_white[0]); i ++)
+    ccitt_add(ccitt_runs[0], CCITT_RUN_BITS, ccitt_white[i].code, ccitt_white[i].length, ccitt_white[i].run);
+
+  for (size_t i = 0; i < sizeof(ccitt_black) / sizeof(ccitt_black[0]); i ++)
+    ccitt_add(ccitt_runs[1], CCITT_RUN_BITS, ccitt_black[i].code, ccitt_black[i].length, ccitt_black[i].run);
+
+  ccitt_add(ccitt_runs[0], CCITT_RUN_BITS, 0x001, 12, CCITT_EOL);
+  ccitt_add(ccitt_runs[1], CCITT_RUN_BITS, 0x001, 12, CCITT_EOL);
+
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i ++)
+    ccitt_add(ccitt_modes, CCITT_MODE_BITS, modes[i].code, modes[i].length, modes[i].mode);
+}
+
+//
+// 'ccitt_fill()' - Fill the bit buffer to at least 57 bits.
+//
+// Past the end of the data the buffer is filled with zero bits, which are
+// counted so the end can be detected.
+//
+
+static void
+ccitt_fill(pdfrip_ccitt_t *c)		// I - Decoder
+{
+  while (c->num_bits <= 56)
+  {
+    if (c->bufpos >= c->buflen && !c->eof)
+    {
+      ssize_t bytes = (c->cb)(c->cb_data, c->buffer, sizeof(c->buffer));
+
+      c->bufpos = 0;
+      c->buflen = bytes > 0 ? (size_t)bytes : 0;
+      c->eof    = bytes <= 0;
+    }
+
+    if (c->bufpos < c->buflen)
+    {
+      c->bits |= (uint64_t)c->buffer[c->bufpos ++] << (56 - c->num_bits);
+    }
+    else
+    {
+      c->pad_bits += 8;
+    }
+
+    c->num_bits += 8;
+  }
+}
+
+//
+// 'ccitt_peek()' - Look at the next bits.
+//
+
+static inline unsigned			  // O - Bits
+ccitt_peek(pdfrip_ccitt_t *c,		// I - Decoder
+	   int            count)	// I - Number of bits, 1 to 32
+{
+  if (c->num_bits < count)
+    ccitt_fill(c);
+
+  return ((unsigned)(c->bits >> (64 - count)));
+}
+
+//
+// 'ccitt_skip()' - Skip bits.
+//
+
+static inline void
+ccitt_skip(pdfrip_ccitt_t *c,		// I - Decoder
+	   int            count)	// I - Number of bits, at most num_bits
+{
+  c->bits     <<= count;
+  c->num_bits -= count;
+
+  if (c->pad_bits > c->num_bits)
+    c->pad_bits = c->num_bits;
+}
+
+//
+// 'ccitt_at_end()' - Check for the end of the data.
+//
+
+static bool				  // O - true if no data bits are left
+ccitt_at_end(pdfrip_ccitt_t *c)		// I - Decoder
+{
+  ccitt_fill(c);
+
+  return (c->num_bits <= c->pad_bits);
+}
+
+//
+// 'ccitt_align()' - Skip to the next byte boundary.
+//
+
+static void
+ccitt_align(pdfrip_ccitt_t *c)		// I - Decoder
+{
+  ccitt_fill(c);
+  ccitt_skip(c, (c->num_bits - c->pad_bits) & 7);
+}
+
+//
+// 'ccitt_run()' - Read a run length of one color.
+//
+// Returns the run length, or CCITT_EOL or -1 on an EOL or invalid code.
+//
+
+static int				  // O - Run length or negative on error
+ccitt_run(pdfrip_ccitt_t *c,		// I - Decoder
+	  int            color)		// I - 0 for white, 1 for black
+{
+  int	total = 0;			// Run length
+
+  for (;;)
+  {
+    const ccitt_entry_t *e = ccitt_runs[color] + ccitt_peek(c, CCITT_RUN_BITS);
+					// Table entry
+
+    if (!e->length)
+      return (-1);
+
+    ccitt_skip(c, e->length);
+
+    if (e->value < 0)
+      return (e->value);
+
+    total += e->value;
+
+    if (e->value < 64)
+      return (total);
+    else if (total > CCITT_MAX_RUN)
+      return (-1);
+  }
+}
+
+//
+// 'ccitt_add_change()' - Add a changing element to the coding line.
+//
+
+static inline bool			  // O - true if in order
+ccitt_add_change(pdfrip_ccitt_t *c,	// I - Decoder
+		 int            pos)	// I - Position
+{
+  if (pos > c->params.columns)
+    pos = c->params.columns;
+
+  if ((c->num_cur > 0 && pos < c->cur[c->num_cur - 1]) || c->num_cur >= c->params.columns + 2)
+    return (false);
+
+  c->cur[c->num_cur ++] = pos;
+
+  return (true);
+}
+
+//
+// 'ccitt_decode_1d()' - Decode a one-dimensional (Modified Huffman) row.
+//
+
+static bool				  // O - true on success
+ccitt_decode_1d(pdfrip_ccitt_t *c)	// I - Decoder
+{
+  int	a0 = 0,				// Current position
+	color = 0,			// Current color
+	run;				// Run length
+
+  while (a0 < c->params.columns)
+  {
+    if ((run = ccitt_run(c, color)) < 0)
+      return (false);
+
+    a0 += run;
+
+    if (!ccitt_add_change(c, a0))
+      return (false);
+
+    color = !color;
+  }
+
+  return (true);
+}
+
+//
+// 'ccitt_decode_2d()' - Decode a two-dimensional (READ) row.
+//
+// b1 is the first change on the reference line to the right of a0 that
+// goes to the opposite of the current color; changes at even indices go
+// to black.  The reference line ends with three copies of the width.
+//
+
+static bool				  // O - true on success
+ccitt_decode_2d(pdfrip_ccitt_t *c)	// I - Decoder
+{
+  const int	*ref = c->ref;		// Reference line
+  int		columns = c->params.columns,
+					// Width of a row
+		a0 = -1,		// Current position
+		color = 0,		// Current color
+		bi = 0,			// First reference change right of a0
+		b1,			// b1 index
+		a1, a2, r1, r2;		// Runs of a horizontal mode
+
+  while (a0 < columns)
+  {
+    const ccitt_entry_t *e = ccitt_modes + ccitt_peek(c, CCITT_MODE_BITS);
+					// Mode code
+
+    if (!e->length)
+      return (false);
+
+    ccitt_skip(c, e->length);
+
+    while (ref[bi] <= a0 && bi < c->num_ref)
+      bi ++;
+
+    b1 = bi + ((bi & 1) != color);
+
+    switch ((ccitt_mode_t)e->value)
+    {
+      case CCITT_MODE_PASS :
+          a0 = ref[b1 + 1];
+          break;
+
+      case CCITT_MODE_HORIZ :
+          if ((r1 = ccitt_run(c, color)) < 0 || (r2 = ccitt_run(c, !color)) < 0)
+            return (false);
+
+          a1 = (a0 < 0 ? 0 : a0) + r1;
+          a2 = a1 + r2;
+
+          if (!ccitt_add_change(c, a1) || !ccitt_add_change(c, a2))
+            return (false);
+
+          a0 = a2;
+          break;
+
+      default :
+          // Vertical modes, V0 to VL3 in order of delta 0, 1, 2, 3, -1, -2, -3
+          a1 = ref[b1] + (e->value <= CCITT_MODE_VR3 ? e->value - CCITT_MODE_V0 : CCITT_MODE_VR3 - e->value);
+
+          if (a1 < 0 || a1 < a0 || !ccitt_add_change(c, a1))
+            return (false);
+
+          a0    = a1;
+          color = !color;
+          break;
+    }
+  }
+
+  return (true);
+}
+
+//
+// 'ccitt_put_row()' - Write the coding line as packed bits.
+//
+
+static void
+ccitt_put_row(pdfrip_ccitt_t *c,	// I - Decoder
+	      uint8_t        *row)	// O - Packed row
+{
+  int		columns = c->params.columns;
+					// Width of a row
+  uint8_t	white = c->params.black_is_1 ? 0x00 : 0xff;
+					// Byte of white pixels
+
+  memset(row, white, (size_t)(columns + 7) / 8);
+
+  // Changes alternate between the start and end of a black run
+  for (int i = 0; i + 1 <= c->num_cur; i += 2)
+  {
+    int start = c->cur[i],		// First black pixel
+	end = i + 1 < c->num_cur ? c->cur[i + 1] : columns;
+					// End of black run
+
+    if (end > columns)
+      end = columns;
+
+    if (start >= end)
+      continue;
+
+    uint8_t	*p = row + start / 8;	// First byte of run
+    int		first = start & 7,	// First bit in first byte
+		last = end - (start & ~7);
+					// End bit relative to first byte
+
+    if (last <= 8)
+    {
+      // Run within one byte
+      *p ^= (uint8_t)((0xff >> first) & (0xff << (8 - last)));
+    }
+    else
+    {
+      *p++ ^= (uint8_t)(0xff >> first);
+      last -= 8;
+
+      if (last >= 8)
+      {
+        memset(p, ~white, (size_t)(last / 8));
+        p    += last / 8;
+        last &= 7;
+      }
+
+      if (last)
+        *p ^= (uint8_t)(0xff << (8 - last));
+    }
+  }
+}
+
+//
+// 'ccitt_row_start()' - Skip fill bits and EOL codes before a Group 3 row.
+//
+// Returns the number of EOL codes skipped, or -1 at the end of the data.
+//
+
+static int				  // O - Number of EOLs or -1
+ccitt_row_start(pdfrip_ccitt_t *c)	// I - Decoder
+{
+  int	eols = 0;			// Number of EOLs
+
+  if (c->params.byte_align && !c->params.end_of_line)
+    ccitt_align(c);
+
+  for (;;)
+  {
+    if (ccitt_at_end(c))
+      return (-1);
+
+    if (ccitt_peek(c, 12) == 0)
+    {
+      // Fill bits before an EOL
+      ccitt_skip(c, __builtin_clzll(c->bits | 1) - 11);
+    }
+    else if (ccitt_peek(c, 12) == 1)
+    {
+      ccitt_skip(c, 12);
+      eols ++;
+
+      // The EOLs of a 2-D RTC are each followed by a 1 tag bit
+      if (c->params.k > 0 && ccitt_peek(c, 13) == 0x1001)
+        ccitt_skip(c, 1);
+
+      if (eols > 1 && c->params.end_of_block)
+        return (-1);
+    }
+    else
+    {
+      return (eols);
+    }
+  }
+}
+
+//
+// 'ccitt_sync()' - Skip to the next EOL after damaged Group 3 data.
+//
+
+static bool				  // O - true if an EOL was found
+ccitt_sync(pdfrip_ccitt_t *c)		// I - Decoder
+{
+  while (!ccitt_at_end(c))
+  {
+    if (ccitt_peek(c, 12) == 1)
+      return (true);
+
+    ccitt_skip(c, 1);
+  }
+
+  return (false);
+}
+
+//
+// 'ccitt_get_params()' - Get the decoding parameters of a CCITTFaxDecode image.
+//
+// Columns defaults to the image width rather than 1728, and Rows to the
+// image height.
+//
+
+void
+ccitt_get_params(
+    pdfio_dict_t          *dict,	// I - Image dictionary
+    pdfrip_ccitt_params_t *params)	// O - Decoding parameters
+{
+  pdfio_dict_t	*parms;			// DecodeParms dictionary
+  pdfio_array_t	*array;			// DecodeParms array
+
+  if ((array = pdfioDictGetArray(dict, "DecodeParms")) != NULL)
+    parms = pdfioArrayGetDict(array, 0);
+  else
+    parms = pdfioDictGetDict(dict, "DecodeParms");
+
+  params->k            = (int)pdfioDictGetNumber(parms, "K");
+  params->columns      = (int)pdfioDictGetNumber(parms, "Columns");
+  params->rows         = (int)pdfioDictGetNumber(parms, "Rows");
+  params->end_of_line  = pdfioDictGetBoolean(parms, "EndOfLine");
+  params->byte_align   = pdfioDictGetBoolean(parms, "EncodedByteAlign");
+  params->end_of_block = pdfioDictGetType(parms, "EndOfBlock") != PDFIO_VALTYPE_BOOLEAN || pdfioDictGetBoolean(parms, "EndOfBlock");
+  params->black_is_1   = pdfioDictGetBoolean(parms, "BlackIs1");
+
+  if (params->columns <= 0)
+    params->columns = (int)pdfioDictGetNumber(dict, "Width");
+
+  if (params->rows <= 0)
+    params->rows = (int)pdfioDictGetNumber(dict, "Height");
+}
+
+//
+// 'ccitt_close()' - Free a CCITT decoder.
+//
+
+void
+ccitt_close(pdfrip_ccitt_t *c)		// I - Decoder
+{
+  if (!c)
+    return;
+
+  free(c->ref);
+  free(c->cur);
+  free(c);
+}
+
+//
+// 'ccitt_open()' - Start decoding CCITT fax data.
+//
+// The callback reads the raw (encoded) data, like pdfioStreamRead().
+//
+
+pdfrip_ccitt_t *			  // O - Decoder or NULL
+ccitt_open(
+    const pdfrip_ccitt_params_t *params,// I - Decoding parameters
+    pdfrip_ccitt_cb_t           cb,	// I - Read callback
+    void                        *cb_data)// I - Callback data
+{
+  pdfrip_ccitt_t	*c;		// Decoder
+
+  if (params->columns <= 0 || params->columns > PDFRIP_IMAGE_MAX_WIDTH * 8)
+    return (NULL);
+
+  pthread_once(&ccitt_once, ccitt_init);
+
+  if ((c = calloc(1, sizeof(pdfrip_ccitt_t))) == NULL)
+    return (NULL);
+
+  c->params  = *params;
+  c->cb      = cb;
+  c->cb_data = cb_data;
+
+  // Every pixel can be a change, plus the end of the row and three markers
+  if ((c->ref = malloc((size_t)(params->columns + 8) * sizeof(int))) == NULL || (c->cur = malloc((size_t)(params->columns + 8) * sizeof(int))) == NULL)
+  {
+    ccitt_close(c);
+    return (NULL);
+  }
+
+  // The line above the first row is white
+  c->ref[0] = c->ref[1] = c->ref[2] = params->columns;
+
+  return (c);
+}
+
+//
+// 'ccitt_read_row()' - Decode the next row.
+//
+// Rows are (columns + 7) / 8 bytes.  Returns false, with a white row,
+// once the data has ended.
+//
+
+bool					  // O - true if a row was decoded
+ccitt_read_row(pdfrip_ccitt_t *c,	// I - Decoder
+	       uint8_t        *row)	// O - Packed row
+{
+  int	eols = 0;			// EOL codes before the row
+  bool	two_d,				// 2-D coded row?
+	ok;				// Decoded without errors?
+  int	*temp;				// Swap of reference and coding lines
+
+  c->num_cur = 0;
+
+  if (c->done || (c->params.rows > 0 && c->row >= c->params.rows))
+  {
+    c->done = true;
+    ccitt_put_row(c, row);
+    return (false);
+  }
+
+  if (c->params.k < 0)
+  {
+    // Group 4, ended by EOFB (two EOLs) or the data
+    if (c->params.byte_align)
+      ccitt_align(c);
+
+    if (ccitt_at_end(c) || ccitt_peek(c, 24) == 0x001001)
+    {
+      c->done = true;
+      ccitt_put_row(c, row);
+      return (false);
+    }
+
+    two_d = true;
+  }
+  else
+  {
+    // Group 3, ended by RTC (six EOLs) or the data
+    if ((eols = ccitt_row_start(c)) < 0)
+    {
+      c->done = true;
+      ccitt_put_row(c, row);
+      return (false);
+    }
+
+    two_d = false;
+
+    if (c->params.k > 0)
+    {
+      two_d = !ccitt_peek(c, 1);
+      ccitt_skip(c, 1);
+    }
+  }
+
+  ok = two_d ? ccitt_decode_2d(c) : ccitt_decode_1d(c);
+
+  if (!ok)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Damaged CCITT data in row %d.\n", c->row);
+
+    // Keep what was decoded; Group 3 data has EOLs to resynchronize at
+    if (c->params.k < 0 || !ccitt_sync(c))
+      c->done = true;
+  }
+
+  ccitt_put_row(c, row);
+
+  // This row is the reference line for the next
+  if (c->num_cur == 0 || c->cur[c->num_cur - 1] < c->params.columns)
+    c->cur[c->num_cur ++] = c->params.columns;
+
+  c->cur[c->num_cur] = c->cur[c->num_cur + 1] = c->cur[c->num_cur + 2] = c->params.columns;
+
+  temp       = c->ref;
+  c->ref     = c->cur;
+  c->cur     = temp;
+  c->num_ref = c->num_cur;
+
+  c->row ++;
+
+  return (true);
+}
@@ -0,0 +1,1078 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+//
+// CMap support for composite (Type0) fonts.
+//
+// Embedded and predefined CMaps are compiled into sorted tables of code
+// ranges that map multi-byte character codes to CIDs with a binary search.
+// ToUnicode CMaps use the same tables with Unicode values; mappings to
+// more than one character are kept in a separate string pool.  Each CMap
+// is parsed once per document and shared by every font using it.
+//
+
+#include "pdfops-private.h"
+#include <ctype.h>
+#include <string.h>
+
+extern int g_verbose;
+
+#define CMAP_MAX_DEPTH	4		// Maximum usecmap nesting
+#define CMAP_MAX_TEXT	32		// Maximum characters in a bf destination
+
+// Identity CMaps map two-byte codes straight to CIDs
+static pdfrip_cmap_t	identity_h = { .name = "Identity-H", .identity = true };
+static pdfrip_cmap_t	identity_v = { .name = "Identity-V", .identity = true };
+
+// Directories searched for predefined CMap files, after $PDFRIP_CMAP_DIR.
+// A "%s" is replaced with the character collection, e.g. "Adobe-Japan1".
+static const char * const cmap_dirs[] =
+{
+  "/usr/share/poppler/cMap/%s",
+  "/usr/share/ghostscript/Resource/CMap",
+  "/usr/share/fonts/cmap/%s"
+};
+
+// Simple tokenizer over a CMap program in memory
+typedef struct cmap_lexer_s
+{
+  const unsigned char	*ptr,		// Current position
+			*end;		// End of buffer
+} cmap_lexer_t;
+
+static pdfrip_cmap_t *cmap_load(pdfrip_doc_t *doc, pdfio_dict_t *dict, const char *key, const char *collection, int depth);
+
+
+//
+// 'cmap_token()' - Read the next token from a CMap program.
+//
+// Hex strings are returned as "<" followed by the decoded bytes, with the
+// byte count in *length.
+//
+
+static bool				  // O - true if a token was read
+cmap_token(cmap_lexer_t *lex,		// I - Lexer
+	   char *token,			// O - Token
+	   size_t size,			// I - Size of token buffer
+	   size_t *length)		// O - Length of token
+{
+  char *ptr = token, *end = token + size - 1;
+
+  // Skip whitespace and comments
+  while (lex->ptr < lex->end)
+  {
+    if (isspace(*lex->ptr))
+      lex->ptr ++;
+    else if (*lex->ptr == '%')
+    {
+      while (lex->ptr < lex->end && *lex->ptr != '\n' && *lex->ptr != '\r')
+        lex->ptr ++;
+    }
+    else
+      break;
+  }
+
+  if (lex->ptr >= lex->end)
+    return (false);
+
+  int ch = *lex->ptr++;
+
+  *ptr++ = (char)ch;
+
+  if (ch == '<' && lex->ptr < lex->end && *lex->ptr == '<')
+  {
+    *ptr++ = (char)*lex->ptr++;
+  }
+  else if (ch == '>' && lex->ptr < lex->end && *lex->ptr == '>')
+  {
+    *ptr++ = (char)*lex->ptr++;
+  }
+  else if (ch == '<')
+  {
+    int value = 0, digits = 0;
+
+    while (lex->ptr < lex->end && *lex->ptr != '>')
+    {
+      ch = *lex->ptr++;
+      if (!isxdigit(ch))
+        continue;
+
+      value = (value << 4) | (isdigit(ch) ? ch - '0' : tolower(ch) - 'a' + 10);
+      if (++ digits == 2)
+      {
+        if (ptr < end)
+          *ptr++ = (char)value;
+        value = digits = 0;
+      }
+    }
+
+    if (digits && ptr < end)
+      *ptr++ = (char)(value << 4);
+
+    if (lex->ptr < lex->end)
+      lex->ptr ++;
+  }
+  else if (ch == '(')
+  {
+    int parens = 0;
+
+    while (lex->ptr < lex->end)
+    {
+      ch = *lex->ptr++;
+      if (ch == '\\' && lex->ptr < lex->end)
+        ch = *lex->ptr++;
+      else if (ch == '(')
+        parens ++;
+      else if (ch == ')' && parens-- == 0)
+        break;
+
+      if (ptr < end)
+        *ptr++ = (char)ch;
+    }
+  }
+  else if (!strchr("[]{}", ch))
+  {
+    // Regular token, possibly a name starting with '/'
+    while (lex->ptr < lex->end && !isspace(*lex->ptr) && !strchr("()<>[]{}/%", *lex->ptr))
+    {
+      if (ptr < end)
+        *ptr++ = (char)*lex->ptr;
+      lex->ptr ++;
+    }
+  }
+
+  *length = (size_t)(ptr - token);
+  *ptr = '\0';
+
+  return (true);
+}
+
+//
+// 'cmap_code()' - Get a code from a hex string token.
+//
+
+static uint32_t				  // O - Code value
+cmap_code(const char *token,		// I - Token starting with '<'
+	  size_t length,		// I - Length of token
+	  uint8_t *bytes)		// O - Number of bytes in code
+{
+  uint32_t code = 0;
+
+  length = length > 1 ? length - 1 : 0;
+  if (length > 4)
+    length = 4;
+
+  for (size_t i = 0; i < length; i ++)
+    code = (code << 8) | (unsigned char)token[i + 1];
+
+  *bytes = (uint8_t)length;
+
+  return (code);
+}
+
+//
+// 'cmap_add()' - Add a code range to a list of ranges.
+//
+// Each range gets the next priority, so later definitions win overlaps.
+//
+
+static bool				  // O - true on success
+cmap_add(pdfrip_cmap_range_t **ranges,	// IO - Ranges
+	 size_t *num_ranges,		// IO - Number of ranges
+	 size_t *alloc_ranges,		// IO - Allocated ranges
+	 uint32_t first,		// I - First code
+	 uint32_t last,			// I - Last code
+	 uint32_t value,		// I - Value of first code
+	 uint8_t length)		// I - Length of codes in bytes
+{
+  if (length == 0 || last < first)
+    return (true);
+
+  if (*num_ranges == *alloc_ranges)
+  {
+    size_t alloc = *alloc_ranges ? *alloc_ranges * 2 : 64;
+    pdfrip_cmap_range_t *temp = realloc(*ranges, alloc * sizeof(pdfrip_cmap_range_t));
+
+    if (!temp)
+      return (false);
+
+    *ranges = temp;
+    *alloc_ranges = alloc;
+  }
+
+  (*ranges)[*num_ranges].first    = first;
+  (*ranges)[*num_ranges].last     = last;
+  (*ranges)[*num_ranges].value    = value;
+  (*ranges)[*num_ranges].priority = PDFRIP_CMAP_OWN | (uint32_t)*num_ranges;
+  (*ranges)[*num_ranges].length   = length;
+  (*num_ranges) ++;
+
+  return (true);
+}
+
+//
+// 'cmap_add_string()' - Add Unicode text to the string pool of a CMap.
+//
+
+static bool				  // O - true on success
+cmap_add_string(pdfrip_cmap_t *cmap,	// I - CMap
+		const uint32_t *text,	// I - Code points
+		size_t num_text,	// I - Number of code points
+		uint32_t *value)	// O - Value referring to the string
+{
+  if (cmap->num_strings + num_text + 1 > cmap->alloc_strings)
+  {
+    size_t alloc = cmap->alloc_strings ? cmap->alloc_strings * 2 : 256;
+    uint32_t *temp;
+
+    while (alloc < cmap->num_strings + num_text + 1)
+      alloc *= 2;
+
+    if ((temp = realloc(cmap->strings, alloc * sizeof(uint32_t))) == NULL)
+      return (false);
+
+    cmap->strings = temp;
+    cmap->alloc_strings = alloc;
+  }
+
+  *value = PDFRIP_CMAP_STRING | (uint32_t)cmap->num_strings;
+
+  cmap->strings[cmap->num_strings++] = (uint32_t)num_text;
+  memcpy(cmap->strings + cmap->num_strings, text, num_text * sizeof(uint32_t));
+  cmap->num_strings += num_text;
+
+  return (true);
+}
+
+//
+// 'cmap_utf16()' - Decode a UTF-16BE hex string token to code points.
+//
+
+static size_t				  // O - Number of code points
+cmap_utf16(const char *token,		// I - Token starting with '<'
+	   size_t length,		// I - Length of token
+	   uint32_t *text,		// O - Code points
+	   size_t textsize)		// I - Size of text array
+{
+  const unsigned char *ptr = (const unsigned char *)token + 1;
+  size_t	count = 0;
+
+  for (length = length > 0 ? length - 1 : 0; length >= 2 && count < textsize; ptr += 2, length -= 2)
+  {
+    uint32_t ch = ((uint32_t)ptr[0] << 8) | ptr[1];
+
+    if (ch >= 0xd800 && ch < 0xdc00 && length >= 4)
+    {
+      uint32_t low = ((uint32_t)ptr[2] << 8) | ptr[3];
+
+      if (low >= 0xdc00 && low < 0xe000)
+      {
+        ch = 0x10000 + ((ch - 0xd800) << 10) + (low - 0xdc00);
+        ptr += 2;
+        length -= 2;
+      }
+    }
+
+    text[count++] = ch;
+  }
+
+  // Odd single byte destinations are seen in the wild; treat as Latin-1
+  if (count == 0 && length == 1 && textsize > 0)
+    text[count++] = *ptr;
+
+  return (count);
+}
+
+//
+// 'cmap_add_bf()' - Add a code to Unicode mapping.
+//
+
+static bool				  // O - true on success
+cmap_add_bf(pdfrip_cmap_t *cmap,	// I - CMap
+	    size_t *alloc_ranges,	// IO - Allocated ranges
+	    uint32_t code,		// I - Code
+	    uint8_t length,		// I - Code length
+	    const uint32_t *text,	// I - Code points
+	    size_t num_text)		// I - Number of code points
+{
+  uint32_t value;
+
+  if (num_text == 0)
+    return (true);
+  else if (num_text == 1)
+    value = text[0];
+  else if (!cmap_add_string(cmap, text, num_text, &value))
+    return (false);
+
+  return (cmap_add(&cmap->ranges, &cmap->num_ranges, alloc_ranges, code, code, value, length));
+}
+
+//
+// 'compare_ranges()' - Order ranges by code length, first code and priority.
+//
+
+static int				  // O - Result of comparison
+compare_ranges(const void *a,		// I - First range
+	       const void *b)		// I - Second range
+{
+  const pdfrip_cmap_range_t *ra = a, *rb = b;
+
+  if (ra->length != rb->length)
+    return (ra->length < rb->length ? -1 : 1);
+  if (ra->first != rb->first)
+    return (ra->first < rb->first ? -1 : 1);
+
+  return (ra->priority < rb->priority ? -1 : ra->priority > rb->priority ? 1 : 0);
+}
+
+//
+// 'cmap_heap_push()' - Add a range to a heap ordered by priority.
+//
+
+static void
+cmap_heap_push(pdfrip_cmap_range_t **heap,// I - Heap
+	       size_t *num_heap,	// IO - Number of ranges in heap
+	       pdfrip_cmap_range_t *r)	// I - Range to add
+{
+  size_t i = (*num_heap) ++, parent;	// Position in heap
+
+  while (i > 0 && heap[parent = (i - 1) / 2]->priority < r->priority)
+  {
+    heap[i] = heap[parent];
+    i       = parent;
+  }
+
+  heap[i] = r;
+}
+
+//
+// 'cmap_heap_pop()' - Remove the highest priority range from a heap.
+//
+
+static void
+cmap_heap_pop(pdfrip_cmap_range_t **heap,// I - Heap
+	      size_t *num_heap)		// IO - Number of ranges in heap
+{
+  pdfrip_cmap_range_t *r = heap[-- (*num_heap)];
+					// Range to sift down
+  size_t i = 0, child;			// Position in heap
+
+  while ((child = 2 * i + 1) < *num_heap)
+  {
+    if (child + 1 < *num_heap && heap[child + 1]->priority > heap[child]->priority)
+      child ++;
+
+    if (heap[child]->priority < r->priority)
+      break;
+
+    heap[i] = heap[child];
+    i       = child;
+  }
+
+  heap[i] = r;
+}
+
+//
+// 'cmap_flatten()' - Split overlapping ranges so that none overlap.
+//
+// The ranges must be sorted with compare_ranges().  Where ranges overlap,
+// the one with the highest priority wins: the CMap's own ranges beat those
+// inherited through usecmap, and a later definition beats an earlier one,
+// so a cidchar after a cidrange splits it.  The winners are found with a
+// heap of the ranges covering the current code, and the result stays
+// sorted.
+//
+
+static bool				  // O - true on success
+cmap_flatten(pdfrip_cmap_t *cmap)	// I - CMap
+{
+  pdfrip_cmap_range_t	*ranges = NULL,	// Non-overlapping ranges
+			**heap,		// Ranges that may cover the current code
+			*prev = NULL;	// Range of the last output
+  size_t		num_ranges = 0,	// Number of ranges
+			alloc_ranges = 0,// Allocated ranges
+			num_heap = 0;	// Ranges in heap
+  uint64_t		pos = 0;	// First code not yet output
+  uint8_t		length = 0;	// Code length of the heap
+
+  if ((heap = malloc((cmap->num_ranges + 1) * sizeof(pdfrip_cmap_range_t *))) == NULL)
+    return (false);
+
+  for (size_t i = 0; i <= cmap->num_ranges; i ++)
+  {
+    pdfrip_cmap_range_t	*r = i < cmap->num_ranges ? cmap->ranges + i : NULL;
+					// Next range, NULL to finish
+    uint64_t		next = r && r->length == length ? r->first : UINT64_MAX;
+					// Where the next range may take over
+
+    // Output the winner of each code up to the next range
+    while (pos < next)
+    {
+      pdfrip_cmap_range_t *top;		// Highest priority range
+      uint64_t		  end;		// Last code it wins
+
+      // Drop ranges that end before the current code
+      while (num_heap > 0 && heap[0]->last < pos)
+        cmap_heap_pop(heap, &num_heap);
+
+      if (num_heap == 0)
+        break;
+
+      top = heap[0];
+      end = top->last < next ? top->last : next - 1;
+
+      if (top == prev && ranges[num_ranges - 1].last + 1 == pos)
+      {
+        // Same range as the last output, just extend it
+        ranges[num_ranges - 1].last = (uint32_t)end;
+      }
+      else if (!cmap_add(&ranges, &num_ranges, &alloc_ranges, (uint32_t)pos, (uint32_t)end, top->value + (uint32_t)(pos - top->first), length))
+      {
+        free(ranges);
+        free(heap);
+        return (false);
+      }
+
+      prev = top;
+      pos  = end + 1;
+    }
+
+    if (!r)
+      break;
+
+    if (r->length != length)
+    {
+      num_heap = 0;
+      prev     = NULL;
+      length   = r->length;
+      pos      = r->first;
+    }
+    else if (pos < r->first)
+      pos = r->first;
+
+    cmap_heap_push(heap, &num_heap, r);
+  }
+
+  free(heap);
+  free(cmap->ranges);
+
+  cmap->ranges     = ranges;
+  cmap->num_ranges = num_ranges;
+
+  return (true);
+}
+
+//
+// 'cmap_merge()' - Copy the ranges of a parent CMap (usecmap).
+//
+// The copied ranges rank below all ranges the CMap defines itself.
+//
+
+static bool				  // O - true on success
+cmap_merge(pdfrip_cmap_t *cmap,		// I - CMap
+	   const pdfrip_cmap_t *parent,	// I - Parent CMap
+	   size_t *alloc_codespace,	// IO - Allocated codespace ranges
+	   size_t *alloc_ranges)	// IO - Allocated ranges
+{
+  const pdfrip_cmap_range_t *r;
+
+  if (parent->identity)
+  {
+    if (!cmap_add(&cmap->codespace, &cmap->num_codespace, alloc_codespace, 0, 0xffff, 0, 2) ||
+        !cmap_add(&cmap->ranges, &cmap->num_ranges, alloc_ranges, 0, 0xffff, 0, 2))
+      return (false);
+
+    cmap->ranges[cmap->num_ranges - 1].priority &= ~PDFRIP_CMAP_OWN;
+    return (true);
+  }
+
+  for (r = parent->codespace; r < parent->codespace + parent->num_codespace; r ++)
+    if (!cmap_add(&cmap->codespace, &cmap->num_codespace, alloc_codespace, r->first, r->last, r->value, r->length))
+      return (false);
+
+  for (r = parent->ranges; r < parent->ranges + parent->num_ranges; r ++)
+  {
+    uint32_t value = r->value;
+
+    if ((value & PDFRIP_CMAP_STRING) &&
+        !cmap_add_string(cmap, parent->strings + (value & ~PDFRIP_CMAP_STRING) + 1, parent->strings[value & ~PDFRIP_CMAP_STRING], &value))
+      return (false);
+
+    if (!cmap_add(&cmap->ranges, &cmap->num_ranges, alloc_ranges, r->first, r->last, value, r->length))
+      return (false);
+
+    cmap->ranges[cmap->num_ranges - 1].priority &= ~PDFRIP_CMAP_OWN;
+  }
+
+  return (true);
+}
+
+//
+// 'cmap_parse()' - Compile a CMap program into range tables.
+//
+
+static bool				  // O - true on success
+cmap_parse(pdfrip_doc_t *doc,		// I - Document for usecmap lookups
+	   pdfrip_cmap_t *cmap,		// I - CMap to fill
+	   const unsigned char *data,	// I - CMap program
+	   size_t size,			// I - Size of program
+	   const char *collection,	// I - Character collection
+	   int depth)			// I - usecmap nesting level
+{
+  cmap_lexer_t	lex = { data, data + size };
+  char		token[256],		// Current token
+		prev[256] = "",		// Previous token
+		first[256],		// First code of entry
+		second[256];		// Second code of entry
+  size_t	length, first_len, second_len;
+  size_t	alloc_codespace = cmap->num_codespace,
+		alloc_ranges = cmap->num_ranges;
+  uint8_t	bytes, last_bytes;
+
+  while (cmap_token(&lex, token, sizeof(token), &length))
+  {
+    if (!strcmp(token, "begincodespacerange"))
+    {
+      while (cmap_token(&lex, first, sizeof(first), &first_len) && first[0] == '<' &&
+             cmap_token(&lex, second, sizeof(second), &second_len))
+      {
+        uint32_t lo = cmap_code(first, first_len, &bytes);
+        uint32_t hi = cmap_code(second, second_len, &last_bytes);
+
+        if (!cmap_add(&cmap->codespace, &cmap->num_codespace, &alloc_codespace, lo, hi, 0, bytes))
+          return (false);
+      }
+    }
+    else if (!strcmp(token, "begincidrange") || !strcmp(token, "beginnotdefrange"))
+    {
+      bool notdef = token[5] == 'n';
+
+      while (cmap_token(&lex, first, sizeof(first), &first_len) && first[0] == '<' &&
+             cmap_token(&lex, second, sizeof(second), &second_len) &&
+             cmap_token(&lex, token, sizeof(token), &length))
+      {
+        uint32_t lo = cmap_code(first, first_len, &bytes);
+        uint32_t hi = cmap_code(second, second_len, &last_bytes);
+        uint32_t cid = (uint32_t)strtoul(token, NULL, 10);
+
+        // notdef ranges map every code to the same CID; only keep them
+        // for single codes, which is how they are normally used
+        if (notdef && hi != lo)
+          continue;
+
+        if (!cmap_add(&cmap->ranges, &cmap->num_ranges, &alloc_ranges, lo, hi, cid, bytes))
+          return (false);
+      }
+    }
+    else if (!strcmp(token, "begincidchar") || !strcmp(token, "beginnotdefchar"))
+    {
+      while (cmap_token(&lex, first, sizeof(first), &first_len) && first[0] == '<' &&
+             cmap_token(&lex, token, sizeof(token), &length))
+      {
+        uint32_t code = cmap_code(first, first_len, &bytes);
+        uint32_t cid = (uint32_t)strtoul(token, NULL, 10);
+
+        if (!cmap_add(&cmap->ranges, &cmap->num_ranges, &alloc_ranges, code, code, cid, bytes))
+          return (false);
+      }
+    }
+    else if (!strcmp(token, "beginbfchar"))
+    {
+      while (cmap_token(&lex, first, sizeof(first), &first_len) && first[0] == '<' &&
+             cmap_token(&lex, second, sizeof(second), &second_len))
+      {
+        uint32_t code = cmap_code(first, first_len, &bytes);
+        uint32_t text[CMAP_MAX_TEXT];
+        size_t num_text = 0;
+        int unicode;
+
+        if (second[0] == '<')
+          num_text = cmap_utf16(second, second_len, text, CMAP_MAX_TEXT);
+        else if (second[0] == '/' && (unicode = glyph_name_to_unicode(second + 1)) > 0)
+          text[num_text++] = (uint32_t)unicode;
+
+        if (!cmap_add_bf(cmap, &alloc_ranges, code, bytes, text, num_text))
+          return (false);
+      }
+    }
+    else if (!strcmp(token, "beginbfrange"))
+    {
+      while (cmap_token(&lex, first, sizeof(first), &first_len) && first[0] == '<' &&
+             cmap_token(&lex, second, sizeof(second), &second_len) &&
+             cmap_token(&lex, token, sizeof(token), &length))
+      {
+        uint32_t lo = cmap_code(first, first_len, &bytes);
+        uint32_t hi = cmap_code(second, second_len, &last_bytes);
+        uint32_t text[CMAP_MAX_TEXT];
+        size_t num_text;
+
+        if (hi < lo)
+          continue;
+
+        if (token[0] == '[')
+        {
+          // One destination string per code
+          for (uint32_t code = lo; cmap_token(&lex, token, sizeof(token), &length) && token[0] != ']'; code ++)
+          {
+            if (token[0] != '<' || code > hi)
+              continue;
+
+            num_text = cmap_utf16(token, length, text, CMAP_MAX_TEXT);
+            if (!cmap_add_bf(cmap, &alloc_ranges, code, bytes, text, num_text))
+              return (false);
+          }
+        }
+        else if (token[0] == '<' && (num_text = cmap_utf16(token, length, text, CMAP_MAX_TEXT)) == 1)
+        {
+          // The common case: consecutive codes to consecutive characters
+          if (!cmap_add(&cmap->ranges, &cmap->num_ranges, &alloc_ranges, lo, hi, text[0], bytes))
+            return (false);
+        }
+        else if (token[0] == '<' && num_text > 1)
+        {
+          // Only the last character of the destination is incremented
+          for (uint32_t code = lo; code <= hi && code - lo < 256; code ++, text[num_text - 1] ++)
+          {
+            if (!cmap_add_bf(cmap, &alloc_ranges, code, bytes, text, num_text))
+              return (false);
+          }
+        }
+      }
+    }
+    else if (!strcmp(token, "usecmap") && prev[0] == '/')
+    {
+      const pdfrip_cmap_t *parent;
+
+      if (depth >= CMAP_MAX_DEPTH)
+        continue;
+
+      if ((parent = cmap_get_predefined(doc, prev + 1, collection)) != NULL &&
+          !cmap_merge(cmap, parent, &alloc_codespace, &alloc_ranges))
+        return (false);
+    }
+
+    memcpy(prev, token, length + 1);
+  }
+
+  qsort(cmap->ranges, cmap->num_ranges, sizeof(pdfrip_cmap_range_t), compare_ranges);
+
+  if (!cmap_flatten(cmap))
+    return (false);
+
+  // Remember the code lengths in use for decoding codes outside the
+  // codespace ranges...
+  cmap->min_length = 4;
+  for (size_t i = 0; i < cmap->num_codespace; i ++)
+  {
+    if (cmap->codespace[i].length < cmap->min_length)
+      cmap->min_length = cmap->codespace[i].length;
+  }
+
+  if (cmap->num_codespace == 0)
+    cmap->min_length = 1;
+
+  return (true);
+}
+
+//
+// 'cmap_cache_add()' - Add a CMap to the document cache.
+//
+
+static pdfrip_cmap_t *			  // O - CMap or NULL on error
+cmap_cache_add(pdfrip_doc_t *doc,	// I - Document
+	       pdfrip_cmap_t *cmap)	// I - CMap
+{
+  if (doc->num_cmaps == doc->alloc_cmaps)
+  {
+    size_t alloc = doc->alloc_cmaps ? doc->alloc_cmaps * 2 : 8;
+    pdfrip_cmap_t **temp = realloc(doc->cmaps, alloc * sizeof(pdfrip_cmap_t *));
+
+    if (!temp)
+    {
+      cmap_free(cmap);
+      return (NULL);
+    }
+
+    doc->cmaps = temp;
+    doc->alloc_cmaps = alloc;
+  }
+
+  doc->cmaps[doc->num_cmaps++] = cmap;
+
+  return (cmap);
+}
+
+//
+// 'cmap_get_predefined()' - Get a predefined CMap by name.
+//
+
+const pdfrip_cmap_t *			  // O - CMap or NULL if not available
+cmap_get_predefined(pdfrip_doc_t *doc,	// I - Document
+		    const char *name,	// I - CMap name, e.g. "UniJIS-UCS2-H"
+		    const char *collection)// I - Character collection or NULL
+{
+  pdfrip_cmap_t	*cmap;			// CMap
+  char		filename[1024];		// CMap filename
+  const char	*env;			// $PDFRIP_CMAP_DIR
+  FILE		*fp = NULL;		// CMap file
+  unsigned char	*data;			// CMap program
+  long		size;			// Size of program
+
+  if (!strcmp(name, "Identity-H"))
+    return (&identity_h);
+  else if (!strcmp(name, "Identity-V"))
+    return (&identity_v);
+
+  for (size_t i = 0; i < doc->num_cmaps; i ++)
+  {
+    if (doc->cmaps[i]->obj_number == 0 && !strcmp(doc->cmaps[i]->name, name))
+      return (doc->cmaps[i]);
+  }
+
+  if (strchr(name, '/') || strstr(name, ".."))
+    return (NULL);
+
+  if ((env = getenv("PDFRIP_CMAP_DIR")) != NULL)
+  {
+    snprintf(filename, sizeof(filename), "%s/%s", env, name);
+    fp = fopen(filename, "rb");
+  }
+
+  for (size_t i = 0; !fp && i < sizeof(cmap_dirs) / sizeof(cmap_dirs[0]); i ++)
+  {
+    char dir[512];
+
+    if (strstr(cmap_dirs[i], "%s"))
+    {
+      if (!collection)
+        continue;
+      snprintf(dir, sizeof(dir), cmap_dirs[i], collection);
+    }
+    else
+      snprintf(dir, sizeof(dir), "%s", cmap_dirs[i]);
+
+    snprintf(filename, sizeof(filename), "%s/%s", dir, name);
+    fp = fopen(filename, "rb");
+  }
+
+  if (!fp)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Predefined CMap %s not found.\n", name);
+    return (NULL);
+  }
+
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  rewind(fp);
+
+  if (size <= 0 || (data = malloc((size_t)size)) == NULL)
+  {
+    fclose(fp);
+    return (NULL);
+  }
+
+  if (fread(data, 1, (size_t)size, fp) != (size_t)size || (cmap = calloc(1, sizeof(pdfrip_cmap_t))) == NULL)
+  {
+    free(data);
+    fclose(fp);
+    return (NULL);
+  }
+
+  fclose(fp);
+
+  snprintf(cmap->name, sizeof(cmap->name), "%s", name);
+
+  if (!cmap_parse(doc, cmap, data, (size_t)size, collection, 1))
+  {
+    free(data);
+    cmap_free(cmap);
+    return (NULL);
+  }
+
+  free(data);
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: Loaded CMap %s with %zu ranges.\n", name, cmap->num_ranges);
+
+  return (cmap_cache_add(doc, cmap));
+}
+
+//
+// 'cmap_load()' - Load the CMap named by a dictionary entry.
+//
+
+static pdfrip_cmap_t *			  // O - CMap or NULL
+cmap_load(pdfrip_doc_t *doc,		// I - Document
+	  pdfio_dict_t *dict,		// I - Dictionary
+	  const char *key,		// I - Key of the CMap entry
+	  const char *collection,	// I - Character collection or NULL
+	  int depth)			// I - usecmap nesting level
+{
+  const char	*name;			// Predefined CMap name
+  pdfio_obj_t	*obj;			// Embedded CMap stream
+  pdfio_stream_t *st;			// Stream
+  pdfrip_cmap_t	*cmap;			// CMap
+  unsigned char	*data = NULL;		// CMap program
+  size_t	size = 0, alloc = 0;	// Size of program
+  ssize_t	bytes;			// Bytes read
+
+  if ((name = pdfioDictGetName(dict, key)) != NULL)
+    return ((pdfrip_cmap_t *)cmap_get_predefined(doc, name, collection));
+
+  if ((obj = pdfioDictGetObj(dict, key)) == NULL)
+    return (NULL);
+
+  for (size_t i = 0; i < doc->num_cmaps; i ++)
+  {
+    if (doc->cmaps[i]->obj_number == pdfioObjGetNumber(obj))
+      return (doc->cmaps[i]);
+  }
+
+  if ((st = pdfioObjOpenStream(obj, true)) == NULL)
+    return (NULL);
+
+  do
+  {
+    if (size == alloc)
+    {
+      unsigned char *temp;
+
+      alloc = alloc ? alloc * 2 : 16384;
+      if ((temp = realloc(data, alloc)) == NULL)
+      {
+        free(data);
+        pdfioStreamClose(st);
+        return (NULL);
+      }
+      data = temp;
+    }
+  }
+  while ((bytes = pdfioStreamRead(st, data + size, alloc - size)) > 0 && (size += (size_t)bytes) > 0);
+
+  pdfioStreamClose(st);
+
+  if ((cmap = calloc(1, sizeof(pdfrip_cmap_t))) == NULL)
+  {
+    free(data);
+    return (NULL);
+  }
+
+  cmap->obj_number = pdfioObjGetNumber(obj);
+  snprintf(cmap->name, sizeof(cmap->name), "%s", pdfioDictGetName(pdfioObjGetDict(obj), "CMapName") ? pdfioDictGetName(pdfioObjGetDict(obj), "CMapName") : "");
+
+  // An embedded CMap may build on another one through /UseCMap
+  if (depth < CMAP_MAX_DEPTH)
+  {
+    pdfrip_cmap_t *parent = cmap_load(doc, pdfioObjGetDict(obj), "UseCMap", collection, depth + 1);
+    size_t alloc_codespace = 0, alloc_ranges = 0;
+
+    if (parent && !cmap_merge(cmap, parent, &alloc_codespace, &alloc_ranges))
+    {
+      free(data);
+      cmap_free(cmap);
+      return (NULL);
+    }
+  }
+
+  if (!cmap_parse(doc, cmap, data, size, collection, depth))
+  {
+    free(data);
+    cmap_free(cmap);
+    return (NULL);
+  }
+
+  free(data);
+
+  return (cmap_cache_add(doc, cmap));
+}
+
+//
+// 'cmap_get()' - Get the CMap of a Type0 font.
+//
+
+const pdfrip_cmap_t *			  // O - CMap or NULL
+cmap_get(pdfrip_doc_t *doc,		// I - Document
+	 pdfio_dict_t *font_dict,	// I - Type0 font dictionary
+	 const char *collection)	// I - Character collection or NULL
+{
+  return (cmap_load(doc, font_dict, "Encoding", collection, 0));
+}
+
+//
+// 'cmap_get_to_unicode()' - Get the ToUnicode CMap of a font.
+//
+
+const pdfrip_cmap_t *			  // O - CMap or NULL
+cmap_get_to_unicode(pdfrip_doc_t *doc,	// I - Document
+		    pdfio_dict_t *font_dict)// I - Font dictionary
+{
+  // Only embedded ToUnicode streams map codes to Unicode
+  if (!pdfioDictGetObj(font_dict, "ToUnicode"))
+    return (NULL);
+
+  return (cmap_load(doc, font_dict, "ToUnicode", NULL, 0));
+}
+
+//
+// 'cmap_lookup()' - Look up the value of a character code.
+//
+
+bool					  // O - true if the code is mapped
+cmap_lookup(const pdfrip_cmap_t *cmap,	// I - CMap
+	    uint32_t code,		// I - Character code
+	    size_t length,		// I - Length of code in bytes
+	    uint32_t *value)		// O - CID or Unicode value
+{
+  size_t lo = 0, hi = cmap->num_ranges;
+
+  if (cmap->identity)
+  {
+    *value = code;
+    return (true);
+  }
+
+  // Binary search for the last range starting at or before the code
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+    const pdfrip_cmap_range_t *r = cmap->ranges + mid;
+
+    if (r->length < length || (r->length == length && r->first <= code))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  // Ranges never overlap, so only that one can hold the code
+  if (lo > 0)
+  {
+    const pdfrip_cmap_range_t *r = cmap->ranges + lo - 1;
+
+    if (r->length == length && code <= r->last)
+    {
+      *value = r->value + (code - r->first);
+      return (true);
+    }
+  }
+
+  *value = 0;
+
+  return (false);
+}
+
+//
+// 'cmap_unicode()' - Expand a Unicode value from a ToUnicode CMap.
+//
+
+size_t					  // O - Number of code points
+cmap_unicode(const pdfrip_cmap_t *cmap,	// I - ToUnicode CMap or NULL
+	     uint32_t value,		// I - Value from cmap_lookup()
+	     uint32_t *text,		// O - Code points
+	     size_t textsize)		// I - Size of text array
+{
+  if (textsize == 0 || value == 0)
+    return (0);
+
+  if (!(value & PDFRIP_CMAP_STRING))
+  {
+    text[0] = value;
+    return (1);
+  }
+
+  if (!cmap || (value & ~PDFRIP_CMAP_STRING) >= cmap->num_strings)
+    return (0);
+
+  const uint32_t *str = cmap->strings + (value & ~PDFRIP_CMAP_STRING);
+  size_t count = str[0] < textsize ? str[0] : textsize;
+
+  memcpy(text, str + 1, count * sizeof(uint32_t));
+
+  return (count);
+}
+
+//
+// 'cmap_decode()' - Decode the next character code of a string.
+//
+
+size_t					  // O - Number of bytes used
+cmap_decode(const pdfrip_cmap_t *cmap,	// I - CMap
+	    const unsigned char *str,	// I - String
+	    size_t len,			// I - Bytes left in string
+	    uint32_t *cid)		// O - CID
+{
+  uint32_t	code = 0;		// Character code
+  size_t	n;			// Code length
+
+  if (cmap->identity)
+  {
+    if (len >= 2)
+    {
+      *cid = ((uint32_t)str[0] << 8) | str[1];
+      return (2);
+    }
+
+    *cid = str[0];
+    return (1);
+  }
+
+  // Find the shortest code that lies within a codespace range
+  for (n = 1; n <= 4 && n <= len; n ++)
+  {
+    code = (code << 8) | str[n - 1];
+
+    for (size_t i = 0; i < cmap->num_codespace; i ++)
+    {
+      const pdfrip_cmap_range_t *r = cmap->codespace + i;
+
+      if (r->length == n && code >= r->first && code <= r->last)
+        goto found;
+    }
+  }
+
+  // Not a valid code; consume the shortest code length
+  for (n = 1, code = str[0]; n < cmap->min_length && n < len; n ++)
+    code = (code << 8) | str[n];
+
+  found:
+
+  cmap_lookup(cmap, code, n, cid);
+
+  return (n);
+}
+
+//
+// 'cmap_free()' - Free a CMap.
+//
+
+void
+cmap_free(pdfrip_cmap_t *cmap)		// I - CMap
+{
+  if (!cmap || cmap->identity)
+    return;
+
+  free(cmap->codespace);
+  free(cmap->ranges);
+  free(cmap->strings);
+  free(cmap);
+}
+
+//
+// 'freeDocCMaps()' - Free the CMaps cached by a document.
+//
+
+void
+freeDocCMaps(pdfrip_doc_t *doc)		// I - Document
+{
+  for (size_t i = 0; i < doc->num_cmaps; i ++)
+    cmap_free(doc->cmaps[i]);
+
+  free(doc->cmaps);
+
+  doc->cmaps = NULL;
+  doc->num_cmaps = doc->alloc_cmaps = 0;
+}
@@ -0,0 +1,504 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+//
+// Font substitution for fonts without an embedded program.
+//
+// BaseFont names such as "Helvetica-Bold", "TimesNewRomanPS-ItalicMT" or
+// "ABCDEF+ArialMT" are split into a family and style, and resolved to a
+// local font file through $PDFRIP_FONTMAP or fontconfig.  Resolutions and
+// the memory-mapped files are cached for the life of the process, so each
+// substitute is looked up and opened once no matter how many documents,
+// pages, fonts or threads use it.
+//
+
+#include "pdfops-private.h"
+#include <ctype.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fontconfig/fontconfig.h>
+
+extern int g_verbose;
+
+// Fallback when fontconfig cannot find anything
+#define FONTSUB_FALLBACK	"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
+
+// A memory-mapped font file
+typedef struct fontsub_file_s
+{
+  char			*filename;	// Font file
+  const unsigned char	*data;		// Mapped contents
+  size_t		size;		// Size of file
+} fontsub_file_t;
+
+// A resolved substitution
+typedef struct fontsub_entry_s
+{
+  char			*key;		// Family, style and language
+  fontsub_file_t	*file;		// Font file or NULL if none found
+  int			index;		// Face index in file
+} fontsub_entry_t;
+
+// Families whose PDF names fontconfig does not know by themselves
+static const struct
+{
+  const char	*name;			// Family part of BaseFont
+  const char	*family;		// Family to look up
+} fontsub_families[] =
+{
+  { "ArialNarrow",	"Arial Narrow" },
+  { "BookAntiqua",	"Book Antiqua" },
+  { "CourierNew",	"Courier New" },
+  { "Symbol",		"Standard Symbols PS" },
+  { "Times",		"Times" },
+  { "TimesNewRoman",	"Times New Roman" },
+  { "ZapfDingbats",	"Dingbats" }
+};
+
+static pthread_mutex_t	fontsub_mutex = PTHREAD_MUTEX_INITIALIZER;
+					// Lock for the caches
+static fontsub_entry_t	*fontsub_entries = NULL;// Resolved substitutions
+static size_t		fontsub_num_entries = 0,
+			fontsub_alloc_entries = 0;
+static fontsub_file_t	**fontsub_files = NULL;	// Mapped files
+static size_t		fontsub_num_files = 0,
+			fontsub_alloc_files = 0;
+
+
+//
+// 'fontsub_parse_name()' - Split a BaseFont name into family and style.
+//
+// A subset tag ("ABCDEF+") and PostScript suffixes ("MT", "PS", "PSMT")
+// are removed.  The style is whatever follows the first '-' or ','.
+//
+
+void
+fontsub_parse_name(const char *base_font,// I - BaseFont name
+		   char       *family,	// O - Family name
+		   size_t     familysize,// I - Size of family buffer
+		   int        *weight,	// O - Weight (FC_WEIGHT_xxx)
+		   int        *slant)	// O - Slant (FC_SLANT_xxx)
+{
+  const char	*style;			// Style part
+  size_t	len;			// Length of family
+  char		lstyle[128];		// Lowercase style
+
+  *weight = FC_WEIGHT_REGULAR;
+  *slant  = FC_SLANT_ROMAN;
+
+  if (familysize == 0)
+    return;
+
+  *family = '\0';
+
+  if (!base_font)
+    return;
+
+  if (strlen(base_font) > 7 && base_font[6] == '+')
+  {
+    int i;
+
+    for (i = 0; i < 6 && isupper(base_font[i] & 255); i ++);
+    if (i == 6)
+      base_font += 7;
+  }
+
+  if ((style = strpbrk(base_font, "-,")) != NULL)
+    len = (size_t)(style - base_font), style ++;
+  else
+    len = strlen(base_font), style = "";
+
+  if (len >= familysize)
+    len = familysize - 1;
+
+  memcpy(family, base_font, len);
+  family[len] = '\0';
+
+  // Drop the PostScript and Monotype suffixes
+  if (len > 4 && !strcmp(family + len - 4, "PSMT"))
+    family[len -= 4] = '\0';
+  else if (len > 2 && (!strcmp(family + len - 2, "MT") || !strcmp(family + len - 2, "PS")))
+    family[len -= 2] = '\0';
+
+  if (len > 2 && !strcmp(family + len - 2, "PS"))
+    family[len -= 2] = '\0';
+
+  // Some producers fold the style into the family, e.g. "ArialBold"
+  if (!*style)
+  {
+    static const char * const suffixes[] = { "BoldItalic", "BoldOblique", "Bold", "Italic", "Oblique" };
+
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i ++)
+    {
+      size_t slen = strlen(suffixes[i]);
+
+      if (len > slen && !strcmp(family + len - slen, suffixes[i]))
+      {
+        style = base_font + len - slen;
+        family[len - slen] = '\0';
+        break;
+      }
+    }
+  }
+
+  for (len = 0; style[len] && len < sizeof(lstyle) - 1; len ++)
+    lstyle[len] = (char)tolower(style[len] & 255);
+  lstyle[len] = '\0';
+
+  if (strstr(lstyle, "black") || strstr(lstyle, "heavy"))
+    *weight = FC_WEIGHT_BLACK;
+  else if (strstr(lstyle, "semibold") || strstr(lstyle, "demi"))
+    *weight = FC_WEIGHT_DEMIBOLD;
+  else if (strstr(lstyle, "bold"))
+    *weight = FC_WEIGHT_BOLD;
+  else if (strstr(lstyle, "light"))
+    *weight = FC_WEIGHT_LIGHT;
+  else if (strstr(lstyle, "medium"))
+    *weight = FC_WEIGHT_MEDIUM;
+
+  if (strstr(lstyle, "italic") || strstr(lstyle, "ital"))
+    *slant = FC_SLANT_ITALIC;
+  else if (strstr(lstyle, "oblique") || strstr(lstyle, "slant"))
+    *slant = FC_SLANT_OBLIQUE;
+}
+
+//
+// 'fontsub_map_file()' - Map a font file, sharing existing mappings.
+//
+
+static fontsub_file_t *			  // O - Mapped file or NULL
+fontsub_map_file(const char *filename)	// I - Font file
+{
+  fontsub_file_t *file;
+  struct stat	info;
+  void		*data;
+  int		fd;
+
+  for (size_t i = 0; i < fontsub_num_files; i ++)
+  {
+    if (!strcmp(fontsub_files[i]->filename, filename))
+      return (fontsub_files[i]);
+  }
+
+  if ((fd = open(filename, O_RDONLY)) < 0)
+    return (NULL);
+
+  if (fstat(fd, &info) || info.st_size <= 0 ||
+      (data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+  {
+    close(fd);
+    return (NULL);
+  }
+
+  close(fd);
+
+  if (fontsub_num_files == fontsub_alloc_files)
+  {
+    size_t alloc = fontsub_alloc_files ? fontsub_alloc_files * 2 : 16;
+    fontsub_file_t **temp = realloc(fontsub_files, alloc * sizeof(fontsub_file_t *));
+
+    if (!temp)
+    {
+      munmap(data, (size_t)info.st_size);
+      return (NULL);
+    }
+
+    fontsub_files = temp;
+    fontsub_alloc_files = alloc;
+  }
+
+  if ((file = calloc(1, sizeof(fontsub_file_t))) == NULL || (file->filename = strdup(filename)) == NULL)
+  {
+    free(file);
+    munmap(data, (size_t)info.st_size);
+    return (NULL);
+  }
+
+  file->data = data;
+  file->size = (size_t)info.st_size;
+
+  fontsub_files[fontsub_num_files++] = file;
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: Mapped substitute font %s (%zu bytes).\n", filename, file->size);
+
+  return (file);
+}
+
+//
+// 'fontsub_from_map()' - Look a BaseFont up in the $PDFRIP_FONTMAP table.
+//
+// Each line of the table holds a BaseFont name (without subset tag) and a
+// font file, separated by whitespace.  '#' starts a comment.
+//
+
+static bool				  // O - true if found
+fontsub_from_map(const char *base_font,	// I - BaseFont name
+		 char       *filename,	// O - Font file
+		 size_t     filesize)	// I - Size of filename buffer
+{
+  const char	*mapname = getenv("PDFRIP_FONTMAP");
+  FILE		*fp;
+  char		line[1024], *name, *file, *ptr;
+  bool		found = false;
+
+  if (!mapname || !base_font || (fp = fopen(mapname, "r")) == NULL)
+    return (false);
+
+  if (strlen(base_font) > 7 && base_font[6] == '+')
+    base_font += 7;
+
+  while (!found && fgets(line, sizeof(line), fp))
+  {
+    if ((ptr = strchr(line, '#')) != NULL)
+      *ptr = '\0';
+
+    if ((name = strtok(line, " \t\r\n")) == NULL || (file = strtok(NULL, "\r\n")) == NULL)
+      continue;
+
+    while (isspace(*file & 255))
+      file ++;
+
+    if (!strcmp(name, base_font))
+    {
+      snprintf(filename, filesize, "%s", file);
+      found = true;
+    }
+  }
+
+  fclose(fp);
+
+  return (found);
+}
+
+//
+// 'fontsub_from_fontconfig()' - Find the best local match with fontconfig.
+//
+
+static bool				  // O - true if found
+fontsub_from_fontconfig(
+    const char *family,			// I - Family from the BaseFont name
+    int        weight,			// I - Weight
+    int        slant,			// I - Slant
+    int        flags,			// I - FontDescriptor flags
+    const char *lang,			// I - Language or NULL
+    char       *filename,		// O - Font file
+    size_t     filesize,		// I - Size of filename buffer
+    int        *index)			// O - Face index
+{
+  FcPattern	*pattern, *match;
+  FcResult	result;
+  FcChar8	*file;
+  char		spaced[256];		// Family with spaces between words
+  size_t	i, j;
+
+  if (!FcInit() || (pattern = FcPatternCreate()) == NULL)
+    return (false);
+
+  for (i = 0; i < sizeof(fontsub_families) / sizeof(fontsub_families[0]); i ++)
+  {
+    if (!strcmp(family, fontsub_families[i].name))
+    {
+      FcPatternAddString(pattern, FC_FAMILY, (const FcChar8 *)fontsub_families[i].family);
+      break;
+    }
+  }
+
+  if (*family)
+  {
+    FcPatternAddString(pattern, FC_FAMILY, (const FcChar8 *)family);
+
+    // "TimesNewRoman" is usually installed as "Times New Roman"
+    for (i = j = 0; family[i] && j < sizeof(spaced) - 2; i ++)
+    {
+      if (i > 0 && isupper(family[i] & 255) && islower(family[i - 1] & 255))
+        spaced[j++] = ' ';
+      spaced[j++] = family[i];
+    }
+    spaced[j] = '\0';
+
+    if (strcmp(spaced, family))
+      FcPatternAddString(pattern, FC_FAMILY, (const FcChar8 *)spaced);
+  }
+
+  // Generic family from the FontDescriptor flags as the last resort
+  FcPatternAddString(pattern, FC_FAMILY, (const FcChar8 *)((flags & 1) ? "monospace" : (flags & 2) ? "serif" : "sans-serif"));
+
+  if ((flags & 0x40000) && weight < FC_WEIGHT_BOLD)
+    weight = FC_WEIGHT_BOLD;		// ForceBold
+  if ((flags & 0x40) && slant == FC_SLANT_ROMAN)
+    slant = FC_SLANT_ITALIC;		// Italic
+
+  FcPatternAddInteger(pattern, FC_WEIGHT, weight);
+  FcPatternAddInteger(pattern, FC_SLANT, slant);
+  FcPatternAddBool(pattern, FC_SCALABLE, FcTrue);
+
+  if (lang)
+    FcPatternAddString(pattern, FC_LANG, (const FcChar8 *)lang);
+
+  FcConfigSubstitute(NULL, pattern, FcMatchPattern);
+  FcDefaultSubstitute(pattern);
+
+  match = FcFontMatch(NULL, pattern, &result);
+  FcPatternDestroy(pattern);
+
+  if (!match)
+    return (false);
+
+  if (FcPatternGetString(match, FC_FILE, 0, &file) != FcResultMatch)
+  {
+    FcPatternDestroy(match);
+    return (false);
+  }
+
+  snprintf(filename, filesize, "%s", (const char *)file);
+
+  if (FcPatternGetInteger(match, FC_INDEX, 0, index) != FcResultMatch)
+    *index = 0;
+
+  FcPatternDestroy(match);
+
+  return (true);
+}
+
+//
+// 'fontsub_get()' - Get the substitute font program for a BaseFont name.
+//
+// The returned data is mapped for the life of the process and must not be
+// freed by the caller.  This function can be called from any thread.
+//
+
+bool					  // O - true if a substitute was found
+fontsub_get(const char          *base_font,// I - BaseFont name or NULL
+	    int                 flags,	// I - FontDescriptor flags
+	    const char          *lang,	// I - Language for CID fonts or NULL
+	    const unsigned char **data,	// O - Font program
+	    size_t              *size,	// O - Size of font program
+	    int                 *index)	// O - Face index in font program
+{
+  char		family[256],		// Family name
+		key[1024],		// Cache key
+		filename[1024];		// Font file
+  int		weight, slant;		// Style
+  const char	*map_name = "";		// BaseFont name for the font map
+  fontsub_entry_t *entry = NULL;
+
+  fontsub_parse_name(base_font, family, sizeof(family), &weight, &slant);
+
+  // The font map matches whole BaseFont names, so names with the same
+  // family and style may still map to different files
+  if (base_font && getenv("PDFRIP_FONTMAP"))
+    map_name = strlen(base_font) > 7 && base_font[6] == '+' ? base_font + 7 : base_font;
+
+  snprintf(key, sizeof(key), "%s|%d|%d|%d|%s|%s", family, weight, slant, flags & 0x40043, lang ? lang : "", map_name);
+
+  pthread_mutex_lock(&fontsub_mutex);
+
+  for (size_t i = 0; i < fontsub_num_entries; i ++)
+  {
+    if (!strcmp(fontsub_entries[i].key, key))
+    {
+      entry = fontsub_entries + i;
+      break;
+    }
+  }
+
+  if (!entry)
+  {
+    fontsub_file_t *file = NULL;
+    int face_index = 0;
+
+    if (fontsub_from_map(base_font, filename, sizeof(filename)) ||
+        fontsub_from_fontconfig(family, weight, slant, flags, lang, filename, sizeof(filename), &face_index))
+      file = fontsub_map_file(filename);
+
+    if (!file)
+    {
+      face_index = 0;
+      file = fontsub_map_file(FONTSUB_FALLBACK);
+    }
+
+    if (fontsub_num_entries == fontsub_alloc_entries)
+    {
+      size_t alloc = fontsub_alloc_entries ? fontsub_alloc_entries * 2 : 32;
+      fontsub_entry_t *temp = realloc(fontsub_entries, alloc * sizeof(fontsub_entry_t));
+
+      if (!temp)
+      {
+        pthread_mutex_unlock(&fontsub_mutex);
+        return (false);
+      }
+
+      fontsub_entries = temp;
+      fontsub_alloc_entries = alloc;
+    }
+
+    entry = fontsub_entries + fontsub_num_entries;
+    if ((entry->key = strdup(key)) == NULL)
+    {
+      pthread_mutex_unlock(&fontsub_mutex);
+      return (false);
+    }
+
+    entry->file  = file;
+    entry->index = face_index;
+    fontsub_num_entries ++;
+
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Substituting %s with %s.\n", base_font ? base_font : "(unnamed)", file ? file->filename : "nothing");
+  }
+
+  if (!entry->file)
+  {
+    pthread_mutex_unlock(&fontsub_mutex);
+    return (false);
+  }
+
+  *data  = entry->file->data;
+  *size  = entry->file->size;
+  *index = entry->index;
+
+  pthread_mutex_unlock(&fontsub_mutex);
+
+  return (true);
+}
+
+//
+// 'fontsub_clear()' - Forget all substitutions and unmap their files.
+//
+// Only call this once no FreeType face uses a substitute anymore.
+//
+
+void
+fontsub_clear(void)
+{
+  pthread_mutex_lock(&fontsub_mutex);
+
+  for (size_t i = 0; i < fontsub_num_entries; i ++)
+    free(fontsub_entries[i].key);
+
+  for (size_t i = 0; i < fontsub_num_files; i ++)
+  {
+    munmap((void *)fontsub_files[i]->data, fontsub_files[i]->size);
+    free(fontsub_files[i]->filename);
+    free(fontsub_files[i]);
+  }
+
+  free(fontsub_entries);
+  free(fontsub_files);
+
+  fontsub_entries = NULL;
+  fontsub_files = NULL;
+  fontsub_num_entries = fontsub_alloc_entries = 0;
+  fontsub_num_files = fontsub_alloc_files = 0;
+
+  pthread_mutex_unlock(&fontsub_mutex);
+}
@@ -0,0 +1,2101 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+//
+// Image XObject decoding.
+//
+// Images are decoded a row at a time straight into a Cairo image surface:
+// samples are unpacked to one byte per component, mapped through the
+// Decode array with a lookup table and converted to RGB, with /Mask and
+// /SMask giving the alpha channel.  Decoded surfaces are cached by the
+// document and keyed by object number, so an image shown on every page is
+// decoded once.  The least recently used images are dropped when the
+// cache goes over PDFRIP_IMAGE_CACHE_BUDGET.
+//
+// Images of more than PDFRIP_IMAGE_MAX_PIXELS pixels are never decoded
+// whole.  They are drawn a strip of rows at a time from an image decoder
+// instead, and only the rows up to the last visible one are read.
+//
+// JPEG images are decoded with libjpeg's scaled IDCT at 1/2, 1/4 or 1/8 of
+// their size when that still covers the pixels they fill on the page, so
+// a 600 DPI scan shown as a thumbnail never exists at full size.
+// JPXDecode images are likewise decoded by pdf-jpx.c with up to five
+// wavelet levels discarded, and only over the visible area when drawn in
+// strips.
+//
+// CCITTFaxDecode images are read raw and decoded by pdf-ccitt.c straight
+// to packed 1-bit rows, which the stencil mask and bilevel image paths
+// turn into A1 or A8 coverage without an 8-bit copy of the image.
+//
+// Images shown at half their size or less are reduced again by whole
+// factors with a box filter, so Cairo never scales them down by 2 or more
+// itself.  Each image keeps its last P2C_IMAGE_SCALED reductions, charged
+// to the cache along with the image.
+//
+
+#include "pdfops-private.h"
+#include "../cairo/cairo-private.h"
+#include <math.h>
+#include <setjmp.h>
+#include <string.h>
+#include <jpeglib.h>
+
+#define IMAGE_MAX_COLORSPACE_DEPTH 4	// Maximum nesting of named color spaces
+
+// Color space of image samples
+typedef struct image_space_s
+{
+  p2c_colorspace_t	base;		// Gray, RGB or CMYK
+  int			num_components;	// Components per sample
+  bool			indexed,	// Indexed color space?
+			subtractive;	// Separation tint, 1 is full colorant?
+  int			hival;		// Highest index of an Indexed space
+  const void		*key;		// Indexed color space array
+  uint32_t		palette[256];	// Opaque ARGB32 pixel of each index
+} image_space_t;
+
+// Stream source for libjpeg
+typedef struct image_jpeg_src_s
+{
+  struct jpeg_source_mgr pub;		// libjpeg source manager
+  pdfio_stream_t	*st;		// Raw DCTDecode stream
+  JOCTET		buffer[8192];	// Read buffer
+} image_jpeg_src_t;
+
+// JPEG decompressor
+typedef struct image_jpeg_s
+{
+  struct jpeg_decompress_struct cinfo;	// libjpeg decompressor, must be first
+  struct jpeg_error_mgr	jerr;		// libjpeg error handler
+  jmp_buf		jmp;		// Error return
+  image_jpeg_src_t	src;		// Stream source
+  bool			invert;		// Adobe inverted CMYK?
+} image_jpeg_t;
+
+// Row reader for image data
+typedef struct image_reader_s
+{
+  pdfio_stream_t	*st;		// Image data stream
+  image_jpeg_t		*jpeg;		// JPEG decompressor or NULL
+  pdfrip_ccitt_t	*ccitt;		// CCITT fax decoder or NULL
+  pdfrip_jpx_t		*jpx;		// JPEG 2000 decoder or NULL
+  size_t		row_bytes;	// Bytes per row of samples
+  int			width,		// Samples per row
+			height,		// Number of rows
+			num_components,	// Components per sample
+			bpc,		// Bits per component
+			scale;		// Reduction of the data, 1 for full size
+  bool			eof;		// Has the data run out?
+} image_reader_t;
+
+// Image decoder, converting rows of samples to Cairo pixels
+typedef struct image_decoder_s
+{
+  image_space_t		*space;		// Color space
+  image_reader_t	r,		// Image data
+			mask;		// /Mask or /SMask data
+  pdfrip_convert_cb_t	convert;	// Row conversion kernel or NULL
+  uint32_t		pixels[256];	// Pixel of each Indexed sample value
+  uint8_t		lut[4][256],	// Decode lookup
+			gray[2],	// Gray levels for a 1-bit kernel
+			mask_lut[256],	// Mask decode lookup
+			*row,		// Packed row
+			*samples,	// Unpacked row
+			*mask_row,	// Packed mask row
+			*mask_samples;	// Mask alpha of row mask_y
+  int			width,		// Decoded size
+			height,
+			y,		// Next row
+			mask_width,	// Size of mask
+			mask_height,
+			mask_y,		// Last mask row read
+			*mask_x,	// Mask column of each image column
+			color_key[8];	// Color key mask ranges
+  bool			has_mask,	// Is there a mask image?
+			has_color_key;	// Is there a color key mask?
+} image_decoder_t;
+
+
+//
+// 'image_jpeg_fill()' - Fill the libjpeg input buffer from the stream.
+//
+
+static boolean				  // O - TRUE
+image_jpeg_fill(j_decompress_ptr cinfo)	// I - Decompressor
+{
+  image_jpeg_src_t	*src = (image_jpeg_src_t *)cinfo->src;
+  ssize_t		bytes;		// Bytes read
+
+  if ((bytes = pdfioStreamRead(src->st, src->buffer, sizeof(src->buffer))) <= 0)
+  {
+    // Truncated data, end the image
+    src->buffer[0] = 0xFF;
+    src->buffer[1] = JPEG_EOI;
+    bytes          = 2;
+  }
+
+  src->pub.next_input_byte = src->buffer;
+  src->pub.bytes_in_buffer = (size_t)bytes;
+
+  return (TRUE);
+}
+
+//
+// 'image_jpeg_skip()' - Skip input data.
+//
+
+static void
+image_jpeg_skip(j_decompress_ptr cinfo,	// I - Decompressor
+		long             num_bytes)	// I - Number of bytes to skip
+{
+  struct jpeg_source_mgr *src = cinfo->src;
+
+  if (num_bytes <= 0)
+    return;
+
+  while ((size_t)num_bytes > src->bytes_in_buffer)
+  {
+    num_bytes -= (long)src->bytes_in_buffer;
+    image_jpeg_fill(cinfo);
+  }
+
+  src->next_input_byte += num_bytes;
+  src->bytes_in_buffer -= (size_t)num_bytes;
+}
+
+//
+// 'image_jpeg_noop()' - Initialize or terminate the source.
+//
+
+static void
+image_jpeg_noop(j_decompress_ptr cinfo)	// I - Decompressor
+{
+  (void)cinfo;
+}
+
+//
+// 'image_jpeg_error()' - Return from a fatal libjpeg error.
+//
+
+static void
+image_jpeg_error(j_common_ptr cinfo)	// I - Decompressor
+{
+  image_jpeg_t *jpeg = (image_jpeg_t *)cinfo;
+
+  if (g_verbose)
+  {
+    char message[JMSG_LENGTH_MAX];	// Error message
+
+    (*cinfo->err->format_message)(cinfo, message);
+    fprintf(stderr, "DEBUG: JPEG image error: %s\n", message);
+  }
+
+  longjmp(jpeg->jmp, 1);
+}
+
+//
+// 'image_jpeg_message()' - Show a libjpeg warning in verbose mode.
+//
+
+static void
+image_jpeg_message(j_common_ptr cinfo)	// I - Decompressor
+{
+  if (g_verbose)
+  {
+    char message[JMSG_LENGTH_MAX];	// Warning message
+
+    (*cinfo->err->format_message)(cinfo, message);
+    fprintf(stderr, "DEBUG: JPEG image warning: %s\n", message);
+  }
+}
+
+//
+// 'image_filter()' - Get the filter of an image, or NULL for none.
+//
+// Only a single filter is returned, since pdfio cannot stop part way
+// through a filter chain to hand the rest to an image decoder.
+//
+
+static const char *			  // O - Filter name or NULL
+image_filter(pdfio_dict_t *dict)	// I - Image dictionary
+{
+  pdfio_array_t	*filters;		// Filter array
+
+  if (pdfioDictGetType(dict, "Filter") == PDFIO_VALTYPE_NAME)
+    return (pdfioDictGetName(dict, "Filter"));
+
+  if ((filters = pdfioDictGetArray(dict, "Filter")) != NULL && pdfioArrayGetSize(filters) == 1)
+    return (pdfioArrayGetName(filters, 0));
+
+  return (NULL);
+}
+
+//
+// 'image_scale()' - Choose the reduced scale of a JPEG or JPEG 2000 image.
+//
+// The smallest of 1/2, 1/4 and 1/8 (and 1/16 and 1/32 for JPEG 2000)
+// that still has as many pixels as the image covers on the device is
+// used, so no visible detail is lost.  Other images are always decoded
+// at full size.
+//
+
+static int				  // O - Scale denominator (1, 2, 4 ...)
+image_scale(pdfio_dict_t *dict,		// I - Image dictionary
+	    double       target_width,	// I - Device width in pixels, 0 for full size
+	    double       target_height)	// I - Device height in pixels, 0 for full size
+{
+  const char	*filter = image_filter(dict);
+					// Image filter
+  int		width = (int)pdfioDictGetNumber(dict, "Width"),
+		height = (int)pdfioDictGetNumber(dict, "Height");
+					// Image size
+  int		scale;			// Scale denominator
+
+  if (target_width <= 0.0 || target_height <= 0.0 || !filter)
+    return (1);
+  else if (!strcmp(filter, "DCTDecode"))
+    scale = 8;
+  else if (!strcmp(filter, "JPXDecode"))
+    scale = PDFRIP_JPX_MAX_SCALE;
+  else
+    return (1);
+
+  for (; scale > 1; scale /= 2)
+  {
+    if ((width + scale - 1) / scale >= target_width && (height + scale - 1) / scale >= target_height)
+      break;
+  }
+
+  return (scale);
+}
+
+//
+// 'image_reader_close()' - Close an image reader.
+//
+
+static void
+image_reader_close(image_reader_t *r)	// I - Reader
+{
+  if (r->jpeg)
+  {
+    if (!setjmp(r->jpeg->jmp))
+      jpeg_destroy_decompress(&r->jpeg->cinfo);
+
+    free(r->jpeg);
+    r->jpeg = NULL;
+  }
+
+  if (r->jpx)
+  {
+    jpx_close(r->jpx);
+    r->jpx = NULL;
+  }
+
+  if (r->ccitt)
+  {
+    ccitt_close(r->ccitt);
+    r->ccitt = NULL;
+  }
+
+  if (r->st)
+  {
+    pdfioStreamClose(r->st);
+    r->st = NULL;
+  }
+}
+
+//
+// 'image_ccitt_read()' - Read CCITTFaxDecode data for the fax decoder.
+//
+
+static ssize_t				  // O - Bytes read or -1 on error
+image_ccitt_read(void    *data,		// I - Raw stream
+		 uint8_t *buffer,	// I - Buffer
+		 size_t  bytes)		// I - Size of buffer
+{
+  return (pdfioStreamRead((pdfio_stream_t *)data, buffer, bytes));
+}
+
+//
+// 'image_reader_open_ccitt()' - Start decoding a CCITTFaxDecode image.
+//
+
+static bool				  // O - true on success
+image_reader_open_ccitt(
+    image_reader_t *r,			// I - Reader
+    pdfio_obj_t    *obj,		// I - Image object
+    int            width,		// I - Image width
+    int            num_components)	// I - Components per sample
+{
+  pdfrip_ccitt_params_t	params;		// Decoding parameters
+
+  ccitt_get_params(pdfioObjGetDict(obj), &params);
+
+  if (params.columns != width || num_components != 1)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: CCITT image has %d columns and %d components, expected %d and 1.\n", params.columns, num_components, width);
+    return (false);
+  }
+
+  if ((r->ccitt = ccitt_open(&params, image_ccitt_read, r->st)) == NULL)
+    return (false);
+
+  r->num_components = 1;
+  r->bpc            = 1;
+  r->row_bytes      = ((size_t)width + 7) / 8;
+
+  return (true);
+}
+
+//
+// 'image_reader_open_jpeg()' - Start decompressing a DCTDecode image.
+//
+
+static bool				  // O - true on success
+image_reader_open_jpeg(
+    image_reader_t *r,			// I - Reader
+    int            width,		// I - Image width
+    int            scale)		// I - IDCT scale denominator (1, 2, 4 or 8)
+{
+  image_jpeg_t	*jpeg;			// Decompressor
+
+  if ((r->jpeg = jpeg = calloc(1, sizeof(image_jpeg_t))) == NULL)
+    return (false);
+
+  jpeg->cinfo.err           = jpeg_std_error(&jpeg->jerr);
+  jpeg->jerr.error_exit     = image_jpeg_error;
+  jpeg->jerr.output_message = image_jpeg_message;
+
+  if (setjmp(jpeg->jmp))
+    return (false);
+
+  jpeg_create_decompress(&jpeg->cinfo);
+
+  jpeg->src.st                    = r->st;
+  jpeg->src.pub.init_source       = image_jpeg_noop;
+  jpeg->src.pub.fill_input_buffer = image_jpeg_fill;
+  jpeg->src.pub.skip_input_data   = image_jpeg_skip;
+  jpeg->src.pub.resync_to_restart = jpeg_resync_to_restart;
+  jpeg->src.pub.term_source       = image_jpeg_noop;
+  jpeg->cinfo.src                 = &jpeg->src.pub;
+
+  jpeg_read_header(&jpeg->cinfo, TRUE);
+
+  switch (jpeg->cinfo.num_components)
+  {
+    case 1 :
+        jpeg->cinfo.out_color_space = JCS_GRAYSCALE;
+        break;
+    case 3 :
+        jpeg->cinfo.out_color_space = JCS_RGB;
+        break;
+    case 4 :
+        // libjpeg converts YCCK to CMYK, but Adobe writes CMYK inverted
+        jpeg->cinfo.out_color_space = JCS_CMYK;
+        jpeg->invert                = jpeg->cinfo.saw_Adobe_marker;
+        break;
+    default :
+        return (false);
+  }
+
+  jpeg->cinfo.scale_num   = 1;
+  jpeg->cinfo.scale_denom = (unsigned)scale;
+
+  jpeg_start_decompress(&jpeg->cinfo);
+
+  if ((int)jpeg->cinfo.output_width < (width + scale - 1) / scale)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: JPEG image is %u pixels wide, expected %d.\n", jpeg->cinfo.output_width, (width + scale - 1) / scale);
+    return (false);
+  }
+
+  r->width          = (int)jpeg->cinfo.output_width;
+  r->height         = (int)jpeg->cinfo.output_height;
+  r->num_components = jpeg->cinfo.output_components;
+  r->bpc            = 8;
+  r->scale          = scale;
+  r->row_bytes      = (size_t)jpeg->cinfo.output_width * (size_t)r->num_components;
+
+  return (true);
+}
+
+//
+// 'image_reader_open_jpx()' - Decode a JPXDecode image.
+//
+
+static bool				  // O - true on success
+image_reader_open_jpx(
+    image_reader_t     *r,		// I - Reader
+    pdfio_obj_t        *obj,		// I - Image object
+    int                num_components,	// I - Components of the color space or 0
+    int                scale,		// I - Largest reduction wanted
+    const pdfio_rect_t *area)		// I - Visible area or NULL
+{
+  pdfrip_jpx_info_t	info;		// Decoded size
+
+  if ((r->jpx = jpx_open(obj, num_components, scale, area, &info)) == NULL)
+    return (false);
+
+  r->width          = info.width;
+  r->height         = info.height;
+  r->num_components = info.num_components;
+  r->bpc            = 8;
+  r->scale          = info.scale;
+  r->row_bytes      = (size_t)info.width * (size_t)info.num_components;
+
+  return (true);
+}
+
+//
+// 'image_reader_open()' - Open the data of an image.
+//
+// DCTDecode and JPXDecode images report the size, components and depth
+// of the JPEG data, which take precedence over the image dictionary, and
+// are reduced by the given scale.  Only the given area of a JPXDecode
+// image is decoded.  Other images are always read whole at full size, and
+// CCITTFaxDecode images always have 1 bit per component.
+//
+
+static bool				  // O - true on success
+image_reader_open(
+    image_reader_t     *r,		// O - Reader
+    pdfio_obj_t        *obj,		// I - Image object
+    int                width,		// I - Width in pixels
+    int                height,		// I - Height in pixels
+    int                num_components,	// I - Components per sample, 0 if unknown
+    int                bpc,		// I - Bits per component
+    int                scale,		// I - JPEG scale denominator
+    const pdfio_rect_t *area)		// I - Visible area of a JPEG 2000 image or NULL
+{
+  const char	*filter = image_filter(pdfioObjGetDict(obj));
+					// Image filter
+
+  memset(r, 0, sizeof(image_reader_t));
+  r->scale = 1;
+
+  if (filter && !strcmp(filter, "JPXDecode"))
+    return (image_reader_open_jpx(r, obj, num_components, scale, area));
+
+  if (filter && !strcmp(filter, "DCTDecode"))
+  {
+    if ((r->st = pdfioObjOpenStream(obj, false)) == NULL)
+      return (false);
+
+    if (!image_reader_open_jpeg(r, width, scale))
+    {
+      image_reader_close(r);
+      return (false);
+    }
+
+    return (true);
+  }
+
+  if (filter && !strcmp(filter, "CCITTFaxDecode"))
+  {
+    if ((r->st = pdfioObjOpenStream(obj, false)) == NULL)
+      return (false);
+
+    if (!image_reader_open_ccitt(r, obj, width, num_components))
+    {
+      image_reader_close(r);
+      return (false);
+    }
+
+    r->width  = width;
+    r->height = height;
+
+    return (true);
+  }
+
+  if ((r->st = pdfioObjOpenStream(obj, true)) == NULL)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Unable to open image data%s%s.\n", filter ? " with filter /" : "", filter ? filter : "");
+    return (false);
+  }
+
+  r->width          = width;
+  r->height         = height;
+  r->num_components = num_components;
+  r->bpc            = bpc;
+  r->row_bytes      = ((size_t)width * (size_t)num_components * (size_t)bpc + 7) / 8;
+
+  return (true);
+}
+
+//
+// 'image_reader_row()' - Read the next row of samples.
+//
+// Rows past the end of truncated data and outside the decoded area of a
+// JPEG 2000 image are zero, or white for CCITT data.
+//
+
+static void
+image_reader_row(image_reader_t *r,	// I - Reader
+		 uint8_t        *row)	// O - Row of samples
+{
+  size_t	total = 0;		// Bytes read
+
+  if (r->ccitt)
+  {
+    if (!ccitt_read_row(r->ccitt, row))
+      r->eof = true;
+    return;
+  }
+
+  if (r->jpx)
+  {
+    if (!jpx_read_row(r->jpx, row))
+      r->eof = true;
+    return;
+  }
+
+  if (r->eof)
+  {
+    memset(row, 0, r->row_bytes);
+    return;
+  }
+
+  if (r->jpeg)
+  {
+    JSAMPROW	rows[1] = { row };	// Scanline pointer
+
+    if (setjmp(r->jpeg->jmp))
+    {
+      r->eof = true;
+      memset(row, 0, r->row_bytes);
+      return;
+    }
+
+    if (r->jpeg->cinfo.output_scanline >= r->jpeg->cinfo.output_height ||
+        jpeg_read_scanlines(&r->jpeg->cinfo, rows, 1) != 1)
+    {
+      r->eof = true;
+      memset(row, 0, r->row_bytes);
+      return;
+    }
+
+    if (r->jpeg->invert)
+    {
+      for (size_t i = 0; i < r->row_bytes; i ++)
+        row[i] = (uint8_t)(255 - row[i]);
+    }
+
+    return;
+  }
+
+  while (total < r->row_bytes)
+  {
+    ssize_t bytes = pdfioStreamRead(r->st, row + total, r->row_bytes - total);
+
+    if (bytes <= 0)
+    {
+      r->eof = true;
+      memset(row + total, 0, r->row_bytes - total);
+      break;
+    }
+
+    total += (size_t)bytes;
+  }
+}
+
+//
+// 'image_unpack_row()' - Unpack samples to one byte per component.
+//
+// Samples of 1, 2 and 4 bits keep their value; 16-bit samples keep their
+// high byte.
+//
+
+static void
+image_unpack_row(const uint8_t *src,	// I - Packed samples
+		 uint8_t       *dst,	// O - One byte per sample
+		 size_t        count,	// I - Number of samples
+		 int           bpc)	// I - Bits per component
+{
+  size_t i;
+
+  switch (bpc)
+  {
+    case 1 :
+        for (i = 0; i < count; i ++)
+          dst[i] = (src[i >> 3] >> (7 - (i & 7))) & 1;
+        break;
+    case 2 :
+        for (i = 0; i < count; i ++)
+          dst[i] = (src[i >> 2] >> (6 - 2 * (i & 3))) & 3;
+        break;
+    case 4 :
+        for (i = 0; i < count; i ++)
+          dst[i] = (src[i >> 1] >> ((i & 1) ? 0 : 4)) & 15;
+        break;
+    case 8 :
+        memcpy(dst, src, count);
+        break;
+    case 16 :
+        for (i = 0; i < count; i ++)
+          dst[i] = src[2 * i];
+        break;
+  }
+}
+
+//
+// 'image_build_lut()' - Map unpacked samples through the Decode array.
+//
+// Color components map to 0-255 and Indexed samples to a palette index.
+//
+
+static void
+image_build_lut(const image_space_t *space,// I - Color space
+		pdfio_array_t       *decode,// I - Decode array or NULL
+		int                 bpc,	// I - Bits per component
+		uint8_t             lut[][256])// O - Lookup table per component
+{
+  int	max_value = bpc >= 8 ? 255 : (1 << bpc) - 1;
+					// Largest unpacked sample
+
+  if (decode && pdfioArrayGetSize(decode) < (size_t)(2 * space->num_components))
+    decode = NULL;
+
+  for (int c = 0; c < space->num_components; c ++)
+  {
+    double dmin = 0.0, dmax = space->indexed ? (bpc == 16 ? 65535.0 : max_value) : 1.0;
+
+    if (decode)
+    {
+      dmin = pdfioArrayGetNumber(decode, (size_t)(2 * c));
+      dmax = pdfioArrayGetNumber(decode, (size_t)(2 * c + 1));
+    }
+
+    for (int v = 0; v <= max_value; v ++)
+    {
+      double	d = dmin + v * (dmax - dmin) / max_value;
+      long	value;
+
+      if (space->indexed)
+      {
+        value = lround(d);
+        if (value > space->hival)
+          value = space->hival;
+      }
+      else
+      {
+        value = lround(d * 255.0);
+        if (value > 255)
+          value = 255;
+      }
+
+      if (value < 0)
+        value = 0;
+
+      lut[c][v] = (uint8_t)(space->subtractive ? 255 - value : value);
+    }
+
+    memset(lut[c] + max_value + 1, lut[c][max_value], (size_t)(255 - max_value));
+  }
+}
+
+//
+// 'image_to_rgb()' - Convert color components to RGB.
+//
+
+static void
+image_to_rgb(p2c_colorspace_t base,	// I - Gray, RGB or CMYK
+	     const uint8_t    *c,	// I - Components
+	     uint8_t          rgb[3])	// O - RGB
+{
+  switch (base)
+  {
+    case CS_DEVICE_GRAY :
+        rgb[0] = rgb[1] = rgb[2] = c[0];
+        break;
+    case CS_DEVICE_RGB :
+        rgb[0] = c[0];
+        rgb[1] = c[1];
+        rgb[2] = c[2];
+        break;
+    case CS_DEVICE_CMYK :
+        rgb[0] = (uint8_t)((255 - c[0]) * (255 - c[3]) / 255);
+        rgb[1] = (uint8_t)((255 - c[1]) * (255 - c[3]) / 255);
+        rgb[2] = (uint8_t)((255 - c[2]) * (255 - c[3]) / 255);
+        break;
+    default :
+        rgb[0] = rgb[1] = rgb[2] = 0;
+        break;
+  }
+}
+
+//
+// 'image_get_array()' - Get an array value of a dictionary, direct or indirect.
+//
+
+static pdfio_array_t *			  // O - Array or NULL
+image_get_array(pdfio_dict_t *dict,	// I - Dictionary
+		const char   *key)	// I - Key
+{
+  if (pdfioDictGetType(dict, key) == PDFIO_VALTYPE_INDIRECT)
+    return (pdfioObjGetArray(pdfioDictGetObj(dict, key)));
+
+  return (pdfioDictGetArray(dict, key));
+}
+
+static bool load_colorspace(pdfio_dict_t *resources, pdfio_dict_t *dict, const char *key, image_space_t *space, int depth);
+
+//
+// 'load_colorspace_name()' - Load a device or named color space.
+//
+
+static bool				  // O - true on success
+load_colorspace_name(
+    pdfio_dict_t  *resources,		// I - Resources for named spaces
+    const char    *name,		// I - Color space name
+    image_space_t *space,		// O - Color space
+    int           depth)		// I - Nesting depth
+{
+  pdfio_dict_t	*colorspaces;		// ColorSpace resources
+
+  if (!strcmp(name, "DeviceGray") || !strcmp(name, "G") || !strcmp(name, "CalGray"))
+  {
+    space->base           = CS_DEVICE_GRAY;
+    space->num_components = 1;
+    return (true);
+  }
+  else if (!strcmp(name, "DeviceRGB") || !strcmp(name, "RGB") || !strcmp(name, "CalRGB"))
+  {
+    space->base           = CS_DEVICE_RGB;
+    space->num_components = 3;
+    return (true);
+  }
+  else if (!strcmp(name, "DeviceCMYK") || !strcmp(name, "CMYK"))
+  {
+    space->base           = CS_DEVICE_CMYK;
+    space->num_components = 4;
+    return (true);
+  }
+
+  if (!resources || depth >= IMAGE_MAX_COLORSPACE_DEPTH)
+    return (false);
+
+  if (pdfioDictGetType(resources, "ColorSpace") == PDFIO_VALTYPE_INDIRECT)
+    colorspaces = pdfioObjGetDict(pdfioDictGetObj(resources, "ColorSpace"));
+  else
+    colorspaces = pdfioDictGetDict(resources, "ColorSpace");
+
+  return (colorspaces && load_colorspace(NULL, colorspaces, name, space, depth + 1));
+}
+
+//
+// 'load_colorspace_array()' - Load a color space array.
+//
+
+static bool				  // O - true on success
+load_colorspace_array(
+    pdfio_dict_t  *resources,		// I - Resources for named spaces
+    pdfio_array_t *array,		// I - Color space array
+    image_space_t *space,		// O - Color space
+    int           depth)		// I - Nesting depth
+{
+  const char	*family = pdfioArrayGetName(array, 0);
+					// Color space family
+  pdfio_obj_t	*obj;			// Stream object
+
+  if (!family)
+    return (false);
+
+  if (!strcmp(family, "ICCBased"))
+  {
+    // Use the number of components of the profile
+    pdfio_dict_t *profile = (obj = pdfioArrayGetObj(array, 1)) != NULL ? pdfioObjGetDict(obj) : NULL;
+
+    if (!profile)
+      return (false);
+
+    switch ((int)pdfioDictGetNumber(profile, "N"))
+    {
+      case 1 :
+          return (load_colorspace_name(NULL, "DeviceGray", space, depth));
+      case 3 :
+          return (load_colorspace_name(NULL, "DeviceRGB", space, depth));
+      case 4 :
+          return (load_colorspace_name(NULL, "DeviceCMYK", space, depth));
+      default :
+          return (load_colorspace(resources, profile, "Alternate", space, depth + 1));
+    }
+  }
+  else if (!strcmp(family, "CalGray") || !strcmp(family, "CalRGB"))
+  {
+    return (load_colorspace_name(NULL, family, space, depth));
+  }
+  else if (!strcmp(family, "Separation"))
+  {
+    // Show the tint as gray rather than evaluating the tint transform
+    space->base           = CS_DEVICE_GRAY;
+    space->num_components = 1;
+    space->subtractive    = true;
+    return (true);
+  }
+  else if (!strcmp(family, "Indexed") || !strcmp(family, "I"))
+  {
+    image_space_t	base;		// Base color space
+    const unsigned char	*lookup;	// Lookup table
+    unsigned char	*data = NULL;	// Lookup stream data
+    size_t		length = 0,	// Length of lookup table
+			alloc = 0;	// Allocated size of data
+    int			hival = (int)pdfioArrayGetNumber(array, 2);
+					// Highest index
+
+    memset(&base, 0, sizeof(base));
+
+    if (depth >= IMAGE_MAX_COLORSPACE_DEPTH || hival < 0 || hival > 255)
+      return (false);
+
+    if (pdfioArrayGetType(array, 1) == PDFIO_VALTYPE_NAME)
+    {
+      if (!load_colorspace_name(resources, pdfioArrayGetName(array, 1), &base, depth + 1))
+        return (false);
+    }
+    else
+    {
+      pdfio_array_t *base_array = pdfioArrayGetType(array, 1) == PDFIO_VALTYPE_INDIRECT ? pdfioObjGetArray(pdfioArrayGetObj(array, 1)) : pdfioArrayGetArray(array, 1);
+
+      if (!base_array || !load_colorspace_array(resources, base_array, &base, depth + 1))
+        return (false);
+    }
+
+    if (base.indexed)
+      return (false);
+
+    if ((obj = pdfioArrayGetObj(array, 3)) != NULL)
+    {
+      pdfio_stream_t	*st;		// Lookup stream
+      ssize_t		bytes;		// Bytes read
+
+      if ((st = pdfioObjOpenStream(obj, true)) == NULL)
+        return (false);
+
+      alloc = (size_t)(hival + 1) * (size_t)base.num_components;
+      if ((data = calloc(1, alloc)) == NULL)
+      {
+        pdfioStreamClose(st);
+        return (false);
+      }
+
+      while (length < alloc && (bytes = pdfioStreamRead(st, data + length, alloc - length)) > 0)
+        length += (size_t)bytes;
+
+      pdfioStreamClose(st);
+      lookup = data;
+    }
+    else if ((lookup = pdfioArrayGetBinary(array, 3, &length)) == NULL)
+    {
+      if ((lookup = (const unsigned char *)pdfioArrayGetString(array, 3)) == NULL)
+        return (false);
+
+      length = strlen((const char *)lookup);
+    }
+
+    space->base           = base.base;
+    space->num_components = 1;
+    space->indexed        = true;
+    space->hival          = hival;
+    space->key            = array;
+
+    // Convert the lookup table through the base color space once
+    for (int i = 0; i <= hival; i ++)
+    {
+      uint8_t	c[4] = { 0, 0, 0, 0 },	// Base components
+		rgb[3];			// Color of the index
+
+      for (int j = 0; j < base.num_components; j ++)
+      {
+        size_t offset = (size_t)(i * base.num_components + j);
+
+        if (offset < length)
+          c[j] = base.subtractive ? (uint8_t)(255 - lookup[offset]) : lookup[offset];
+      }
+
+      image_to_rgb(base.base, c, rgb);
+      space->palette[i] = 0xff000000 | (uint32_t)rgb[0] << 16 | (uint32_t)rgb[1] << 8 | rgb[2];
+    }
+
+    free(data);
+
+    return (true);
+  }
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: Unsupported image color space /%s.\n", family);
+
+  return (false);
+}
+
+//
+// 'load_colorspace()' - Load the color space value of a dictionary.
+//
+
+static bool				  // O - true on success
+load_colorspace(pdfio_dict_t  *resources,// I - Resources for named spaces
+		pdfio_dict_t  *dict,	// I - Dictionary
+		const char    *key,	// I - Key
+		image_space_t *space,	// O - Color space
+		int           depth)	// I - Nesting depth
+{
+  pdfio_array_t	*array;			// Color space array
+
+  if (pdfioDictGetType(dict, key) == PDFIO_VALTYPE_NAME)
+    return (load_colorspace_name(resources, pdfioDictGetName(dict, key), space, depth));
+  else if ((array = image_get_array(dict, key)) != NULL)
+    return (load_colorspace_array(resources, array, space, depth));
+  else
+    return (false);
+}
+
+//
+// 'image_decoder_close()' - Close an image decoder.
+//
+
+static void
+image_decoder_close(image_decoder_t *d)	// I - Decoder
+{
+  image_reader_close(&d->r);
+  image_reader_close(&d->mask);
+
+  free(d->space);
+  free(d->row);
+  free(d->samples);
+  free(d->mask_row);
+  free(d->mask_samples);
+  free(d->mask_x);
+
+  memset(d, 0, sizeof(image_decoder_t));
+}
+
+//
+// 'image_decoder_open_mask()' - Open a /Mask stencil or /SMask image.
+//
+// Masks may have their own size, so their rows are read alongside the
+// image and sampled nearest neighbor.
+//
+
+static bool				  // O - true on success
+image_decoder_open_mask(
+    image_decoder_t *d,			// I - Decoder
+    pdfio_obj_t     *obj,		// I - Mask image
+    bool            stencil)		// I - Stencil mask (1 = transparent)?
+{
+  pdfio_dict_t	*dict = pdfioObjGetDict(obj);
+					// Mask dictionary
+  image_space_t	space;			// Mask "color space"
+  uint8_t	lut[4][256];		// Decode lookup
+  int		bpc;			// Bits per component
+
+  if (!dict)
+    return (false);
+
+  d->mask_width  = (int)pdfioDictGetNumber(dict, "Width");
+  d->mask_height = (int)pdfioDictGetNumber(dict, "Height");
+  bpc            = stencil ? 1 : (int)pdfioDictGetNumber(dict, "BitsPerComponent");
+
+  if (d->mask_width <= 0 || d->mask_height <= 0 || d->mask_width > PDFRIP_IMAGE_MAX_WIDTH)
+    return (false);
+
+  if (bpc != 1 && bpc != 2 && bpc != 4 && bpc != 8 && bpc != 16)
+    bpc = 8;
+
+  memset(&space, 0, sizeof(space));
+  space.base           = CS_DEVICE_GRAY;
+  space.num_components = 1;
+  space.subtractive    = stencil;
+
+  if (!image_reader_open(&d->mask, obj, d->mask_width, d->mask_height, 1, bpc, 1, NULL))
+    return (false);
+
+  // A JPEG soft mask must be grayscale
+  if (d->mask.num_components != 1)
+  {
+    image_reader_close(&d->mask);
+    return (false);
+  }
+
+  image_build_lut(&space, pdfioDictGetArray(dict, "Decode"), d->mask.bpc, lut);
+  memcpy(d->mask_lut, lut[0], sizeof(d->mask_lut));
+
+  d->mask_row     = malloc(d->mask.row_bytes);
+  d->mask_samples = malloc((size_t)d->mask_width + 8);
+  d->mask_x       = malloc((size_t)d->width * sizeof(int));
+  d->mask_y       = -1;
+
+  if (!d->mask_row || !d->mask_samples || !d->mask_x)
+  {
+    image_reader_close(&d->mask);
+    return (false);
+  }
+
+  for (int x = 0; x < d->width; x ++)
+    d->mask_x[x] = (int)((int64_t)x * d->mask_width / d->width);
+
+  d->has_mask = true;
+
+  return (true);
+}
+
+//
+// 'image_decoder_kernel()' - Choose a row conversion kernel for an image.
+//
+// Kernels handle unmasked gray, RGB and CMYK data without a Decode array,
+// and 1-bit gray with any Decode array.
+//
+
+static pdfrip_convert_cb_t		  // O - Kernel or NULL
+image_decoder_kernel(image_decoder_t *d)// I - Decoder
+{
+  pdfrip_convert_t	kernel;		// Kind of samples
+  pdfrip_convert_cb_t	convert;	// Kernel
+  pdfrip_simd_t		simd;		// Instruction set
+
+  if (d->has_mask || d->has_color_key || d->space->indexed)
+    return (NULL);
+
+  if (d->space->base == CS_DEVICE_GRAY && d->r.bpc == 1)
+  {
+    d->gray[0] = d->lut[0][0];
+    d->gray[1] = d->lut[0][1];
+    kernel     = PDFRIP_CONVERT_GRAY1;
+  }
+  else
+  {
+    for (int c = 0; c < d->r.num_components; c ++)
+    {
+      for (int v = 0; v < 256; v ++)
+      {
+        if (d->lut[c][v] != v)
+          return (NULL);
+      }
+    }
+
+    if (d->space->base == CS_DEVICE_GRAY && d->r.bpc == 8)
+      kernel = PDFRIP_CONVERT_GRAY8;
+    else if (d->space->base == CS_DEVICE_RGB && d->r.bpc == 8)
+      kernel = PDFRIP_CONVERT_RGB8;
+    else if (d->space->base == CS_DEVICE_RGB && d->r.bpc == 16)
+      kernel = PDFRIP_CONVERT_RGB16;
+    else if (d->space->base == CS_DEVICE_CMYK && d->r.bpc == 8)
+      kernel = PDFRIP_CONVERT_CMYK8;
+    else
+      return (NULL);
+  }
+
+  // Use the fastest kernel there is, the scalar one always exists
+  for (simd = image_simd_level(); (convert = image_convert_func(kernel, simd)) == NULL; simd = (pdfrip_simd_t)(simd - 1));
+
+  return (convert);
+}
+
+//
+// 'image_decoder_open()' - Start decoding an image XObject.
+//
+// The decoded size is that of the image data, which is smaller than
+// /Width and /Height when a JPEG or JPEG 2000 image is scaled.
+//
+
+static bool				  // O - true on success
+image_decoder_open(
+    image_decoder_t    *d,		// O - Decoder
+    pdfio_obj_t        *obj,		// I - Image object
+    pdfio_dict_t       *resources,	// I - Resources for named color spaces
+    int                scale,		// I - JPEG scale denominator
+    const pdfio_rect_t *area)		// I - Visible area of a JPEG 2000 image or NULL
+{
+  pdfio_dict_t	*dict = pdfioObjGetDict(obj);
+					// Image dictionary
+  pdfio_array_t	*mask_array;		// /Mask array
+  pdfio_obj_t	*mask_obj;		// /Mask or /SMask image
+  const char	*filter;		// Image filter
+  int		bpc;			// Bits per component
+
+  memset(d, 0, sizeof(image_decoder_t));
+
+  if (!dict)
+    return (false);
+
+  d->width  = (int)pdfioDictGetNumber(dict, "Width");
+  d->height = (int)pdfioDictGetNumber(dict, "Height");
+  bpc       = (int)pdfioDictGetNumber(dict, "BitsPerComponent");
+
+  if (d->width <= 0 || d->height <= 0)
+    return (false);
+
+  // Stencil masks are coverage rather than pixels, see image_load_stencil()
+  if (pdfioDictGetBoolean(dict, "ImageMask"))
+    return (false);
+
+  if (bpc != 1 && bpc != 2 && bpc != 4 && bpc != 8 && bpc != 16)
+    bpc = 8;
+
+  if ((d->space = calloc(1, sizeof(image_space_t))) == NULL)
+    return (false);
+
+  if (!load_colorspace(resources, dict, "ColorSpace", d->space, 0))
+  {
+    // Only JPEG and JPEG 2000 images may leave out their color space
+    d->space->num_components = 0;
+
+    if ((filter = image_filter(dict)) == NULL || (strcmp(filter, "DCTDecode") && strcmp(filter, "JPXDecode")))
+    {
+      if (g_verbose)
+        fprintf(stderr, "DEBUG: Image has no supported color space.\n");
+      goto error;
+    }
+  }
+
+  if (!image_reader_open(&d->r, obj, d->width, d->height, d->space->num_components, bpc, scale, area))
+    goto error;
+
+  if (d->r.num_components != d->space->num_components && !d->space->indexed)
+  {
+    // Trust the components of the JPEG or JPEG 2000 data
+    memset(d->space, 0, sizeof(image_space_t));
+    if (!load_colorspace_name(NULL, d->r.num_components == 1 ? "DeviceGray" : d->r.num_components == 3 ? "DeviceRGB" : "DeviceCMYK", d->space, 0))
+      goto error;
+  }
+  else if (d->r.num_components != d->space->num_components)
+  {
+    goto error;
+  }
+
+  d->width  = d->r.width;
+  d->height = d->r.height;
+
+  image_build_lut(d->space, pdfioDictGetArray(dict, "Decode"), d->r.bpc, d->lut);
+
+  // Indexed samples go through the Decode array and palette in one lookup
+  if (d->space->indexed)
+  {
+    for (int v = 0; v < 256; v ++)
+      d->pixels[v] = d->space->palette[d->lut[0][v]];
+  }
+
+  // Masks: a soft mask, a stencil mask image or color key ranges
+  if ((mask_obj = pdfioDictGetObj(dict, "SMask")) != NULL)
+  {
+    image_decoder_open_mask(d, mask_obj, false);
+  }
+  else if ((mask_array = pdfioDictGetArray(dict, "Mask")) != NULL)
+  {
+    if (pdfioArrayGetSize(mask_array) >= (size_t)(2 * d->r.num_components))
+    {
+      d->has_color_key = true;
+
+      for (int i = 0; i < 2 * d->r.num_components; i ++)
+        d->color_key[i] = (int)pdfioArrayGetNumber(mask_array, (size_t)i) >> (d->r.bpc == 16 ? 8 : 0);
+    }
+  }
+  else if ((mask_obj = pdfioDictGetObj(dict, "Mask")) != NULL)
+  {
+    image_decoder_open_mask(d, mask_obj, true);
+  }
+
+  d->convert = image_decoder_kernel(d);
+  d->row     = malloc(d->r.row_bytes);
+  d->samples = malloc((size_t)d->width * (size_t)d->r.num_components + 8);
+
+  if (!d->row || !d->samples)
+    goto error;
+
+  return (true);
+
+  error:
+
+  image_decoder_close(d);
+
+  return (false);
+}
+
+//
+// 'image_decoder_skip()' - Read past the next row without converting it.
+//
+
+static void
+image_decoder_skip(image_decoder_t *d)	// I - Decoder
+{
+  image_reader_row(&d->r, d->row);
+  d->y ++;
+}
+
+//
+// 'image_decoder_row()' - Decode the next row into Cairo pixels.
+//
+// Rows are RGB24, or premultiplied ARGB32 when the image has a mask.
+//
+
+static void
+image_decoder_row(image_decoder_t *d,	// I - Decoder
+		  uint32_t        *dst)	// O - Row of pixels
+{
+  const image_space_t	*space = d->space;
+  const uint8_t		*s = d->samples,// Current sample
+			*alpha_row = NULL;
+					// Mask row
+  int			num_components = d->r.num_components;
+					// Components per sample
+
+  image_reader_row(&d->r, d->row);
+
+  if (d->convert)
+  {
+    (d->convert)(d->row, dst, (size_t)d->width, d->gray);
+    d->y ++;
+    return;
+  }
+  else if (space->indexed && !d->has_mask && !d->has_color_key)
+  {
+    // Unmasked Indexed images are a single gather per pixel
+    if (d->r.bpc == 8)
+      s = d->row;
+    else
+      image_unpack_row(d->row, d->samples, (size_t)d->width, d->r.bpc);
+
+    for (int x = 0; x < d->width; x ++)
+      dst[x] = d->pixels[s[x]];
+
+    d->y ++;
+    return;
+  }
+
+  image_unpack_row(d->row, d->samples, (size_t)d->width * (size_t)num_components, d->r.bpc);
+
+  if (d->has_mask)
+  {
+    int mask_y = (int)((int64_t)d->y * d->mask_height / d->height);
+					// Mask row for this row
+
+    if (d->mask_y < mask_y)
+    {
+      while (d->mask_y < mask_y)
+      {
+        image_reader_row(&d->mask, d->mask_row);
+        d->mask_y ++;
+      }
+
+      image_unpack_row(d->mask_row, d->mask_samples, (size_t)d->mask_width, d->mask.bpc);
+
+      for (int x = 0; x < d->mask_width; x ++)
+        d->mask_samples[x] = d->mask_lut[d->mask_samples[x]];
+    }
+
+    alpha_row = d->mask_samples;
+  }
+
+  for (int x = 0; x < d->width; x ++, s += num_components)
+  {
+    uint8_t	c[4],			// Decoded components
+		rgb[3];			// Pixel color
+    uint32_t	a = 255;		// Pixel alpha
+
+    if (d->has_color_key)
+    {
+      int i;
+
+      for (i = 0; i < num_components; i ++)
+      {
+        if (s[i] < d->color_key[2 * i] || s[i] > d->color_key[2 * i + 1])
+          break;
+      }
+
+      if (i == num_components)
+        a = 0;
+    }
+
+    if (space->indexed)
+    {
+      uint32_t pixel = d->pixels[s[0]];	// Palette pixel
+
+      rgb[0] = (uint8_t)(pixel >> 16);
+      rgb[1] = (uint8_t)(pixel >> 8);
+      rgb[2] = (uint8_t)pixel;
+    }
+    else
+    {
+      for (int i = 0; i < num_components; i ++)
+        c[i] = d->lut[i][s[i]];
+
+      image_to_rgb(space->base, c, rgb);
+    }
+
+    if (alpha_row)
+      a = alpha_row[d->mask_x[x]];
+
+    if (a == 255)
+      dst[x] = 0xff000000 | (uint32_t)rgb[0] << 16 | (uint32_t)rgb[1] << 8 | rgb[2];
+    else
+      dst[x] = a << 24 | (uint32_t)((rgb[0] * a + 127) / 255) << 16 | (uint32_t)((rgb[1] * a + 127) / 255) << 8 | (uint32_t)((rgb[2] * a + 127) / 255);
+  }
+
+  d->y ++;
+}
+
+//
+// 'image_load_mask()' - Read 1-bit samples as Cairo A1 or A8 coverage.
+//
+// Masks shown smaller than their size are expanded to A8, so the pattern
+// filter averages bytes rather than bits.  Otherwise the bits are kept as
+// A1, a 32nd of the size of RGB24 pixels.
+//
+
+static bool				  // O - true on success
+image_load_mask(p2c_image_t    *image,	// I - Image
+		image_reader_t *r,	// I - 1-bit sample reader
+		int            paint,	// I - Sample value that is painted
+		double         target_width,
+					// I - Device width in pixels, 0 for full size
+		double         target_height)
+					// I - Device height in pixels, 0 for full size
+{
+  cairo_format_t	format = CAIRO_FORMAT_A1;
+					// Surface format
+  pdfrip_expand_cb_t	expand = NULL;	// A8 expansion kernel
+  pdfrip_simd_t		simd;		// Instruction set
+  uint8_t		bits[256],	// A1 byte of each sample byte
+			alpha[2],	// A8 coverage of each sample value
+			*row,		// Packed row
+			*data;		// Surface data
+  int			stride;		// Surface row stride
+
+  if (target_width > 0.0 && target_height > 0.0 && (target_width < image->width || target_height < image->height) && (size_t)image->width * (size_t)image->height <= PDFRIP_IMAGE_MAX_PIXELS * 4)
+    format = CAIRO_FORMAT_A8;
+
+  image->surface = cairo_image_surface_create(format, image->width, image->height);
+
+  if (cairo_surface_status(image->surface) != CAIRO_STATUS_SUCCESS || (row = malloc(r->row_bytes)) == NULL)
+  {
+    cairo_surface_destroy(image->surface);
+    image->surface = NULL;
+    return (false);
+  }
+
+  if (format == CAIRO_FORMAT_A8)
+  {
+    alpha[paint]     = 255;
+    alpha[1 - paint] = 0;
+
+    for (simd = image_simd_level(); (expand = image_expand_func(simd)) == NULL; simd = (pdfrip_simd_t)(simd - 1));
+  }
+  else
+  {
+    // Cairo A1 pixels are set bits, in the bit order of a native 32-bit word
+    for (int i = 0; i < 256; i ++)
+    {
+      uint8_t b = (uint8_t)(paint ? i : ~i);
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      b = (uint8_t)((b & 0xf0) >> 4 | (b & 0x0f) << 4);
+      b = (uint8_t)((b & 0xcc) >> 2 | (b & 0x33) << 2);
+      b = (uint8_t)((b & 0xaa) >> 1 | (b & 0x55) << 1);
+#endif // __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+      bits[i] = b;
+    }
+  }
+
+  cairo_surface_flush(image->surface);
+
+  data   = cairo_image_surface_get_data(image->surface);
+  stride = cairo_image_surface_get_stride(image->surface);
+
+  for (int y = 0; y < image->height; y ++)
+  {
+    uint8_t *dst = data + (size_t)y * (size_t)stride;
+					// Surface row
+
+    image_reader_row(r, row);
+
+    if (expand)
+    {
+      (expand)(row, dst, (size_t)image->width, alpha);
+    }
+    else
+    {
+      for (size_t i = 0; i < r->row_bytes; i ++)
+        dst[i] = bits[row[i]];
+    }
+  }
+
+  free(row);
+  cairo_surface_mark_dirty(image->surface);
+
+  image->bytes += (size_t)stride * (size_t)image->height;
+
+  return (true);
+}
+
+//
+// 'image_load_stencil()' - Decode an /ImageMask image as coverage.
+//
+// Stencil masks are never drawn in strips; as A1 coverage they are 32
+// times smaller than the largest cached image.
+//
+
+static bool				  // O - true on success
+image_load_stencil(
+    p2c_image_t *image,			// I - Image
+    pdfio_obj_t *obj,			// I - Image object
+    double      target_width,		// I - Device width in pixels, 0 for full size
+    double      target_height)		// I - Device height in pixels, 0 for full size
+{
+  pdfio_array_t	*decode = pdfioDictGetArray(pdfioObjGetDict(obj), "Decode");
+					// Decode array
+  image_reader_t r;			// Sample reader
+  bool		ret;			// Return value
+
+  if ((size_t)image->width * (size_t)image->height > PDFRIP_IMAGE_MAX_PIXELS * 32)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Skipping %dx%d stencil mask, too large.\n", image->width, image->height);
+    return (false);
+  }
+
+  if (!image_reader_open(&r, obj, image->width, image->height, 1, 1, 1, NULL))
+    return (false);
+
+  if (r.jpeg || r.jpx)
+  {
+    image_reader_close(&r);
+    return (false);
+  }
+
+  // Samples of 0 are painted unless the Decode array is [1 0]
+  image->stencil = true;
+  ret            = image_load_mask(image, &r, decode && pdfioArrayGetNumber(decode, 0) >= 0.5, target_width, target_height);
+
+  image_reader_close(&r);
+
+  return (ret);
+}
+
+//
+// 'image_decoder_bilevel()' - Check for a black and white 1-bit image.
+//
+
+static bool				  // O - true if bilevel
+image_decoder_bilevel(
+    image_decoder_t *d,			// I - Decoder
+    int             *paint)		// O - Sample value that is black
+{
+  if (d->has_mask || d->has_color_key || d->space->indexed || d->space->base != CS_DEVICE_GRAY || d->r.bpc != 1 || d->r.jpeg)
+    return (false);
+
+  if (d->lut[0][0] == 0 && d->lut[0][1] == 255)
+    *paint = 0;
+  else if (d->lut[0][0] == 255 && d->lut[0][1] == 0)
+    *paint = 1;
+  else
+    return (false);
+
+  return (true);
+}
+
+//
+// 'load_image()' - Decode an image XObject into a Cairo surface.
+//
+// JPEG and JPEG 2000 images are decoded no larger than needed for the
+// target size, and the surface may be smaller than /Width and /Height.
+// Images with more than PDFRIP_IMAGE_MAX_PIXELS pixels are not decoded
+// here but marked to be drawn in strips.  Stencil masks and black and
+// white 1-bit images are decoded as A1 or A8 coverage instead of pixels.
+//
+
+static bool				  // O - true on success
+load_image(p2c_image_t  *image,		// I - Image
+	   pdfio_obj_t  *obj,		// I - Image object
+	   pdfio_dict_t *resources,	// I - Resources for named color spaces
+	   double       target_width,	// I - Device width in pixels, 0 for full size
+	   double       target_height)	// I - Device height in pixels, 0 for full size
+{
+  pdfio_dict_t	*dict = pdfioObjGetDict(obj);
+					// Image dictionary
+  image_decoder_t d;			// Decoder
+  unsigned char	*data;			// Surface pixels
+  int		stride,			// Surface row stride
+		paint;			// Black sample value of a bilevel image
+  size_t	full,			// Bytes of a full size surface
+		pixels;			// Decoded pixels
+  bool		ret;			// Return value
+
+  if (!dict)
+    return (false);
+
+  image->width       = (int)pdfioDictGetNumber(dict, "Width");
+  image->height      = (int)pdfioDictGetNumber(dict, "Height");
+  image->interpolate = pdfioDictGetBoolean(dict, "Interpolate");
+  image->scale       = 1;
+  image->saved       = 0;
+  image->strips      = false;
+  image->stencil     = false;
+  image->bilevel     = false;
+
+  if (image->width <= 0 || image->height <= 0)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Skipping %dx%d image.\n", image->width, image->height);
+    return (false);
+  }
+
+  if (pdfioDictGetBoolean(dict, "ImageMask"))
+    return (image_load_stencil(image, obj, target_width, target_height));
+
+  image->scale = image_scale(dict, target_width, target_height);
+
+  pixels = (size_t)((image->width + image->scale - 1) / image->scale) * (size_t)((image->height + image->scale - 1) / image->scale);
+
+  // 1-bit images may be bilevel, which are cached as A1 when much larger
+  if (pixels > PDFRIP_IMAGE_MAX_PIXELS && ((int)pdfioDictGetNumber(dict, "BitsPerComponent") != 1 || pixels > PDFRIP_IMAGE_MAX_PIXELS * 32))
+  {
+    image->strips = true;
+    return (true);
+  }
+
+  if (!image_decoder_open(&d, obj, resources, image->scale, NULL))
+    return (false);
+
+  if (image_decoder_bilevel(&d, &paint))
+  {
+    image->bilevel = true;
+    ret            = image_load_mask(image, &d.r, paint, target_width, target_height);
+
+    image_decoder_close(&d);
+    return (ret);
+  }
+  else if (pixels > PDFRIP_IMAGE_MAX_PIXELS)
+  {
+    image_decoder_close(&d);
+    image->strips = true;
+    return (true);
+  }
+
+  // JPEG 2000 data may have fewer resolution levels than asked for
+  full          = (size_t)image->width * (size_t)image->height * 4;
+  image->width  = d.width;
+  image->height = d.height;
+  image->scale  = d.r.scale;
+
+  if (image->scale > 1 && full > (size_t)image->width * (size_t)image->height * 4)
+    image->saved = full - (size_t)image->width * (size_t)image->height * 4;
+
+  image->surface = cairo_image_surface_create(d.has_mask || d.has_color_key ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24, image->width, image->height);
+
+  if (cairo_surface_status(image->surface) != CAIRO_STATUS_SUCCESS)
+  {
+    cairo_surface_destroy(image->surface);
+    image->surface = NULL;
+    image_decoder_close(&d);
+    return (false);
+  }
+
+  cairo_surface_flush(image->surface);
+
+  data   = cairo_image_surface_get_data(image->surface);
+  stride = cairo_image_surface_get_stride(image->surface);
+
+  for (int y = 0; y < image->height; y ++)
+    image_decoder_row(&d, (uint32_t *)(data + (size_t)y * (size_t)stride));
+
+  image_decoder_close(&d);
+  cairo_surface_mark_dirty(image->surface);
+
+  image->bytes += (size_t)stride * (size_t)image->height;
+
+  return (true);
+}
+
+//
+// 'image_free_scaled()' - Free the reduced copies of an image.
+//
+
+static void
+image_free_scaled(p2c_image_t *image)	// I - Image
+{
+  for (size_t i = 0; i < image->num_scaled; i ++)
+    cairo_surface_destroy(image->scaled[i].surface);
+
+  image->num_scaled = image->next_scaled = 0;
+}
+
+//
+// 'image_destroy()' - Free a cached image.
+//
+
+static void
+image_destroy(p2c_image_t *image)	// I - Image
+{
+  image_free_scaled(image);
+
+  if (image->surface)
+    cairo_surface_destroy(image->surface);
+
+  free(image);
+}
+
+//
+// 'image_decode()' - Decode an image for the cache and log the result.
+//
+
+static void
+image_decode(pdfrip_doc_t *doc,		// I - Document
+	     p2c_image_t  *image,	// I - Image
+	     pdfio_obj_t  *obj,		// I - Image object
+	     pdfio_dict_t *resources,	// I - Resources of the content stream
+	     double       target_width,	// I - Device width in pixels
+	     double       target_height)// I - Device height in pixels
+{
+  if (load_image(image, obj, resources, target_width, target_height) && g_verbose)
+  {
+    if (image->strips)
+      fprintf(stderr, "DEBUG: Drawing %dx%d image %zu in strips.\n", image->width, image->height, image->obj_number);
+    else if (image->stencil || image->bilevel)
+      fprintf(stderr, "DEBUG: Decoded %dx%d %s %zu as %s coverage.\n", image->width, image->height, image->stencil ? "stencil mask" : "bilevel image", image->obj_number, cairo_image_surface_get_format(image->surface) == CAIRO_FORMAT_A8 ? "A8" : "A1");
+    else if (image->scale > 1)
+      fprintf(stderr, "DEBUG: Decoded %dx%d image %zu at 1/%d scale, saving %zu bytes.\n", image->width, image->height, image->obj_number, image->scale, image->saved);
+    else
+      fprintf(stderr, "DEBUG: Decoded %dx%d image %zu.\n", image->width, image->height, image->obj_number);
+  }
+
+  doc->image_bytes       += image->bytes;
+  doc->image_bytes_saved += image->saved;
+}
+
+//
+// 'image_evict()' - Drop the least recently used images when over budget.
+//
+
+static void
+image_evict(pdfrip_doc_t *doc,		// I - Document
+	    p2c_image_t  *keep)		// I - Image in use
+{
+  while (doc->image_bytes > PDFRIP_IMAGE_CACHE_BUDGET && doc->num_images > 1)
+  {
+    size_t oldest = 0;
+
+    for (size_t i = 1; i < doc->num_images; i ++)
+    {
+      if (doc->images[i]->last_used < doc->images[oldest]->last_used)
+        oldest = i;
+    }
+
+    if (doc->images[oldest] == keep)
+      break;
+
+    doc->image_bytes       -= doc->images[oldest]->bytes;
+    doc->image_bytes_saved -= doc->images[oldest]->saved;
+    image_destroy(doc->images[oldest]);
+    doc->images[oldest] = doc->images[-- doc->num_images];
+  }
+}
+
+//
+// 'getDocImage()' - Get the decoded pixels of an image XObject.
+//
+// The target size is the number of device pixels the image covers, or 0
+// for full size.  A JPEG or JPEG 2000 image decoded at a reduced scale is
+// decoded again when it is later shown larger.  Images that cannot be
+// decoded are cached too, so they are only tried once.  The returned image
+// stays valid until the next call.
+//
+
+p2c_image_t *				  // O - Image or NULL
+getDocImage(pdfrip_doc_t *doc,		// I - Document
+	    pdfio_obj_t  *obj,		// I - Image object
+	    pdfio_dict_t *resources,	// I - Resources of the content stream
+	    double       target_width,	// I - Device width in pixels, 0 for full size
+	    double       target_height)	// I - Device height in pixels, 0 for full size
+{
+  size_t	obj_number = pdfioObjGetNumber(obj);
+					// Object number
+  p2c_image_t	*image;			// Image
+
+  for (size_t i = 0; i < doc->num_images; i ++)
+  {
+    if ((image = doc->images[i])->obj_number != obj_number)
+      continue;
+
+    image->last_used = ++ doc->image_clock;
+
+    if (image->surface && image->scale > 1)
+    {
+      pdfio_dict_t *dict = pdfioObjGetDict(obj);
+					// Image dictionary
+
+      if (image_scale(dict, target_width, target_height) < image->scale)
+      {
+        doc->image_bytes       -= image->bytes;
+        doc->image_bytes_saved -= image->saved;
+
+        image_free_scaled(image);
+        cairo_surface_destroy(image->surface);
+        image->surface = NULL;
+        image->bytes   = sizeof(p2c_image_t);
+
+        image_decode(doc, image, obj, resources, target_width, target_height);
+        image_evict(doc, image);
+      }
+    }
+
+    return (image);
+  }
+
+  if (doc->num_images == doc->alloc_images)
+  {
+    size_t	alloc = doc->alloc_images ? doc->alloc_images * 2 : 16;
+    p2c_image_t	**temp = realloc(doc->images, alloc * sizeof(p2c_image_t *));
+
+    if (!temp)
+      return (NULL);
+
+    doc->images       = temp;
+    doc->alloc_images = alloc;
+  }
+
+  if ((image = calloc(1, sizeof(p2c_image_t))) == NULL)
+    return (NULL);
+
+  image->obj_number = obj_number;
+  image->bytes      = sizeof(p2c_image_t);
+  image->last_used  = ++ doc->image_clock;
+
+  doc->images[doc->num_images ++] = image;
+
+  image_decode(doc, image, obj, resources, target_width, target_height);
+  image_evict(doc, image);
+
+  return (image);
+}
+
+//
+// 'getDocImageScaled()' - Get a cached image reduced for its device size.
+//
+// Returns NULL when the image is drawn as it is: when it is not shown at
+// half its size or less, is a stencil mask, bilevel or drawn in strips, or
+// cannot be reduced.  The surface belongs to the image.
+//
+
+cairo_surface_t *			  // O - Reduced pixels or NULL
+getDocImageScaled(
+    pdfrip_doc_t *doc,			// I - Document
+    p2c_image_t  *image,		// I - Image from getDocImage()
+    double       target_width,		// I - Device width in pixels
+    double       target_height)		// I - Device height in pixels
+{
+  p2c_image_scaled_t	*scaled;	// Reduced copy
+  cairo_surface_t	*surface;	// Reduced pixels
+  int			x_factor,	// Image columns per reduced pixel
+			y_factor;	// Image rows per reduced pixel
+  size_t		bytes;		// Memory used by a copy
+
+  if (!image->surface || image->strips || image->stencil || image->bilevel || target_width < 1.0 || target_height < 1.0)
+    return (NULL);
+
+  // Whole factors, so the reduced image still covers every device pixel
+  x_factor = image->width / target_width >= PDFRIP_IMAGE_MAX_SHRINK ? PDFRIP_IMAGE_MAX_SHRINK : (int)(image->width / target_width);
+  y_factor = image->height / target_height >= PDFRIP_IMAGE_MAX_SHRINK ? PDFRIP_IMAGE_MAX_SHRINK : (int)(image->height / target_height);
+
+  if (x_factor < 2 && y_factor < 2)
+    return (NULL);
+
+  if (x_factor < 1)
+    x_factor = 1;
+  if (y_factor < 1)
+    y_factor = 1;
+
+  for (size_t i = 0; i < image->num_scaled; i ++)
+  {
+    if (image->scaled[i].x_factor == x_factor && image->scaled[i].y_factor == y_factor)
+      return (image->scaled[i].surface);
+  }
+
+  if ((surface = image_shrink(image->surface, x_factor, y_factor, image_simd_level())) == NULL)
+    return (NULL);
+
+  if (image->num_scaled < P2C_IMAGE_SCALED)
+  {
+    scaled = image->scaled + image->num_scaled ++;
+  }
+  else
+  {
+    scaled = image->scaled + image->next_scaled;
+    image->next_scaled = (image->next_scaled + 1) % P2C_IMAGE_SCALED;
+
+    bytes = (size_t)cairo_image_surface_get_stride(scaled->surface) * (size_t)cairo_image_surface_get_height(scaled->surface);
+    image->bytes     -= bytes;
+    doc->image_bytes -= bytes;
+
+    cairo_surface_destroy(scaled->surface);
+  }
+
+  scaled->x_factor = x_factor;
+  scaled->y_factor = y_factor;
+  scaled->surface  = surface;
+
+  bytes = (size_t)cairo_image_surface_get_stride(surface) * (size_t)cairo_image_surface_get_height(surface);
+  image->bytes     += bytes;
+  doc->image_bytes += bytes;
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: Reduced %dx%d image %zu to %dx%d with a %dx%d box filter.\n", image->width, image->height, image->obj_number, cairo_image_surface_get_width(surface), cairo_image_surface_get_height(surface), x_factor, y_factor);
+
+  image_evict(doc, image);
+
+  return (surface);
+}
+
+//
+// 'freeDocImages()' - Free the images cached by a document.
+//
+
+void
+freeDocImages(pdfrip_doc_t *doc)	// I - Document
+{
+  for (size_t i = 0; i < doc->num_images; i ++)
+    image_destroy(doc->images[i]);
+
+  free(doc->images);
+
+  doc->images      = NULL;
+  doc->num_images  = doc->alloc_images = 0;
+  doc->image_bytes = doc->image_bytes_saved = 0;
+}
+
+//
+// 'getDocColorSpace()' - Get the family and palette of a fill or stroke color space.
+//
+// Indexed palettes are converted through their base color space once and
+// cached by the document, so the cs/scn operators of later pages reuse the
+// same pixels.  Pattern and unsupported color spaces return false.
+//
+
+bool					  // O - true on success
+getDocColorSpace(
+    pdfrip_doc_t           *doc,	// I - Document
+    pdfio_dict_t           *resources,	// I - Resources of the content stream
+    const char             *name,	// I - Color space name
+    p2c_colorspace_t       *family,	// O - Color space family
+    const p2c_palette_t    **palette)	// O - Palette of an Indexed space or NULL
+{
+  pdfio_dict_t	*colorspaces = NULL;	// ColorSpace resources
+  pdfio_array_t	*array = NULL;		// Color space array
+  image_space_t	space;			// Color space
+  p2c_palette_t	*pal;			// New palette
+
+  *family  = CS_DEVICE_GRAY;
+  *palette = NULL;
+
+  // Look for an Indexed space that was already converted
+  if (resources)
+  {
+    if (pdfioDictGetType(resources, "ColorSpace") == PDFIO_VALTYPE_INDIRECT)
+      colorspaces = pdfioObjGetDict(pdfioDictGetObj(resources, "ColorSpace"));
+    else
+      colorspaces = pdfioDictGetDict(resources, "ColorSpace");
+  }
+
+  if (colorspaces && (array = image_get_array(colorspaces, name)) != NULL)
+  {
+    for (size_t i = 0; i < doc->num_palettes; i ++)
+    {
+      if (doc->palettes[i]->key == array)
+      {
+        *family  = CS_INDEXED;
+        *palette = doc->palettes[i];
+        return (true);
+      }
+    }
+  }
+
+  memset(&space, 0, sizeof(space));
+
+  if (!load_colorspace_name(resources, name, &space, 0))
+    return (false);
+
+  if (!space.indexed)
+  {
+    *family = space.subtractive ? CS_SEPARATION : space.base;
+    return (true);
+  }
+
+  if (doc->num_palettes == doc->alloc_palettes)
+  {
+    size_t		alloc = doc->alloc_palettes ? doc->alloc_palettes * 2 : 4;
+    p2c_palette_t	**temp = realloc(doc->palettes, alloc * sizeof(p2c_palette_t *));
+
+    if (!temp)
+      return (false);
+
+    doc->palettes       = temp;
+    doc->alloc_palettes = alloc;
+  }
+
+  if ((pal = calloc(1, sizeof(p2c_palette_t))) == NULL)
+    return (false);
+
+  pal->key   = space.key;
+  pal->hival = space.hival;
+  memcpy(pal->pixels, space.palette, sizeof(pal->pixels));
+
+  doc->palettes[doc->num_palettes ++] = pal;
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: Converted %d colors of Indexed color space /%s.\n", space.hival + 1, name);
+
+  *family  = CS_INDEXED;
+  *palette = pal;
+
+  return (true);
+}
+
+//
+// 'freeDocPalettes()' - Free the Indexed palettes cached by a document.
+//
+
+void
+freeDocPalettes(pdfrip_doc_t *doc)	// I - Document
+{
+  for (size_t i = 0; i < doc->num_palettes; i ++)
+    free(doc->palettes[i]);
+
+  free(doc->palettes);
+
+  doc->palettes     = NULL;
+  doc->num_palettes = doc->alloc_palettes = 0;
+}
+
+//
+// 'openImageStrips()' - Start decoding a large image a strip at a time.
+//
+// The visible area is in fractions of the image width and height from its
+// top left corner.  JPEG 2000 images are only decoded over that area, and
+// other images are read whole.
+//
+
+p2c_image_strips_t *			  // O - Image strips or NULL
+openImageStrips(pdfio_obj_t        *obj,// I - Image object
+		pdfio_dict_t       *resources,// I - Resources of the content stream
+		double             target_width,// I - Device width in pixels, 0 for full size
+		double             target_height,// I - Device height in pixels, 0 for full size
+		const pdfio_rect_t *area)// I - Visible area or NULL for all
+{
+  pdfio_dict_t		*dict = pdfioObjGetDict(obj);
+					// Image dictionary
+  p2c_image_strips_t	*strips;	// Image strips
+
+  if (!dict || (strips = calloc(1, sizeof(p2c_image_strips_t))) == NULL)
+    return (NULL);
+
+  if ((strips->decoder = calloc(1, sizeof(image_decoder_t))) == NULL)
+  {
+    free(strips);
+    return (NULL);
+  }
+
+  if (!image_decoder_open(strips->decoder, obj, resources, image_scale(dict, target_width, target_height), area))
+  {
+    free(strips->decoder);
+    free(strips);
+    return (NULL);
+  }
+
+  strips->width       = strips->decoder->width;
+  strips->height      = strips->decoder->height;
+  strips->interpolate = pdfioDictGetBoolean(dict, "Interpolate");
+  strips->has_alpha   = strips->decoder->has_mask || strips->decoder->has_color_key;
+
+  if (strips->width > PDFRIP_IMAGE_MAX_WIDTH || (strips->last_row = malloc((size_t)strips->width * 4)) == NULL)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Skipping %dx%d image.\n", strips->width, strips->height);
+
+    closeImageStrips(strips);
+    return (NULL);
+  }
+
+  return (strips);
+}
+
+//
+// 'readImageStrip()' - Decode a strip of rows of a large image.
+//
+// Strips must be read top to bottom, but may skip rows and may start at
+// the last row of the previous strip.  Skipped rows are read from the
+// image data but not converted.
+//
+
+cairo_surface_t *			  // O - Surface with the rows or NULL
+readImageStrip(p2c_image_strips_t *strips,// I - Image strips
+	       int                y,	// I - First row
+	       int                rows)	// I - Number of rows
+{
+  image_decoder_t	*d = strips->decoder;
+					// Decoder
+  cairo_surface_t	*surface;	// Strip pixels
+  unsigned char		*data;		// Surface pixels
+  int			stride;		// Surface row stride
+
+  if (y < 0 || y >= strips->height || y < d->y - 1 || rows <= 0)
+    return (NULL);
+
+  if (rows > strips->height - y)
+    rows = strips->height - y;
+
+  surface = cairo_image_surface_create(strips->has_alpha ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24, strips->width, rows);
+
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
+  {
+    cairo_surface_destroy(surface);
+    return (NULL);
+  }
+
+  cairo_surface_flush(surface);
+
+  data   = cairo_image_surface_get_data(surface);
+  stride = cairo_image_surface_get_stride(surface);
+
+  for (int i = 0; i < rows; i ++)
+  {
+    uint32_t *dst = (uint32_t *)(data + (size_t)i * (size_t)stride);
+					// Row of pixels
+
+    if (y + i < d->y)
+    {
+      memcpy(dst, strips->last_row, (size_t)strips->width * 4);
+      continue;
+    }
+
+    while (d->y < y + i)
+      image_decoder_skip(d);
+
+    image_decoder_row(d, dst);
+  }
+
+  memcpy(strips->last_row, data + (size_t)(rows - 1) * (size_t)stride, (size_t)strips->width * 4);
+  cairo_surface_mark_dirty(surface);
+
+  return (surface);
+}
+
+//
+// 'closeImageStrips()' - Stop decoding a large image.
+//
+
+void
+closeImageStrips(p2c_image_strips_t *strips)// I - Image strips
+{
+  if (!strips)
+    return;
+
+  image_decoder_close(strips->decoder);
+  free(strips->decoder);
+  free(strips->last_row);
+  free(strips);
+}
@@ -0,0 +1,854 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+//
+// Image row conversion kernels.
+//
+// The most common kinds of image data - 1-bit and 8-bit gray, 8-bit RGB
+// and CMYK and 16-bit RGB - are converted from packed samples straight to
+// Cairo RGB24 pixels, without going through one byte per sample and a
+// lookup table per pixel.  On x86 there are SSE2 and AVX2 versions, chosen
+// at run time.  The scalar versions are the reference: the vector versions
+// must give the same pixels, bit for bit.
+//
+// SSE2 has no byte shuffle, so RGB8 and RGB16 only have AVX2 versions.
+//
+// Stencil masks and bilevel scans are expanded from 1 bit per pixel to
+// Cairo A8 coverage the same way, eight pixels per source byte.
+//
+// Images shown much smaller than their size are reduced by whole factors
+// with a box filter: the rows of each block are summed into 16-bit
+// columns, then each run of columns is summed and divided by multiplying
+// with a 24-bit reciprocal.  Pixel bytes are averaged independently, so
+// premultiplied ARGB32 stays premultiplied.
+//
+
+#include "pdfops-private.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  include <immintrin.h>
+#  define IMAGE_X86 1
+#  define IMAGE_AVX2 __attribute__((target("avx2")))
+#  ifdef __SSE2__
+#    define IMAGE_SSE2 1
+#  endif
+#endif
+
+
+//
+// Local globals...
+//
+
+static pthread_once_t	simd_once = PTHREAD_ONCE_INIT;
+					// One-time CPU check
+static pdfrip_simd_t	simd_level = PDFRIP_SIMD_NONE;
+					// Best supported instruction set
+
+
+//
+// 'convert_gray1()' - Convert 1-bit gray samples.
+//
+
+static void
+convert_gray1(const uint8_t *src,	// I - Packed samples
+	      uint32_t      *dst,	// O - RGB24 pixels
+	      size_t        width,	// I - Number of pixels
+	      const uint8_t *gray)	// I - Gray level of 0 and 1 bits
+{
+  uint32_t	pixels[2];		// Pixel of each bit
+
+  pixels[0] = 0xff000000 | gray[0] * 0x010101u;
+  pixels[1] = 0xff000000 | gray[1] * 0x010101u;
+
+  for (size_t x = 0; x < width; x ++)
+    dst[x] = pixels[(src[x >> 3] >> (7 - (x & 7))) & 1];
+}
+
+//
+// 'expand_mask1()' - Expand 1-bit samples to A8 coverage.
+//
+
+static void
+expand_mask1(const uint8_t *src,	// I - Packed samples
+	     uint8_t       *dst,	// O - A8 coverage
+	     size_t        width,	// I - Number of pixels
+	     const uint8_t *alpha)	// I - Coverage of 0 and 1 bits
+{
+  for (size_t x = 0; x < width; x ++)
+    dst[x] = alpha[(src[x >> 3] >> (7 - (x & 7))) & 1];
+}
+
+//
+// 'convert_gray8()' - Convert 8-bit gray samples.
+//
+
+static void
+convert_gray8(const uint8_t *src,	// I - Samples
+	      uint32_t      *dst,	// O - RGB24 pixels
+	      size_t        width,	// I - Number of pixels
+	      const uint8_t *gray)	// I - Unused
+{
+  (void)gray;
+
+  for (size_t x = 0; x < width; x ++)
+    dst[x] = 0xff000000 | src[x] * 0x010101u;
+}
+
+//
+// 'convert_rgb8()' - Convert 8-bit RGB samples.
+//
+
+static void
+convert_rgb8(const uint8_t *src,	// I - Samples
+	     uint32_t      *dst,	// O - RGB24 pixels
+	     size_t        width,	// I - Number of pixels
+	     const uint8_t *gray)	// I - Unused
+{
+  (void)gray;
+
+  for (size_t x = 0; x < width; x ++, src += 3)
+    dst[x] = 0xff000000 | (uint32_t)src[0] << 16 | (uint32_t)src[1] << 8 | src[2];
+}
+
+//
+// 'convert_cmyk8()' - Convert 8-bit CMYK samples.
+//
+
+static void
+convert_cmyk8(const uint8_t *src,	// I - Samples
+	      uint32_t      *dst,	// O - RGB24 pixels
+	      size_t        width,	// I - Number of pixels
+	      const uint8_t *gray)	// I - Unused
+{
+  (void)gray;
+
+  for (size_t x = 0; x < width; x ++, src += 4)
+  {
+    uint32_t k = 255u - src[3];		// Inverse black
+
+    dst[x] = 0xff000000 | (255u - src[0]) * k / 255 << 16 | (255u - src[1]) * k / 255 << 8 | (255u - src[2]) * k / 255;
+  }
+}
+
+//
+// 'convert_rgb16()' - Convert 16-bit RGB samples, keeping the high bytes.
+//
+
+static void
+convert_rgb16(const uint8_t *src,	// I - Big-endian samples
+	      uint32_t      *dst,	// O - RGB24 pixels
+	      size_t        width,	// I - Number of pixels
+	      const uint8_t *gray)	// I - Unused
+{
+  (void)gray;
+
+  for (size_t x = 0; x < width; x ++, src += 6)
+    dst[x] = 0xff000000 | (uint32_t)src[0] << 16 | (uint32_t)src[2] << 8 | src[4];
+}
+
+//
+// 'shrink_sum()' - Add a row of bytes to the column sums of a box.
+//
+
+static void
+shrink_sum(const uint8_t *src,		// I - Pixel bytes
+	   uint16_t      *sums,		// IO - Sum of each byte
+	   size_t        count)		// I - Number of bytes
+{
+  for (size_t i = 0; i < count; i ++)
+    sums[i] += src[i];
+}
+
+//
+// 'shrink_box()' - Average runs of summed pixels into pixels.
+//
+// Each pixel averages 'factor' pixels of sums, 'scale' being 2^24 divided
+// by the number of pixels in the box.
+//
+
+static void
+shrink_box(const uint16_t *sums,	// I - Column sums, 4 per pixel
+	   uint32_t       *dst,		// O - Pixels
+	   size_t         width,	// I - Number of pixels
+	   int            factor,	// I - Pixels summed per pixel
+	   uint32_t       scale)	// I - Reciprocal of box size, 24-bit fraction
+{
+  uint8_t	*out = (uint8_t *)dst;	// Output bytes
+
+  for (size_t x = 0; x < width; x ++, out += 4)
+  {
+    uint32_t	total[4] = { 0, 0, 0, 0 };
+					// Sum of each byte over the box
+
+    for (int i = 0; i < factor; i ++, sums += 4)
+    {
+      total[0] += sums[0];
+      total[1] += sums[1];
+      total[2] += sums[2];
+      total[3] += sums[3];
+    }
+
+    for (int i = 0; i < 4; i ++)
+      out[i] = (uint8_t)((total[i] * scale + 0x800000) >> 24);
+  }
+}
+
+
+#ifdef IMAGE_SSE2
+//
+// 'convert_gray1_sse2()' - Convert 1-bit gray samples with SSE2.
+//
+
+static void
+convert_gray1_sse2(const uint8_t *src,	// I - Packed samples
+		   uint32_t      *dst,	// O - RGB24 pixels
+		   size_t        width,	// I - Number of pixels
+		   const uint8_t *gray)	// I - Gray level of 0 and 1 bits
+{
+  const __m128i	zero = _mm_set1_epi32((int)(0xff000000 | gray[0] * 0x010101u)),
+		diff = _mm_xor_si128(zero, _mm_set1_epi32((int)(0xff000000 | gray[1] * 0x010101u))),
+		bits_lo = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10),
+		bits_hi = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 8 <= width; x += 8, dst += 8)
+  {
+    __m128i byte = _mm_set1_epi32(*src++);
+					// Eight samples
+
+    _mm_storeu_si128((__m128i *)dst, _mm_xor_si128(zero, _mm_and_si128(diff, _mm_cmpeq_epi32(_mm_and_si128(byte, bits_lo), bits_lo))));
+    _mm_storeu_si128((__m128i *)(dst + 4), _mm_xor_si128(zero, _mm_and_si128(diff, _mm_cmpeq_epi32(_mm_and_si128(byte, bits_hi), bits_hi))));
+  }
+
+  if (x < width)
+    convert_gray1(src, dst, width - x, gray);
+}
+
+//
+// 'expand_mask1_sse2()' - Expand 1-bit samples to A8 coverage with SSE2.
+//
+// Two source bytes are spread over 16 bytes by unpacking them with
+// themselves, then each byte tests its own bit.
+//
+
+static void
+expand_mask1_sse2(const uint8_t *src,	// I - Packed samples
+		  uint8_t       *dst,	// O - A8 coverage
+		  size_t        width,	// I - Number of pixels
+		  const uint8_t *alpha)	// I - Coverage of 0 and 1 bits
+{
+  const __m128i	zero = _mm_set1_epi8((char)alpha[0]),
+		diff = _mm_set1_epi8((char)(alpha[0] ^ alpha[1])),
+		bits = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+				     (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 16 <= width; x += 16, src += 2, dst += 16)
+  {
+    __m128i v = _mm_cvtsi32_si128(src[0] | src[1] << 8);
+					// Sixteen samples
+
+    v = _mm_unpacklo_epi8(v, v);
+    v = _mm_unpacklo_epi16(v, v);
+    v = _mm_unpacklo_epi32(v, v);
+
+    _mm_storeu_si128((__m128i *)dst, _mm_xor_si128(zero, _mm_and_si128(diff, _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits))));
+  }
+
+  if (x < width)
+    expand_mask1(src, dst, width - x, alpha);
+}
+
+//
+// 'convert_gray8_sse2()' - Convert 8-bit gray samples with SSE2.
+//
+
+static void
+convert_gray8_sse2(const uint8_t *src,	// I - Samples
+		   uint32_t      *dst,	// O - RGB24 pixels
+		   size_t        width,	// I - Number of pixels
+		   const uint8_t *gray)	// I - Unused
+{
+  const __m128i	alpha = _mm_set1_epi32((int)0xff000000);
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 16 <= width; x += 16, src += 16, dst += 16)
+  {
+    __m128i	v = _mm_loadu_si128((const __m128i *)src),
+		lo = _mm_unpacklo_epi8(v, v),
+		hi = _mm_unpackhi_epi8(v, v);
+
+    _mm_storeu_si128((__m128i *)dst, _mm_or_si128(alpha, _mm_unpacklo_epi16(lo, lo)));
+    _mm_storeu_si128((__m128i *)(dst + 4), _mm_or_si128(alpha, _mm_unpackhi_epi16(lo, lo)));
+    _mm_storeu_si128((__m128i *)(dst + 8), _mm_or_si128(alpha, _mm_unpacklo_epi16(hi, hi)));
+    _mm_storeu_si128((__m128i *)(dst + 12), _mm_or_si128(alpha, _mm_unpackhi_epi16(hi, hi)));
+  }
+
+  if (x < width)
+    convert_gray8(src, dst, width - x, gray);
+}
+
+//
+// 'convert_cmyk8_sse2()' - Convert 8-bit CMYK samples with SSE2.
+//
+// (255 - c) * (255 - k) / 255 is computed in 16 bits, with the division
+// done exactly as a multiply by 0x8081 and a shift by 23.
+//
+
+static void
+convert_cmyk8_sse2(const uint8_t *src,	// I - Samples
+		   uint32_t      *dst,	// O - RGB24 pixels
+		   size_t        width,	// I - Number of pixels
+		   const uint8_t *gray)	// I - Unused
+{
+  const __m128i	zero = _mm_setzero_si128(),
+		ones = _mm_set1_epi16(255),
+		div255 = _mm_set1_epi16((short)0x8081),
+		alpha = _mm_set1_epi32((int)0xff000000);
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 4 <= width; x += 4, src += 16, dst += 4)
+  {
+    __m128i	v = _mm_loadu_si128((const __m128i *)src),
+		lo = _mm_sub_epi16(ones, _mm_unpacklo_epi8(v, zero)),
+		hi = _mm_sub_epi16(ones, _mm_unpackhi_epi8(v, zero));
+					// Inverse CMYK of two pixels each
+
+    // Multiply by the inverse black of each pixel
+    lo = _mm_mullo_epi16(lo, _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
+    hi = _mm_mullo_epi16(hi, _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
+    lo = _mm_srli_epi16(_mm_mulhi_epu16(lo, div255), 7);
+    hi = _mm_srli_epi16(_mm_mulhi_epu16(hi, div255), 7);
+
+    // Reorder to B, G, R, A and pack
+    lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+    hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+
+    _mm_storeu_si128((__m128i *)dst, _mm_or_si128(alpha, _mm_packus_epi16(lo, hi)));
+  }
+
+  if (x < width)
+    convert_cmyk8(src, dst, width - x, gray);
+}
+
+//
+// 'shrink_sum_sse2()' - Add a row of bytes to the column sums with SSE2.
+//
+
+static void
+shrink_sum_sse2(const uint8_t *src,	// I - Pixel bytes
+		uint16_t      *sums,	// IO - Sum of each byte
+		size_t        count)	// I - Number of bytes
+{
+  const __m128i	zero = _mm_setzero_si128();
+  size_t	i;			// Current byte
+
+  for (i = 0; i + 16 <= count; i += 16, src += 16, sums += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)src);
+					// Sixteen bytes
+
+    _mm_storeu_si128((__m128i *)sums, _mm_add_epi16(_mm_loadu_si128((const __m128i *)sums), _mm_unpacklo_epi8(v, zero)));
+    _mm_storeu_si128((__m128i *)(sums + 8), _mm_add_epi16(_mm_loadu_si128((const __m128i *)(sums + 8)), _mm_unpackhi_epi8(v, zero)));
+  }
+
+  if (i < count)
+    shrink_sum(src, sums, count - i);
+}
+
+//
+// 'shrink_box_sse2()' - Average runs of summed pixels with SSE2.
+//
+// SSE2 only multiplies even 32-bit lanes, so the odd lanes are shifted
+// down, multiplied separately and shifted back.
+//
+
+static void
+shrink_box_sse2(const uint16_t *sums,	// I - Column sums, 4 per pixel
+		uint32_t       *dst,	// O - Pixels
+		size_t         width,	// I - Number of pixels
+		int            factor,	// I - Pixels summed per pixel
+		uint32_t       scale)	// I - Reciprocal of box size, 24-bit fraction
+{
+  const __m128i	zero = _mm_setzero_si128(),
+		mul = _mm_set1_epi32((int)scale),
+		round = _mm_set1_epi64x(0x800000),
+		even = _mm_set_epi32(0, -1, 0, -1);
+
+  for (size_t x = 0; x < width; x ++)
+  {
+    __m128i	total = zero,		// Sum of each byte over the box
+		lo, hi;			// Even and odd products
+
+    for (int i = 0; i < factor; i ++, sums += 4)
+      total = _mm_add_epi32(total, _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)sums), zero));
+
+    lo    = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(total, mul), round), 24);
+    hi    = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(total, 32), mul), round), 24);
+    total = _mm_or_si128(_mm_and_si128(lo, even), _mm_slli_epi64(hi, 32));
+    total = _mm_packs_epi32(total, total);
+
+    dst[x] = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(total, total));
+  }
+}
+#endif // IMAGE_SSE2
+
+
+#ifdef IMAGE_X86
+//
+// 'convert_gray1_avx2()' - Convert 1-bit gray samples with AVX2.
+//
+
+IMAGE_AVX2 static void
+convert_gray1_avx2(const uint8_t *src,	// I - Packed samples
+		   uint32_t      *dst,	// O - RGB24 pixels
+		   size_t        width,	// I - Number of pixels
+		   const uint8_t *gray)	// I - Gray level of 0 and 1 bits
+{
+  const __m256i	zero = _mm256_set1_epi32((int)(0xff000000 | gray[0] * 0x010101u)),
+		one = _mm256_set1_epi32((int)(0xff000000 | gray[1] * 0x010101u)),
+		bits = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 8 <= width; x += 8, dst += 8)
+  {
+    __m256i byte = _mm256_set1_epi32(*src++);
+					// Eight samples
+
+    _mm256_storeu_si256((__m256i *)dst, _mm256_blendv_epi8(zero, one, _mm256_cmpeq_epi32(_mm256_and_si256(byte, bits), bits)));
+  }
+
+  if (x < width)
+    convert_gray1(src, dst, width - x, gray);
+}
+
+//
+// 'expand_mask1_avx2()' - Expand 1-bit samples to A8 coverage with AVX2.
+//
+
+IMAGE_AVX2 static void
+expand_mask1_avx2(const uint8_t *src,	// I - Packed samples
+		  uint8_t       *dst,	// O - A8 coverage
+		  size_t        width,	// I - Number of pixels
+		  const uint8_t *alpha)	// I - Coverage of 0 and 1 bits
+{
+  const __m256i	zero = _mm256_set1_epi8((char)alpha[0]),
+		one = _mm256_set1_epi8((char)alpha[1]),
+		spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+					  2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3),
+		bits = _mm256_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+					(char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+					(char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+					(char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 32 <= width; x += 32, src += 4, dst += 32)
+  {
+    uint32_t	word;			// Thirty-two samples
+    __m256i	v;			// Samples spread to bytes
+
+    memcpy(&word, src, 4);
+
+    v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)word), spread);
+
+    _mm256_storeu_si256((__m256i *)dst, _mm256_blendv_epi8(zero, one, _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits)));
+  }
+
+  if (x < width)
+    expand_mask1(src, dst, width - x, alpha);
+}
+
+//
+// 'convert_gray8_avx2()' - Convert 8-bit gray samples with AVX2.
+//
+
+IMAGE_AVX2 static void
+convert_gray8_avx2(const uint8_t *src,	// I - Samples
+		   uint32_t      *dst,	// O - RGB24 pixels
+		   size_t        width,	// I - Number of pixels
+		   const uint8_t *gray)	// I - Unused
+{
+  const __m256i	alpha = _mm256_set1_epi32((int)0xff000000),
+		spread = _mm256_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+					  0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 16 <= width; x += 16, src += 16, dst += 16)
+  {
+    // Each 128-bit lane spreads the first 4 gray bytes it is given
+    __m128i	v = _mm_loadu_si128((const __m128i *)src);
+    __m256i	lo = _mm256_inserti128_si256(_mm256_castsi128_si256(v), _mm_srli_si128(v, 4), 1),
+		hi = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_srli_si128(v, 8)), _mm_srli_si128(v, 12), 1);
+
+    _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(alpha, _mm256_shuffle_epi8(lo, spread)));
+    _mm256_storeu_si256((__m256i *)(dst + 8), _mm256_or_si256(alpha, _mm256_shuffle_epi8(hi, spread)));
+  }
+
+  if (x < width)
+    convert_gray8(src, dst, width - x, gray);
+}
+
+//
+// 'convert_rgb8_avx2()' - Convert 8-bit RGB samples with AVX2.
+//
+
+IMAGE_AVX2 static void
+convert_rgb8_avx2(const uint8_t *src,	// I - Samples
+		  uint32_t      *dst,	// O - RGB24 pixels
+		  size_t        width,	// I - Number of pixels
+		  const uint8_t *gray)	// I - Unused
+{
+  const __m256i	alpha = _mm256_set1_epi32((int)0xff000000),
+		order = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+					 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+  size_t	x;			// Current pixel
+
+  // Each half loads 16 bytes for 4 pixels, so stop 4 bytes early
+  for (x = 0; x + 10 <= width; x += 8, src += 24, dst += 8)
+  {
+    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)src)), _mm_loadu_si128((const __m128i *)(src + 12)), 1);
+
+    _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(alpha, _mm256_shuffle_epi8(v, order)));
+  }
+
+  if (x < width)
+    convert_rgb8(src, dst, width - x, gray);
+}
+
+//
+// 'convert_cmyk8_avx2()' - Convert 8-bit CMYK samples with AVX2.
+//
+
+IMAGE_AVX2 static void
+convert_cmyk8_avx2(const uint8_t *src,	// I - Samples
+		   uint32_t      *dst,	// O - RGB24 pixels
+		   size_t        width,	// I - Number of pixels
+		   const uint8_t *gray)	// I - Unused
+{
+  const __m256i	zero = _mm256_setzero_si256(),
+		ones = _mm256_set1_epi16(255),
+		div255 = _mm256_set1_epi16((short)0x8081),
+		alpha = _mm256_set1_epi32((int)0xff000000);
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 8 <= width; x += 8, src += 32, dst += 8)
+  {
+    __m256i	v = _mm256_loadu_si256((const __m256i *)src),
+		lo = _mm256_sub_epi16(ones, _mm256_unpacklo_epi8(v, zero)),
+		hi = _mm256_sub_epi16(ones, _mm256_unpackhi_epi8(v, zero));
+					// Inverse CMYK of four pixels each
+
+    lo = _mm256_mullo_epi16(lo, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
+    hi = _mm256_mullo_epi16(hi, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
+    lo = _mm256_srli_epi16(_mm256_mulhi_epu16(lo, div255), 7);
+    hi = _mm256_srli_epi16(_mm256_mulhi_epu16(hi, div255), 7);
+    lo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+    hi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+
+    // Unpacking and packing both work within 128-bit lanes, so the pixels
+    // come out in order
+    _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(alpha, _mm256_packus_epi16(lo, hi)));
+  }
+
+  if (x < width)
+    convert_cmyk8(src, dst, width - x, gray);
+}
+
+//
+// 'convert_rgb16_avx2()' - Convert 16-bit RGB samples with AVX2.
+//
+
+IMAGE_AVX2 static void
+convert_rgb16_avx2(const uint8_t *src,	// I - Big-endian samples
+		   uint32_t      *dst,	// O - RGB24 pixels
+		   size_t        width,	// I - Number of pixels
+		   const uint8_t *gray)	// I - Unused
+{
+  const __m128i	high = _mm_set1_epi16(0xff);
+  const __m256i	alpha = _mm256_set1_epi32((int)0xff000000),
+		order = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+					 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 8 <= width; x += 8, src += 48, dst += 8)
+  {
+    // The first byte of each big-endian sample is the low byte of a lane
+    __m128i	a = _mm_packus_epi16(_mm_and_si128(_mm_loadu_si128((const __m128i *)src), high), _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 16)), high)),
+		b = _mm_packus_epi16(_mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 32)), high), high);
+    __m256i	v = _mm256_inserti128_si256(_mm256_castsi128_si256(a), _mm_alignr_epi8(b, a, 12), 1);
+
+    _mm256_storeu_si256((__m256i *)dst, _mm256_or_si256(alpha, _mm256_shuffle_epi8(v, order)));
+  }
+
+  if (x < width)
+    convert_rgb16(src, dst, width - x, gray);
+}
+
+//
+// 'shrink_sum_avx2()' - Add a row of bytes to the column sums with AVX2.
+//
+
+IMAGE_AVX2 static void
+shrink_sum_avx2(const uint8_t *src,	// I - Pixel bytes
+		uint16_t      *sums,	// IO - Sum of each byte
+		size_t        count)	// I - Number of bytes
+{
+  size_t	i;			// Current byte
+
+  for (i = 0; i + 32 <= count; i += 32, src += 32, sums += 32)
+  {
+    _mm256_storeu_si256((__m256i *)sums, _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)sums), _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)src))));
+    _mm256_storeu_si256((__m256i *)(sums + 16), _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(sums + 16)), _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + 16)))));
+  }
+
+  if (i < count)
+    shrink_sum(src, sums, count - i);
+}
+
+//
+// 'shrink_box_avx2()' - Average runs of summed pixels with AVX2.
+//
+// Two pixels are averaged at once, one in each 128-bit lane.
+//
+
+IMAGE_AVX2 static void
+shrink_box_avx2(const uint16_t *sums,	// I - Column sums, 4 per pixel
+		uint32_t       *dst,	// O - Pixels
+		size_t         width,	// I - Number of pixels
+		int            factor,	// I - Pixels summed per pixel
+		uint32_t       scale)	// I - Reciprocal of box size, 24-bit fraction
+{
+  const __m256i	mul = _mm256_set1_epi32((int)scale),
+		round = _mm256_set1_epi32(0x800000);
+  const uint16_t *next = sums + 4 * factor;
+					// Sums of the second pixel
+  size_t	x;			// Current pixel
+
+  for (x = 0; x + 2 <= width; x += 2, dst += 2, sums += 8 * factor, next += 8 * factor)
+  {
+    __m256i	total = _mm256_setzero_si256();
+					// Sum of each byte over both boxes
+    __m128i	v;			// Packed bytes
+
+    for (int i = 0; i < factor; i ++)
+      total = _mm256_add_epi32(total, _mm256_cvtepu16_epi32(_mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(sums + 4 * i)), _mm_loadl_epi64((const __m128i *)(next + 4 * i)))));
+
+    // The products fit in 32 bits for the box sizes image_shrink() allows
+    total = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(total, mul), round), 24);
+    v     = _mm_packus_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+
+    _mm_storel_epi64((__m128i *)dst, _mm_packus_epi16(v, v));
+  }
+
+  if (x < width)
+    shrink_box(sums, dst, width - x, factor, scale);
+}
+#endif // IMAGE_X86
+
+
+//
+// 'simd_init()' - Find the best instruction set of the CPU.
+//
+
+static void
+simd_init(void)
+{
+#ifdef IMAGE_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    simd_level = PDFRIP_SIMD_AVX2;
+#  ifdef IMAGE_SSE2
+  else if (__builtin_cpu_supports("sse2"))
+    simd_level = PDFRIP_SIMD_SSE2;
+#  endif // IMAGE_SSE2
+#endif // IMAGE_X86
+}
+
+//
+// 'image_simd_level()' - Get the best instruction set for image conversion.
+//
+
+pdfrip_simd_t				  // O - Instruction set
+image_simd_level(void)
+{
+  pthread_once(&simd_once, simd_init);
+
+  return (simd_level);
+}
+
+//
+// 'image_convert_func()' - Get a row conversion kernel.
+//
+// Returns the kernel for exactly the given instruction set, or NULL if
+// there is none or the CPU does not support it.  Pass image_simd_level()
+// for the fastest kernel, which falls back to the scalar one.
+//
+
+pdfrip_convert_cb_t			  // O - Kernel or NULL
+image_convert_func(
+    pdfrip_convert_t kernel,		// I - Kind of samples
+    pdfrip_simd_t    simd)		// I - Instruction set
+{
+  static const pdfrip_convert_cb_t scalar[PDFRIP_CONVERT_MAX] =
+  {					// Reference kernels
+    convert_gray1, convert_gray8, convert_rgb8, convert_cmyk8, convert_rgb16
+  };
+#ifdef IMAGE_SSE2
+  static const pdfrip_convert_cb_t sse2[PDFRIP_CONVERT_MAX] =
+  {					// SSE2 kernels
+    convert_gray1_sse2, convert_gray8_sse2, NULL, convert_cmyk8_sse2, NULL
+  };
+#endif // IMAGE_SSE2
+#ifdef IMAGE_X86
+  static const pdfrip_convert_cb_t avx2[PDFRIP_CONVERT_MAX] =
+  {					// AVX2 kernels
+    convert_gray1_avx2, convert_gray8_avx2, convert_rgb8_avx2, convert_cmyk8_avx2, convert_rgb16_avx2
+  };
+#endif // IMAGE_X86
+
+  if ((unsigned)kernel >= PDFRIP_CONVERT_MAX || simd > image_simd_level())
+    return (NULL);
+
+  switch (simd)
+  {
+    case PDFRIP_SIMD_NONE :
+        return (scalar[kernel]);
+#ifdef IMAGE_SSE2
+    case PDFRIP_SIMD_SSE2 :
+        return (sse2[kernel]);
+#endif // IMAGE_SSE2
+#ifdef IMAGE_X86
+    case PDFRIP_SIMD_AVX2 :
+        return (avx2[kernel]);
+#endif // IMAGE_X86
+    default :
+        return (NULL);
+  }
+}
+
+//
+// 'image_expand_func()' - Get a 1-bit to A8 expansion kernel.
+//
+// Returns the kernel for exactly the given instruction set, or NULL if
+// there is none or the CPU does not support it.
+//
+
+pdfrip_expand_cb_t			  // O - Kernel or NULL
+image_expand_func(pdfrip_simd_t simd)	// I - Instruction set
+{
+  if (simd > image_simd_level())
+    return (NULL);
+
+  switch (simd)
+  {
+    case PDFRIP_SIMD_NONE :
+        return (expand_mask1);
+#ifdef IMAGE_SSE2
+    case PDFRIP_SIMD_SSE2 :
+        return (expand_mask1_sse2);
+#endif // IMAGE_SSE2
+#ifdef IMAGE_X86
+    case PDFRIP_SIMD_AVX2 :
+        return (expand_mask1_avx2);
+#endif // IMAGE_X86
+    default :
+        return (NULL);
+  }
+}
+
+//
+// 'image_shrink()' - Reduce an RGB24 or ARGB32 surface with a box filter.
+//
+// Each pixel of the new surface averages a block of x_factor by y_factor
+// pixels; blocks at the right and bottom edges may be smaller.  Factors
+// must be from 1 to PDFRIP_IMAGE_MAX_SHRINK.  The kernels for 'simd' are
+// used, falling back to the scalar ones.
+//
+
+cairo_surface_t *			  // O - New surface or NULL
+image_shrink(cairo_surface_t *src,	// I - RGB24 or ARGB32 surface
+	     int             x_factor,	// I - Columns per new pixel
+	     int             y_factor,	// I - Rows per new pixel
+	     pdfrip_simd_t   simd)	// I - Instruction set
+{
+  cairo_surface_t	*dst;		// New surface
+  cairo_format_t	format = cairo_image_surface_get_format(src);
+  int			width = cairo_image_surface_get_width(src),
+			height = cairo_image_surface_get_height(src),
+			src_stride = cairo_image_surface_get_stride(src),
+			dst_width = (width + x_factor - 1) / x_factor,
+			dst_height = (height + y_factor - 1) / y_factor,
+			dst_stride,	// Bytes per new row
+			full = width / x_factor,
+					// Whole blocks per row
+			edge = width - full * x_factor;
+					// Columns in the partial block
+  const uint8_t		*src_data;	// Source pixels
+  uint8_t		*dst_data;	// New pixels
+  uint16_t		*sums;		// Column sums of a block row
+  void			(*sum)(const uint8_t *, uint16_t *, size_t) = shrink_sum;
+  void			(*box)(const uint16_t *, uint32_t *, size_t, int, uint32_t) = shrink_box;
+					// Kernels
+
+  if ((format != CAIRO_FORMAT_RGB24 && format != CAIRO_FORMAT_ARGB32) || x_factor < 1 || x_factor > PDFRIP_IMAGE_MAX_SHRINK || y_factor < 1 || y_factor > PDFRIP_IMAGE_MAX_SHRINK || width < 1 || height < 1)
+    return (NULL);
+
+  if (simd > image_simd_level())
+    simd = image_simd_level();
+
+#ifdef IMAGE_SSE2
+  if (simd == PDFRIP_SIMD_SSE2)
+  {
+    sum = shrink_sum_sse2;
+    box = shrink_box_sse2;
+  }
+#endif // IMAGE_SSE2
+#ifdef IMAGE_X86
+  if (simd == PDFRIP_SIMD_AVX2)
+  {
+    sum = shrink_sum_avx2;
+    box = shrink_box_avx2;
+  }
+#endif // IMAGE_X86
+
+  dst = cairo_image_surface_create(format, dst_width, dst_height);
+  if (cairo_surface_status(dst) != CAIRO_STATUS_SUCCESS || (sums = malloc((size_t)width * 4 * sizeof(uint16_t))) == NULL)
+  {
+    cairo_surface_destroy(dst);
+    return (NULL);
+  }
+
+  cairo_surface_flush(src);
+
+  src_data   = cairo_image_surface_get_data(src);
+  dst_data   = cairo_image_surface_get_data(dst);
+  dst_stride = cairo_image_surface_get_stride(dst);
+
+  for (int y = 0; y < height; y += y_factor, dst_data += dst_stride)
+  {
+    int	rows = height - y < y_factor ? height - y : y_factor;
+					// Rows in this block row
+
+    memset(sums, 0, (size_t)width * 4 * sizeof(uint16_t));
+
+    for (int i = 0; i < rows; i ++)
+      (sum)(src_data + (size_t)(y + i) * (size_t)src_stride, sums, (size_t)width * 4);
+
+    (box)(sums, (uint32_t *)dst_data, (size_t)full, x_factor, (0x1000000 + x_factor * rows / 2) / (uint32_t)(x_factor * rows));
+
+    if (edge)
+      (box)(sums + (size_t)full * (size_t)x_factor * 4, (uint32_t *)dst_data + full, 1, edge, (0x1000000 + edge * rows / 2) / (uint32_t)(edge * rows));
+  }
+
+  free(sums);
+  cairo_surface_mark_dirty(dst);
+
+  return (dst);
+}
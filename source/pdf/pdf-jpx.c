@@ -0,0 +1,505 @@
+//
+// Copyright 2025-2026 Uddhav Phatak <uddhavphatak@gmail.com>
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+//
+// JPXDecode (JPEG 2000) image decoder, using OpenJPEG when built with
+// HAVE_OPENJPEG.
+//
+// JPEG 2000 data is a wavelet pyramid, so an image shown smaller than its
+// size is decoded with the finest resolution levels discarded, at 1/2,
+// 1/4 ... 1/32 of its size, and only the code blocks of the visible area
+// are decoded when an area is given.  The decoded components are handed
+// out a row at a time as interleaved 8-bit samples, like a DCTDecode
+// image, with rows and columns outside the decoded area left at zero.
+//
+// The color space of the PDF image takes precedence over the one in the
+// JPEG 2000 data, which is only used when /ColorSpace is absent.  Alpha
+// channels (/SMaskInData) are not used.
+//
+
+#include "pdfops-private.h"
+#include <string.h>
+#ifdef HAVE_OPENJPEG
+#  include <openjpeg.h>
+#endif // HAVE_OPENJPEG
+
+extern int g_verbose;
+
+#ifdef HAVE_OPENJPEG
+// In-memory JPEG 2000 data
+typedef struct jpx_data_s
+{
+  uint8_t	*data;			// Encoded data
+  size_t	length,			// Length of data
+		pos;			// Read position
+} jpx_data_t;
+
+// JPEG 2000 decoder
+struct pdfrip_jpx_s
+{
+  opj_image_t	*image;			// Decoded components
+  int		width,			// Width of the reduced image
+		height,			// Height of the reduced image
+		num_components,		// Components per pixel
+		x,			// Left of the decoded area
+		y,			// Top of the decoded area
+		row;			// Next row
+  bool		sycc;			// Convert YCbCr to RGB?
+};
+
+
+//
+// 'jpx_message()' - Show an OpenJPEG error.
+//
+
+static void
+jpx_message(const char *msg,		// I - Message with a newline
+	    void       *data)		// I - Unused
+{
+  (void)data;
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: JPEG 2000: %s", msg);
+}
+
+//
+// 'jpx_read()' - Read JPEG 2000 data for OpenJPEG.
+//
+
+static OPJ_SIZE_T			  // O - Bytes read or -1 at the end
+jpx_read(void       *buffer,		// I - Buffer
+	 OPJ_SIZE_T bytes,		// I - Size of buffer
+	 void       *data)		// I - JPEG 2000 data
+{
+  jpx_data_t	*jd = (jpx_data_t *)data;
+					// JPEG 2000 data
+
+  if (jd->pos >= jd->length)
+    return ((OPJ_SIZE_T)-1);
+
+  if (bytes > jd->length - jd->pos)
+    bytes = jd->length - jd->pos;
+
+  memcpy(buffer, jd->data + jd->pos, bytes);
+  jd->pos += bytes;
+
+  return (bytes);
+}
+
+//
+// 'jpx_skip()' - Skip JPEG 2000 data for OpenJPEG.
+//
+
+static OPJ_OFF_T			  // O - Bytes skipped
+jpx_skip(OPJ_OFF_T bytes,		// I - Bytes to skip
+	 void      *data)		// I - JPEG 2000 data
+{
+  jpx_data_t	*jd = (jpx_data_t *)data;
+					// JPEG 2000 data
+
+  if (bytes < 0 || (size_t)bytes > jd->length - jd->pos)
+    bytes = (OPJ_OFF_T)(jd->length - jd->pos);
+
+  jd->pos += (size_t)bytes;
+
+  return (bytes);
+}
+
+//
+// 'jpx_seek()' - Seek in the JPEG 2000 data for OpenJPEG.
+//
+
+static OPJ_BOOL				  // O - OPJ_TRUE on success
+jpx_seek(OPJ_OFF_T pos,			// I - New position
+	 void      *data)		// I - JPEG 2000 data
+{
+  jpx_data_t	*jd = (jpx_data_t *)data;
+					// JPEG 2000 data
+
+  if (pos < 0 || (size_t)pos > jd->length)
+    return (OPJ_FALSE);
+
+  jd->pos = (size_t)pos;
+
+  return (OPJ_TRUE);
+}
+
+//
+// 'jpx_load()' - Read the raw data of a JPXDecode stream.
+//
+
+static bool				  // O - true on success
+jpx_load(pdfio_obj_t *obj,		// I - Image object
+	 jpx_data_t  *jd)		// O - JPEG 2000 data
+{
+  pdfio_stream_t	*st;		// Raw stream
+  size_t		alloc;		// Allocated size of data
+  ssize_t		bytes;		// Bytes read
+
+  memset(jd, 0, sizeof(jpx_data_t));
+
+  if ((st = pdfioObjOpenStream(obj, false)) == NULL)
+    return (false);
+
+  if ((alloc = pdfioObjGetLength(obj)) < 4096)
+    alloc = 4096;
+
+  if ((jd->data = malloc(alloc)) == NULL)
+  {
+    pdfioStreamClose(st);
+    return (false);
+  }
+
+  while ((bytes = pdfioStreamRead(st, jd->data + jd->length, alloc - jd->length)) > 0)
+  {
+    jd->length += (size_t)bytes;
+
+    if (jd->length == alloc)
+    {
+      uint8_t *temp = realloc(jd->data, alloc * 2);
+					// Larger buffer
+
+      if (!temp)
+        break;
+
+      jd->data = temp;
+      alloc    *= 2;
+    }
+  }
+
+  pdfioStreamClose(st);
+
+  return (jd->length > 0);
+}
+
+//
+// 'jpx_ceil_pow2()' - Divide by a power of 2, rounding up.
+//
+
+static int				  // O - Quotient
+jpx_ceil_pow2(int value,		// I - Value
+	      int power)		// I - Power of 2
+{
+  return ((value + (1 << power) - 1) >> power);
+}
+
+//
+// 'jpx_sample()' - Get a component sample as 8 bits.
+//
+
+static int				  // O - Sample, 0 to 255
+jpx_sample(opj_image_comp_t *comp,	// I - Component
+	   int              x,		// I - Column in the component
+	   int              y)		// I - Row in the component
+{
+  int	v = comp->data[(size_t)y * comp->w + (size_t)x];
+					// Sample
+  int	prec = (int)comp->prec;		// Bits per sample
+
+  if (comp->sgnd)
+    v += 1 << (prec - 1);
+
+  if (prec > 8)
+    v >>= prec - 8;
+  else if (prec < 8)
+    v = v * 255 / ((1 << prec) - 1);
+
+  return (v < 0 ? 0 : v > 255 ? 255 : v);
+}
+#endif // HAVE_OPENJPEG
+
+
+//
+// 'jpx_open()' - Decode a JPXDecode image.
+//
+// The image is reduced by the largest power of 2 up to the given scale
+// that its resolution levels allow.  The area, if not NULL, is the part
+// of the image to decode as fractions of its width and height from the
+// top left corner.  The number of components is 0 to use all the color
+// channels of the data.
+//
+
+pdfrip_jpx_t *				  // O - Decoder or NULL
+jpx_open(pdfio_obj_t        *obj,	// I - Image object
+	 int                num_components,// I - Components wanted or 0
+	 int                scale,	// I - Largest reduction wanted
+	 const pdfio_rect_t *area,	// I - Area to decode or NULL for all
+	 pdfrip_jpx_info_t  *info)	// O - Size and components
+{
+#ifdef HAVE_OPENJPEG
+  pdfrip_jpx_t		*jpx = NULL;	// Decoder
+  jpx_data_t		jd;		// JPEG 2000 data
+  opj_stream_t		*stream = NULL;	// OpenJPEG stream
+  opj_codec_t		*codec = NULL;	// OpenJPEG decoder
+  opj_dparameters_t	params;		// Decoding parameters
+  opj_image_t		*image = NULL;	// Image
+  opj_image_comp_t	*comp;		// First component
+  int			reduce = 0,	// Resolution levels discarded
+			ix0, iy0,	// Top left of the full image
+			ix1, iy1,	// Bottom right of the full image
+			n;		// Color components
+  static const uint8_t	jp2_sig[12] = { 0, 0, 0, 12, 'j', 'P', ' ', ' ', '\r', '\n', 0x87, '\n' };
+					// JP2 file signature
+
+  if (!jpx_load(obj, &jd))
+    return (NULL);
+
+  if (jd.length >= 12 && !memcmp(jd.data, jp2_sig, 12))
+    codec = opj_create_decompress(OPJ_CODEC_JP2);
+  else if (jd.length >= 4 && jd.data[0] == 0xff && jd.data[1] == 0x4f && jd.data[2] == 0xff && jd.data[3] == 0x51)
+    codec = opj_create_decompress(OPJ_CODEC_J2K);
+
+  if (!codec)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Unknown JPEG 2000 data format.\n");
+    goto error;
+  }
+
+  opj_set_error_handler(codec, jpx_message, NULL);
+
+  // The /ColorSpace of the image replaces any in the JPEG 2000 data
+  opj_set_default_decoder_parameters(&params);
+  if (pdfioDictGetType(pdfioObjGetDict(obj), "ColorSpace") != PDFIO_VALTYPE_NONE)
+    params.flags |= OPJ_DPARAMETERS_IGNORE_PCLR_CMAP_CDEF_FLAG;
+
+  if (!opj_setup_decoder(codec, &params))
+    goto error;
+
+  if ((stream = opj_stream_default_create(OPJ_TRUE)) == NULL)
+    goto error;
+
+  opj_stream_set_user_data(stream, &jd, NULL);
+  opj_stream_set_user_data_length(stream, jd.length);
+  opj_stream_set_read_function(stream, jpx_read);
+  opj_stream_set_skip_function(stream, jpx_skip);
+  opj_stream_set_seek_function(stream, jpx_seek);
+
+  if (!opj_read_header(stream, codec, &image) || image->numcomps == 0 || image->x1 <= image->x0 || image->y1 <= image->y0)
+    goto error;
+
+  ix0 = (int)image->x0;
+  iy0 = (int)image->y0;
+  ix1 = (int)image->x1;
+  iy1 = (int)image->y1;
+
+  // Discard the resolution levels that the scale does not need
+  while ((2 << reduce) <= scale && (2 << reduce) <= PDFRIP_JPX_MAX_SCALE)
+    reduce ++;
+
+  while (reduce > 0 && !opj_set_decoded_resolution_factor(codec, (OPJ_UINT32)reduce))
+    reduce --;
+
+  if (area)
+  {
+    // Decode the visible area plus a reduced pixel of margin
+    int margin = 1 << reduce;		// Margin in full size pixels
+    int ax0 = ix0 + (int)((ix1 - ix0) * area->x1) - margin,
+	ay0 = iy0 + (int)((iy1 - iy0) * area->y1) - margin,
+	ax1 = ix0 + (int)((ix1 - ix0) * area->x2 + 1.0) + margin,
+	ay1 = iy0 + (int)((iy1 - iy0) * area->y2 + 1.0) + margin;
+					// Area to decode
+
+    if (ax0 < ix0)
+      ax0 = ix0;
+    if (ay0 < iy0)
+      ay0 = iy0;
+    if (ax1 > ix1)
+      ax1 = ix1;
+    if (ay1 > iy1)
+      ay1 = iy1;
+
+    if (ax0 >= ax1 || ay0 >= ay1 || !opj_set_decode_area(codec, image, ax0, ay0, ax1, ay1))
+      goto error;
+  }
+
+  if ((size_t)jpx_ceil_pow2(image->x1 - image->x0, reduce) * (size_t)jpx_ceil_pow2(image->y1 - image->y0, reduce) > PDFRIP_IMAGE_MAX_PIXELS)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: Skipping JPEG 2000 image, %ux%u pixels at 1/%d scale is too large.\n", image->x1 - image->x0, image->y1 - image->y0, 1 << reduce);
+    goto error;
+  }
+
+  if (!opj_decode(codec, stream, image) || !opj_end_decompress(codec, stream))
+    goto error;
+
+  // Color components, leaving out alpha channels when the data has them
+  if (num_components > 0)
+  {
+    n = num_components;
+  }
+  else
+  {
+    for (n = 0; n < (int)image->numcomps && !image->comps[n].alpha; n ++);
+
+    if (n == 2)
+      n = 1;
+  }
+
+  if ((n != 1 && n != 3 && n != 4) || n > (int)image->numcomps)
+  {
+    if (g_verbose)
+      fprintf(stderr, "DEBUG: JPEG 2000 image has %u components, expected %d.\n", image->numcomps, n);
+    goto error;
+  }
+
+  for (int i = 0; i < n; i ++)
+  {
+    if (!image->comps[i].data || image->comps[i].prec < 1 || image->comps[i].prec > 16)
+      goto error;
+  }
+
+  if ((jpx = calloc(1, sizeof(pdfrip_jpx_t))) == NULL)
+    goto error;
+
+  // Size of the whole reduced image, and where the decoded area is in it
+  comp                = image->comps;
+  jpx->image          = image;
+  jpx->num_components = n;
+  jpx->width          = jpx_ceil_pow2((ix1 + (int)comp->dx - 1) / (int)comp->dx, reduce) - jpx_ceil_pow2((ix0 + (int)comp->dx - 1) / (int)comp->dx, reduce);
+  jpx->height         = jpx_ceil_pow2((iy1 + (int)comp->dy - 1) / (int)comp->dy, reduce) - jpx_ceil_pow2((iy0 + (int)comp->dy - 1) / (int)comp->dy, reduce);
+  jpx->x              = jpx_ceil_pow2((int)comp->x0, reduce) - jpx_ceil_pow2((ix0 + (int)comp->dx - 1) / (int)comp->dx, reduce);
+  jpx->y              = jpx_ceil_pow2((int)comp->y0, reduce) - jpx_ceil_pow2((iy0 + (int)comp->dy - 1) / (int)comp->dy, reduce);
+  jpx->sycc           = n == 3 && !num_components && image->color_space == OPJ_CLRSPC_SYCC;
+
+  if (jpx->width <= 0 || jpx->height <= 0 || jpx->width > PDFRIP_IMAGE_MAX_WIDTH)
+  {
+    free(jpx);
+    jpx = NULL;
+    goto error;
+  }
+
+  info->width          = jpx->width;
+  info->height         = jpx->height;
+  info->num_components = n;
+  info->scale          = 1 << reduce;
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: Decoded %ux%u of %dx%d JPEG 2000 image at 1/%d scale.\n", comp->w, comp->h, jpx->width, jpx->height, info->scale);
+
+  opj_stream_destroy(stream);
+  opj_destroy_codec(codec);
+  free(jd.data);
+
+  return (jpx);
+
+  error:
+
+  if (image)
+    opj_image_destroy(image);
+  if (stream)
+    opj_stream_destroy(stream);
+  if (codec)
+    opj_destroy_codec(codec);
+  free(jd.data);
+
+  return (NULL);
+
+#else
+  (void)obj;
+  (void)num_components;
+  (void)scale;
+  (void)area;
+  (void)info;
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: JPXDecode images need OpenJPEG, which this build does not have.\n");
+
+  return (NULL);
+#endif // HAVE_OPENJPEG
+}
+
+//
+// 'jpx_read_row()' - Get the next row of a JPXDecode image.
+//
+// Rows are width * num_components bytes.  Returns false, with a zero row,
+// after the last row.
+//
+
+bool					  // O - true if a row was read
+jpx_read_row(pdfrip_jpx_t *jpx,		// I - Decoder
+	     uint8_t      *row)		// O - Interleaved 8-bit samples
+{
+#ifdef HAVE_OPENJPEG
+  opj_image_comp_t	*comps = jpx->image->comps;
+					// Components
+  int			y = jpx->row - jpx->y,
+					// Row in the decoded area
+			n = jpx->num_components;
+					// Components per pixel
+
+  memset(row, 0, (size_t)jpx->width * (size_t)n);
+
+  if (jpx->row >= jpx->height)
+    return (false);
+
+  jpx->row ++;
+
+  if (y < 0 || y >= (int)comps[0].h)
+    return (true);
+
+  for (int c = 0; c < n; c ++)
+  {
+    opj_image_comp_t	*comp = comps + c;
+					// Component
+    int			cy = comp->h == comps[0].h ? y : (int)((int64_t)y * comp->h / comps[0].h);
+					// Row in the component
+    uint8_t		*ptr = row + (size_t)jpx->x * (size_t)n + (size_t)c;
+					// Output sample
+
+    for (int x = 0; x < (int)comps[0].w && x + jpx->x < jpx->width; x ++, ptr += n)
+      *ptr = (uint8_t)jpx_sample(comp, comp->w == comps[0].w ? x : (int)((int64_t)x * comp->w / comps[0].w), cy);
+  }
+
+  if (jpx->sycc)
+  {
+    // sYCC, ITU-R BT.601 full range
+    uint8_t *ptr = row + (size_t)jpx->x * 3;
+					// Output pixel
+
+    for (int x = 0; x < (int)comps[0].w && x + jpx->x < jpx->width; x ++, ptr += 3)
+    {
+      int	yy = ptr[0],
+		cb = ptr[1] - 128,
+		cr = ptr[2] - 128;
+      int	r = yy + ((91881 * cr) >> 16),
+		g = yy - ((22554 * cb + 46802 * cr) >> 16),
+		b = yy + ((116130 * cb) >> 16);
+
+      ptr[0] = (uint8_t)(r < 0 ? 0 : r > 255 ? 255 : r);
+      ptr[1] = (uint8_t)(g < 0 ? 0 : g > 255 ? 255 : g);
+      ptr[2] = (uint8_t)(b < 0 ? 0 : b > 255 ? 255 : b);
+    }
+  }
+
+  return (true);
+
+#else
+  (void)jpx;
+  (void)row;
+
+  return (false);
+#endif // HAVE_OPENJPEG
+}
+
+//
+// 'jpx_close()' - Free a JPXDecode decoder.
+//
+
+void
+jpx_close(pdfrip_jpx_t *jpx)		// I - Decoder
+{
+#ifdef HAVE_OPENJPEG
+  if (jpx)
+  {
+    opj_image_destroy(jpx->image);
+    free(jpx);
+  }
+#else
+  (void)jpx;
+#endif // HAVE_OPENJPEG
+}
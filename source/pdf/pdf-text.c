@@ -1,10 +1,17 @@
 //
 // Mapping table for character names to Unicode values.
 //
+// The table is sorted by name (strcmp order) and each name appears once so
+// that it can be searched with bsearch().  Where the Adobe Glyph List gives
+// a name two code points, the first one is kept.
+//
 
 #include "pdfops-private.h"
 #include "../cairo/cairo-private.h"
 #include <string.h>
+#include <pthread.h>
+#include FT_ADVANCES_H
+#include FT_FONT_FORMATS_H
 
 typedef struct name_map_s
 {
@@ -12,7 +19,7 @@ typedef struct name_map_s
   int		unicode;		// Unicode value
 } name_map_t;
 
-static name_map_t	unicode_map[] =
+static const name_map_t	unicode_map[] =
 {
   { "A",		0x0041 },
   { "AE",		0x00c6 },
@@ -60,7 +67,6 @@ static name_map_t	unicode_map[] =
   { "Dcaron",		0x010e },
   { "Dcroat",		0x0110 },
   { "Delta",		0x0394 },
-  { "Delta",		0x2206 },
   { "Dieresis",		0xf6cb },
   { "DieresisAcute",	0xf6cc },
   { "DieresisGrave",	0xf6cd },
@@ -179,7 +185,6 @@ static name_map_t	unicode_map[] =
   { "Ohungarumlaut",	0x0150 },
   { "Omacron",		0x014c },
   { "Omega",		0x03a9 },
-  { "Omega",		0x2126 },
   { "Omegatonos",	0x038f },
   { "Omicron",		0x039f },
   { "Omicrontonos",	0x038c },
@@ -249,7 +254,6 @@ static name_map_t	unicode_map[] =
   { "Scaron",		0x0160 },
   { "Scaronsmall",	0xf6fd },
   { "Scedilla",		0x015e },
-  { "Scedilla",		0xf6c1 },
   { "Scircumflex",	0x015c },
   { "Scommaaccent",	0x0218 },
   { "Sigma",		0x03a3 },
@@ -259,7 +263,6 @@ static name_map_t	unicode_map[] =
   { "Tbar",		0x0166 },
   { "Tcaron",		0x0164 },
   { "Tcommaaccent",	0x0162 },
-  { "Tcommaaccent",	0x021a },
   { "Theta",		0x0398 },
   { "Thorn",		0x00de },
   { "Thornsmall",	0xf7fe },
@@ -746,7 +749,6 @@ static name_map_t	unicode_map[] =
   { "fouroldstyle",	0xf734 },
   { "foursuperior",	0x2074 },
   { "fraction",		0x2044 },
-  { "fraction",		0x2215 },
   { "franc",		0x20a3 },
   { "g",		0x0067 },
   { "gamma",		0x03b3 },
@@ -826,14 +828,11 @@ static name_map_t	unicode_map[] =
   { "ltshade",		0x2591 },
   { "m",		0x006d },
   { "macron",		0x00af },
-  { "macron",		0x02c9 },
   { "male",		0x2642 },
-  { "minus",		0x00ad },
   { "minus",		0x2212 },
   { "minute",		0x2032 },
   { "msuperior",	0xf6ef },
   { "mu",		0x00b5 },
-  { "mu",		0x03bc },
   { "multiply",		0x00d7 },
   { "musicalnote",	0x266a },
   { "musicalnotedbl",	0x266b },
@@ -905,7 +904,6 @@ static name_map_t	unicode_map[] =
   { "percent",		0x0025 },
   { "period",		0x002e },
   { "periodcentered",	0x00b7 },
-  { "periodcentered",	0x2219 },
   { "periodinferior",	0xf6e7 },
   { "periodsuperior",	0xf6e8 },
   { "perpendicular",	0x22a5 },
@@ -957,7 +955,6 @@ static name_map_t	unicode_map[] =
   { "sacute",		0x015b },
   { "scaron",		0x0161 },
   { "scedilla",		0x015f },
-  { "scedilla",		0xf6c2 },
   { "scircumflex",	0x015d },
   { "scommaaccent",	0x0219 },
   { "second",		0x2033 },
@@ -979,7 +976,6 @@ static name_map_t	unicode_map[] =
   { "slash",		0x002f },
   { "smileface",	0x263a },
   { "space",		0x0020 },
-  { "space",		0x00a0 },
   { "spade",		0x2660 },
   { "ssuperior",	0xf6f2 },
   { "sterling",		0x00a3 },
@@ -991,7 +987,6 @@ static name_map_t	unicode_map[] =
   { "tbar",		0x0167 },
   { "tcaron",		0x0165 },
   { "tcommaaccent",	0x0163 },
-  { "tcommaaccent",	0x021b },
   { "therefore",	0x2234 },
   { "theta",		0x03b8 },
   { "theta1",		0x03d1 },
@@ -1067,22 +1062,48 @@ static name_map_t	unicode_map[] =
   { "zeta",		0x03b6 }
 };
 
+//
+// 'compare_glyph_names()' - Compare a glyph name with a name map entry
+//
+
+static int				  // O - Result of comparison
+compare_glyph_names(const void *a,	// I - Glyph name
+		    const void *b)	// I - Name map entry
+{
+  return (strcmp((const char *)a, ((const name_map_t *)b)->name));
+}
+
+//
+// 'glyph_name_to_unicode()' - Map a glyph name to its Unicode value
+//
+
+int					  // O - Unicode value or -1 if unknown
+glyph_name_to_unicode(const char *name)	// I - Glyph name, e.g. "Aacute"
+{
+  const name_map_t *match;		// Matching entry
+
+  if (!name)
+    return (-1);
+
+  match = bsearch(name, unicode_map, sizeof(unicode_map) / sizeof(unicode_map[0]),
+                  sizeof(unicode_map[0]), compare_glyph_names);
+
+  return (match ? match->unicode : -1);
+}
+
 //
 // 'load_encoding()' - Load the encoding for a font.
 //
+// A NULL font dictionary yields the default WinAnsi encoding.
+//
 
 void
 load_encoding(
-    pdfio_obj_t   *page_obj,		// I - Page object
-    const char    *name,		// I - Font name
+    pdfio_dict_t  *font_dict,		// I - Font dictionary
     int           encoding[256])	// O - Encoding table
 {
-  size_t	i, j;			// Looping vars
-  pdfio_dict_t	*page_dict,		// Page dictionary
-		*resources_dict,	// Resources dictionary
-		*font_dict;		// Font dictionary
-  pdfio_obj_t	*font_obj,		// Font object
-		*encoding_obj;		// Encoding object
+  size_t	i;			// Looping var
+  pdfio_obj_t	*encoding_obj;		// Encoding object
   pdfio_dict_t	*encoding_dict;		// Encoding dictionary
   const char	*base_encoding;		// BaseEncoding name
   pdfio_array_t	*differences;		// Differences array
@@ -1125,35 +1146,28 @@ load_encoding(
     encoding[i] = i;
   memcpy(encoding + 128, win_ansi, sizeof(win_ansi));
 
-  // Find the named font...
-  if ((page_dict = pdfioObjGetDict(page_obj)) == NULL)
-    return;
-
-  if ((resources_dict = pdfioDictGetDict(page_dict, "Resources")) == NULL)
+  if (!font_dict)
     return;
 
-  if ((font_dict = pdfioDictGetDict(resources_dict, "Font")) == NULL)
+  // The encoding is either a predefined name, a direct dictionary, or a
+  // reference to an encoding dictionary...
+  if ((encoding_dict = pdfioDictGetDict(font_dict, "Encoding")) == NULL)
   {
-    // Font resources not a dictionary, see if it is an object...
-    if ((font_obj = pdfioDictGetObj(resources_dict, "Font")) != NULL)
-      font_dict = pdfioObjGetDict(font_obj);
-
-    if (!font_dict)
-      return;
+    if ((encoding_obj = pdfioDictGetObj(font_dict, "Encoding")) != NULL)
+      encoding_dict = pdfioObjGetDict(encoding_obj);
   }
 
-  if ((font_obj = pdfioDictGetObj(font_dict, name)) == NULL)
-    return;
-
-  if ((encoding_obj = pdfioDictGetObj(pdfioObjGetDict(font_obj), "Encoding")) == NULL)
-    return;
-
-  if ((encoding_dict = pdfioObjGetDict(encoding_obj)) == NULL)
-    return;
-
-  // OK, have the encoding object, build the encoding using it...
-  base_encoding = pdfioDictGetName(encoding_dict, "BaseEncoding");
-  differences   = pdfioDictGetArray(encoding_dict, "Differences");
+  if (encoding_dict)
+  {
+    // OK, have the encoding object, build the encoding using it...
+    base_encoding = pdfioDictGetName(encoding_dict, "BaseEncoding");
+    differences   = pdfioDictGetArray(encoding_dict, "Differences");
+  }
+  else
+  {
+    base_encoding = pdfioDictGetName(font_dict, "Encoding");
+    differences   = NULL;
+  }
 
   if (base_encoding && !strcmp(base_encoding, "MacRomanEncoding"))
   {
@@ -1167,6 +1181,7 @@ load_encoding(
     size_t	count = pdfioArrayGetSize(differences);
 					// Number of differences
     const char	*name;			// Character name
+    int		unicode;		// Unicode value of name
     size_t	idx = 0;		// Index in encoding array
 
     for (i = 0; i < count; i ++)
@@ -1184,14 +1199,8 @@ load_encoding(
               break;
 
             name = pdfioArrayGetName(differences, i);
-            for (j = 0; j < (sizeof(unicode_map) / sizeof(unicode_map[0])); j ++)
-            {
-              if (!strcmp(name, unicode_map[j].name))
-              {
-                encoding[idx] = unicode_map[j].unicode;
-                break;
-              }
-            }
+            if ((unicode = glyph_name_to_unicode(name)) >= 0)
+              encoding[idx] = unicode;
 	    idx ++;
             break;
 
@@ -1251,11 +1260,903 @@ getPageFonts(p2c_device_t *dev) 	// I - PDF2Cairo Conversion document
 */
 
 //
-// 'getPageFonts()' - Get Font Glyphs and build TrueType faces safely
+// 'font_build_glyph_map()' - Map character codes to glyph indices and advances
+//
+// Both tables are built once per font so that showing text never has to
+// go through Unicode or ask FreeType for metrics.
+//
+
+static void
+font_build_glyph_map(
+    p2c_font_t    *font,		// I - Font
+    pdfio_dict_t  *descriptor_dict)	// I - FontDescriptor dictionary or NULL
+{
+  int		code;			// Character code
+  FT_Face	face = font->ft_face;	// FreeType face, if any
+  int		flags = 0;		// FontDescriptor flags
+  double	missing_width = 0.0;	// Width of codes outside /Widths
+
+  if (descriptor_dict)
+  {
+    flags         = (int)pdfioDictGetNumber(descriptor_dict, "Flags");
+    missing_width = pdfioDictGetNumber(descriptor_dict, "MissingWidth");
+  }
+
+  memset(font->glyph_ids, 0, sizeof(font->glyph_ids));
+
+  if (face)
+  {
+    FT_CharMap	unicode_cmap = NULL,	// Unicode cmap
+		symbol_cmap = NULL,	// Microsoft symbol (3,0) cmap
+		roman_cmap = NULL,	// Apple Roman (1,0) cmap
+		builtin_cmap = NULL;	// Built-in encoding of a Type 1 or CFF font
+
+    for (int i = 0; i < face->num_charmaps; i ++)
+    {
+      switch (face->charmaps[i]->encoding)
+      {
+        case FT_ENCODING_UNICODE :
+            unicode_cmap = face->charmaps[i];
+            break;
+        case FT_ENCODING_MS_SYMBOL :
+            symbol_cmap = face->charmaps[i];
+            break;
+        case FT_ENCODING_APPLE_ROMAN :
+            roman_cmap = face->charmaps[i];
+            break;
+        case FT_ENCODING_ADOBE_CUSTOM :
+        case FT_ENCODING_ADOBE_STANDARD :
+            if (!builtin_cmap || face->charmaps[i]->encoding == FT_ENCODING_ADOBE_CUSTOM)
+              builtin_cmap = face->charmaps[i];
+            break;
+        default :
+            break;
+      }
+    }
+
+    // Symbolic fonts address glyphs through the (3,0) cmap, either at
+    // U+F000 + code or directly by code...
+    if (symbol_cmap && ((flags & 4) || !unicode_cmap))
+    {
+      FT_Set_Charmap(face, symbol_cmap);
+      for (code = 0; code < 256; code ++)
+      {
+        if ((font->glyph_ids[code] = FT_Get_Char_Index(face, 0xF000 + code)) == 0)
+          font->glyph_ids[code] = FT_Get_Char_Index(face, code);
+      }
+    }
+
+    // Others go through the Unicode value from the encoding...
+    if (unicode_cmap)
+    {
+      FT_Set_Charmap(face, unicode_cmap);
+      for (code = 0; code < 256; code ++)
+      {
+        if (!font->glyph_ids[code] && font->encoding_table[code] > 0)
+          font->glyph_ids[code] = FT_Get_Char_Index(face, font->encoding_table[code]);
+
+        // Custom encodings often only make sense through ToUnicode
+        if (!font->glyph_ids[code] && font->unicode[code] && !(font->unicode[code] & PDFRIP_CMAP_STRING))
+          font->glyph_ids[code] = FT_Get_Char_Index(face, font->unicode[code]);
+      }
+    }
+
+    if (roman_cmap)
+    {
+      FT_Set_Charmap(face, roman_cmap);
+      for (code = 0; code < 256; code ++)
+      {
+        if (!font->glyph_ids[code])
+          font->glyph_ids[code] = FT_Get_Char_Index(face, code);
+      }
+    }
+
+    // Symbolic Type 1 and CFF fonts (e.g. TeX math) use their own encoding
+    if (builtin_cmap)
+    {
+      FT_Set_Charmap(face, builtin_cmap);
+      for (code = 0; code < 256; code ++)
+      {
+        if (!font->glyph_ids[code])
+          font->glyph_ids[code] = FT_Get_Char_Index(face, code);
+      }
+    }
+
+    // Subset TrueType fonts without a cmap use the code as glyph index
+    if (face->num_charmaps == 0)
+    {
+      for (code = 0; code < 256 && code < face->num_glyphs; code ++)
+        font->glyph_ids[code] = code;
+    }
+  }
+
+  // Advances come from /Widths when present.  Fonts without /Widths (the
+  // standard 14) use the metrics of whatever face we loaded.
+  for (code = 0; code < 256; code ++)
+  {
+    FT_Fixed advance;			// Advance in font units
+
+    if (font->widths)
+    {
+      if (code >= font->first_char && (size_t)(code - font->first_char) < font->num_widths)
+        font->advances[code] = font->widths[code - font->first_char];
+      else
+        font->advances[code] = missing_width;
+    }
+    else if (face && face->units_per_EM && font->glyph_ids[code] &&
+             !FT_Get_Advance(face, font->glyph_ids[code], FT_LOAD_NO_SCALE, &advance))
+      font->advances[code] = advance * 1000.0 / face->units_per_EM;
+    else
+      font->advances[code] = missing_width;
+  }
+}
+
+//
+// 'compare_cid_widths()' - Order /W intervals by first CID.
+//
+
+static int				  // O - Result of comparison
+compare_cid_widths(const void *a,	// I - First interval
+		   const void *b)	// I - Second interval
+{
+  const p2c_cid_width_t *wa = a, *wb = b;
+
+  return (wa->first < wb->first ? -1 : wa->first > wb->first);
+}
+
+//
+// 'add_cid_width()' - Add an interval of CID widths.
+//
+// Consecutive CIDs of the same width are merged into one interval.
+//
+
+static bool				  // O - true on success
+add_cid_width(p2c_font_t *font,		// I - Font
+	      size_t *alloc,		// IO - Allocated intervals
+	      uint32_t first,		// I - First CID
+	      uint32_t last,		// I - Last CID
+	      double width)		// I - Width
+{
+  p2c_cid_width_t *prev = font->num_cid_widths ? font->cid_widths + font->num_cid_widths - 1 : NULL;
+
+  if (last < first)
+    return (true);
+
+  if (prev && prev->last + 1 == first && prev->width == width)
+  {
+    prev->last = last;
+    return (true);
+  }
+
+  if (font->num_cid_widths == *alloc)
+  {
+    size_t new_alloc = *alloc ? *alloc * 2 : 64;
+    p2c_cid_width_t *temp = realloc(font->cid_widths, new_alloc * sizeof(p2c_cid_width_t));
+
+    if (!temp)
+      return (false);
+
+    font->cid_widths = temp;
+    *alloc = new_alloc;
+  }
+
+  font->cid_widths[font->num_cid_widths].first = first;
+  font->cid_widths[font->num_cid_widths].last  = last;
+  font->cid_widths[font->num_cid_widths].width = width;
+  font->num_cid_widths ++;
+
+  return (true);
+}
+
+//
+// 'load_cid_metrics()' - Compile the /W array of a CIDFont into intervals.
+//
+// /W holds entries of the forms "c [w1 w2 ...]" and "c_first c_last w".
+//
+
+static bool				  // O - true on success
+load_cid_metrics(p2c_font_t   *font,	// I - Font
+		 pdfio_dict_t *cid_dict)// I - CIDFont dictionary
+{
+  pdfio_array_t	*w = pdfioDictGetArray(cid_dict, "W");
+  size_t	count = pdfioArrayGetSize(w),
+		alloc = 0,
+		i = 0;
+
+  font->default_width = pdfioDictGetType(cid_dict, "DW") == PDFIO_VALTYPE_NUMBER ? pdfioDictGetNumber(cid_dict, "DW") : 1000.0;
+
+  while (i + 1 < count)
+  {
+    uint32_t	first = (uint32_t)pdfioArrayGetNumber(w, i);
+    pdfio_array_t *list;
+
+    if ((list = pdfioArrayGetArray(w, i + 1)) != NULL)
+    {
+      size_t num = pdfioArrayGetSize(list);
+
+      for (size_t j = 0; j < num; j ++)
+      {
+        if (!add_cid_width(font, &alloc, first + (uint32_t)j, first + (uint32_t)j, pdfioArrayGetNumber(list, j)))
+          return (false);
+      }
+
+      i += 2;
+    }
+    else if (i + 2 < count)
+    {
+      if (!add_cid_width(font, &alloc, first, (uint32_t)pdfioArrayGetNumber(w, i + 1), pdfioArrayGetNumber(w, i + 2)))
+        return (false);
+
+      i += 3;
+    }
+    else
+      break;
+  }
+
+  qsort(font->cid_widths, font->num_cid_widths, sizeof(p2c_cid_width_t), compare_cid_widths);
+
+  return (true);
+}
+
+//
+// 'load_cid_to_gid()' - Load the CIDToGIDMap of a CIDFontType2 font.
+//
+
+static bool				  // O - true on success
+load_cid_to_gid(p2c_font_t   *font,	// I - Font
+		pdfio_dict_t *cid_dict)	// I - CIDFont dictionary
+{
+  pdfio_obj_t	*obj;			// CIDToGIDMap stream
+  pdfio_stream_t *st;			// Stream
+  unsigned char	buffer[8192];		// Read buffer
+  ssize_t	bytes;			// Bytes read
+  size_t	alloc = 0;		// Allocated entries
+  int		high = -1;		// Pending high byte
+
+  // Identity (the default) maps CIDs straight to glyph indices
+  if ((obj = pdfioDictGetObj(cid_dict, "CIDToGIDMap")) == NULL)
+    return (true);
+
+  if ((st = pdfioObjOpenStream(obj, true)) == NULL)
+    return (true);
+
+  while ((bytes = pdfioStreamRead(st, buffer, sizeof(buffer))) > 0)
+  {
+    for (ssize_t i = 0; i < bytes; i ++)
+    {
+      if (high < 0)
+      {
+        high = buffer[i];
+        continue;
+      }
+
+      if (font->num_cid_to_gid == alloc)
+      {
+        uint16_t *temp;
+
+        alloc = alloc ? alloc * 2 : 4096;
+        if ((temp = realloc(font->cid_to_gid, alloc * sizeof(uint16_t))) == NULL)
+        {
+          pdfioStreamClose(st);
+          return (false);
+        }
+        font->cid_to_gid = temp;
+      }
+
+      font->cid_to_gid[font->num_cid_to_gid++] = (uint16_t)((high << 8) | buffer[i]);
+      high = -1;
+    }
+  }
+
+  pdfioStreamClose(st);
+
+  return (true);
+}
+
+//
+// 'free_face_data()' - Free the font program of a FreeType face.
+//
+// This is the generic finalizer of embedded faces, so the program lives
+// exactly as long as the face, however long Cairo keeps that around.
+//
+
+static void
+free_face_data(void *object)		// I - FreeType face
+{
+  FT_Face face = (FT_Face)object;
+
+  free(face->generic.data);
+  face->generic.data = NULL;
+}
+
+//
+// 'read_font_file()' - Read an embedded font program.
+//
+// The buffer is sized from /Length1 (plus /Length2 and /Length3 for Type 1
+// programs), /DL or /Length, and the stream is decoded straight into it.
+// When it fills up, a small read checks for more data first, so an exact
+// size is never grown or trimmed.  It only grows if the size was an
+// underestimate, and is trimmed to the decoded length at the end.
+//
+
+static unsigned char *			  // O - Font program or NULL
+read_font_file(pdfio_obj_t *obj,	// I - FontFile, FontFile2 or FontFile3 stream
+	       size_t      *size)	// O - Size of font program
+{
+  pdfio_dict_t		*dict = pdfioObjGetDict(obj);
+  pdfio_stream_t	*st;
+  unsigned char		*buffer, *temp;
+  unsigned char		probe[256];	// Data past a full buffer
+  size_t		capacity, total = 0;
+  ssize_t		bytes;
+
+  *size = 0;
+
+  if ((capacity = (size_t)(pdfioDictGetNumber(dict, "Length1") + pdfioDictGetNumber(dict, "Length2") +
+                           pdfioDictGetNumber(dict, "Length3"))) == 0 &&
+      (capacity = (size_t)pdfioDictGetNumber(dict, "DL")) == 0)
+  {
+    // Only the encoded length is known; compressed fonts are usually
+    // about twice that size
+    capacity = pdfioObjGetLength(obj);
+    if (pdfioDictGetType(dict, "Filter") != PDFIO_VALTYPE_NONE)
+      capacity *= 2;
+  }
+
+  if (capacity < 1024)
+    capacity = 1024;
+
+  if ((st = pdfioObjOpenStream(obj, true)) == NULL)
+    return (NULL);
+
+  if ((buffer = malloc(capacity)) == NULL)
+  {
+    pdfioStreamClose(st);
+    return (NULL);
+  }
+
+  while ((bytes = pdfioStreamRead(st, buffer + total, capacity - total)) > 0)
+  {
+    total += (size_t)bytes;
+
+    if (total == capacity)
+    {
+      // Only grow when the stream has more data
+      if ((bytes = pdfioStreamRead(st, probe, sizeof(probe))) <= 0)
+        break;
+
+      capacity += capacity / 2 + (size_t)bytes;
+
+      if ((temp = realloc(buffer, capacity)) == NULL)
+      {
+        free(buffer);
+        pdfioStreamClose(st);
+        return (NULL);
+      }
+
+      buffer = temp;
+      memcpy(buffer + total, probe, (size_t)bytes);
+      total += (size_t)bytes;
+    }
+  }
+
+  pdfioStreamClose(st);
+
+  if (total == 0)
+  {
+    free(buffer);
+    return (NULL);
+  }
+
+  if (total < capacity && (temp = realloc(buffer, total)) != NULL)
+    buffer = temp;
+
+  *size = total;
+
+  return (buffer);
+}
+
+//
+// 'font_program_id()' - Compute the FNV-1a hash identifying a font program.
+//
+// The glyph cache uses this to share masks between documents embedding
+// the same program.  0 is reserved for "not cacheable".
+//
+
+static uint64_t				  // O - Identity
+font_program_id(const unsigned char *data,// I - Font program
+		size_t              size,	// I - Size of program
+		int                 index)	// I - Face index
+{
+  uint64_t id = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < size; i ++)
+  {
+    id ^= data[i];
+    id *= 1099511628211ULL;
+  }
+
+  id ^= (uint64_t)index;
+  id *= 1099511628211ULL;
+
+  return (id ? id : 1);
+}
+
+//
+// 'load_font_program()' - Load the font program of a font into FreeType.
+//
+// Embedded programs come from the FontDescriptor: TrueType (FontFile2),
+// CFF or OpenType (FontFile3) or Type 1 (FontFile).  Fonts without one,
+// including the standard 14, use a local substitute for their BaseFont.
+//
+
+static void
+load_font_program(
+    p2c_font_t    *font,		// I - Font
+    pdfio_dict_t  *descriptor_dict,	// I - FontDescriptor dictionary or NULL
+    const char    *lang)		// I - Language of a CID font or NULL
+{
+  static const char * const keys[] = { "FontFile2", "FontFile3", "FontFile" };
+  pdfio_obj_t	*font_file_obj = NULL;	// Embedded font program
+  FT_Face	ft_face = NULL;		// FreeType face
+
+  for (size_t i = 0; descriptor_dict && !font_file_obj && i < sizeof(keys) / sizeof(keys[0]); i ++)
+    font_file_obj = pdfioDictGetObj(descriptor_dict, keys[i]);
+
+  if (font_file_obj)
+  {
+    size_t size;
+    unsigned char *data = read_font_file(font_file_obj, &size);
+
+    if (data && !p2c_font_new_face(data, size, 0, &ft_face))
+    {
+      // The face owns the program from here on
+      ft_face->generic.data      = data;
+      ft_face->generic.finalizer = free_face_data;
+
+      font->data      = data;
+      font->data_size = size;
+      font->font_id   = font_program_id(data, size, 0);
+      font->embedded  = true;
+
+      if (g_verbose)
+        fprintf(stderr, "DEBUG: Loaded %zu byte %s program for %s.\n", size, FT_Get_Font_Format(ft_face), font->font_name ? font->font_name : "(unnamed)");
+    }
+    else
+    {
+      free(data);
+      ft_face = NULL;
+    }
+  }
+
+  if (!ft_face)
+  {
+    const unsigned char	*sub_data;	// Substitute font program
+    size_t		sub_size;	// Size of substitute
+    int			sub_index;	// Face index in substitute
+
+    // The substitute stays mapped for the process, so font->data is unset
+    if (!fontsub_get(font->font_name, (int)pdfioDictGetNumber(descriptor_dict, "Flags"), lang, &sub_data, &sub_size, &sub_index) ||
+        p2c_font_new_face(sub_data, sub_size, sub_index, &ft_face))
+      return;
+
+    // Substitutes can be large system fonts, so their size and first few
+    // kilobytes are enough to tell them apart
+    font->font_id = font_program_id(sub_data, sub_size < 4096 ? sub_size : 4096, sub_index) ^ sub_size;
+  }
+
+  font->ft_face = ft_face;
+}
+
+//
+// 'load_font_face()' - Create the Cairo face of a loaded FreeType face.
+//
+
+static void
+load_font_face(p2c_font_t *font)	// I - Font
+{
+  static const cairo_user_data_key_t cleanup_key;
+  cairo_font_face_t *cairo_face;
+
+  if (!font->ft_face)
+    return;
+
+  cairo_face = cairo_ft_font_face_create_for_ft_face(font->ft_face, 0);
+  if (cairo_font_face_status(cairo_face) != CAIRO_STATUS_SUCCESS)
+  {
+    p2c_font_done_face(font->ft_face);
+    font->ft_face = NULL;
+    return;
+  }
+
+  cairo_font_face_set_user_data(cairo_face, &cleanup_key, font->ft_face, p2c_font_done_face);
+
+  font->cairo_face = cairo_face;
+}
+
+//
+// 'build_gid_to_unicode()' - Invert the Unicode cmap of an embedded font.
+//
+// Type0 fonts without ToUnicode can often still be extracted, since many
+// embedded TrueType subsets keep their Unicode cmap.
+//
+
+static bool				  // O - true on success
+build_gid_to_unicode(p2c_font_t *font)	// I - Font
+{
+  FT_Face	face = font->ft_face;
+  FT_ULong	ch;			// Unicode character
+  FT_UInt	glyph;			// Glyph index
+
+  if (!face || face->num_glyphs <= 0 || FT_Select_Charmap(face, FT_ENCODING_UNICODE))
+    return (true);
+
+  if ((font->gid_to_unicode = calloc((size_t)face->num_glyphs, sizeof(uint32_t))) == NULL)
+    return (false);
+
+  font->num_gid_to_unicode = (size_t)face->num_glyphs;
+
+  // Keep the lowest code point of glyphs reachable from several
+  for (ch = FT_Get_First_Char(face, &glyph); glyph != 0; ch = FT_Get_Next_Char(face, ch, &glyph))
+  {
+    if (glyph < font->num_gid_to_unicode && !font->gid_to_unicode[glyph])
+      font->gid_to_unicode[glyph] = (uint32_t)ch;
+  }
+
+  return (true);
+}
+
+//
+// 'build_unicode_map()' - Map the codes of a simple font to Unicode.
+//
+// ToUnicode takes precedence over the encoding.  Fonts whose ToUnicode
+// CMap uses two-byte source codes are looked up with those too.
+//
+
+static void
+build_unicode_map(p2c_font_t *font)	// I - Font
+{
+  for (uint32_t code = 0; code < 256; code ++)
+  {
+    uint32_t value;
+
+    if (font->to_unicode &&
+        (cmap_lookup(font->to_unicode, code, 1, &value) || cmap_lookup(font->to_unicode, code, 2, &value)) &&
+        value)
+      font->unicode[code] = value;
+    else
+      font->unicode[code] = font->encoding_table[code] > 0 ? (uint32_t)font->encoding_table[code] : 0;
+  }
+}
+
+//
+// 'load_type3()' - Load the glyph procedures and metrics of a Type 3 font.
+//
+// The Differences of the encoding name the CharProc of each code.  The
+// CharProcs are compiled when a glyph is first shown.
+//
+
+static void
+load_type3(p2c_font_t   *font,		// I - Font
+	   pdfio_dict_t *font_dict)	// I - Font dictionary
+{
+  pdfio_array_t	*matrix = pdfioDictGetArray(font_dict, "FontMatrix");
+  pdfio_dict_t	*char_procs = pdfioDictGetDict(font_dict, "CharProcs");
+  pdfio_dict_t	*encoding_dict = pdfioDictGetDict(font_dict, "Encoding");
+  pdfio_array_t	*differences = pdfioDictGetArray(encoding_dict, "Differences");
+  size_t	i, count, idx = 0;	// Looping vars
+
+  font->type3 = true;
+  font->type3_resources = pdfioDictGetDict(font_dict, "Resources");
+
+  if (pdfioArrayGetSize(matrix) == 6)
+    cairo_matrix_init(&font->type3_matrix, pdfioArrayGetNumber(matrix, 0), pdfioArrayGetNumber(matrix, 1),
+                      pdfioArrayGetNumber(matrix, 2), pdfioArrayGetNumber(matrix, 3),
+                      pdfioArrayGetNumber(matrix, 4), pdfioArrayGetNumber(matrix, 5));
+  else
+    cairo_matrix_init_scale(&font->type3_matrix, 0.001, 0.001);
+
+  for (i = 0, count = pdfioArrayGetSize(differences); i < count; i ++)
+  {
+    if (pdfioArrayGetType(differences, i) == PDFIO_VALTYPE_NUMBER)
+    {
+      idx = (size_t)pdfioArrayGetNumber(differences, i);
+    }
+    else if (pdfioArrayGetType(differences, i) == PDFIO_VALTYPE_NAME)
+    {
+      if (idx < 256)
+        font->char_procs[idx] = pdfioDictGetObj(char_procs, pdfioArrayGetName(differences, i));
+      idx ++;
+    }
+  }
+
+  // Widths are in glyph space, so scale them by the FontMatrix
+  for (int code = 0; code < 256; code ++)
+  {
+    if (code >= font->first_char && (size_t)(code - font->first_char) < font->num_widths)
+      font->advances[code] = font->widths[code - font->first_char] * font->type3_matrix.xx * 1000.0;
+  }
+
+  if (g_verbose)
+    fprintf(stderr, "DEBUG: Type 3 font with %zu CharProcs.\n", pdfioDictGetNumPairs(char_procs));
+}
+
+//
+// 'load_font()' - Load a font dictionary.
+//
+// Simple fonts get 256-entry glyph and Unicode maps.  Type0 fonts get
+// their CMap, compiled /W widths and CIDToGIDMap from the descendant
+// CIDFont.  The ToUnicode CMap of either kind is shared through the
+// document's CMap cache.
 //
 
-bool 					  
-getPageFonts(p2c_device_t *dev) 	
+static p2c_font_t *			  // O - Font or NULL on error
+load_font(pdfrip_doc_t *doc,		// I - Document
+	  pdfio_dict_t *font_dict)	// I - Font dictionary
+{
+  p2c_font_t	*font;			// Font
+  const char	*subtype = pdfioDictGetName(font_dict, "Subtype");
+  pdfio_dict_t	*descriptor_dict;	// FontDescriptor dictionary
+
+  if ((font = calloc(1, sizeof(p2c_font_t))) == NULL)
+    return (NULL);
+
+  font->font_name = pdfioDictGetName(font_dict, "BaseFont");
+  font->encoding = pdfioDictGetName(font_dict, "Encoding");
+  font->to_unicode = cmap_get_to_unicode(doc, font_dict);
+
+  if (subtype && !strcmp(subtype, "Type0"))
+  {
+    pdfio_array_t *descendants = pdfioDictGetArray(font_dict, "DescendantFonts");
+    pdfio_dict_t *cid_dict = pdfioArrayGetDict(descendants, 0);
+
+    if (!cid_dict)
+      cid_dict = pdfioObjGetDict(pdfioArrayGetObj(descendants, 0));
+
+    pdfio_dict_t *info_dict = pdfioDictGetDict(cid_dict, "CIDSystemInfo");
+    const char *registry = pdfioDictGetString(info_dict, "Registry");
+    const char *ordering = pdfioDictGetString(info_dict, "Ordering");
+    char collection[256];		// Character collection, e.g. "Adobe-Japan1"
+
+    snprintf(collection, sizeof(collection), "%s-%s", registry ? registry : "Adobe", ordering ? ordering : "Identity");
+
+    // Language of a substitute for non-embedded CJK fonts
+    const char *lang = NULL;
+
+    if (ordering && !strcmp(ordering, "Japan1"))
+      lang = "ja";
+    else if (ordering && !strcmp(ordering, "GB1"))
+      lang = "zh-cn";
+    else if (ordering && !strcmp(ordering, "CNS1"))
+      lang = "zh-tw";
+    else if (ordering && !strcmp(ordering, "Korea1"))
+      lang = "ko";
+
+    font->cid = true;
+    if ((font->cmap = cmap_get(doc, font_dict, collection)) == NULL)
+    {
+      if (g_verbose)
+        fprintf(stderr, "DEBUG: No CMap for font %s, using Identity-H.\n", font->font_name ? font->font_name : "(unnamed)");
+
+      font->cmap = cmap_get_predefined(doc, "Identity-H", NULL);
+    }
+
+    if (!load_cid_metrics(font, cid_dict) || !load_cid_to_gid(font, cid_dict))
+    {
+      p2c_font_destroy(font);
+      return (NULL);
+    }
+
+    descriptor_dict = pdfioDictGetDict(cid_dict, "FontDescriptor");
+    load_font_program(font, descriptor_dict, lang);
+
+    if (!font->to_unicode && font->embedded && !build_gid_to_unicode(font))
+    {
+      p2c_font_destroy(font);
+      return (NULL);
+    }
+  }
+  else
+  {
+    font->first_char = (int)pdfioDictGetNumber(font_dict, "FirstChar");
+    font->last_char = (int)pdfioDictGetNumber(font_dict, "LastChar");
+
+    // Build the encoding once; Tf only points the graphics state at it
+    load_encoding(font_dict, font->encoding_table);
+
+    pdfio_array_t *width_array = pdfioDictGetArray(font_dict, "Widths");
+    size_t width_array_size = pdfioArrayGetSize(width_array);
+
+    if (width_array_size > 0)
+    {
+      if ((font->widths = calloc(width_array_size, sizeof(*font->widths))) == NULL)
+      {
+        p2c_font_destroy(font);
+        return (NULL);
+      }
+
+      font->num_widths = width_array_size;
+
+      for (size_t i = 0; i < width_array_size; i++)
+        font->widths[i] = pdfioArrayGetNumber(width_array, i);
+    }
+
+    build_unicode_map(font);
+
+    if (subtype && !strcmp(subtype, "Type3"))
+    {
+      // Glyphs are content streams, drawn by device_show_type3_text()
+      load_type3(font, font_dict);
+    }
+    else
+    {
+      descriptor_dict = pdfioDictGetDict(font_dict, "FontDescriptor");
+      load_font_program(font, descriptor_dict, NULL);
+
+      // Map codes before Cairo gets the face, since this selects charmaps
+      font_build_glyph_map(font, descriptor_dict);
+    }
+  }
+
+  load_font_face(font);
+
+  return (font);
+}
+
+//
+// 'freeDocFonts()' - Free the fonts cached by a document.
+//
+
+void
+freeDocFonts(pdfrip_doc_t *doc)		// I - Document
+{
+  for (size_t i = 0; i < doc->num_fonts; i ++)
+    p2c_font_destroy(doc->fonts[i]);
+
+  free(doc->fonts);
+
+  doc->fonts = NULL;
+  doc->num_fonts = doc->alloc_fonts = 0;
+}
+
+//
+// 'getDocFontMemory()' - Get the memory used by the fonts of a document.
+//
+// Substitute fonts are mapped once per process and are not counted.
+//
+
+void
+getDocFontMemory(pdfrip_doc_t         *doc,// I - Document
+		 pdfrip_font_memory_t *memory)// O - Memory used
+{
+  memset(memory, 0, sizeof(pdfrip_font_memory_t));
+
+  memory->num_fonts = doc->num_fonts;
+
+  for (size_t i = 0; i < doc->num_fonts; i ++)
+  {
+    p2c_font_t *font = doc->fonts[i];
+
+    memory->programs += font->data_size;
+    memory->metrics  += sizeof(p2c_font_t) +
+                        font->num_widths * sizeof(double) +
+                        font->num_cid_to_gid * sizeof(uint16_t) +
+                        font->num_cid_widths * sizeof(p2c_cid_width_t) +
+                        font->num_gid_to_unicode * sizeof(uint32_t);
+    memory->caches   += font->outlines.bytes;
+
+    if (font->type3_glyphs)
+    {
+      memory->caches += 256 * sizeof(p2c_type3_glyph_t);
+
+      for (int code = 0; code < 256; code ++)
+      {
+        p2c_type3_glyph_t *glyph = font->type3_glyphs + code;
+
+        if (glyph->program)
+          memory->caches += sizeof(parser_program_t) +
+                            glyph->program->alloc_ops * sizeof(parser_op_t) +
+                            glyph->program->alloc_operands * sizeof(parser_operand_t) +
+                            glyph->program->alloc_strings;
+
+        for (size_t j = 0; j < glyph->num_masks; j ++)
+          memory->caches += (size_t)cairo_image_surface_get_stride(glyph->masks[j].mask) *
+                            (size_t)cairo_image_surface_get_height(glyph->masks[j].mask);
+      }
+    }
+  }
+}
+
+// --- Shared FreeType Library ---
+//
+// One FT_Library serves every thread and document.  FreeType only allows
+// faces of a shared library to be created and destroyed under a lock; a
+// face itself is used by the thread whose document owns it, and font
+// programs from the substitution cache are shared read-only.
+//
+
+static pthread_once_t	font_library_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t	font_library_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FT_Library	font_library = NULL;
+
+
+//
+// 'font_library_init()' - Initialize the shared FreeType library.
+//
+
+static void
+font_library_init(void)
+{
+  if (FT_Init_FreeType(&font_library))
+    font_library = NULL;
+}
+
+//
+// 'p2c_font_library()' - Get the shared FreeType library.
+//
+
+FT_Library				  // O - Library or NULL on error
+p2c_font_library(void)
+{
+  pthread_once(&font_library_once, font_library_init);
+
+  return (font_library);
+}
+
+//
+// 'p2c_font_new_face()' - Open a face of a font program in memory.
+//
+// The data must stay valid until the face is released with
+// p2c_font_done_face().
+//
+
+FT_Error				  // O - FreeType error code
+p2c_font_new_face(
+    const unsigned char *data,		// I - Font program
+    size_t              size,		// I - Size of font program
+    int                 index,		// I - Face index
+    FT_Face             *face)		// O - Face
+{
+  FT_Library	library = p2c_font_library();
+  FT_Error	error;
+
+  if (!library)
+    return (FT_Err_Invalid_Library_Handle);
+
+  pthread_mutex_lock(&font_library_mutex);
+  error = FT_New_Memory_Face(library, data, (FT_Long)size, index, face);
+  pthread_mutex_unlock(&font_library_mutex);
+
+  return (error);
+}
+
+//
+// 'p2c_font_done_face()' - Release a face of the shared library.
+//
+// This is also the destroy function of the Cairo faces, so Cairo may call
+// it from whichever thread drops the last reference.
+//
+
+void
+p2c_font_done_face(void *face)		// I - Face
+{
+  pthread_mutex_lock(&font_library_mutex);
+  FT_Done_Face((FT_Face)face);
+  pthread_mutex_unlock(&font_library_mutex);
+}
+
+//
+// 'getPageFonts()' - Get the fonts of the page resources
+//
+// Fonts are loaded once per document and cached by object number, or by
+// dictionary for direct fonts, so pages sharing a font share its face,
+// glyph map, CMap and widths.  Like the pdfio file under it, a document is
+// used by one thread at a time; threads rendering concurrently each open
+// their own document.
+//
+
+bool 					  // O - true on success, false on error
+getPageFonts(p2c_device_t *dev) 	// I - Active Rendering Context
 {
   if (!dev || !dev->font_dict)
     return true; 
@@ -1267,169 +2168,93 @@ getPageFonts(p2c_device_t *dev)
     return false;
   }
 
+  if (!dev->doc)
+    return false;
+
   dev->num_fonts = pdfioDictGetNumPairs(dev->font_dict);
   if (dev->num_fonts == 0)
     return true;
 
-  dev->fonts = calloc(dev->num_fonts, sizeof(p2c_font_t *));
+  dev->fonts = calloc(dev->num_fonts, sizeof(p2c_font_ref_t));
   if (!dev->fonts)
     return false;
 
-  // Initialize FreeType as a static instance 
-  static FT_Library ft_library = NULL;
-  static bool ft_initialized = false;
-  if (!ft_initialized)
+  if (!p2c_font_library())
   {
-    if (FT_Init_FreeType(&ft_library) != 0)
-    {
-      fprintf(stderr, "ERROR: Could not initialize FreeType library.\n");
-      return false;
-    }
-    ft_initialized = true;
+    fprintf(stderr, "ERROR: Could not initialize FreeType library.\n");
+    device_clear_fonts(dev);
+    return false;
   }
 
+  pdfrip_doc_t *doc = dev->doc;
+
   for(size_t cur_font=0; cur_font < dev->num_fonts; cur_font++) 
   {
-    dev->fonts[cur_font] = calloc(1, sizeof(*dev->fonts[cur_font]));
-    if (!dev->fonts[cur_font])
-    {
-      device_clear_fonts(dev);
-      return false;
-    }
-
     const char *font_key = pdfioDictGetKey(dev->font_dict, cur_font);
     if (!font_key)
       continue;
 
-    dev->fonts[cur_font] = calloc(1, sizeof(p2c_font_t));
-    if (!dev->fonts[cur_font])
-      continue;
-
     pdfio_obj_t *ref_font_obj = pdfioDictGetObj(dev->font_dict, font_key);
-    pdfio_dict_t *ref_font_dict = pdfioObjGetDict(ref_font_obj);
+    pdfio_dict_t *ref_font_dict = ref_font_obj ? pdfioObjGetDict(ref_font_obj) : pdfioDictGetDict(dev->font_dict, font_key);
+    size_t obj_number = ref_font_obj ? pdfioObjGetNumber(ref_font_obj) : 0;
+    p2c_font_t *font = NULL;
+
     if (!ref_font_dict)
       continue;
 
-    // Use dictionary key (e.g. "F1") as the reference name, 
-    dev->fonts[cur_font]->ref_font_name = font_key; 
-    dev->fonts[cur_font]->font_name = pdfioDictGetName(ref_font_dict, "BaseFont");
-    dev->fonts[cur_font]->encoding = pdfioDictGetName(ref_font_dict, "Encoding");
-
-    dev->fonts[cur_font]->first_char = (int)pdfioDictGetNumber(ref_font_dict, "FirstChar");
-    dev->fonts[cur_font]->last_char = (int)pdfioDictGetNumber(ref_font_dict, "LastChar");
-    
-    load_encoding(dev->page_obj, font_key, dev->fonts[cur_font]->encoding_table);
-
-    pdfio_obj_t *width_object = pdfioDictGetObj(ref_font_dict, "Widths");
-    pdfio_array_t *width_array = pdfioObjGetArray(width_object);
+    // Use dictionary key (e.g. "F1") as the reference name
+    dev->fonts[cur_font].name = font_key;
 
-    if (width_array)
+    // Direct font dictionaries live as long as the PDF file, so their
+    // address identifies them
+    for (size_t i = 0; i < doc->num_fonts; i ++)
     {
-      size_t width_array_size = pdfioArrayGetSize(width_array);
-      if (width_array_size > 0)
+      if (obj_number ? doc->fonts[i]->obj_number == obj_number : doc->fonts[i]->direct_dict == ref_font_dict)
       {
-	dev->fonts[cur_font]->widths = calloc(width_array_size, sizeof(*dev->fonts[cur_font]->widths));
-	
-	if(!dev->fonts[cur_font]->widths)
- 	{
-	  device_clear_fonts(dev);
-      	  return false;
-	}
-
-	dev->fonts[cur_font]->num_widths = width_array_size;
-
-	for (size_t width_array_index = 0; width_array_index < width_array_size; width_array_index++)
-          dev->fonts[cur_font]->widths[width_array_index] = pdfioArrayGetNumber(width_array, width_array_index);
+        font = doc->fonts[i];
+        break;
       }
     }
 
-    pdfio_dict_t *descriptor_dict = pdfioDictGetDict(ref_font_dict, "FontDescriptor");
-    pdfio_obj_t *font_file_obj = NULL;
-
-    if (descriptor_dict)
-    {
-      font_file_obj = pdfioDictGetObj(descriptor_dict, "FontFile2");
-      if (!font_file_obj)
-        font_file_obj = pdfioDictGetObj(descriptor_dict, "FontFile");
-    }
-
-    int ft_error = -1;
-    FT_Face ft_face = NULL;
-
-    if (font_file_obj)
+    if (!font)
     {
-      pdfio_stream_t *st = pdfioObjOpenStream(font_file_obj, true);
-      if (st)
+      if (doc->num_fonts == doc->alloc_fonts)
       {
-        size_t capacity = 64 * 1024;
-        size_t total_bytes = 0;
-        unsigned char *buffer = malloc(capacity);
+        size_t alloc = doc->alloc_fonts ? doc->alloc_fonts * 2 : 16;
+        p2c_font_t **temp = realloc(doc->fonts, alloc * sizeof(p2c_font_t *));
 
-        if (buffer)
+        if (!temp)
         {
-          ssize_t bytes_read;
-          unsigned char read_buf[4096];
-
-          while ((bytes_read = pdfioStreamRead(st, read_buf, sizeof(read_buf))) > 0)
-          {
-            if (total_bytes + bytes_read > capacity)
-            {
-              capacity *= 2;
-              unsigned char *new_buffer = realloc(buffer, capacity);
-              if (!new_buffer)
-              {
-                free(buffer);
-                buffer = NULL;
-                break;
-              }
-              buffer = new_buffer;
-            }
-            memcpy(buffer + total_bytes, read_buf, bytes_read);
-            total_bytes += bytes_read;
-          }
-
-          if (buffer && total_bytes > 0)
-          {
-            dev->fonts[cur_font]->data = buffer;
-            dev->fonts[cur_font]->data_size = total_bytes;
-
-            ft_error = FT_New_Memory_Face(ft_library, 
-                                          dev->fonts[cur_font]->data, 
-                                          (FT_Long)total_bytes, 
-                                          0, 
-                                          &ft_face);
-          }
-          else if (buffer)
-          {
-            free(buffer);
-          }
+          device_clear_fonts(dev);
+          return false;
         }
-        pdfioStreamClose(st);
+
+        doc->fonts = temp;
+        doc->alloc_fonts = alloc;
       }
-    }
 
-    if (ft_error != 0 || !ft_face)
-    {
-      const char *fallback_path = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
-      ft_error = FT_New_Face(ft_library, fallback_path, 0, &ft_face);
-      
-      if (ft_error != 0)
-        continue;
-    }
+      if ((font = load_font(doc, ref_font_dict)) == NULL)
+      {
+        device_clear_fonts(dev);
+        return false;
+      }
 
-    dev->fonts[cur_font]->ft_face = ft_face;
+      font->obj_number  = obj_number;
+      font->direct_dict = obj_number ? NULL : ref_font_dict;
+      doc->fonts[doc->num_fonts++] = font;
 
-    cairo_font_face_t *cairo_face = cairo_ft_font_face_create_for_ft_face(ft_face, 0);
-    if (cairo_font_face_status(cairo_face) != CAIRO_STATUS_SUCCESS)
-    {
-      FT_Done_Face(ft_face);
-      continue;
+      if (g_verbose)
+        fprintf(stderr, "DEBUG: Loaded font %s (%s) as %s.\n", font->font_name ? font->font_name : "(unnamed)", font->cid ? "CID" : "simple", font_key);
     }
 
-    static const cairo_user_data_key_t cleanup_key;
-    cairo_font_face_set_user_data(cairo_face, &cleanup_key, ft_face, (cairo_destroy_func_t)FT_Done_Face);
+    dev->fonts[cur_font].font = font;
+  }
 
-    dev->fonts[cur_font]->cairo_face = cairo_face;
+  // Index the fonts by resource name for device_set_font()
+  if (!device_index_fonts(dev))
+  {
+    device_clear_fonts(dev);
+    return false;
   }
 
   return true;
@@ -11,11 +11,43 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <pdfio.h>
+#include <cairo/cairo.h>
 #include "../cairo/cairo-device-private.h"
 
 typedef struct cairo_device_s p2c_device_t;
 
+#define PDFRIP_CMAP_STRING 0x80000000	// Value is an offset into the string pool
+#define PDFRIP_CMAP_OWN    0x80000000	// Priority of ranges not inherited through usecmap
+
+// A range of character codes in a CMap
+typedef struct pdfrip_cmap_range_s
+{
+  uint32_t	  first,		// First code
+		  last,			// Last code
+		  value,		// CID or Unicode value of first code
+		  priority;		// Definition order, higher wins overlaps
+  uint8_t	  length;		// Length of codes in bytes
+} pdfrip_cmap_range_t;
+
+// A CMap compiled into range tables
+typedef struct pdfrip_cmap_s
+{
+  char		  name[64];		// CMap name
+  size_t	  obj_number;		// Stream object number, 0 if predefined
+  bool		  identity;		// Identity-H/V?
+  uint8_t	  min_length;		// Shortest code length
+  pdfrip_cmap_range_t *codespace;	// Codespace ranges
+  size_t	  num_codespace;	// Number of codespace ranges
+  pdfrip_cmap_range_t *ranges;		// Code to value ranges, sorted by length and first code
+  size_t	  num_ranges;		// Number of ranges
+  uint32_t	  *strings;		// Multi-character Unicode values, each a count and code points
+  size_t	  num_strings,		// Used size of strings
+		  alloc_strings;	// Allocated size of strings
+} pdfrip_cmap_t;
+
 typedef struct pdfrip_doc_s
 {
   pdfio_file_t 	  *pdf;			// PDF file	
@@ -23,8 +55,94 @@ typedef struct pdfrip_doc_s
   size_t 	  num_pages,		// Number of Pages in PDF file
 		  num_objects;		// Number of Objects in PDF file
   pdfio_dict_t 	  *catalog_dict; 	// Catalog Dictionary of PDF file
+  struct p2c_font_s **fonts;		// Fonts loaded so far, shared by all pages
+  size_t	  num_fonts,		// Number of loaded fonts
+		  alloc_fonts;		// Allocated size of fonts
+  pdfrip_cmap_t	  **cmaps;		// CMaps loaded so far
+  size_t	  num_cmaps,		// Number of loaded CMaps
+		  alloc_cmaps;		// Allocated size of cmaps
+  struct p2c_image_s **images;		// Decoded images, shared by all pages
+  size_t	  num_images,		// Number of cached images
+		  alloc_images,		// Allocated size of images
+		  image_bytes,		// Memory used by cached images
+		  image_bytes_saved;	// Memory saved by scaled JPEG/JPEG 2000 decoding
+  uint64_t	  image_clock;		// Use counter for image eviction
+  struct p2c_palette_s **palettes;	// Indexed color spaces converted to pixels
+  size_t	  num_palettes,		// Number of cached palettes
+		  alloc_palettes;	// Allocated size of palettes
 } pdfrip_doc_t;
 
+#define PDFRIP_IMAGE_CACHE_BUDGET (64 * 1024 * 1024)
+					// Decoded image bytes cached per document
+#define PDFRIP_IMAGE_MAX_PIXELS	(16 * 1024 * 1024)
+					// Largest image decoded whole and cached, in pixels
+#define PDFRIP_IMAGE_MAX_WIDTH	32767	// Widest image drawn, the Cairo surface limit
+#define PDFRIP_IMAGE_STRIP_BYTES (4 * 1024 * 1024)
+					// Pixels decoded at a time for larger images
+#define PDFRIP_JPX_MAX_SCALE	32	// Largest JPEG 2000 reduction, 5 levels
+#define PDFRIP_IMAGE_MAX_SHRINK	64	// Largest box filter reduction per axis
+
+// Image row conversion kernels, packed samples to Cairo RGB24 pixels
+typedef enum pdfrip_convert_e
+{
+  PDFRIP_CONVERT_GRAY1,			// 1-bit gray with two gray levels
+  PDFRIP_CONVERT_GRAY8,			// 8-bit gray
+  PDFRIP_CONVERT_RGB8,			// 8-bit RGB
+  PDFRIP_CONVERT_CMYK8,			// 8-bit CMYK
+  PDFRIP_CONVERT_RGB16,			// 16-bit RGB, high bytes only
+  PDFRIP_CONVERT_MAX
+} pdfrip_convert_t;
+
+// Instruction sets for image conversion
+typedef enum pdfrip_simd_e
+{
+  PDFRIP_SIMD_NONE,			// Scalar reference code
+  PDFRIP_SIMD_SSE2,			// x86 SSE2
+  PDFRIP_SIMD_AVX2			// x86 AVX2
+} pdfrip_simd_t;
+
+typedef void (*pdfrip_convert_cb_t)(const uint8_t *src, uint32_t *dst, size_t width, const uint8_t *gray);
+
+// 1-bit samples to Cairo A8 coverage, for stencil masks and bilevel images
+typedef void (*pdfrip_expand_cb_t)(const uint8_t *src, uint8_t *dst, size_t width, const uint8_t *alpha);
+
+// CCITTFaxDecode parameters, from /DecodeParms
+typedef struct pdfrip_ccitt_params_s
+{
+  int		  k,			// <0 Group 4, 0 Group 3 1-D, >0 Group 3 2-D
+		  columns,		// Pixels per row
+		  rows;			// Number of rows, 0 if unknown
+  bool		  end_of_line,		// EOL codes before each row?
+		  byte_align,		// Rows padded to byte boundaries?
+		  end_of_block,		// Data ends with RTC or EOFB?
+		  black_is_1;		// Are 1 bits black?
+} pdfrip_ccitt_params_t;
+
+// Reads encoded CCITT data, like pdfioStreamRead()
+typedef ssize_t (*pdfrip_ccitt_cb_t)(void *cb_data, uint8_t *buffer, size_t bytes);
+
+typedef struct pdfrip_ccitt_s pdfrip_ccitt_t;
+
+// Size of a decoded JPXDecode image
+typedef struct pdfrip_jpx_info_s
+{
+  int		  width,		// Width after reduction
+		  height,		// Height after reduction
+		  num_components,	// Components per pixel
+		  scale;		// Reduction, 1 for full size
+} pdfrip_jpx_info_t;
+
+typedef struct pdfrip_jpx_s pdfrip_jpx_t;
+
+// Memory used by the fonts of a document
+typedef struct pdfrip_font_memory_s
+{
+  size_t	  num_fonts,		// Number of loaded fonts
+		  programs,		// Embedded font programs
+		  metrics,		// Font records, widths, CID and Unicode tables
+		  caches;		// Glyph outlines, Type 3 programs and masks
+} pdfrip_font_memory_t;
+
 pdfrip_doc_t* getPDFdata(pdfio_file_t *pdf); 		// get all metadata of PDF file
 pdfrip_doc_t* openPDFfile(char* filename);		// open PDF file
 void 	      freePDFdoc(pdfrip_doc_t *PDF_data);	// free the data structure
@@ -47,5 +165,48 @@ void freePageData(pdfrip_page_t *page);
 
 // Text helper functions
 bool getPageFonts(p2c_device_t *dev);
-void load_encoding(pdfio_obj_t *page_obj, const char *name, int encoding[256]);
+void load_encoding(pdfio_dict_t *font_dict, int encoding[256]);
+int  glyph_name_to_unicode(const char *name);
+void freeDocFonts(pdfrip_doc_t *doc);
+void getDocFontMemory(pdfrip_doc_t *doc, pdfrip_font_memory_t *memory);
+
+// CMap functions
+const pdfrip_cmap_t *cmap_get(pdfrip_doc_t *doc, pdfio_dict_t *font_dict, const char *collection);
+const pdfrip_cmap_t *cmap_get_predefined(pdfrip_doc_t *doc, const char *name, const char *collection);
+const pdfrip_cmap_t *cmap_get_to_unicode(pdfrip_doc_t *doc, pdfio_dict_t *font_dict);
+size_t              cmap_decode(const pdfrip_cmap_t *cmap, const unsigned char *str, size_t len, uint32_t *cid);
+bool                cmap_lookup(const pdfrip_cmap_t *cmap, uint32_t code, size_t length, uint32_t *value);
+size_t              cmap_unicode(const pdfrip_cmap_t *cmap, uint32_t value, uint32_t *text, size_t textsize);
+void                cmap_free(pdfrip_cmap_t *cmap);
+void                freeDocCMaps(pdfrip_doc_t *doc);
+
+// Image functions
+struct p2c_image_s  *getDocImage(pdfrip_doc_t *doc, pdfio_obj_t *obj, pdfio_dict_t *resources, double target_width, double target_height);
+cairo_surface_t     *getDocImageScaled(pdfrip_doc_t *doc, struct p2c_image_s *image, double target_width, double target_height);
+void                freeDocImages(pdfrip_doc_t *doc);
+void                freeDocPalettes(pdfrip_doc_t *doc);
+pdfrip_convert_cb_t image_convert_func(pdfrip_convert_t kernel, pdfrip_simd_t simd);
+pdfrip_simd_t       image_simd_level(void);
+pdfrip_expand_cb_t  image_expand_func(pdfrip_simd_t simd);
+cairo_surface_t     *image_shrink(cairo_surface_t *src, int x_factor, int y_factor, pdfrip_simd_t simd);
+struct p2c_image_strips_s *openImageStrips(pdfio_obj_t *obj, pdfio_dict_t *resources, double target_width, double target_height, const pdfio_rect_t *area);
+cairo_surface_t     *readImageStrip(struct p2c_image_strips_s *strips, int y, int rows);
+void                closeImageStrips(struct p2c_image_strips_s *strips);
+
+// CCITT fax decoder
+void                ccitt_get_params(pdfio_dict_t *dict, pdfrip_ccitt_params_t *params);
+pdfrip_ccitt_t      *ccitt_open(const pdfrip_ccitt_params_t *params, pdfrip_ccitt_cb_t cb, void *cb_data);
+bool                ccitt_read_row(pdfrip_ccitt_t *c, uint8_t *row);
+void                ccitt_close(pdfrip_ccitt_t *c);
+
+// JPEG 2000 decoder
+pdfrip_jpx_t        *jpx_open(pdfio_obj_t *obj, int num_components, int scale, const pdfio_rect_t *area, pdfrip_jpx_info_t *info);
+bool                jpx_read_row(pdfrip_jpx_t *jpx, uint8_t *row);
+void                jpx_close(pdfrip_jpx_t *jpx);
+
+// Font substitution
+void                fontsub_parse_name(const char *base_font, char *family, size_t familysize, int *weight, int *slant);
+bool                fontsub_get(const char *base_font, int flags, const char *lang, const unsigned char **data, size_t *size, int *index);
+void                fontsub_clear(void);
+
 #endif //PDFOPS_PRIVATE_H
@@ -21,7 +21,7 @@ getPDFdata(pdfio_file_t *pdf)		// I - PDF file in pdfio_file_t
     return NULL;
   }
 
-  pdfrip_doc_t *PDF_data = (pdfrip_doc_t*)malloc(sizeof(pdfrip_doc_t));
+  pdfrip_doc_t *PDF_data = (pdfrip_doc_t*)calloc(1, sizeof(pdfrip_doc_t));
   
   PDF_data->pdf 	  = pdf;
   PDF_data->version 	  = pdfioFileGetVersion(pdf);
@@ -82,6 +82,11 @@ openPDFfile(char* filename)		// I - PDF filename
 void 					  // O - Void output
 freePDFdoc(pdfrip_doc_t *PDF_data)	// I - ripPDF doc
 {
+  // Fonts reference the CMaps and the file, so free them first
+  freeDocFonts(PDF_data);
+  freeDocCMaps(PDF_data);
+  freeDocImages(PDF_data);
+  freeDocPalettes(PDF_data);
   pdfioFileClose(PDF_data->pdf);
   free(PDF_data);
 }
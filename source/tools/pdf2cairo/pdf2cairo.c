@@ -33,7 +33,10 @@ print_usage(const char *prog_name) // I - Program name
   fprintf(stderr, "  -t                     Generate a temporary filename (e.g., 'inputResult123.png').\n");
   fprintf(stderr, "                         Must be used with the -d option.\n");
   fprintf(stderr, "  -d <directory>         Specify the output directory when using -t.\n");
+  fprintf(stderr, "  -g <pixels>            Draw text smaller than <pixels> as gray bars (greeking).\n");
   fprintf(stderr, "  -T                     Generate a temporary filename in 'testfiles/renderer-output/'.\n");
+  fprintf(stderr, "  -x <text|json>         Extract text instead of rendering, to -o or stdout.\n");
+  fprintf(stderr, "                         'json' gives word bounding boxes at the -r resolution.\n");
   fprintf(stderr, "  -v                     Enable verbose debugging output.\n"); 
 }
 
@@ -52,7 +55,12 @@ main(int argc, 		// I - Number of command-line args
   char 			*output_filename = NULL; 	// output filename
   int 			pagenum = 1;
   size_t 		cur_page;			// page iterator
+  size_t		text_pages = 0;			// Pages of text written
   int 			dpi = 72;
+  double 		greek_threshold = 0.0;		// Greeking threshold in pixels
+  int			text_mode = 0;			// Extract text instead of rendering?
+  p2c_text_format_t	text_format = P2C_TEXT_PLAIN;	// Text output format
+  FILE			*text_fp = stdout;		// Text output file
   int analyze_mode = 0;
   int opt;
  
@@ -82,7 +90,7 @@ main(int argc, 		// I - Number of command-line args
       break;
     }
   }
-  while ((opt = getopt(argc, argv, "o:p:r:d:tTv")) != -1)
+  while ((opt = getopt(argc, argv, "o:p:r:d:g:tTvx:")) != -1)
   {
     switch (opt)
     {
@@ -98,6 +106,9 @@ main(int argc, 		// I - Number of command-line args
     case 'd':
       output_dir = optarg;
       break;
+    case 'g':
+      greek_threshold = atof(optarg);
+      break;
     case 't':
       t_flag = 1;
       break;
@@ -107,6 +118,17 @@ main(int argc, 		// I - Number of command-line args
     case 'v': 
       g_verbose = 1;
       break;
+    case 'x':
+      text_mode = 1;
+      if (!strcmp(optarg, "json"))
+        text_format = P2C_TEXT_JSON;
+      else if (strcmp(optarg, "text"))
+      {
+        fprintf(stderr, "ERROR: Unknown text format '%s'.\n", optarg);
+        print_usage(argv[0]);
+        return (1);
+      }
+      break;
     default: // '?'
       print_usage(argv[0]);
       return (1);
@@ -124,8 +146,15 @@ main(int argc, 		// I - Number of command-line args
     return (1);
   }
 
+  // --- Output File for Text Extraction Mode ---
+  if (text_mode && output_filename && (text_fp = fopen(output_filename, "w")) == NULL)
+  {
+    perror(output_filename);
+    return (1);
+  }
+
   // --- Filename and Argument Validation for Render Mode ---
-  if (!analyze_mode)
+  if (!analyze_mode && !text_mode)
   {
     int output_options_count = (output_filename != NULL) + t_flag + T_flag;
     if (output_options_count > 1)
@@ -178,15 +207,20 @@ main(int argc, 		// I - Number of command-line args
   //pdf FIle processing
   PDF_doc = openPDFfile(input_filename);	
 
+  if (text_mode && text_format == P2C_TEXT_JSON)
+    fputs("{\"pages\":[\n", text_fp);
+
   for(cur_page=0; cur_page<PDF_doc->num_pages ; cur_page++)
   {
     pdfrip_page_t *page = getPageData(PDF_doc, cur_page); 
     
-    p2c_device_t *dev = device_create(page, dpi);
+    // Text extraction skips the surface, painting and PNG encoding
+    p2c_device_t *dev = text_mode ? device_create_text(page, dpi) : device_create(page, dpi);
     if (dev)
     {
       // this sets the current page being worked upon into the context(dev will act as context)
       dev->page_obj = page->object;
+      dev->greek_threshold = greek_threshold;
 
       if(!page->resources_dict)
       { 
@@ -228,13 +262,45 @@ main(int argc, 		// I - Number of command-line args
       dev->xobject_dict = xobject_res_obj ? pdfioObjGetDict(xobject_res_obj) : NULL;
 
       process_content_stream(dev, page);
-      device_save_to_png(dev, output_filename);
+
+      if (text_mode)
+      {
+        // Separate from the previous page written, which may not be the
+        // previous page of the document
+        if (text_pages ++ > 0)
+          fputs(text_format == P2C_TEXT_JSON ? ",\n" : "\f", text_fp);
+        device_write_text(dev, text_fp, text_format, cur_page + 1);
+      }
+      else
+        device_save_to_png(dev, output_filename);
+
       device_destroy(dev);
     }
     freePageData(page);
   }
 
+  if (text_mode)
+  {
+    if (text_format == P2C_TEXT_JSON)
+      fputs("\n]}\n", text_fp);
+    if (text_fp != stdout)
+      fclose(text_fp);
+  }
+
   fprintf(stderr, "%s\n", PDF_doc->version);
+
+  if (g_verbose)
+  {
+    pdfrip_font_memory_t memory;		// Font memory of the document
+
+    getDocFontMemory(PDF_doc, &memory);
+    fprintf(stderr, "DEBUG: %zu fonts use %zu bytes (programs %zu, metrics %zu, caches %zu).\n",
+            memory.num_fonts, memory.programs + memory.metrics + memory.caches,
+            memory.programs, memory.metrics, memory.caches);
+    fprintf(stderr, "DEBUG: %zu images use %zu bytes, scaled JPEG decoding saved %zu bytes.\n",
+            PDF_doc->num_images, PDF_doc->image_bytes, PDF_doc->image_bytes_saved);
+  }
+
   freePDFdoc(PDF_doc);
 
   return 0;
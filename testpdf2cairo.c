@@ -6,7 +6,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include "test.h"  // testBegin and testEnd functions come from here
+#include "pdfops-private.h"
+#include "cairo-private.h"
 #include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fontconfig/fontconfig.h>
+#include <pthread.h>
 
 int g_verbose = 0;
 
@@ -55,18 +61,1213 @@ static renderer_test_t manual_tests[] =
   { "TestStrokedRectangles", 	"shapes/TestStrokedRectangles.pdf", 	"", "T", ""},
   { "TestStrokedStars", 	"shapes/TestStrokedStars.pdf", 	"", "T", ""},
   { "TestTables", 		"shapes/TestTables.pdf",		"", "T", ""},
+  { "IndexedColors", 		"shapes/IndexedColors.pdf",		"", "T", ""},
   { "simpleText", 		"text/simpleText.pdf", 	"", "T", ""},
   { "TextColumnWise", 		"text/TextColumnWise.pdf", 	"", "T", ""},
   { "TextColumnWithMultipleFont", "text/TextColumnWithMultipleFont.pdf", "", "T", ""},
   { "TextWithShape", 		"text/TextWithShape.pdf", 	"", "T", ""},
+  { "TextColumnWise greeked",	"text/TextColumnWise.pdf", 	"-r 24 -g 8", "T", ""},
+  { "Type3Text",			"text/Type3Text.pdf", 		"-r 150", "T", ""},
+  { "simpleImage",		"xobject/simpleImage.pdf", 	"", "T", ""},
+  { "simpleImage thumbnail",	"xobject/simpleImage.pdf", 	"-r 18", "T", ""},
+  { "ImageFormats",		"xobject/ImageFormats.pdf", 	"-r 150", "T", ""},
+  { "LargeImage",		"xobject/LargeImage.pdf", 	"", "T", ""},
+  { "StencilMask",		"xobject/StencilMask.pdf", 	"", "T", ""},
+  { "CCITTFax",		"xobject/CCITTFax.pdf", 	"", "T", ""},
+  { "JPXImages",		"xobject/JPXImages.pdf", 	"", "T", ""},
+  { "JPXImages thumbnail",	"xobject/JPXImages.pdf", 	"-r 18", "T", ""},
 };
 
+//
+// 'test_glyph_names()' - Test the glyph name table used by /Differences arrays.
+//
+
+static int
+test_glyph_names(void)
+{
+  int status = 0;
+
+  testBegin("glyph_name_to_unicode(\"A\")");
+  if (glyph_name_to_unicode("A") == 0x0041) testEnd(true);
+  else status = 1, testEnd(false);
+
+  testBegin("glyph_name_to_unicode(\"zeta\")");
+  if (glyph_name_to_unicode("zeta") == 0x03b6) testEnd(true);
+  else status = 1, testEnd(false);
+
+  testBegin("glyph_name_to_unicode(\"Delta\") (duplicate name)");
+  if (glyph_name_to_unicode("Delta") == 0x0394) testEnd(true);
+  else status = 1, testEnd(false);
+
+  testBegin("glyph_name_to_unicode(\"minus\")");
+  if (glyph_name_to_unicode("minus") == 0x2212) testEnd(true);
+  else status = 1, testEnd(false);
+
+  testBegin("glyph_name_to_unicode(\"nosuchglyph\")");
+  if (glyph_name_to_unicode("nosuchglyph") == -1) testEnd(true);
+  else status = 1, testEnd(false);
+
+  return (status);
+}
+
+//
+// 'test_cmap()' - Test CMap compilation, decoding, ToUnicode and CID widths.
+//
+
+static int
+test_cmap(void)
+{
+  int status = 0;
+  char dir[256], filename[512];
+  FILE *fp;
+  pdfrip_doc_t doc = { 0 };
+  const pdfrip_cmap_t *cmap;
+  uint32_t cid;
+  size_t n;
+  static const char cmap_data[] =
+    "%!PS-Adobe-3.0 Resource-CMap\n"
+    "/CMapName /Test-H def\n"
+    "2 begincodespacerange\n"
+    "<00> <80>\n"
+    "<8140> <FCFC>\n"
+    "endcodespacerange\n"
+    "2 begincidrange\n"
+    "<20> <7e> 1\n"
+    "<8140> <817e> 633\n"
+    "endcidrange\n"
+    "1 begincidchar\n"
+    "<8150> 9000\n"
+    "endcidchar\n";
+  static const char to_unicode_data[] =
+    "/CIDInit /ProcSet findresource begin\n"
+    "1 begincodespacerange <00> <FF> endcodespacerange\n"
+    "3 beginbfchar\n"
+    "<01> <0066006C>\n"
+    "<02> <D835DC00>\n"
+    "<03> /Zeta\n"
+    "endbfchar\n"
+    "2 beginbfrange\n"
+    "<41> <5A> <0410>\n"
+    "<61> <62> [<00E6> <0153>]\n"
+    "endbfrange\n";
+
+  snprintf(dir, sizeof(dir), "/tmp/pdfrip-cmap-%d", (int)getpid());
+  snprintf(filename, sizeof(filename), "%s/Test-H", dir);
+  mkdir(dir, 0700);
+  if ((fp = fopen(filename, "w")) != NULL)
+  {
+    fputs(cmap_data, fp);
+    fclose(fp);
+  }
+  snprintf(filename, sizeof(filename), "%s/Test-UCS", dir);
+  if ((fp = fopen(filename, "w")) != NULL)
+  {
+    fputs(to_unicode_data, fp);
+    fclose(fp);
+  }
+  setenv("PDFRIP_CMAP_DIR", dir, 1);
+
+  // The cidchar splits the second cidrange, leaving no overlapping ranges
+  testBegin("cmap_get_predefined(\"Test-H\")");
+  if ((cmap = cmap_get_predefined(&doc, "Test-H", NULL)) != NULL && cmap->num_ranges == 4)
+    testEnd(true);
+  else
+    status = 1, testEnd(false);
+
+  if (cmap)
+  {
+    testBegin("cmap_decode one-byte code");
+    n = cmap_decode(cmap, (const unsigned char *)"A", 1, &cid);
+    if (n == 1 && cid == 34) testEnd(true);
+    else status = 1, testEndMessage(false, "got %u bytes, CID %u", (unsigned)n, (unsigned)cid);
+
+    testBegin("cmap_decode two-byte code");
+    n = cmap_decode(cmap, (const unsigned char *)"\x81\x41", 2, &cid);
+    if (n == 2 && cid == 634) testEnd(true);
+    else status = 1, testEndMessage(false, "got %u bytes, CID %u", (unsigned)n, (unsigned)cid);
+
+    testBegin("cmap_decode cidchar inside cidrange");
+    n = cmap_decode(cmap, (const unsigned char *)"\x81\x50", 2, &cid);
+    if (n == 2 && cid == 9000) testEnd(true);
+    else status = 1, testEndMessage(false, "got %u bytes, CID %u", (unsigned)n, (unsigned)cid);
+
+    testBegin("cmap_decode cidrange after cidchar");
+    n = cmap_decode(cmap, (const unsigned char *)"\x81\x51", 2, &cid);
+    if (n == 2 && cid == 650) testEnd(true);
+    else status = 1, testEndMessage(false, "got %u bytes, CID %u", (unsigned)n, (unsigned)cid);
+
+    testBegin("cmap_get_predefined caches CMaps");
+    if (cmap_get_predefined(&doc, "Test-H", NULL) == cmap && doc.num_cmaps == 1) testEnd(true);
+    else status = 1, testEnd(false);
+  }
+
+  testBegin("ToUnicode bfchar/bfrange");
+  if ((cmap = cmap_get_predefined(&doc, "Test-UCS", NULL)) != NULL)
+  {
+    p2c_font_t font = { .to_unicode = cmap };
+    uint32_t text[4], value;
+    size_t count;
+    bool ok = true;
+
+    for (int code = 0; code < 256; code ++)
+      cmap_lookup(cmap, (uint32_t)code, 1, font.unicode + code);
+
+    ok &= cmap_lookup(cmap, 'C', 1, &value) && value == 0x0412;
+    ok &= !cmap_lookup(cmap, '0', 1, &value);
+    ok &= p2c_font_get_unicode(&font, (const unsigned char *)"b", 1, text, 4) == 1 && text[0] == 0x0153;
+    ok &= p2c_font_get_unicode(&font, (const unsigned char *)"\3", 1, text, 4) == 1 && text[0] == 0x0396;
+    ok &= p2c_font_get_unicode(&font, (const unsigned char *)"\2", 1, text, 4) == 1 && text[0] == 0x1d400;
+    count = p2c_font_get_unicode(&font, (const unsigned char *)"\1", 1, text, 4);
+    ok &= count == 2 && text[0] == 'f' && text[1] == 'l';
+
+    if (ok)
+      testEnd(true);
+    else
+      status = 1, testEnd(false);
+  }
+  else
+    status = 1, testEnd(false);
+
+  testBegin("cmap_decode Identity-H");
+  cmap = cmap_get_predefined(&doc, "Identity-H", NULL);
+  n = cmap_decode(cmap, (const unsigned char *)"\x12\x34", 2, &cid);
+  if (n == 2 && cid == 0x1234) testEnd(true);
+  else status = 1, testEnd(false);
+
+  freeDocCMaps(&doc);
+  unsetenv("PDFRIP_CMAP_DIR");
+  unlink(filename);
+  snprintf(filename, sizeof(filename), "%s/Test-H", dir);
+  unlink(filename);
+  rmdir(dir);
+
+  // The embedded CMap of UseCMap.pdf has a cidrange over a cidchar of its
+  // /UseCMap parent, and maps one code twice
+  testBegin("cmap_get embedded CMap over /UseCMap parent");
+  {
+    pdfrip_doc_t	*pdf = openPDFfile("testfiles/input/text/UseCMap.pdf");
+    pdfrip_page_t	*page = pdf ? getPageData(pdf, 0) : NULL;
+    pdfio_dict_t	*font_dict;	// Type0 font
+    uint32_t		cids[4] = { 0 };// CIDs of the test codes
+
+    font_dict = page ? pdfioObjGetDict(pdfioDictGetObj(pdfioDictGetDict(page->resources_dict, "Font"), "F1")) : NULL;
+    cmap      = font_dict ? cmap_get(pdf, font_dict, NULL) : NULL;
+
+    if (cmap && cmap_decode(cmap, (const unsigned char *)"\x01\x00", 2, cids) == 2 &&
+        cmap_decode(cmap, (const unsigned char *)"\x01\x41", 2, cids + 1) == 2 &&
+        cmap_decode(cmap, (const unsigned char *)"\x01\x50", 2, cids + 2) == 2 &&
+        cmap_decode(cmap, (const unsigned char *)"\x01\x60", 2, cids + 3) == 2 &&
+        cids[0] == 100 && cids[1] == 7001 && cids[2] == 2016 && cids[3] == 196)
+      testEnd(true);
+    else if (cmap)
+      status = 1, testEndMessage(false, "got CIDs %u, %u, %u, %u", (unsigned)cids[0], (unsigned)cids[1], (unsigned)cids[2], (unsigned)cids[3]);
+    else
+      status = 1, testEnd(false);
+
+    if (page)
+      freePageData(page);
+    if (pdf)
+      freePDFdoc(pdf);
+  }
+
+  testBegin("p2c_font_cid_width");
+  {
+    p2c_cid_width_t widths[] = { { 1, 1, 250 }, { 2, 95, 500 }, { 633, 700, 1000 } };
+    p2c_font_t font = { .cid = true, .cid_widths = widths, .num_cid_widths = 3, .default_width = 750 };
+
+    if (p2c_font_cid_width(&font, 1) == 250 && p2c_font_cid_width(&font, 50) == 500 &&
+        p2c_font_cid_width(&font, 700) == 1000 && p2c_font_cid_width(&font, 96) == 750)
+      testEnd(true);
+    else
+      status = 1, testEnd(false);
+  }
+
+  return (status);
+}
+
+//
+// 'test_text_extraction()' - Test word grouping and output of text extraction.
+//
+
+static int
+test_text_extraction(void)
+{
+  int status = 0;
+  p2c_device_t dev = { 0 };
+  p2c_text_page_t page = { 0 };
+  const char *chars = "Hi you";
+  char buffer[1024] = "";
+  FILE *fp;
+  double x = 10.0;
+
+  dev.extract = &page;
+  dev.width = 612.0;
+  dev.height = 792.0;
+
+  // "Hi you" on one line, then a Cyrillic word and a quote on the next
+  for (const char *ch = chars; *ch; ch ++, x += 6.0)
+  {
+    uint32_t text = (uint32_t)*ch;
+    double bbox[4] = { x, 90.0, x + 6.0, 100.0 }, origin[2] = { x, 98.0 }, end[2] = { x + 6.0, 98.0 };
+
+    device_add_text_char(&dev, &text, 1, bbox, origin, end, 10.0);
+  }
+
+  {
+    uint32_t text[] = { 0x0416, '"' };
+    double bbox[4] = { 10.0, 110.0, 16.0, 120.0 }, origin[2] = { 10.0, 118.0 }, end[2] = { 16.0, 118.0 };
+
+    device_add_text_char(&dev, text, 2, bbox, origin, end, 10.0);
+  }
+
+  testBegin("device_add_text_char word grouping");
+  if (page.num_words == 3 && page.words[1].length == 3 && page.words[1].x1 == 28.0 && page.words[1].x2 == 46.0)
+    testEnd(true);
+  else
+    status = 1, testEndMessage(false, "got %u words", (unsigned)page.num_words);
+
+  testBegin("device_write_text plain text");
+  if ((fp = tmpfile()) != NULL)
+  {
+    device_write_text(&dev, fp, P2C_TEXT_PLAIN, 1);
+    rewind(fp);
+    buffer[fread(buffer, 1, sizeof(buffer) - 1, fp)] = '\0';
+    fclose(fp);
+  }
+  if (!strcmp(buffer, "Hi you\n\xd0\x96\"\n"))
+    testEnd(true);
+  else
+    status = 1, testEndMessage(false, "got '%s'", buffer);
+
+  testBegin("device_write_text JSON");
+  if ((fp = tmpfile()) != NULL)
+  {
+    device_write_text(&dev, fp, P2C_TEXT_JSON, 1);
+    rewind(fp);
+    buffer[fread(buffer, 1, sizeof(buffer) - 1, fp)] = '\0';
+    fclose(fp);
+  }
+  if (strstr(buffer, "{\"text\":\"you\",\"bbox\":[28.00,90.00,46.00,100.00]}") &&
+      strstr(buffer, "\"text\":\"\xd0\x96\\\"\""))
+    testEnd(true);
+  else
+    status = 1, testEndMessage(false, "got '%s'", buffer);
+
+  free(page.text);
+  free(page.words);
+
+  return (status);
+}
+
+//
+// 'test_outline_cache()' - Test the per-font glyph outline cache.
+//
+
+static int
+test_outline_cache(void)
+{
+  int status = 0;
+  FT_Library library;
+  p2c_font_t *font;
+  const p2c_outline_t *outline;
+  bool bounded = true;
+
+  testBegin("Glyph outline cache");
+  if (FT_Init_FreeType(&library))
+  {
+    testEndMessage(false, "Unable to initialize FreeType.");
+    return (1);
+  }
+
+  font = calloc(1, sizeof(p2c_font_t));
+  if (FT_New_Face(library, "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf", 0, &font->ft_face))
+  {
+    testEndMessage(true, "skipped, DejaVuSans.ttf not installed");
+    free(font);
+    FT_Done_FreeType(library);
+    return (0);
+  }
+
+  outline = p2c_font_get_outline(font, FT_Get_Char_Index(font->ft_face, 'A'));
+  if (!outline || outline->num_data == 0)
+    status = 1, testEndMessage(false, "No outline for 'A'.");
+  else if (p2c_font_get_outline(font, outline->glyph) != outline)
+    status = 1, testEndMessage(false, "Second lookup was not a cache hit.");
+  else
+  {
+    for (FT_Long glyph = 0; glyph < font->ft_face->num_glyphs; glyph ++)
+    {
+      p2c_font_get_outline(font, (FT_UInt)glyph);
+      if (font->outlines.bytes > P2C_OUTLINE_CACHE_BUDGET && font->outlines.lru_head != font->outlines.lru_tail)
+        bounded = false;
+    }
+
+    if (bounded)
+      testEnd(true);
+    else
+      status = 1, testEndMessage(false, "Cache grew past its budget.");
+  }
+
+  p2c_outline_cache_clear(&font->outlines);
+  FT_Done_Face(font->ft_face);
+  free(font);
+  FT_Done_FreeType(library);
+
+  return (status);
+}
+
+//
+// 'test_glyph_cache()' - Test hits, sub-pixel keys and eviction of the glyph mask cache.
+//
+
+static int
+test_glyph_cache(void)
+{
+  static const cairo_user_data_key_t cleanup_key;
+  int			status = 0;
+  p2c_font_t		*font;
+  cairo_matrix_t	font_matrix;
+  cairo_surface_t	*mask;
+  int			mask_x, mask_y;
+  size_t		count, bytes, hits, misses;
+  FT_UInt		glyph;
+
+  testBegin("Glyph mask cache");
+  font = calloc(1, sizeof(p2c_font_t));
+  if (FT_New_Face(p2c_font_library(), "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf", 0, &font->ft_face))
+  {
+    testEndMessage(true, "skipped, DejaVuSans.ttf not installed");
+    free(font);
+    return (0);
+  }
+
+  font->font_id    = 1;
+  font->cairo_face = cairo_ft_font_face_create_for_ft_face(font->ft_face, 0);
+  glyph            = FT_Get_Char_Index(font->ft_face, 'A');
+
+  cairo_matrix_init_scale(&font_matrix, 24.0, 24.0);
+  p2c_glyph_cache_clear();
+  p2c_glyph_cache_set_budget(P2C_GLYPH_CACHE_BUDGET);
+
+  // Cairo may hold on to the face after we let go, so it closes the FreeType face
+  if (font->cairo_face)
+    cairo_font_face_set_user_data(font->cairo_face, &cleanup_key, font->ft_face, p2c_font_done_face);
+  else
+    p2c_font_done_face(font->ft_face);
+
+  if (!font->cairo_face || cairo_font_face_status(font->cairo_face) != CAIRO_STATUS_SUCCESS)
+  {
+    testEndMessage(true, "skipped, unable to create a Cairo face");
+  }
+  else if (!p2c_glyph_cache_get(font, glyph, &font_matrix, 10.0, 30.0, &mask, &mask_x, &mask_y) || !mask)
+  {
+    status = 1, testEndMessage(false, "No mask for 'A'.");
+  }
+  else
+  {
+    cairo_surface_destroy(mask);
+
+    // Same glyph at the same sub-pixel offset in another pixel is a hit
+    if (p2c_glyph_cache_get(font, glyph, &font_matrix, 50.0, 30.0, &mask, &mask_x, &mask_y) && mask)
+      cairo_surface_destroy(mask);
+    // A quarter pixel over is a new mask
+    if (p2c_glyph_cache_get(font, glyph, &font_matrix, 50.25, 30.0, &mask, &mask_x, &mask_y) && mask)
+      cairo_surface_destroy(mask);
+
+    p2c_glyph_cache_stats(&count, &bytes, &hits, &misses);
+    if (count != 2 || hits != 1 || misses != 2)
+    {
+      status = 1, testEndMessage(false, "Got %zu glyphs, %zu hits, %zu misses.", count, hits, misses);
+    }
+    else
+    {
+      p2c_glyph_cache_set_budget(16384);
+
+      for (FT_UInt i = 0; i < 200; i ++)
+      {
+        if (p2c_glyph_cache_get(font, i, &font_matrix, 10.0, 30.0, &mask, &mask_x, &mask_y) && mask)
+          cairo_surface_destroy(mask);
+      }
+
+      p2c_glyph_cache_stats(&count, &bytes, &hits, &misses);
+      if (bytes > 16384 && count > 1)
+        status = 1, testEndMessage(false, "Cache grew to %zu bytes.", bytes);
+      else
+        testEnd(true);
+    }
+  }
+
+  p2c_glyph_cache_clear();
+  p2c_glyph_cache_set_budget(P2C_GLYPH_CACHE_BUDGET);
+
+  if (font->cairo_face)
+    cairo_font_face_destroy(font->cairo_face);
+  free(font);
+
+  return (status);
+}
+
+//
+// 'test_font_substitution()' - Test BaseFont parsing and the substitute cache.
+//
+
+static int
+test_font_substitution(void)
+{
+  static const struct
+  {
+    const char	*base_font;		// BaseFont name
+    const char	*family;		// Expected family
+    int		weight;			// Expected weight
+    int		slant;			// Expected slant
+  } names[] =
+  {
+    { "Helvetica",			"Helvetica",	FC_WEIGHT_REGULAR,	FC_SLANT_ROMAN },
+    { "Helvetica-BoldOblique",		"Helvetica",	FC_WEIGHT_BOLD,		FC_SLANT_OBLIQUE },
+    { "Times-Roman",			"Times",	FC_WEIGHT_REGULAR,	FC_SLANT_ROMAN },
+    { "ABCDEF+ArialMT",			"Arial",	FC_WEIGHT_REGULAR,	FC_SLANT_ROMAN },
+    { "TimesNewRomanPS-BoldItalicMT",	"TimesNewRoman",FC_WEIGHT_BOLD,		FC_SLANT_ITALIC },
+    { "Arial,Bold",			"Arial",	FC_WEIGHT_BOLD,		FC_SLANT_ROMAN },
+    { "ArialBold",			"Arial",	FC_WEIGHT_BOLD,		FC_SLANT_ROMAN },
+    { "MyriadPro-Semibold",		"MyriadPro",	FC_WEIGHT_DEMIBOLD,	FC_SLANT_ROMAN }
+  };
+  int			status = 0;
+  char			family[256];
+  int			weight, slant;
+  const unsigned char	*data1, *data2;
+  size_t		size1, size2;
+  int			index1, index2;
+
+  testBegin("Font substitution name parsing");
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i ++)
+  {
+    fontsub_parse_name(names[i].base_font, family, sizeof(family), &weight, &slant);
+    if (strcmp(family, names[i].family) || weight != names[i].weight || slant != names[i].slant)
+    {
+      testEndMessage(false, "%s parsed as %s/%d/%d.", names[i].base_font, family, weight, slant);
+      return (1);
+    }
+  }
+  testEnd(true);
+
+  testBegin("Font substitution cache");
+  if (!fontsub_get("Helvetica-Bold", 0, NULL, &data1, &size1, &index1))
+  {
+    testEndMessage(true, "skipped, no substitute fonts installed");
+    return (0);
+  }
+
+  if (!fontsub_get("ABCDEF+Helvetica-Bold", 0, NULL, &data2, &size2, &index2))
+    status = 1, testEndMessage(false, "Subset name did not resolve.");
+  else if (data1 != data2 || size1 != size2 || index1 != index2)
+    status = 1, testEndMessage(false, "Same BaseFont mapped twice.");
+  else
+    testEnd(true);
+
+  fontsub_clear();
+
+  return (status);
+}
+
+//
+// 'test_font_memory()' - Test the per-document font memory report.
+//
+
+static int
+test_font_memory(void)
+{
+  pdfrip_doc_t		doc;
+  p2c_font_t		fonts[2], *font_ptrs[2] = { fonts, fonts + 1 };
+  pdfrip_font_memory_t	memory;
+  int			status = 0;
+
+  memset(&doc, 0, sizeof(doc));
+  memset(fonts, 0, sizeof(fonts));
+
+  fonts[0].data_size      = 40000;
+  fonts[0].num_widths     = 100;
+  fonts[1].data_size      = 2000000;
+  fonts[1].num_cid_widths = 10;
+  fonts[1].outlines.bytes = 5000;
+
+  doc.fonts     = font_ptrs;
+  doc.num_fonts = 2;
+
+  testBegin("getDocFontMemory");
+  getDocFontMemory(&doc, &memory);
+
+  if (memory.num_fonts != 2 || memory.programs != 2040000 || memory.caches != 5000 ||
+      memory.metrics != 2 * sizeof(p2c_font_t) + 100 * sizeof(double) + 10 * sizeof(p2c_cid_width_t))
+    status = 1, testEndMessage(false, "Got %zu fonts, %zu/%zu/%zu bytes.", memory.num_fonts, memory.programs, memory.metrics, memory.caches);
+  else
+    testEnd(true);
+
+  return (status);
+}
+
+//
+// 'test_image_convert()' - Test image row conversion kernels against the scalar reference.
+//
+
+static int
+test_image_convert(void)
+{
+  static const char * const kernels[PDFRIP_CONVERT_MAX] =
+  {					// Kernel names
+    "gray1", "gray8", "rgb8", "cmyk8", "rgb16"
+  };
+  static const char * const simds[] =	// Instruction set names
+  {
+    "scalar", "sse2", "avx2"
+  };
+  static const uint8_t cmyk[8] = { 0, 255, 0, 0, 0, 0, 0, 128 };
+					// Magenta and half black
+  uint8_t		gray[2] = { 255, 0 },
+					// Inverted 1-bit gray
+			*src;		// Random samples
+  uint32_t		expected[70],
+			got[70];	// Pixels
+  uint8_t		expected_a8[70],
+			got_a8[70];	// Coverage
+  pdfrip_convert_cb_t	reference,	// Scalar kernel
+			convert;	// Vector kernel
+  pdfrip_expand_cb_t	expand;		// Vector mask kernel
+  int			status = 0;
+
+  testBegin("image_convert_func(cmyk8, scalar)");
+  image_convert_func(PDFRIP_CONVERT_CMYK8, PDFRIP_SIMD_NONE)(cmyk, got, 2, NULL);
+  if (got[0] == 0xffff00ff && got[1] == 0xff7f7f7f) testEnd(true);
+  else status = 1, testEndMessage(false, "got %08x %08x", got[0], got[1]);
+
+  // Random samples, with room for the widest kernel and no more
+  if ((src = malloc(6 * 70)) == NULL)
+    return (1);
+
+  srand(45);
+  for (int i = 0; i < 6 * 70; i ++)
+    src[i] = (uint8_t)rand();
+
+  for (int simd = PDFRIP_SIMD_SSE2; simd <= PDFRIP_SIMD_AVX2; simd ++)
+  {
+    for (int kernel = 0; kernel < PDFRIP_CONVERT_MAX; kernel ++)
+    {
+      int width;			// Pixels per row
+
+      if ((convert = image_convert_func((pdfrip_convert_t)kernel, (pdfrip_simd_t)simd)) == NULL)
+        continue;
+
+      testBegin("image_convert_func(%s, %s)", kernels[kernel], simds[simd]);
+      reference = image_convert_func((pdfrip_convert_t)kernel, PDFRIP_SIMD_NONE);
+
+      // Every width up to 70 covers the vector loops and their tails
+      for (width = 0; width <= 70; width ++)
+      {
+        memset(expected, 0, sizeof(expected));
+        memset(got, 0, sizeof(got));
+
+        (reference)(src, expected, (size_t)width, gray);
+        (convert)(src, got, (size_t)width, gray);
+
+        if (memcmp(expected, got, sizeof(got)))
+          break;
+      }
+
+      if (width > 70) testEnd(true);
+      else status = 1, testEndMessage(false, "Differs from the scalar kernel at width %d", width);
+    }
+
+    if ((expand = image_expand_func((pdfrip_simd_t)simd)) != NULL)
+    {
+      int width;			// Pixels per row
+
+      testBegin("image_expand_func(%s)", simds[simd]);
+
+      for (width = 0; width <= 70; width ++)
+      {
+        memset(expected_a8, 0, sizeof(expected_a8));
+        memset(got_a8, 0, sizeof(got_a8));
+
+        (image_expand_func(PDFRIP_SIMD_NONE))(src, expected_a8, (size_t)width, gray);
+        (expand)(src, got_a8, (size_t)width, gray);
+
+        if (memcmp(expected_a8, got_a8, sizeof(got_a8)))
+          break;
+      }
+
+      if (width > 70) testEnd(true);
+      else status = 1, testEndMessage(false, "Differs from the scalar kernel at width %d", width);
+    }
+  }
+
+  free(src);
+
+  return (status);
+}
+
+//
+// 'test_image_shrink()' - Test the box filter for oversampled images.
+//
+
+static int
+test_image_shrink(void)
+{
+  static const char * const simds[] =	// Instruction set names
+  {
+    "scalar", "sse2", "avx2"
+  };
+  static const uint32_t pixels[3][3] =	// 3x3 image
+  {
+    { 0x00000000, 0xffffffff, 0x80808080 },
+    { 0xffffffff, 0xffffffff, 0x40404040 },
+    { 0x10101010, 0x30303030, 0x02020202 }
+  };
+  static const uint32_t shrunk[2][2] =	// Same image reduced 2x2
+  {
+    { 0xbfbfbfbf, 0x60606060 },
+    { 0x20202020, 0x02020202 }
+  };
+  static const int factors[][2] =	// Reductions compared with the scalar kernels
+  {
+    { 2, 2 }, { 3, 2 }, { 2, 5 }, { 7, 3 }, { 16, 1 }, { 1, 9 }
+  };
+  cairo_surface_t	*src,		// Source image
+			*expected,	// Scalar reduction
+			*got;		// Vector reduction
+  uint8_t		*data;		// Source pixels
+  int			stride,		// Bytes per source row
+			x, y;		// Current pixel
+  int			status = 0;
+
+  testBegin("image_shrink(2x2, scalar)");
+  src    = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 3, 3);
+  data   = cairo_image_surface_get_data(src);
+  stride = cairo_image_surface_get_stride(src);
+
+  for (y = 0; y < 3; y ++)
+    memcpy(data + y * stride, pixels[y], sizeof(pixels[y]));
+  cairo_surface_mark_dirty(src);
+
+  if ((got = image_shrink(src, 2, 2, PDFRIP_SIMD_NONE)) == NULL)
+  {
+    status = 1, testEnd(false);
+  }
+  else
+  {
+    for (y = 0; y < 2; y ++)
+    {
+      if (memcmp(cairo_image_surface_get_data(got) + y * cairo_image_surface_get_stride(got), shrunk[y], sizeof(shrunk[y])))
+        break;
+    }
+
+    if (cairo_image_surface_get_width(got) != 2 || cairo_image_surface_get_height(got) != 2)
+      status = 1, testEndMessage(false, "Got %dx%d", cairo_image_surface_get_width(got), cairo_image_surface_get_height(got));
+    else if (y < 2)
+      status = 1, testEndMessage(false, "Row %d differs", y);
+    else
+      testEnd(true);
+
+    cairo_surface_destroy(got);
+  }
+
+  cairo_surface_destroy(src);
+
+  // Random pixels, with edge blocks in both directions
+  src    = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 67, 23);
+  data   = cairo_image_surface_get_data(src);
+  stride = cairo_image_surface_get_stride(src);
+
+  srand(50);
+  for (y = 0; y < 23; y ++)
+  {
+    for (x = 0; x < 67 * 4; x ++)
+      data[y * stride + x] = (uint8_t)rand();
+  }
+  cairo_surface_mark_dirty(src);
+
+  for (int simd = PDFRIP_SIMD_SSE2; simd <= PDFRIP_SIMD_AVX2 && simd <= image_simd_level(); simd ++)
+  {
+    size_t i;				// Current reduction
+
+    testBegin("image_shrink(%s)", simds[simd]);
+
+    for (i = 0; i < sizeof(factors) / sizeof(factors[0]); i ++)
+    {
+      bool same;			// Same pixels?
+
+      expected = image_shrink(src, factors[i][0], factors[i][1], PDFRIP_SIMD_NONE);
+      got      = image_shrink(src, factors[i][0], factors[i][1], (pdfrip_simd_t)simd);
+      same     = expected && got;
+
+      for (y = 0; same && y < cairo_image_surface_get_height(got); y ++)
+        same = !memcmp(cairo_image_surface_get_data(expected) + y * cairo_image_surface_get_stride(expected), cairo_image_surface_get_data(got) + y * cairo_image_surface_get_stride(got), (size_t)cairo_image_surface_get_width(got) * 4);
+
+      cairo_surface_destroy(expected);
+      cairo_surface_destroy(got);
+
+      if (!same)
+        break;
+    }
+
+    if (i < sizeof(factors) / sizeof(factors[0]))
+      status = 1, testEndMessage(false, "%dx%d reduction differs from the scalar kernels", factors[i][0], factors[i][1]);
+    else
+      testEnd(true);
+  }
+
+  cairo_surface_destroy(src);
+
+  return (status);
+}
+
+//
+// 'ccitt_stream_read()' - Read raw CCITT data from a PDF stream.
+//
+
+static ssize_t				  // O - Bytes read
+ccitt_stream_read(void    *data,	// I - Stream
+		  uint8_t *buffer,	// I - Buffer
+		  size_t  bytes)	// I - Size of buffer
+{
+  return (pdfioStreamRead((pdfio_stream_t *)data, buffer, bytes));
+}
+
+//
+// 'test_ccitt()' - Test the CCITT fax decoder against Flate copies of the same images.
+//
+// Each page of CCITTFax.pdf shows a /Fax image, encoded by libtiff, over a
+// /Ref image with the same samples.
+//
+
+static int
+test_ccitt(void)
+{
+  pdfrip_doc_t	*doc;
+  int		status = 0;
+
+  testBegin("Open CCITTFax.pdf");
+  if ((doc = openPDFfile("testfiles/input/xobject/CCITTFax.pdf")) == NULL)
+  {
+    testEnd(false);
+    return (1);
+  }
+  testEnd(true);
+
+  for (size_t i = 0; i < doc->num_pages; i ++)
+  {
+    pdfrip_page_t	*page = getPageData(doc, i);
+    pdfio_dict_t	*xobjects;	// XObject resources
+    pdfio_obj_t		*fax, *ref;	// CCITT and reference images
+    pdfio_stream_t	*fax_st, *ref_st;
+					// Image data
+    pdfrip_ccitt_params_t params;	// Decoding parameters
+    pdfrip_ccitt_t	*ccitt;		// Decoder
+    uint8_t		row[256],	// Decoded row
+			expected[256];	// Reference row
+    size_t		row_bytes;	// Bytes per row
+    int			y = 0;		// Current row
+
+    xobjects = page ? pdfioDictGetDict(page->resources_dict, "XObject") : NULL;
+    fax      = pdfioDictGetObj(xobjects, "Fax");
+    ref      = pdfioDictGetObj(xobjects, "Ref");
+
+    ccitt_get_params(pdfioObjGetDict(fax), &params);
+    row_bytes = ((size_t)params.columns + 7) / 8;
+
+    testBegin("ccitt_read_row(K=%d, %dx%d)", params.k, params.columns, params.rows);
+
+    if (!fax || !ref || row_bytes > sizeof(row))
+    {
+      status = 1, testEndMessage(false, "Missing images on page %zu", i + 1);
+      freePageData(page);
+      continue;
+    }
+
+    fax_st = pdfioObjOpenStream(fax, false);
+    ref_st = pdfioObjOpenStream(ref, true);
+    ccitt  = fax_st ? ccitt_open(&params, ccitt_stream_read, fax_st) : NULL;
+
+    if (ccitt && ref_st)
+    {
+      for (; y < params.rows; y ++)
+      {
+        size_t total = 0;		// Reference bytes read
+        ssize_t bytes;			// Bytes in this read
+
+        while (total < row_bytes && (bytes = pdfioStreamRead(ref_st, expected + total, row_bytes - total)) > 0)
+          total += (size_t)bytes;
+
+        if (total < row_bytes || !ccitt_read_row(ccitt, row) || memcmp(row, expected, row_bytes))
+          break;
+      }
+    }
+
+    if (!ccitt || !ref_st)
+      status = 1, testEndMessage(false, "Unable to open image data");
+    else if (y < params.rows)
+      status = 1, testEndMessage(false, "Row %d differs", y);
+    else if (ccitt_read_row(ccitt, row))
+      status = 1, testEndMessage(false, "Got rows past the end of the data");
+    else
+      testEnd(true);
+
+    ccitt_close(ccitt);
+    if (fax_st)
+      pdfioStreamClose(fax_st);
+    if (ref_st)
+      pdfioStreamClose(ref_st);
+    freePageData(page);
+  }
+
+  freePDFdoc(doc);
+
+  return (status);
+}
+
+//
+// 'test_jpx()' - Test reduced resolution and area decoding of JPEG 2000 images.
+//
+// Im0 in JPXImages.pdf is a 640x400 JP2 image with five resolution levels.
+//
+
+static int
+test_jpx(void)
+{
+#ifdef HAVE_OPENJPEG
+  pdfrip_doc_t		*doc;		// Document
+  pdfrip_page_t		*page;		// First page
+  pdfio_obj_t		*obj;		// Image object
+  pdfrip_jpx_t		*jpx;		// Decoder
+  pdfrip_jpx_info_t	info;		// Decoded size
+  static const pdfio_rect_t area = { 0.0, 0.0, 0.25, 0.25 };
+					// Top left corner of the image
+  uint8_t		row[640 * 3],	// Decoded row
+			zero[640 * 3];	// Row of zeros
+  int			y;		// Current row
+  int			status = 0;
+
+  testBegin("Open JPXImages.pdf");
+  if ((doc = openPDFfile("testfiles/input/xobject/JPXImages.pdf")) == NULL)
+  {
+    testEnd(false);
+    return (1);
+  }
+  testEnd(true);
+
+  page = getPageData(doc, 0);
+  obj  = page ? pdfioDictGetObj(pdfioDictGetDict(page->resources_dict, "XObject"), "Im0") : NULL;
+  memset(zero, 0, sizeof(zero));
+
+  testBegin("jpx_open(scale=1)");
+  if ((jpx = jpx_open(obj, 3, 1, NULL, &info)) == NULL)
+    status = 1, testEnd(false);
+  else if (info.width != 640 || info.height != 400 || info.num_components != 3 || info.scale != 1)
+    status = 1, testEndMessage(false, "Got %dx%dx%d at 1/%d", info.width, info.height, info.num_components, info.scale);
+  else
+    testEnd(true);
+  jpx_close(jpx);
+
+  testBegin("jpx_open(scale=4)");
+  if ((jpx = jpx_open(obj, 3, 4, NULL, &info)) == NULL)
+  {
+    status = 1, testEnd(false);
+  }
+  else
+  {
+    for (y = 0; y < info.height && jpx_read_row(jpx, row); y ++);
+
+    if (info.width != 160 || info.height != 100 || info.scale != 4)
+      status = 1, testEndMessage(false, "Got %dx%d at 1/%d", info.width, info.height, info.scale);
+    else if (y < info.height)
+      status = 1, testEndMessage(false, "Row %d missing", y);
+    else
+      testEnd(true);
+  }
+  jpx_close(jpx);
+
+  testBegin("jpx_open(area=[0 0 0.25 0.25])");
+  if ((jpx = jpx_open(obj, 3, 1, &area, &info)) == NULL)
+  {
+    status = 1, testEnd(false);
+  }
+  else
+  {
+    bool	inside = false,		// Got pixels inside the area?
+		outside = false;	// Got pixels outside the area?
+
+    for (y = 0; y < info.height && jpx_read_row(jpx, row); y ++)
+    {
+      if (y == 0)
+        inside = memcmp(row, zero, 3) != 0;
+      if (y > 110)
+        outside |= memcmp(row, zero, sizeof(row)) != 0;
+      else
+        outside |= memcmp(row + 170 * 3, zero, sizeof(row) - 170 * 3) != 0;
+    }
+
+    if (info.width != 640 || info.height != 400 || y < info.height)
+      status = 1, testEndMessage(false, "Got %d rows of %dx%d", y, info.width, info.height);
+    else if (!inside)
+      status = 1, testEndMessage(false, "No pixels inside the area");
+    else if (outside)
+      status = 1, testEndMessage(false, "Got pixels outside the area");
+    else
+      testEnd(true);
+  }
+  jpx_close(jpx);
+
+  freePageData(page);
+  freePDFdoc(doc);
+
+  return (status);
+#else
+  return (0);
+#endif // HAVE_OPENJPEG
+}
+
+//
+// Thread stress test state
+//
+
+#define STRESS_THREADS	8		// Number of threads
+#define STRESS_ROUNDS	4		// Passes over the document per thread
+
+typedef struct stress_s
+{
+  const char	*filename;		// PDF file
+  bool		extract;		// Extract text instead of rendering?
+  const char	*expected;		// Expected text, NULL when rendering
+  char		*text;			// Extracted text
+  bool		ok;			// Did every pass succeed?
+} stress_t;
+
+
+//
+// 'stress_document()' - Render or extract every page of a document.
+//
+
+static bool				  // O - true on success
+stress_document(const char *filename,	// I - PDF file
+		bool       extract,	// I - Extract text?
+		char       **text)	// O - Extracted text or NULL
+{
+  pdfrip_doc_t	*doc;
+  FILE		*fp = NULL;
+  size_t	textsize;
+  bool		ok = true;
+
+  if ((doc = openPDFfile((char *)filename)) == NULL)
+    return (false);
+
+  if (text && (fp = open_memstream(text, &textsize)) == NULL)
+  {
+    freePDFdoc(doc);
+    return (false);
+  }
+
+  for (size_t i = 0; ok && i < doc->num_pages; i ++)
+  {
+    pdfrip_page_t	*page = getPageData(doc, i);
+    p2c_device_t	*dev;
+
+    if (!page)
+    {
+      ok = false;
+      break;
+    }
+
+    if ((dev = extract ? device_create_text(page, 72) : device_create(page, 72)) == NULL)
+    {
+      freePageData(page);
+      ok = false;
+      break;
+    }
+
+    if (page->resources_dict)
+    {
+      pdfio_obj_t *font_obj = pdfioDictGetObj(page->resources_dict, "Font");
+      pdfio_obj_t *xobject_obj = pdfioDictGetObj(page->resources_dict, "XObject");
+
+      dev->font_dict = font_obj ? pdfioObjGetDict(font_obj) : pdfioDictGetDict(page->resources_dict, "Font");
+      dev->xobject_dict = xobject_obj ? pdfioObjGetDict(xobject_obj) : NULL;
+    }
+
+    if (!getPageFonts(dev))
+      ok = false;
+    else
+      process_content_stream(dev, page);
+
+    if (fp)
+      device_write_text(dev, fp, P2C_TEXT_PLAIN, i + 1);
+
+    device_destroy(dev);
+    freePageData(page);
+  }
+
+  if (fp)
+    fclose(fp);
+
+  freePDFdoc(doc);
+
+  return (ok);
+}
+
+//
+// 'stress_thread()' - Run one thread of the stress test.
+//
+
+static void *				  // O - Thread state
+stress_thread(void *data)		// I - Thread state
+{
+  stress_t *stress = (stress_t *)data;
+
+  stress->ok = true;
+
+  for (int i = 0; stress->ok && i < STRESS_ROUNDS; i ++)
+  {
+    char *text = NULL;
+
+    if (!stress_document(stress->filename, stress->extract, stress->extract ? &text : NULL))
+      stress->ok = false;
+    else if (stress->expected && (!text || strcmp(text, stress->expected)))
+      stress->ok = false;
+
+    free(stress->text);
+    stress->text = text;
+  }
+
+  return (stress);
+}
+
+//
+// 'face_thread()' - Open and use substitute faces from one thread.
+//
+
+static void *				  // O - NULL on success, non-NULL on error
+face_thread(void *data)			// I - Unused
+{
+  static const char * const names[] = { "Helvetica", "Helvetica-Bold", "Times-Roman", "Courier", "ArialMT" };
+
+  for (int i = 0; i < 50; i ++)
+  {
+    const unsigned char	*fdata;
+    size_t		fsize;
+    int			findex;
+    FT_Face		face;
+
+    if (!fontsub_get(names[i % 5], 0, NULL, &fdata, &fsize, &findex) ||
+        p2c_font_new_face(fdata, fsize, findex, &face))
+      return (data);
+
+    FT_Set_Char_Size(face, 0, 12 * 64, 72, 72);
+    for (FT_ULong ch = 'A'; ch <= 'Z'; ch ++)
+      FT_Load_Char(face, ch, FT_LOAD_DEFAULT);
+
+    p2c_font_done_face(face);
+  }
+
+  return (NULL);
+}
+
+//
+// 'test_threads()' - Render and extract text pages from several threads.
+//
+
+static int
+test_threads(void)
+{
+  static const char	*filename = "testfiles/input/full_pdf/test_file_4pg.pdf";
+  pthread_t		threads[STRESS_THREADS];
+  stress_t		stress[STRESS_THREADS];
+  char			*expected = NULL;
+  const unsigned char	*fdata;
+  size_t		fsize;
+  int			findex, i, status = 0;
+  void			*result;
+
+  testBegin("Font faces from %d threads", STRESS_THREADS);
+  if (!fontsub_get("Helvetica", 0, NULL, &fdata, &fsize, &findex))
+  {
+    testEndMessage(true, "skipped, no substitute fonts installed");
+  }
+  else
+  {
+    for (i = 0; i < STRESS_THREADS; i ++)
+      pthread_create(threads + i, NULL, face_thread, &status);
+
+    for (i = 0; i < STRESS_THREADS; i ++)
+    {
+      pthread_join(threads[i], &result);
+      if (result)
+        status = 1;
+    }
+
+    if (status)
+      testEndMessage(false, "A thread could not open or use a face.");
+    else
+      testEnd(true);
+  }
+
+  testBegin("Render and extract %s from %d threads", filename, STRESS_THREADS);
+  if (!stress_document(filename, true, &expected))
+  {
+    testEndMessage(true, "skipped, unable to process the document");
+    free(expected);
+    return (status);
+  }
+
+  memset(stress, 0, sizeof(stress));
+
+  for (i = 0; i < STRESS_THREADS; i ++)
+  {
+    stress[i].filename = filename;
+    stress[i].extract  = (i & 1) != 0;
+    stress[i].expected = stress[i].extract ? expected : NULL;
+
+    pthread_create(threads + i, NULL, stress_thread, stress + i);
+  }
+
+  for (i = 0; i < STRESS_THREADS; i ++)
+    pthread_join(threads[i], NULL);
+
+  for (i = 0; i < STRESS_THREADS; i ++)
+  {
+    if (!stress[i].ok)
+      break;
+  }
+
+  if (i < STRESS_THREADS)
+    status = 1, testEndMessage(false, "Thread %d failed or extracted different text.", i);
+  else
+    testEnd(true);
+
+  for (i = 0; i < STRESS_THREADS; i ++)
+    free(stress[i].text);
+
+  free(expected);
+
+  return (status);
+}
+
 // Main()
 int main(void)
 {
   int status = 0;
   char command[2048];
 
+  puts(" --- Running PDF2Cairo Unit Tests --- ");
+  status |= test_glyph_names();
+  status |= test_cmap();
+  status |= test_font_substitution();
+  status |= test_outline_cache();
+  status |= test_glyph_cache();
+  status |= test_font_memory();
+  status |= test_image_convert();
+  status |= test_image_shrink();
+  status |= test_ccitt();
+  status |= test_jpx();
+  status |= test_text_extraction();
+  status |= test_threads();
+
   puts(" --- Running PDF2Cairo Renderer Tests --- ");
 
   // Create the output directory